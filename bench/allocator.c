@@ -0,0 +1,386 @@
+//========================================================================
+// vku device memory allocator benchmark
+//------------------------------------------------------------------------
+// Measures the allocation throughput of VkuAllocator against calling
+// vkAllocateMemory() per resource, and the fragmentation it ends up with
+// after a long run of random allocations and frees, as reported by
+// VkuAllocatorStatistics.
+//
+// Build (from the root of the repository):
+//
+//     cc -O2 -std=c99 -I. bench/allocator.c -o vku-allocator -lvulkan -lpthread
+//
+// Run, e.g. on a machine without a GPU, against Mesa's software driver:
+//
+//     VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./vku-allocator [allocations] [rounds]
+//
+// Each benchmark is written to stdout as a line of JSON. The allocation
+// sizes are random (log-uniform from 256 bytes to 1 MiB) with random
+// power of two alignments, and are the same for every run.
+//========================================================================
+
+#ifndef _WIN32
+// For CLOCK_MONOTONIC with -std=c99
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <vulkan/vulkan.h>
+#include "vku.h"
+
+
+#define BENCH_DEFAULT_ALLOCATION_COUNT 4096
+#define BENCH_DEFAULT_ROUND_COUNT 16
+
+#define BENCH_MIN_SIZE_LOG2 8
+#define BENCH_MAX_SIZE_LOG2 20
+
+
+typedef struct bench_context
+{
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	// All the memory types, as if every resource could go anywhere
+	uint32_t memoryTypeBits;
+
+	uint32_t allocationCount;
+	VkMemoryRequirements *requirements;
+} bench_context;
+
+
+// xorshift32, such that every run allocates the same sizes
+static uint32_t bench_random(uint32_t *state)
+{
+	uint32_t x = (*state);
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return (*state) = x;
+}
+
+static void bench_randomRequirements(bench_context *context, uint32_t *state, VkMemoryRequirements *requirements)
+{
+	const uint32_t sizeLog2 = BENCH_MIN_SIZE_LOG2 + bench_random(state) % (BENCH_MAX_SIZE_LOG2 - BENCH_MIN_SIZE_LOG2);
+	const VkDeviceSize size = 1ull << sizeLog2;
+
+	requirements->size = size + bench_random(state) % size;
+	requirements->alignment = 1ull << (4 + bench_random(state) % 9);
+	requirements->memoryTypeBits = context->memoryTypeBits;
+}
+
+
+static void bench_printStatistics(const VkuAllocatorStatistics *statistics)
+{
+	uint32_t blockCount = 0;
+	uint32_t dedicatedAllocationCount = 0;
+	VkDeviceSize allocatedSize = 0;
+	VkDeviceSize usedSize = 0;
+
+	for (uint32_t heapIndex = 0; heapIndex < statistics->memoryHeapCount; heapIndex++)
+	{
+		blockCount += statistics->heaps[heapIndex].blockCount;
+		dedicatedAllocationCount += statistics->heaps[heapIndex].dedicatedAllocationCount;
+		allocatedSize += statistics->heaps[heapIndex].allocatedSize;
+		usedSize += statistics->heaps[heapIndex].usedSize;
+	}
+
+	// The share of the allocated VkDeviceMemory which isn't used by any allocation
+	const double fragmentation = allocatedSize ? (1.0 - (double) usedSize / (double) allocatedSize) : 0.0;
+
+	printf(",\"blocks\":%u,\"dedicatedAllocations\":%u,\"deviceMemoryCount\":%u,"
+		"\"allocatedBytes\":%llu,\"usedBytes\":%llu,\"fragmentation\":%.4f",
+		blockCount, dedicatedAllocationCount, statistics->deviceMemoryCount,
+		(unsigned long long) allocatedSize, (unsigned long long) usedSize, fragmentation);
+}
+
+
+// One vkAllocateMemory() per resource, limited by maxMemoryAllocationCount
+static void bench_vkAllocateMemory(bench_context *context, uint32_t roundCount)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(context->physicalDevice, &properties);
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(context->physicalDevice, &memoryProperties);
+
+	// Leave some room for the loader and driver
+	uint32_t allocationCount = context->allocationCount;
+
+	if (allocationCount > properties.limits.maxMemoryAllocationCount / 2)
+		allocationCount = properties.limits.maxMemoryAllocationCount / 2;
+
+	VkDeviceMemory *memories = (VkDeviceMemory*) calloc(allocationCount, sizeof(VkDeviceMemory));
+
+	if (!memories)
+		return;
+
+
+	uint64_t allocateTime = 0;
+	uint64_t freeTime = 0;
+	uint32_t failureCount = 0;
+
+	for (uint32_t round = 0; round < roundCount; round++)
+	{
+		uint64_t start = vku_getTime();
+
+		for (uint32_t allocationIndex = 0; allocationIndex < allocationCount; allocationIndex++)
+		{
+			const VkMemoryRequirements *requirements = &context->requirements[allocationIndex];
+
+			VkMemoryAllocateInfo allocateInfo;
+			memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+			allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocateInfo.allocationSize = requirements->size;
+
+			if (vkuFindMemoryTypeIndex(&memoryProperties, requirements->memoryTypeBits, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocateInfo.memoryTypeIndex) ||
+				vkAllocateMemory(context->device, &allocateInfo, NULL, &memories[allocationIndex]))
+			{
+				memories[allocationIndex] = VK_NULL_HANDLE;
+				failureCount++;
+			}
+		}
+
+		allocateTime += vku_getTime() - start;
+		start = vku_getTime();
+
+		for (uint32_t allocationIndex = 0; allocationIndex < allocationCount; allocationIndex++)
+			vkFreeMemory(context->device, memories[allocationIndex], NULL);
+
+		freeTime += vku_getTime() - start;
+	}
+
+	free(memories);
+
+
+	const double operationCount = (double) allocationCount * roundCount;
+
+	printf("{\"name\":\"vkAllocateMemory\",\"allocations\":%u,\"rounds\":%u,\"failures\":%u,"
+		"\"allocationsPerSecond\":%.0f,\"freesPerSecond\":%.0f}\n",
+		allocationCount, roundCount, failureCount,
+		allocateTime ? operationCount * 1e9 / allocateTime : 0.0, freeTime ? operationCount * 1e9 / freeTime : 0.0);
+
+	fflush(stdout);
+}
+
+// Allocates all the sizes and then frees them, blocks are reused between the rounds. The
+// fragmentation is the one with all the allocations alive in the last round.
+static void bench_vkuAllocateMemory(bench_context *context, VkuAllocator allocator, uint32_t roundCount)
+{
+	VkuAllocation *allocations = (VkuAllocation*) calloc(context->allocationCount, sizeof(VkuAllocation));
+
+	if (!allocations)
+		return;
+
+
+	VkuAllocationCreateInfo createInfo;
+	memset(&createInfo, 0, sizeof(createInfo));
+
+	createInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	createInfo.linear = VK_TRUE;
+
+	VkuAllocatorStatistics statistics;
+
+	uint64_t allocateTime = 0;
+	uint64_t freeTime = 0;
+	uint32_t failureCount = 0;
+
+	for (uint32_t round = 0; round < roundCount; round++)
+	{
+		uint64_t start = vku_getTime();
+
+		for (uint32_t allocationIndex = 0; allocationIndex < context->allocationCount; allocationIndex++)
+		{
+			if (vkuAllocateMemory(allocator, &context->requirements[allocationIndex], &createInfo, &allocations[allocationIndex]))
+				failureCount++;
+		}
+
+		allocateTime += vku_getTime() - start;
+
+		vkuGetAllocatorStatistics(allocator, &statistics);
+
+		start = vku_getTime();
+
+		for (uint32_t allocationIndex = 0; allocationIndex < context->allocationCount; allocationIndex++)
+			vkuFreeMemory(allocator, allocations[allocationIndex]);
+
+		freeTime += vku_getTime() - start;
+	}
+
+	free(allocations);
+
+
+	const double operationCount = (double) context->allocationCount * roundCount;
+
+	printf("{\"name\":\"vkuAllocateMemory\",\"allocations\":%u,\"rounds\":%u,\"failures\":%u,"
+		"\"allocationsPerSecond\":%.0f,\"freesPerSecond\":%.0f",
+		context->allocationCount, roundCount, failureCount,
+		allocateTime ? operationCount * 1e9 / allocateTime : 0.0, freeTime ? operationCount * 1e9 / freeTime : 0.0);
+
+	bench_printStatistics(&statistics);
+	printf("}\n");
+
+	fflush(stdout);
+}
+
+// Keeps allocationCount allocations alive, and replaces a random one with a new random size
+// allocationCount times per round, which is what fragments the blocks over time
+static void bench_churn(bench_context *context, VkuAllocator allocator, uint32_t roundCount)
+{
+	VkuAllocation *allocations = (VkuAllocation*) calloc(context->allocationCount, sizeof(VkuAllocation));
+
+	if (!allocations)
+		return;
+
+
+	VkuAllocationCreateInfo createInfo;
+	memset(&createInfo, 0, sizeof(createInfo));
+
+	createInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	createInfo.linear = VK_TRUE;
+
+	uint32_t failureCount = 0;
+
+	for (uint32_t allocationIndex = 0; allocationIndex < context->allocationCount; allocationIndex++)
+	{
+		if (vkuAllocateMemory(allocator, &context->requirements[allocationIndex], &createInfo, &allocations[allocationIndex]))
+			failureCount++;
+	}
+
+
+	uint32_t state = 0x9e3779b9u;
+	const uint32_t operationCount = context->allocationCount * roundCount;
+
+	const uint64_t start = vku_getTime();
+
+	for (uint32_t operation = 0; operation < operationCount; operation++)
+	{
+		const uint32_t allocationIndex = bench_random(&state) % context->allocationCount;
+
+		VkMemoryRequirements requirements;
+		bench_randomRequirements(context, &state, &requirements);
+
+		vkuFreeMemory(allocator, allocations[allocationIndex]);
+
+		if (vkuAllocateMemory(allocator, &requirements, &createInfo, &allocations[allocationIndex]))
+			failureCount++;
+	}
+
+	const uint64_t time = vku_getTime() - start;
+
+	VkuAllocatorStatistics statistics;
+	vkuGetAllocatorStatistics(allocator, &statistics);
+
+
+	printf("{\"name\":\"churn\",\"allocations\":%u,\"rounds\":%u,\"failures\":%u,\"replacementsPerSecond\":%.0f",
+		context->allocationCount, roundCount, failureCount, time ? (double) operationCount * 1e9 / time : 0.0);
+
+	bench_printStatistics(&statistics);
+	printf("}\n");
+
+	fflush(stdout);
+
+
+	for (uint32_t allocationIndex = 0; allocationIndex < context->allocationCount; allocationIndex++)
+		vkuFreeMemory(allocator, allocations[allocationIndex]);
+
+	free(allocations);
+}
+
+
+int main(int argc, char **argv)
+{
+	bench_context context;
+	memset(&context, 0, sizeof(context));
+
+	context.allocationCount = BENCH_DEFAULT_ALLOCATION_COUNT;
+	uint32_t roundCount = BENCH_DEFAULT_ROUND_COUNT;
+
+	if (argc > 1)
+		context.allocationCount = (uint32_t) strtoul(argv[1], NULL, 10);
+
+	if (argc > 2)
+		roundCount = (uint32_t) strtoul(argv[2], NULL, 10);
+
+	if (context.allocationCount == 0)
+		context.allocationCount = 1;
+
+	if (roundCount == 0)
+		roundCount = 1;
+
+
+	VkInstance instance = VK_NULL_HANDLE;
+	uint32_t queueFamilyIndex;
+
+	VkResult err = vkuCreateSimpleInstance(VK_MAKE_VERSION(1, 0, 0), VK_FALSE, NULL, &instance);
+
+	if (!err)
+		err = vkuGetPhysicalDevice(instance, &context.physicalDevice);
+
+	if (!err && !vkuGetQueueFamilyIndex(context.physicalDevice, &queueFamilyIndex))
+		err = VK_ERROR_INITIALIZATION_FAILED;
+
+	if (!err)
+		err = vkuCreateSimpleDevice(VK_FALSE, NULL, context.physicalDevice, queueFamilyIndex, &context.device);
+
+	VkuAllocator allocator = VK_NULL_HANDLE;
+
+	if (!err)
+	{
+		VkuAllocatorCreateInfo createInfo;
+		memset(&createInfo, 0, sizeof(createInfo));
+
+		createInfo.physicalDevice = context.physicalDevice;
+		createInfo.device = context.device;
+
+		err = vkuCreateAllocator(&createInfo, &allocator);
+	}
+
+	context.requirements = (VkMemoryRequirements*) calloc(context.allocationCount, sizeof(VkMemoryRequirements));
+
+	if (!err && !context.requirements)
+		err = VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	if (err)
+	{
+		fprintf(stderr, "{\"error\":\"%s\"}\n", vkuGetResultString(err));
+
+		free(context.requirements);
+		vkuDestroyAllocator(allocator);
+
+		if (context.device)
+			vkDestroyDevice(context.device, NULL);
+
+		if (instance)
+			vkDestroyInstance(instance, NULL);
+
+		return 1;
+	}
+
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(context.physicalDevice, &memoryProperties);
+
+	context.memoryTypeBits = (memoryProperties.memoryTypeCount < 32) ? ((1u << memoryProperties.memoryTypeCount) - 1) : ~0u;
+
+	uint32_t state = 0x2545f491u;
+
+	for (uint32_t allocationIndex = 0; allocationIndex < context.allocationCount; allocationIndex++)
+		bench_randomRequirements(&context, &state, &context.requirements[allocationIndex]);
+
+
+	bench_vkAllocateMemory(&context, roundCount);
+	bench_vkuAllocateMemory(&context, allocator, roundCount);
+	bench_churn(&context, allocator, roundCount);
+
+
+	free(context.requirements);
+	vkuDestroyAllocator(allocator);
+
+	vkDestroyDevice(context.device, NULL);
+	vkDestroyInstance(instance, NULL);
+
+	return 0;
+}
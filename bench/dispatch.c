@@ -0,0 +1,278 @@
+//========================================================================
+// vku device dispatch benchmark
+//------------------------------------------------------------------------
+// Measures the cost of recording vkCmd* commands through the loader's
+// exported trampolines, against calling them through a VkuDeviceDispatch
+// loaded with vkuLoadDeviceDispatch(), which goes straight to the driver.
+// The commands are small state setting ones (vkCmdSetViewport,
+// vkCmdSetScissor and vkCmdPushConstants), so that the call overhead
+// isn't hidden behind the driver's own work. Nothing is submitted.
+//
+// Build (from the root of the repository):
+//
+//     cc -O2 -std=c99 -I. bench/dispatch.c -o vku-dispatch -lvulkan -lpthread
+//
+// Run, e.g. on a machine without a GPU, against Mesa's software driver:
+//
+//     VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./vku-dispatch [calls per command buffer] [rounds]
+//
+// The rounds alternate between the two ways of calling, and each is
+// written to stdout as a line of JSON, with the nanoseconds per call
+// counting only the recording, and for VkuDeviceDispatch the speedup
+// over the loader.
+//========================================================================
+
+#ifndef _WIN32
+// For CLOCK_MONOTONIC with -std=c99
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <vulkan/vulkan.h>
+#include "vku.h"
+
+
+#define BENCH_DEFAULT_CALL_COUNT 30000
+#define BENCH_DEFAULT_ROUND_COUNT 100
+
+// The size of the push constant range, which vkCmdPushConstants() updates entirely
+#define BENCH_PUSH_CONSTANT_SIZE 16
+
+
+typedef struct bench_context
+{
+	VkDevice device;
+	VkuDeviceDispatch dispatch;
+
+	VkCommandPool commandPool;
+	VkCommandBuffer commandBuffer;
+	VkPipelineLayout pipelineLayout;
+
+	// Each group records one of each command
+	uint32_t groupCount;
+	uint32_t roundCount;
+} bench_context;
+
+
+// Records the commands through the loader's trampolines, and returns the time it took in nanoseconds
+static VkResult bench_recordLoader(bench_context *context, uint64_t *time)
+{
+	VkCommandBufferBeginInfo beginInfo;
+	memset(&beginInfo, 0, sizeof(beginInfo));
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VkResult err = vkResetCommandPool(context->device, context->commandPool, 0);
+
+	if (!err)
+		err = vkBeginCommandBuffer(context->commandBuffer, &beginInfo);
+
+	if (err)
+		return err;
+
+
+	const VkCommandBuffer commandBuffer = context->commandBuffer;
+	uint32_t constants[BENCH_PUSH_CONSTANT_SIZE / sizeof(uint32_t)] = { 0 };
+
+	const uint64_t start = vku_getTime();
+
+	for (uint32_t groupIndex = 0; groupIndex < context->groupCount; groupIndex++)
+	{
+		const VkViewport viewport = { 0.0f, 0.0f, (float) (groupIndex % 4096 + 1), 1.0f, 0.0f, 1.0f };
+		const VkRect2D scissor = { { 0, 0 }, { groupIndex % 4096 + 1, 1 } };
+
+		constants[0] = groupIndex;
+
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		vkCmdPushConstants(commandBuffer, context->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, BENCH_PUSH_CONSTANT_SIZE, constants);
+	}
+
+	(*time) += vku_getTime() - start;
+
+	return vkEndCommandBuffer(commandBuffer);
+}
+
+// Records the same commands through the VkuDeviceDispatch
+static VkResult bench_recordDispatch(bench_context *context, uint64_t *time)
+{
+	const VkuDeviceDispatch *dispatch = &context->dispatch;
+
+	VkCommandBufferBeginInfo beginInfo;
+	memset(&beginInfo, 0, sizeof(beginInfo));
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VkResult err = VKU_DISPATCH(dispatch, vkResetCommandPool)(context->device, context->commandPool, 0);
+
+	if (!err)
+		err = VKU_DISPATCH(dispatch, vkBeginCommandBuffer)(context->commandBuffer, &beginInfo);
+
+	if (err)
+		return err;
+
+
+	const VkCommandBuffer commandBuffer = context->commandBuffer;
+	uint32_t constants[BENCH_PUSH_CONSTANT_SIZE / sizeof(uint32_t)] = { 0 };
+
+	const uint64_t start = vku_getTime();
+
+	for (uint32_t groupIndex = 0; groupIndex < context->groupCount; groupIndex++)
+	{
+		const VkViewport viewport = { 0.0f, 0.0f, (float) (groupIndex % 4096 + 1), 1.0f, 0.0f, 1.0f };
+		const VkRect2D scissor = { { 0, 0 }, { groupIndex % 4096 + 1, 1 } };
+
+		constants[0] = groupIndex;
+
+		VKU_DISPATCH(dispatch, vkCmdSetViewport)(commandBuffer, 0, 1, &viewport);
+		VKU_DISPATCH(dispatch, vkCmdSetScissor)(commandBuffer, 0, 1, &scissor);
+		VKU_DISPATCH(dispatch, vkCmdPushConstants)(commandBuffer, context->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, BENCH_PUSH_CONSTANT_SIZE, constants);
+	}
+
+	(*time) += vku_getTime() - start;
+
+	return VKU_DISPATCH(dispatch, vkEndCommandBuffer)(commandBuffer);
+}
+
+
+static void bench_print(const char *name, const bench_context *context, uint64_t time, uint64_t loaderTime)
+{
+	const double callCount = (double) context->groupCount * 3 * context->roundCount;
+
+	printf("{\"name\":\"%s\",\"callsPerCommandBuffer\":%u,\"rounds\":%u,\"recordNs\":%llu,\"nsPerCall\":%.2f",
+		name, context->groupCount * 3, context->roundCount, (unsigned long long) time, (double) time / callCount);
+
+	if (loaderTime)
+		printf(",\"speedupOverLoader\":%.2f", time ? (double) loaderTime / time : 0.0);
+
+	printf("}\n");
+
+	fflush(stdout);
+}
+
+
+int main(int argc, char **argv)
+{
+	bench_context context;
+	memset(&context, 0, sizeof(context));
+
+	uint32_t callCount = BENCH_DEFAULT_CALL_COUNT;
+	context.roundCount = BENCH_DEFAULT_ROUND_COUNT;
+
+	if (argc > 1)
+		callCount = (uint32_t) strtoul(argv[1], NULL, 10);
+
+	if (argc > 2)
+		context.roundCount = (uint32_t) strtoul(argv[2], NULL, 10);
+
+	context.groupCount = (callCount >= 3) ? callCount / 3 : 1;
+
+	if (context.roundCount == 0)
+		context.roundCount = 1;
+
+
+	VkInstance instance = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	uint32_t queueFamilyIndex = 0;
+
+	VkResult err = vkuCreateSimpleInstance(VK_MAKE_VERSION(1, 0, 0), VK_FALSE, NULL, &instance);
+
+	if (!err)
+		err = vkuGetPhysicalDevice(instance, &physicalDevice);
+
+	if (!err && !vkuGetQueueFamilyIndex(physicalDevice, &queueFamilyIndex))
+		err = VK_ERROR_INITIALIZATION_FAILED;
+
+	if (!err)
+		err = vkuCreateSimpleDevice(VK_FALSE, NULL, physicalDevice, queueFamilyIndex, &context.device);
+
+	if (!err)
+		err = vkuLoadDeviceDispatch(context.device, &context.dispatch);
+
+	if (!err)
+	{
+		VkCommandPoolCreateInfo commandPoolCreateInfo;
+		memset(&commandPoolCreateInfo, 0, sizeof(commandPoolCreateInfo));
+
+		commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+		err = vkCreateCommandPool(context.device, &commandPoolCreateInfo, NULL, &context.commandPool);
+	}
+
+	if (!err)
+	{
+		VkCommandBufferAllocateInfo allocateInfo;
+		memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = context.commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+
+		err = vkAllocateCommandBuffers(context.device, &allocateInfo, &context.commandBuffer);
+	}
+
+	if (!err)
+	{
+		VkPushConstantRange pushConstantRange;
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = BENCH_PUSH_CONSTANT_SIZE;
+
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+		memset(&pipelineLayoutCreateInfo, 0, sizeof(pipelineLayoutCreateInfo));
+
+		pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+		err = vkCreatePipelineLayout(context.device, &pipelineLayoutCreateInfo, NULL, &context.pipelineLayout);
+	}
+
+
+	// A round of each first, such that neither pays for the first use of the driver's command memory
+	uint64_t loaderTime = 0;
+	uint64_t dispatchTime = 0;
+
+	if (!err)
+		err = bench_recordLoader(&context, &loaderTime);
+
+	if (!err)
+		err = bench_recordDispatch(&context, &dispatchTime);
+
+	loaderTime = 0;
+	dispatchTime = 0;
+
+	for (uint32_t round = 0; !err && (round < context.roundCount); round++)
+	{
+		err = bench_recordLoader(&context, &loaderTime);
+
+		if (!err)
+			err = bench_recordDispatch(&context, &dispatchTime);
+	}
+
+	if (err)
+		fprintf(stderr, "{\"error\":\"%s\"}\n", vkuGetResultString(err));
+	else
+	{
+		bench_print("loader", &context, loaderTime, 0);
+		bench_print("VkuDeviceDispatch", &context, dispatchTime, loaderTime);
+	}
+
+
+	if (context.pipelineLayout)
+		vkDestroyPipelineLayout(context.device, context.pipelineLayout, NULL);
+
+	if (context.commandPool)
+		vkDestroyCommandPool(context.device, context.commandPool, NULL);
+
+	if (context.device)
+		vkDestroyDevice(context.device, NULL);
+
+	if (instance)
+		vkDestroyInstance(instance, NULL);
+
+	return err ? 1 : 0;
+}
@@ -0,0 +1,285 @@
+//========================================================================
+// vku host allocator benchmark
+//------------------------------------------------------------------------
+// Compares VkuHostAllocator's VkAllocationCallbacks against callbacks
+// which call plain malloc/realloc/free, with 1, 2, 4, ... threads each
+// running a mix of allocations, reallocations and frees like a driver
+// would make them. It needs no Vulkan device.
+//
+// Build (from the root of the repository):
+//
+//     cc -O2 -std=c99 -I. bench/host_allocator.c -o vku-host-allocator -lvulkan -lpthread
+//
+// Run:
+//
+//     ./vku-host-allocator [operations per thread] [max threads]
+//
+// Each allocator and thread count is written to stdout as a line of JSON,
+// with the operations per second summed across the threads, and for
+// VkuHostAllocator the speedup over malloc with as many threads.
+//========================================================================
+
+#ifndef _WIN32
+// For CLOCK_MONOTONIC with -std=c99
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <vulkan/vulkan.h>
+#include "vku.h"
+
+
+#define BENCH_DEFAULT_OPERATION_COUNT 1000000
+#define BENCH_DEFAULT_MAX_THREAD_COUNT 8
+
+// The allocations each thread keeps alive at most
+#define BENCH_SLOT_COUNT 1024
+
+#define BENCH_MIN_SIZE_LOG2 4
+#define BENCH_MAX_SIZE_LOG2 12
+
+// malloc only guarantees the alignment of the largest fundamental type, which is at least 8
+#define BENCH_ALIGNMENT 8
+
+
+typedef struct bench_thread
+{
+	vku_thread thread;
+
+	const VkAllocationCallbacks *allocationCallbacks;
+	uint32_t operationCount;
+	uint32_t seed;
+
+	// Set by the thread if an allocation failed
+	VkBool32 failed;
+} bench_thread;
+
+
+static void* VKAPI_PTR bench_mallocAllocation(void *pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+	(void) pUserData;
+	(void) alignment;
+	(void) allocationScope;
+
+	return malloc(size);
+}
+
+static void* VKAPI_PTR bench_mallocReallocation(void *pUserData, void *pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+	(void) pUserData;
+	(void) alignment;
+	(void) allocationScope;
+
+	return realloc(pOriginal, size);
+}
+
+static void VKAPI_PTR bench_mallocFree(void *pUserData, void *pMemory)
+{
+	(void) pUserData;
+
+	free(pMemory);
+}
+
+
+// xorshift32, such that every run makes the same calls
+static uint32_t bench_random(uint32_t *state)
+{
+	uint32_t x = (*state);
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return (*state) = x;
+}
+
+static size_t bench_randomSize(uint32_t *state)
+{
+	const uint32_t sizeLog2 = BENCH_MIN_SIZE_LOG2 + bench_random(state) % (BENCH_MAX_SIZE_LOG2 - BENCH_MIN_SIZE_LOG2);
+	const size_t size = ((size_t) 1) << sizeLog2;
+
+	return size + bench_random(state) % size;
+}
+
+
+// Picks a random slot, and frees it if it's taken, or otherwise allocates it. Every 16th operation
+// on a taken slot reallocates it instead. A quarter of the allocations are command scope, which
+// are short lived, and the rest are object scope.
+static void bench_threadMain(void *pThread)
+{
+	bench_thread *thread = (bench_thread*) pThread;
+
+	const VkAllocationCallbacks *callbacks = thread->allocationCallbacks;
+
+	void *slots[BENCH_SLOT_COUNT];
+	memset(slots, 0, sizeof(slots));
+
+	uint32_t state = thread->seed;
+
+	for (uint32_t operation = 0; operation < thread->operationCount; operation++)
+	{
+		const uint32_t random = bench_random(&state);
+		void **slot = &slots[random % BENCH_SLOT_COUNT];
+
+		const VkSystemAllocationScope scope = ((random >> 16) % 4 == 0) ? VK_SYSTEM_ALLOCATION_SCOPE_COMMAND : VK_SYSTEM_ALLOCATION_SCOPE_OBJECT;
+
+		if (!(*slot))
+		{
+			(*slot) = callbacks->pfnAllocation(callbacks->pUserData, bench_randomSize(&state), BENCH_ALIGNMENT, scope);
+
+			if (!(*slot))
+				thread->failed = VK_TRUE;
+			else
+				memset(*slot, 0, BENCH_ALIGNMENT);
+		}
+		else if ((random >> 24) % 16 == 0)
+		{
+			void *memory = callbacks->pfnReallocation(callbacks->pUserData, (*slot), bench_randomSize(&state), BENCH_ALIGNMENT, scope);
+
+			if (memory)
+				(*slot) = memory;
+			else
+				thread->failed = VK_TRUE;
+		}
+		else
+		{
+			callbacks->pfnFree(callbacks->pUserData, (*slot));
+			(*slot) = NULL;
+		}
+	}
+
+	for (uint32_t slotIndex = 0; slotIndex < BENCH_SLOT_COUNT; slotIndex++)
+		callbacks->pfnFree(callbacks->pUserData, slots[slotIndex]);
+}
+
+
+// Returns the wall time in nanoseconds, or 0 if a thread couldn't be started or an allocation failed
+static uint64_t bench_run(const VkAllocationCallbacks *allocationCallbacks, uint32_t threadCount, uint32_t operationCount)
+{
+	bench_thread *threads = (bench_thread*) calloc(threadCount, sizeof(bench_thread));
+
+	if (!threads)
+		return 0;
+
+
+	VkBool32 failed = VK_FALSE;
+	uint32_t startedThreadCount = 0;
+
+	const uint64_t start = vku_getTime();
+
+	for (uint32_t threadIndex = 0; threadIndex < threadCount; threadIndex++)
+	{
+		bench_thread *thread = &threads[threadIndex];
+
+		thread->allocationCallbacks = allocationCallbacks;
+		thread->operationCount = operationCount;
+		thread->seed = 0x9e3779b9u * (threadIndex + 1);
+
+		if (!vku_createThread(&thread->thread, bench_threadMain, thread))
+		{
+			failed = VK_TRUE;
+			break;
+		}
+
+		startedThreadCount++;
+	}
+
+	for (uint32_t threadIndex = 0; threadIndex < startedThreadCount; threadIndex++)
+	{
+		vku_joinThread(&threads[threadIndex].thread);
+
+		if (threads[threadIndex].failed)
+			failed = VK_TRUE;
+	}
+
+	const uint64_t time = vku_getTime() - start;
+
+	free(threads);
+
+	return failed ? 0 : time;
+}
+
+
+static void bench_print(const char *name, uint32_t threadCount, uint32_t operationCount, uint64_t time, uint64_t mallocTime)
+{
+	const double totalOperationCount = (double) operationCount * threadCount;
+
+	printf("{\"name\":\"%s\",\"threads\":%u,\"operationsPerThread\":%u,\"wallNs\":%llu,\"operationsPerSecond\":%.0f",
+		name, threadCount, operationCount, (unsigned long long) time, time ? totalOperationCount * 1e9 / time : 0.0);
+
+	if (mallocTime)
+		printf(",\"speedupOverMalloc\":%.2f", time ? (double) mallocTime / time : 0.0);
+
+	printf("}\n");
+
+	fflush(stdout);
+}
+
+
+int main(int argc, char **argv)
+{
+	uint32_t operationCount = BENCH_DEFAULT_OPERATION_COUNT;
+	uint32_t maxThreadCount = BENCH_DEFAULT_MAX_THREAD_COUNT;
+
+	if (argc > 1)
+		operationCount = (uint32_t) strtoul(argv[1], NULL, 10);
+
+	if (argc > 2)
+		maxThreadCount = (uint32_t) strtoul(argv[2], NULL, 10);
+
+	if (operationCount == 0)
+		operationCount = 1;
+
+	if (maxThreadCount == 0)
+		maxThreadCount = 1;
+
+
+	VkAllocationCallbacks mallocCallbacks;
+	memset(&mallocCallbacks, 0, sizeof(mallocCallbacks));
+
+	mallocCallbacks.pfnAllocation = bench_mallocAllocation;
+	mallocCallbacks.pfnReallocation = bench_mallocReallocation;
+	mallocCallbacks.pfnFree = bench_mallocFree;
+
+
+	VkuHostAllocator hostAllocator;
+
+	if (vkuCreateHostAllocator(NULL, &hostAllocator) != VK_SUCCESS)
+	{
+		fprintf(stderr, "{\"error\":\"vkuCreateHostAllocator\"}\n");
+		return 1;
+	}
+
+	VkAllocationCallbacks hostCallbacks;
+	vkuGetHostAllocationCallbacks(hostAllocator, &hostCallbacks);
+
+
+	int result = 0;
+
+	for (uint32_t threadCount = 1; threadCount <= maxThreadCount; )
+	{
+		const uint64_t mallocTime = bench_run(&mallocCallbacks, threadCount, operationCount);
+		const uint64_t hostTime = bench_run(&hostCallbacks, threadCount, operationCount);
+
+		if (!mallocTime || !hostTime)
+		{
+			fprintf(stderr, "{\"error\":\"failed with %u threads\"}\n", threadCount);
+
+			result = 1;
+			break;
+		}
+
+		bench_print("malloc", threadCount, operationCount, mallocTime, 0);
+		bench_print("VkuHostAllocator", threadCount, operationCount, hostTime, mallocTime);
+
+		// Powers of two, and the maximum itself
+		if ((threadCount < maxThreadCount) && ((threadCount * 2) > maxThreadCount))
+			threadCount = maxThreadCount;
+		else
+			threadCount *= 2;
+	}
+
+
+	vkuDestroyHostAllocator(hostAllocator);
+
+	return result;
+}
@@ -0,0 +1,341 @@
+//========================================================================
+// vku parallel pipeline builder benchmark
+//------------------------------------------------------------------------
+// Builds the same amount of compute pipelines with a VkuPipelineBuilder
+// of 1, 2, 4, ... worker threads, to show how the load time scales with
+// the amount of cores. Each pipeline specializes the same shader with a
+// different constant, such that none of them are cache hits.
+//
+// Build (from the root of the repository):
+//
+//     cc -O2 -std=c99 -I. bench/pipeline_builder.c -o vku-pipeline-builder -lvulkan -lpthread
+//
+// Run, e.g. on a machine without a GPU, against Mesa's software driver:
+//
+//     VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./vku-pipeline-builder [pipelines] [max threads]
+//
+// Each thread count is written to stdout as a line of JSON, with the wall
+// time, the pipelines per second and the speedup over a single thread.
+//========================================================================
+
+#ifndef _WIN32
+// For CLOCK_MONOTONIC with -std=c99
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <vulkan/vulkan.h>
+#include "vku.h"
+
+
+#define BENCH_DEFAULT_PIPELINE_COUNT 256
+#define BENCH_DEFAULT_MAX_THREAD_COUNT 16
+
+
+// #version 450
+// layout(local_size_x = 64) in;
+// layout(constant_id = 0) const uint SEED = 1;
+// layout(std430, binding = 0) buffer Data { uint values[]; };
+// void main() { uint i = gl_GlobalInvocationID.x; values[i] = values[i] * SEED + SEED; }
+static const uint32_t bench_shaderCode[] =
+{
+	0x07230203, 0x00010000, 0x00000000, 25, 0,
+
+	0x00020011, 1,                                  // OpCapability Shader
+	0x0003000E, 0, 1,                               // OpMemoryModel Logical GLSL450
+	0x0006000F, 5, 17, 0x6E69616D, 0x00000000, 6,   // OpEntryPoint GLCompute %17 "main" %6
+	0x00060010, 17, 17, 64, 1, 1,                   // OpExecutionMode %17 LocalSize 64 1 1
+
+	0x00040047, 6, 11, 28,                          // OpDecorate %6 BuiltIn GlobalInvocationId
+	0x00040047, 7, 6, 4,                            // OpDecorate %7 ArrayStride 4
+	0x00050048, 8, 0, 35, 0,                        // OpMemberDecorate %8 0 Offset 0
+	0x00030047, 8, 3,                               // OpDecorate %8 BufferBlock
+	0x00040047, 10, 34, 0,                          // OpDecorate %10 DescriptorSet 0
+	0x00040047, 10, 33, 0,                          // OpDecorate %10 Binding 0
+	0x00040047, 13, 1, 0,                           // OpDecorate %13 SpecId 0
+
+	0x00020013, 1,                                  // %1 = OpTypeVoid
+	0x00030021, 2, 1,                               // %2 = OpTypeFunction %1
+	0x00040015, 3, 32, 0,                           // %3 = OpTypeInt 32 0
+	0x00040017, 4, 3, 3,                            // %4 = OpTypeVector %3 3
+	0x00040020, 5, 1, 4,                            // %5 = OpTypePointer Input %4
+	0x0004003B, 5, 6, 1,                            // %6 = OpVariable %5 Input
+	0x0003001D, 7, 3,                               // %7 = OpTypeRuntimeArray %3
+	0x0003001E, 8, 7,                               // %8 = OpTypeStruct %7
+	0x00040020, 9, 2, 8,                            // %9 = OpTypePointer Uniform %8
+	0x0004003B, 9, 10, 2,                           // %10 = OpVariable %9 Uniform
+	0x00040015, 11, 32, 1,                          // %11 = OpTypeInt 32 1
+	0x0004002B, 11, 12, 0,                          // %12 = OpConstant %11 0
+	0x00040032, 3, 13, 1,                           // %13 = OpSpecConstant %3 1
+	0x00040020, 14, 1, 3,                           // %14 = OpTypePointer Input %3
+	0x0004002B, 3, 15, 0,                           // %15 = OpConstant %3 0
+	0x00040020, 16, 2, 3,                           // %16 = OpTypePointer Uniform %3
+
+	0x00050036, 1, 17, 0, 2,                        // %17 = OpFunction %1 None %2
+	0x000200F8, 18,                                 // %18 = OpLabel
+	0x00050041, 14, 19, 6, 15,                      // %19 = OpAccessChain %14 %6 %15
+	0x0004003D, 3, 20, 19,                          // %20 = OpLoad %3 %19
+	0x00060041, 16, 21, 10, 12, 20,                 // %21 = OpAccessChain %16 %10 %12 %20
+	0x0004003D, 3, 22, 21,                          // %22 = OpLoad %3 %21
+	0x00050084, 3, 23, 22, 13,                      // %23 = OpIMul %3 %22 %13
+	0x00050080, 3, 24, 23, 13,                      // %24 = OpIAdd %3 %23 %13
+	0x0003003E, 21, 24,                             // OpStore %21 %24
+	0x000100FD,                                     // OpReturn
+	0x00010038                                      // OpFunctionEnd
+};
+
+
+typedef struct bench_context
+{
+	VkDevice device;
+
+	VkShaderModule shaderModule;
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkPipelineLayout pipelineLayout;
+
+	uint32_t pipelineCount;
+
+	// Per pipeline
+	uint32_t *seeds;
+	VkSpecializationInfo *specializationInfos;
+	VkComputePipelineCreateInfo *createInfos;
+	VkPipeline *pipelines;
+} bench_context;
+
+
+static VkResult bench_createObjects(bench_context *context)
+{
+	VkShaderModuleCreateInfo shaderModuleCreateInfo;
+	memset(&shaderModuleCreateInfo, 0, sizeof(shaderModuleCreateInfo));
+
+	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = sizeof(bench_shaderCode);
+	shaderModuleCreateInfo.pCode = bench_shaderCode;
+
+	VkResult err = vkCreateShaderModule(context->device, &shaderModuleCreateInfo, NULL, &context->shaderModule);
+
+	if (err)
+		return err;
+
+
+	VkDescriptorSetLayoutBinding binding;
+	memset(&binding, 0, sizeof(binding));
+
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
+	memset(&descriptorSetLayoutCreateInfo, 0, sizeof(descriptorSetLayoutCreateInfo));
+
+	descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorSetLayoutCreateInfo.bindingCount = 1;
+	descriptorSetLayoutCreateInfo.pBindings = &binding;
+
+	err = vkCreateDescriptorSetLayout(context->device, &descriptorSetLayoutCreateInfo, NULL, &context->descriptorSetLayout);
+
+	if (err)
+		return err;
+
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+	memset(&pipelineLayoutCreateInfo, 0, sizeof(pipelineLayoutCreateInfo));
+
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &context->descriptorSetLayout;
+
+	return vkCreatePipelineLayout(context->device, &pipelineLayoutCreateInfo, NULL, &context->pipelineLayout);
+}
+
+static void bench_destroyObjects(bench_context *context)
+{
+	if (context->pipelineLayout)
+		vkDestroyPipelineLayout(context->device, context->pipelineLayout, NULL);
+
+	if (context->descriptorSetLayout)
+		vkDestroyDescriptorSetLayout(context->device, context->descriptorSetLayout, NULL);
+
+	if (context->shaderModule)
+		vkDestroyShaderModule(context->device, context->shaderModule, NULL);
+}
+
+
+static VkResult bench_build(bench_context *context, uint32_t threadCount, uint32_t firstSeed, uint64_t *time, VkuPipelineBuilderStatistics *statistics)
+{
+	static const VkSpecializationMapEntry mapEntry = { 0, 0, sizeof(uint32_t) };
+
+	for (uint32_t pipelineIndex = 0; pipelineIndex < context->pipelineCount; pipelineIndex++)
+	{
+		context->seeds[pipelineIndex] = firstSeed + pipelineIndex;
+
+		VkSpecializationInfo *specializationInfo = &context->specializationInfos[pipelineIndex];
+
+		specializationInfo->mapEntryCount = 1;
+		specializationInfo->pMapEntries = &mapEntry;
+		specializationInfo->dataSize = sizeof(uint32_t);
+		specializationInfo->pData = &context->seeds[pipelineIndex];
+
+		VkComputePipelineCreateInfo *createInfo = &context->createInfos[pipelineIndex];
+		memset(createInfo, 0, sizeof(VkComputePipelineCreateInfo));
+
+		createInfo->sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		createInfo->stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		createInfo->stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		createInfo->stage.module = context->shaderModule;
+		createInfo->stage.pName = "main";
+		createInfo->stage.pSpecializationInfo = specializationInfo;
+		createInfo->layout = context->pipelineLayout;
+		createInfo->basePipelineIndex = -1;
+
+		context->pipelines[pipelineIndex] = VK_NULL_HANDLE;
+	}
+
+
+	VkuPipelineBuilderCreateInfo createInfo;
+	memset(&createInfo, 0, sizeof(createInfo));
+
+	createInfo.device = context->device;
+	createInfo.threadCount = threadCount;
+
+	// Starting the threads isn't part of the load time
+	VkuPipelineBuilder builder;
+	VkResult err = vkuCreatePipelineBuilder(&createInfo, &builder);
+
+	if (err)
+		return err;
+
+
+	const uint64_t start = vku_getTime();
+
+	VkuPipelineBatch batch;
+	err = vkuBuildComputePipelines(builder, context->pipelineCount, context->createInfos, context->pipelines, NULL, NULL, &batch);
+
+	if (!err)
+	{
+		err = vkuWaitPipelineBatch(batch);
+		vkuDestroyPipelineBatch(batch);
+	}
+
+	(*time) = vku_getTime() - start;
+
+	vkuGetPipelineBuilderStatistics(builder, statistics);
+	vkuDestroyPipelineBuilder(builder);
+
+
+	for (uint32_t pipelineIndex = 0; pipelineIndex < context->pipelineCount; pipelineIndex++)
+	{
+		if (context->pipelines[pipelineIndex])
+			vkDestroyPipeline(context->device, context->pipelines[pipelineIndex], NULL);
+	}
+
+	return err;
+}
+
+
+int main(int argc, char **argv)
+{
+	bench_context context;
+	memset(&context, 0, sizeof(context));
+
+	context.pipelineCount = BENCH_DEFAULT_PIPELINE_COUNT;
+	uint32_t maxThreadCount = BENCH_DEFAULT_MAX_THREAD_COUNT;
+
+	if (argc > 1)
+		context.pipelineCount = (uint32_t) strtoul(argv[1], NULL, 10);
+
+	if (argc > 2)
+		maxThreadCount = (uint32_t) strtoul(argv[2], NULL, 10);
+
+	if (context.pipelineCount == 0)
+		context.pipelineCount = 1;
+
+	if (maxThreadCount == 0)
+		maxThreadCount = 1;
+
+
+	VkInstance instance = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice;
+	uint32_t queueFamilyIndex;
+
+	VkResult err = vkuCreateSimpleInstance(VK_MAKE_VERSION(1, 0, 0), VK_FALSE, NULL, &instance);
+
+	if (!err)
+		err = vkuGetPhysicalDevice(instance, &physicalDevice);
+
+	if (!err && !vkuGetQueueFamilyIndex(physicalDevice, &queueFamilyIndex))
+		err = VK_ERROR_INITIALIZATION_FAILED;
+
+	if (!err)
+		err = vkuCreateSimpleDevice(VK_FALSE, NULL, physicalDevice, queueFamilyIndex, &context.device);
+
+	if (!err)
+		err = bench_createObjects(&context);
+
+	if (!err)
+	{
+		context.seeds = (uint32_t*) calloc(context.pipelineCount, sizeof(uint32_t));
+		context.specializationInfos = (VkSpecializationInfo*) calloc(context.pipelineCount, sizeof(VkSpecializationInfo));
+		context.createInfos = (VkComputePipelineCreateInfo*) calloc(context.pipelineCount, sizeof(VkComputePipelineCreateInfo));
+		context.pipelines = (VkPipeline*) calloc(context.pipelineCount, sizeof(VkPipeline));
+
+		if (!context.seeds || !context.specializationInfos || !context.createInfos || !context.pipelines)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+
+	uint64_t singleThreadTime = 0;
+	uint32_t firstSeed = 1;
+
+	for (uint32_t threadCount = 1; !err && (threadCount <= maxThreadCount); )
+	{
+		uint64_t time;
+		VkuPipelineBuilderStatistics statistics;
+
+		err = bench_build(&context, threadCount, firstSeed, &time, &statistics);
+
+		if (err)
+			break;
+
+		if (threadCount == 1)
+			singleThreadTime = time;
+
+		printf("{\"threads\":%u,\"pipelines\":%u,\"failures\":%u,\"wallNs\":%llu,\"buildNs\":%llu,"
+			"\"pipelinesPerSecond\":%.1f,\"speedup\":%.2f}\n",
+			threadCount, context.pipelineCount, statistics.failedPipelineCount,
+			(unsigned long long) time, (unsigned long long) statistics.buildTime,
+			time ? (double) context.pipelineCount * 1e9 / time : 0.0,
+			time ? (double) singleThreadTime / time : 0.0);
+
+		fflush(stdout);
+
+		// New constants for each run, such that the driver can't reuse anything
+		firstSeed += context.pipelineCount;
+
+		// Powers of two, and the maximum itself
+		if ((threadCount < maxThreadCount) && ((threadCount * 2) > maxThreadCount))
+			threadCount = maxThreadCount;
+		else
+			threadCount *= 2;
+	}
+
+	if (err)
+		fprintf(stderr, "{\"error\":\"%s\"}\n", vkuGetResultString(err));
+
+
+	free(context.pipelines);
+	free(context.createInfos);
+	free(context.specializationInfos);
+	free(context.seeds);
+
+	if (context.device)
+	{
+		bench_destroyObjects(&context);
+		vkDestroyDevice(context.device, NULL);
+	}
+
+	if (instance)
+		vkDestroyInstance(instance, NULL);
+
+	return err ? 1 : 0;
+}
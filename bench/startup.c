@@ -0,0 +1,298 @@
+//========================================================================
+// vku startup and enumeration benchmark
+//------------------------------------------------------------------------
+// Times instance creation, physical device selection, device creation and
+// the extension/layer queries over many iterations, and counts the heap
+// allocations of each call, both vku's own (VKU_COUNT_ALLOCATIONS) and the
+// loader's and driver's (through a VkuHostAllocator passed as pAllocator).
+//
+// Build (from the root of the repository):
+//
+//     cc -O2 -std=c99 -I. bench/startup.c -o vku-startup -lvulkan -lpthread
+//
+// Run, e.g. on a machine without a GPU, against Mesa's software driver:
+//
+//     VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./vku-startup [iterations]
+//
+// Each benchmark is written to stdout as a line of JSON, with the first
+// (cold) call and the mean/min/max of the calls in nanoseconds, and the
+// allocations and allocated bytes per call.
+//========================================================================
+
+#ifndef _WIN32
+// For CLOCK_MONOTONIC with -std=c99
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <vulkan/vulkan.h>
+
+#define VKU_COUNT_ALLOCATIONS
+#include "vku.h"
+
+
+#define BENCH_DEFAULT_ITERATIONS 100
+
+
+typedef struct bench_context
+{
+	const VkAllocationCallbacks *pAllocator;
+
+	VkInstance instance;
+	VkPhysicalDevice physicalDevice;
+	uint32_t queueFamilyIndex;
+
+	// Set by a benchmark if the call failed
+	VkBool32 failed;
+} bench_context;
+
+typedef void (*bench_function)(bench_context *context);
+
+
+// The allocations the loader and driver made through pAllocator so far
+static uint64_t bench_getDriverAllocationCount(VkuHostAllocator hostAllocator)
+{
+	VkuHostAllocatorStatistics statistics;
+	vkuGetHostAllocatorStatistics(hostAllocator, &statistics);
+
+	uint64_t allocationCount = 0;
+
+	for (uint32_t scope = 0; scope < VKU_HOST_ALLOCATION_SCOPE_COUNT; scope++)
+		allocationCount += statistics.totalAllocationCount[scope];
+
+	return allocationCount;
+}
+
+static void bench_run(const char *name, uint32_t iterations, bench_function function, bench_context *context, VkuHostAllocator hostAllocator)
+{
+	uint64_t firstTime = 0;
+	uint64_t minTime = UINT64_MAX;
+	uint64_t maxTime = 0;
+	uint64_t totalTime = 0;
+	uint32_t failureCount = 0;
+
+	vkuResetAllocationCounters();
+
+	const uint64_t driverAllocationsBefore = bench_getDriverAllocationCount(hostAllocator);
+
+
+	for (uint32_t iteration = 0; iteration < iterations; iteration++)
+	{
+		context->failed = VK_FALSE;
+
+		const uint64_t start = vku_getTime();
+		function(context);
+		const uint64_t time = vku_getTime() - start;
+
+		if (context->failed)
+			failureCount++;
+
+		if (iteration == 0)
+			firstTime = time;
+
+		if (time < minTime)
+			minTime = time;
+
+		if (time > maxTime)
+			maxTime = time;
+
+		totalTime += time;
+	}
+
+
+	VkuAllocationCounters counters;
+	vkuGetAllocationCounters(&counters);
+
+	const uint64_t driverAllocationsAfter = bench_getDriverAllocationCount(hostAllocator);
+
+	const double vkuAllocations = (double) (counters.allocationCount + counters.reallocationCount) / iterations;
+	const double vkuAllocatedSize = (double) counters.allocatedSize / iterations;
+	const double driverAllocations = (double) (driverAllocationsAfter - driverAllocationsBefore) / iterations;
+
+	printf("{\"name\":\"%s\",\"iterations\":%u,\"failures\":%u,"
+		"\"firstNs\":%llu,\"meanNs\":%llu,\"minNs\":%llu,\"maxNs\":%llu,"
+		"\"vkuAllocations\":%.2f,\"vkuAllocatedBytes\":%.2f,\"driverAllocations\":%.2f}\n",
+		name, iterations, failureCount,
+		(unsigned long long) firstTime, (unsigned long long) (totalTime / iterations),
+		(unsigned long long) minTime, (unsigned long long) maxTime,
+		vkuAllocations, vkuAllocatedSize, driverAllocations);
+
+	fflush(stdout);
+}
+
+
+static void bench_createSimpleInstance(bench_context *context)
+{
+	VkInstance instance;
+
+	if (vkuCreateSimpleInstance(VK_MAKE_VERSION(1, 0, 0), VK_FALSE, context->pAllocator, &instance) != VK_SUCCESS)
+	{
+		context->failed = VK_TRUE;
+		return;
+	}
+
+	vkDestroyInstance(instance, context->pAllocator);
+}
+
+static void bench_getPhysicalDevice(bench_context *context)
+{
+	VkPhysicalDevice physicalDevice;
+
+	if (vkuGetPhysicalDevice(context->instance, &physicalDevice) != VK_SUCCESS)
+		context->failed = VK_TRUE;
+}
+
+static void bench_getQueueFamilyIndex(bench_context *context)
+{
+	uint32_t queueFamilyIndex;
+
+	if (!vkuGetQueueFamilyIndex(context->physicalDevice, &queueFamilyIndex))
+		context->failed = VK_TRUE;
+}
+
+static void bench_createSimpleDevice(bench_context *context)
+{
+	VkDevice device;
+
+	if (vkuCreateSimpleDevice(VK_FALSE, context->pAllocator, context->physicalDevice, context->queueFamilyIndex, &device) != VK_SUCCESS)
+	{
+		context->failed = VK_TRUE;
+		return;
+	}
+
+	vkDestroyDevice(device, context->pAllocator);
+}
+
+
+// The queries answer either way, so they can't fail
+static void bench_isInstanceExtensionSupported(bench_context *context)
+{
+	(void) context;
+	vkuIsInstanceExtensionSupported(NULL, VK_KHR_SURFACE_EXTENSION_NAME);
+}
+
+static void bench_isInstanceLayerSupported(bench_context *context)
+{
+	(void) context;
+	vkuIsInstanceLayerSupported("VK_LAYER_KHRONOS_validation");
+}
+
+static void bench_isDeviceExtensionSupported(bench_context *context)
+{
+	vkuIsDeviceExtensionSupported(context->physicalDevice, NULL, VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+}
+
+static void bench_isDeviceLayerSupported(bench_context *context)
+{
+	vkuIsDeviceLayerSupported(context->physicalDevice, "VK_LAYER_KHRONOS_validation");
+}
+
+
+static void bench_getInstanceExtensionNames(bench_context *context)
+{
+	(void) context;
+
+	uint32_t nameCount = 0;
+	char **names = vkuGetInstanceExtensionNames(NULL, &nameCount);
+
+	vkuDeleteNames(nameCount, names);
+}
+
+static void bench_getInstanceLayerNames(bench_context *context)
+{
+	(void) context;
+
+	uint32_t nameCount = 0;
+	char **names = vkuGetInstanceLayerNames(&nameCount);
+
+	vkuDeleteNames(nameCount, names);
+}
+
+static void bench_getDeviceExtensionNames(bench_context *context)
+{
+	uint32_t nameCount = 0;
+	char **names = vkuGetDeviceExtensionNames(context->physicalDevice, NULL, &nameCount);
+
+	vkuDeleteNames(nameCount, names);
+}
+
+static void bench_getDeviceLayerNames(bench_context *context)
+{
+	uint32_t nameCount = 0;
+	char **names = vkuGetDeviceLayerNames(context->physicalDevice, &nameCount);
+
+	vkuDeleteNames(nameCount, names);
+}
+
+
+int main(int argc, char **argv)
+{
+	uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+
+	if (argc > 1)
+		iterations = (uint32_t) strtoul(argv[1], NULL, 10);
+
+	if (iterations == 0)
+		iterations = 1;
+
+
+	VkuHostAllocator hostAllocator;
+
+	if (vkuCreateHostAllocator(NULL, &hostAllocator) != VK_SUCCESS)
+	{
+		fprintf(stderr, "{\"error\":\"vkuCreateHostAllocator\"}\n");
+		return 1;
+	}
+
+	VkAllocationCallbacks allocationCallbacks;
+	vkuGetHostAllocationCallbacks(hostAllocator, &allocationCallbacks);
+
+
+	bench_context context;
+	memset(&context, 0, sizeof(context));
+
+	context.pAllocator = &allocationCallbacks;
+
+	// The first instance creation also loads the driver, which is the cold startup time
+	bench_run("vkuCreateSimpleInstance", iterations, bench_createSimpleInstance, &context, hostAllocator);
+
+
+	VkResult err = vkuCreateSimpleInstance(VK_MAKE_VERSION(1, 0, 0), VK_FALSE, context.pAllocator, &context.instance);
+
+	if (!err)
+		err = vkuGetPhysicalDevice(context.instance, &context.physicalDevice);
+
+	if (!err && !vkuGetQueueFamilyIndex(context.physicalDevice, &context.queueFamilyIndex))
+		err = VK_ERROR_INITIALIZATION_FAILED;
+
+	if (err)
+	{
+		fprintf(stderr, "{\"error\":\"%s\"}\n", vkuGetResultString(err));
+
+		if (context.instance)
+			vkDestroyInstance(context.instance, context.pAllocator);
+
+		vkuDestroyHostAllocator(hostAllocator);
+		return 1;
+	}
+
+
+	bench_run("vkuGetPhysicalDevice", iterations, bench_getPhysicalDevice, &context, hostAllocator);
+	bench_run("vkuGetQueueFamilyIndex", iterations, bench_getQueueFamilyIndex, &context, hostAllocator);
+	bench_run("vkuCreateSimpleDevice", iterations, bench_createSimpleDevice, &context, hostAllocator);
+
+	bench_run("vkuIsInstanceExtensionSupported", iterations, bench_isInstanceExtensionSupported, &context, hostAllocator);
+	bench_run("vkuIsInstanceLayerSupported", iterations, bench_isInstanceLayerSupported, &context, hostAllocator);
+	bench_run("vkuIsDeviceExtensionSupported", iterations, bench_isDeviceExtensionSupported, &context, hostAllocator);
+	bench_run("vkuIsDeviceLayerSupported", iterations, bench_isDeviceLayerSupported, &context, hostAllocator);
+
+	bench_run("vkuGetInstanceExtensionNames", iterations, bench_getInstanceExtensionNames, &context, hostAllocator);
+	bench_run("vkuGetInstanceLayerNames", iterations, bench_getInstanceLayerNames, &context, hostAllocator);
+	bench_run("vkuGetDeviceExtensionNames", iterations, bench_getDeviceExtensionNames, &context, hostAllocator);
+	bench_run("vkuGetDeviceLayerNames", iterations, bench_getDeviceLayerNames, &context, hostAllocator);
+
+
+	vkDestroyInstance(context.instance, context.pAllocator);
+	vkuDestroyHostAllocator(hostAllocator);
+
+	return 0;
+}
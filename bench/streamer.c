@@ -0,0 +1,282 @@
+//========================================================================
+// vku streamer benchmark
+//------------------------------------------------------------------------
+// Writes a large file of random data, streams all of it into a device
+// local buffer with vkuStreamFile(), and measures the throughput from
+// queuing the request until vkuWaitStreamerIdle() returns.
+//
+// Build (from the root of the repository):
+//
+//     cc -O2 -std=c99 -I. bench/streamer.c -o vku-streamer -lvulkan -lpthread
+//
+// Run, e.g. on a machine without a GPU, against Mesa's software driver:
+//
+//     VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./vku-streamer [megabytes] [threads] [path]
+//
+// The file is written to path (vku-streamer.bin by default) and removed
+// afterwards. As it was just written it's usually in the page cache, so
+// this measures the copies rather than the disk. The result is written to
+// stdout as a line of JSON, with the GB/s and the VkuStreamerStatistics,
+// i.e. the time the I/O threads spent copying and stalled on the GPU.
+//========================================================================
+
+#ifndef _WIN32
+// For CLOCK_MONOTONIC with -std=c99
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <vulkan/vulkan.h>
+#include "vku.h"
+
+
+#define BENCH_DEFAULT_MEGABYTES 256
+#define BENCH_DEFAULT_PATH "vku-streamer.bin"
+
+// The size of the writes that fill the file
+#define BENCH_WRITE_SIZE (1024 * 1024)
+
+
+typedef struct bench_context
+{
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	uint32_t queueFamilyIndex;
+	VkQueue queue;
+
+	VkBuffer dstBuffer;
+	VkDeviceMemory dstMemory;
+
+	const char *path;
+	VkDeviceSize size;
+
+	// 0 means VKU_DEFAULT_STREAM_THREAD_COUNT
+	uint32_t threadCount;
+} bench_context;
+
+
+// xorshift32, such that the file doesn't compress or dedupe to nothing
+static uint32_t bench_random(uint32_t *state)
+{
+	uint32_t x = (*state);
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return (*state) = x;
+}
+
+static VkResult bench_writeFile(const bench_context *context)
+{
+	uint32_t *data = (uint32_t*) malloc(BENCH_WRITE_SIZE);
+
+	if (!data)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	FILE *file = fopen(context->path, "wb");
+
+	if (!file)
+	{
+		free(data);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+
+	uint32_t state = 0x9e3779b9u;
+	VkDeviceSize writtenSize = 0;
+	VkResult err = VK_SUCCESS;
+
+	while (!err && (writtenSize < context->size))
+	{
+		for (uint32_t wordIndex = 0; wordIndex < BENCH_WRITE_SIZE / sizeof(uint32_t); wordIndex++)
+			data[wordIndex] = bench_random(&state);
+
+		size_t writeSize = BENCH_WRITE_SIZE;
+
+		if (writeSize > context->size - writtenSize)
+			writeSize = (size_t) (context->size - writtenSize);
+
+		if (fwrite(data, 1, writeSize, file) != writeSize)
+			err = VK_ERROR_INITIALIZATION_FAILED;
+
+		writtenSize += writeSize;
+	}
+
+	if (fclose(file) != 0)
+		err = VK_ERROR_INITIALIZATION_FAILED;
+
+	free(data);
+
+	return err;
+}
+
+
+static VkResult bench_createDstBuffer(bench_context *context)
+{
+	VkBufferCreateInfo bufferCreateInfo;
+	memset(&bufferCreateInfo, 0, sizeof(bufferCreateInfo));
+
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = context->size;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkResult err = vkCreateBuffer(context->device, &bufferCreateInfo, NULL, &context->dstBuffer);
+
+	if (err)
+		return err;
+
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(context->physicalDevice, &memoryProperties);
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(context->device, context->dstBuffer, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocateInfo;
+	memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = memoryRequirements.size;
+
+	err = vkuFindMemoryTypeIndex(&memoryProperties, memoryRequirements.memoryTypeBits, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocateInfo.memoryTypeIndex);
+
+	if (!err)
+		err = vkAllocateMemory(context->device, &allocateInfo, NULL, &context->dstMemory);
+
+	if (!err)
+		err = vkBindBufferMemory(context->device, context->dstBuffer, context->dstMemory, 0);
+
+	return err;
+}
+
+
+static VkResult bench_stream(bench_context *context)
+{
+	VkuStreamerCreateInfo createInfo;
+	memset(&createInfo, 0, sizeof(createInfo));
+
+	createInfo.physicalDevice = context->physicalDevice;
+	createInfo.device = context->device;
+	createInfo.queueFamilyIndex = context->queueFamilyIndex;
+	createInfo.queue = context->queue;
+	createInfo.threadCount = context->threadCount;
+
+	VkuStreamer streamer;
+	VkResult err = vkuCreateStreamer(&createInfo, &streamer);
+
+	if (err)
+		return err;
+
+
+	const uint64_t start = vku_getTime();
+
+	err = vkuStreamFile(streamer, context->path, 0, context->size, context->dstBuffer, 0, VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+	if (!err)
+		err = vkuWaitStreamerIdle(streamer);
+
+	const uint64_t time = vku_getTime() - start;
+
+
+	if (!err)
+	{
+		VkuStreamerStatistics statistics;
+		vkuGetStreamerStatistics(streamer, &statistics);
+
+		// Bytes per nanosecond are GB/s
+		printf("{\"name\":\"vkuStreamFile\",\"size\":%llu,\"threads\":%u,\"chunkSize\":%llu,\"chunkCount\":%u,"
+			"\"wallNs\":%llu,\"gigabytesPerSecond\":%.3f,\"requests\":%llu,\"chunks\":%llu,\"streamedBytes\":%llu,"
+			"\"copyNs\":%llu,\"stalls\":%llu,\"stallNs\":%llu}\n",
+			(unsigned long long) context->size, statistics.threadCount,
+			(unsigned long long) VKU_DEFAULT_STREAM_CHUNK_SIZE, VKU_DEFAULT_STREAM_CHUNK_COUNT,
+			(unsigned long long) time, time ? (double) statistics.streamedSize / time : 0.0,
+			(unsigned long long) statistics.requestCount, (unsigned long long) statistics.chunkCount,
+			(unsigned long long) statistics.streamedSize, (unsigned long long) statistics.copyTime,
+			(unsigned long long) statistics.stallCount, (unsigned long long) statistics.stallTime);
+
+		fflush(stdout);
+	}
+
+	vkuDestroyStreamer(streamer);
+
+	return err;
+}
+
+
+int main(int argc, char **argv)
+{
+	bench_context context;
+	memset(&context, 0, sizeof(context));
+
+	uint32_t megabytes = BENCH_DEFAULT_MEGABYTES;
+	context.path = BENCH_DEFAULT_PATH;
+
+	if (argc > 1)
+		megabytes = (uint32_t) strtoul(argv[1], NULL, 10);
+
+	if (argc > 2)
+		context.threadCount = (uint32_t) strtoul(argv[2], NULL, 10);
+
+	if (argc > 3)
+		context.path = argv[3];
+
+	if (megabytes == 0)
+		megabytes = 1;
+
+	context.size = (VkDeviceSize) megabytes * 1024 * 1024;
+
+
+	VkInstance instance = VK_NULL_HANDLE;
+
+	VkResult err = vkuCreateSimpleInstance(VK_MAKE_VERSION(1, 0, 0), VK_FALSE, NULL, &instance);
+
+	if (!err)
+		err = vkuGetPhysicalDevice(instance, &context.physicalDevice);
+
+	if (!err && !vkuGetQueueFamilyIndex(context.physicalDevice, &context.queueFamilyIndex))
+		err = VK_ERROR_INITIALIZATION_FAILED;
+
+	if (!err)
+		err = vkuCreateSimpleDevice(VK_FALSE, NULL, context.physicalDevice, context.queueFamilyIndex, &context.device);
+
+	if (!err)
+	{
+		vkGetDeviceQueue(context.device, context.queueFamilyIndex, 0, &context.queue);
+
+		err = bench_createDstBuffer(&context);
+	}
+
+	VkBool32 wroteFile = VK_FALSE;
+
+	if (!err)
+	{
+		err = bench_writeFile(&context);
+		wroteFile = VK_TRUE;
+	}
+
+	if (!err)
+		err = bench_stream(&context);
+
+	if (err)
+		fprintf(stderr, "{\"error\":\"%s\"}\n", vkuGetResultString(err));
+
+
+	if (wroteFile)
+		remove(context.path);
+
+	if (context.dstBuffer)
+		vkDestroyBuffer(context.device, context.dstBuffer, NULL);
+
+	if (context.dstMemory)
+		vkFreeMemory(context.device, context.dstMemory, NULL);
+
+	if (context.device)
+		vkDestroyDevice(context.device, NULL);
+
+	if (instance)
+		vkDestroyInstance(instance, NULL);
+
+	return err ? 1 : 0;
+}
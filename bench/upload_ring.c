@@ -0,0 +1,428 @@
+//========================================================================
+// vku upload ring benchmark
+//------------------------------------------------------------------------
+// Measures the throughput of many small uploads per frame through a
+// VkuUploadRing, against creating a staging buffer and calling
+// vkMapMemory() per upload, with one submission per frame either way.
+//
+// Build (from the root of the repository):
+//
+//     cc -O2 -std=c99 -I. bench/upload_ring.c -o vku-upload-ring -lvulkan -lpthread
+//
+// Run, e.g. on a machine without a GPU, against Mesa's software driver:
+//
+//     VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./vku-upload-ring [uploads] [frames] [size]
+//
+// Each benchmark is written to stdout as a line of JSON, with the uploads
+// and megabytes per second including waiting for the last frame's copies.
+//========================================================================
+
+#ifndef _WIN32
+// For CLOCK_MONOTONIC with -std=c99
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <vulkan/vulkan.h>
+#include "vku.h"
+
+
+#define BENCH_DEFAULT_UPLOAD_COUNT 4096
+#define BENCH_DEFAULT_FRAME_COUNT 32
+#define BENCH_DEFAULT_UPLOAD_SIZE 256
+
+
+typedef struct bench_context
+{
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	uint32_t queueFamilyIndex;
+	VkQueue queue;
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+
+	// Each upload goes to its own range of dstBuffer
+	VkBuffer dstBuffer;
+	VkDeviceMemory dstMemory;
+
+	uint32_t uploadCount;
+	uint32_t frameCount;
+	VkDeviceSize uploadSize;
+
+	char *data;
+} bench_context;
+
+
+static VkResult bench_createBuffer(bench_context *context, VkDeviceSize size, VkBufferUsageFlags usage,
+	VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags, VkBuffer *buffer, VkDeviceMemory *memory)
+{
+	(*buffer) = VK_NULL_HANDLE;
+	(*memory) = VK_NULL_HANDLE;
+
+	VkBufferCreateInfo bufferCreateInfo;
+	memset(&bufferCreateInfo, 0, sizeof(bufferCreateInfo));
+
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usage;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkResult err = vkCreateBuffer(context->device, &bufferCreateInfo, NULL, buffer);
+
+	if (err)
+		return err;
+
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(context->device, (*buffer), &memoryRequirements);
+
+	VkMemoryAllocateInfo allocateInfo;
+	memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = memoryRequirements.size;
+
+	err = vkuFindMemoryTypeIndex(&context->memoryProperties, memoryRequirements.memoryTypeBits, requiredFlags, preferredFlags, &allocateInfo.memoryTypeIndex);
+
+	if (!err)
+		err = vkAllocateMemory(context->device, &allocateInfo, NULL, memory);
+
+	if (!err)
+		err = vkBindBufferMemory(context->device, (*buffer), (*memory), 0);
+
+	if (err)
+	{
+		vkDestroyBuffer(context->device, (*buffer), NULL);
+		vkFreeMemory(context->device, (*memory), NULL);
+
+		(*buffer) = VK_NULL_HANDLE;
+		(*memory) = VK_NULL_HANDLE;
+	}
+
+	return err;
+}
+
+
+static void bench_print(const char *name, const bench_context *context, uint32_t uploadCount, uint64_t time, uint32_t failureCount)
+{
+	const double totalUploadCount = (double) uploadCount * context->frameCount;
+	const double seconds = (double) time / 1e9;
+
+	printf("{\"name\":\"%s\",\"uploadsPerFrame\":%u,\"frames\":%u,\"uploadSize\":%llu,\"failures\":%u,"
+		"\"uploadsPerSecond\":%.0f,\"megabytesPerSecond\":%.2f",
+		name, uploadCount, context->frameCount, (unsigned long long) context->uploadSize, failureCount,
+		(time > 0) ? totalUploadCount / seconds : 0.0,
+		(time > 0) ? totalUploadCount * context->uploadSize / (seconds * 1024.0 * 1024.0) : 0.0);
+}
+
+
+// A staging buffer with its own memory and vkMapMemory() per upload, limited by maxMemoryAllocationCount
+static void bench_stagingBuffers(bench_context *context)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(context->physicalDevice, &properties);
+
+	// Leave some room for the destination buffer, loader and driver
+	uint32_t uploadCount = context->uploadCount;
+
+	if (uploadCount > properties.limits.maxMemoryAllocationCount / 2)
+		uploadCount = properties.limits.maxMemoryAllocationCount / 2;
+
+	VkBuffer *buffers = (VkBuffer*) calloc(uploadCount, sizeof(VkBuffer));
+	VkDeviceMemory *memories = (VkDeviceMemory*) calloc(uploadCount, sizeof(VkDeviceMemory));
+
+
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo;
+	memset(&commandPoolCreateInfo, 0, sizeof(commandPoolCreateInfo));
+
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = context->queueFamilyIndex;
+
+	VkResult err = (buffers && memories) ? VK_SUCCESS : VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	if (!err)
+		err = vkCreateCommandPool(context->device, &commandPoolCreateInfo, NULL, &commandPool);
+
+	if (!err)
+	{
+		VkCommandBufferAllocateInfo allocateInfo;
+		memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+
+		err = vkAllocateCommandBuffers(context->device, &allocateInfo, &commandBuffer);
+	}
+
+	if (!err)
+	{
+		VkFenceCreateInfo fenceCreateInfo;
+		memset(&fenceCreateInfo, 0, sizeof(fenceCreateInfo));
+
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		err = vkCreateFence(context->device, &fenceCreateInfo, NULL, &fence);
+	}
+
+
+	uint32_t failureCount = 0;
+	const uint64_t start = vku_getTime();
+
+	for (uint32_t frame = 0; !err && (frame < context->frameCount); frame++)
+	{
+		VkCommandBufferBeginInfo beginInfo;
+		memset(&beginInfo, 0, sizeof(beginInfo));
+
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		err = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+		for (uint32_t uploadIndex = 0; !err && (uploadIndex < uploadCount); uploadIndex++)
+		{
+			if (bench_createBuffer(context, context->uploadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, &buffers[uploadIndex], &memories[uploadIndex]))
+			{
+				failureCount++;
+				continue;
+			}
+
+			void *mappedData;
+
+			if (vkMapMemory(context->device, memories[uploadIndex], 0, context->uploadSize, 0, &mappedData))
+			{
+				failureCount++;
+				continue;
+			}
+
+			memcpy(mappedData, context->data + uploadIndex * context->uploadSize, (size_t) context->uploadSize);
+			vkUnmapMemory(context->device, memories[uploadIndex]);
+
+			VkBufferCopy region;
+			region.srcOffset = 0;
+			region.dstOffset = uploadIndex * context->uploadSize;
+			region.size = context->uploadSize;
+
+			vkCmdCopyBuffer(commandBuffer, buffers[uploadIndex], context->dstBuffer, 1, &region);
+		}
+
+		if (!err)
+			err = vkEndCommandBuffer(commandBuffer);
+
+		if (!err)
+		{
+			VkSubmitInfo submitInfo;
+			memset(&submitInfo, 0, sizeof(submitInfo));
+
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &commandBuffer;
+
+			err = vkQueueSubmit(context->queue, 1, &submitInfo, fence);
+		}
+
+		// The staging buffers can only be destroyed once the copies have completed
+		if (!err)
+			err = vkWaitForFences(context->device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+		if (!err)
+			err = vkResetFences(context->device, 1, &fence);
+
+		for (uint32_t uploadIndex = 0; uploadIndex < uploadCount; uploadIndex++)
+		{
+			vkDestroyBuffer(context->device, buffers[uploadIndex], NULL);
+			vkFreeMemory(context->device, memories[uploadIndex], NULL);
+
+			buffers[uploadIndex] = VK_NULL_HANDLE;
+			memories[uploadIndex] = VK_NULL_HANDLE;
+		}
+	}
+
+	const uint64_t time = vku_getTime() - start;
+
+
+	if (err)
+		fprintf(stderr, "{\"name\":\"stagingBuffers\",\"error\":\"%s\"}\n", vkuGetResultString(err));
+	else
+	{
+		bench_print("stagingBuffers", context, uploadCount, time, failureCount);
+		printf("}\n");
+	}
+
+	fflush(stdout);
+
+
+	if (fence)
+		vkDestroyFence(context->device, fence, NULL);
+
+	if (commandPool)
+		vkDestroyCommandPool(context->device, commandPool, NULL);
+
+	free(memories);
+	free(buffers);
+}
+
+static void bench_uploadRing(bench_context *context)
+{
+	VkuUploadRingCreateInfo createInfo;
+	memset(&createInfo, 0, sizeof(createInfo));
+
+	createInfo.physicalDevice = context->physicalDevice;
+	createInfo.device = context->device;
+	createInfo.queueFamilyIndex = context->queueFamilyIndex;
+	createInfo.queue = context->queue;
+
+	VkuUploadRing ring;
+	VkResult err = vkuCreateUploadRing(&createInfo, &ring);
+
+	if (err)
+	{
+		fprintf(stderr, "{\"name\":\"vkuUploadRing\",\"error\":\"%s\"}\n", vkuGetResultString(err));
+		return;
+	}
+
+
+	uint32_t failureCount = 0;
+	const uint64_t start = vku_getTime();
+
+	for (uint32_t frame = 0; !err && (frame < context->frameCount); frame++)
+	{
+		for (uint32_t uploadIndex = 0; uploadIndex < context->uploadCount; uploadIndex++)
+		{
+			if (vkuUploadRingCopy(ring, context->dstBuffer, uploadIndex * context->uploadSize,
+				context->data + uploadIndex * context->uploadSize, context->uploadSize))
+				failureCount++;
+		}
+
+		err = vkuFlushUploadRing(ring, VK_NULL_HANDLE);
+	}
+
+	if (!err)
+		err = vkuWaitUploadRingIdle(ring);
+
+	const uint64_t time = vku_getTime() - start;
+
+
+	if (err)
+		fprintf(stderr, "{\"name\":\"vkuUploadRing\",\"error\":\"%s\"}\n", vkuGetResultString(err));
+	else
+	{
+		VkuUploadRingStatistics statistics;
+		vkuGetUploadRingStatistics(ring, &statistics);
+
+		bench_print("vkuUploadRing", context, context->uploadCount, time, failureCount);
+
+		printf(",\"ringSize\":%llu,\"flushes\":%llu,\"copyCommands\":%llu,\"stalls\":%llu,\"stallNs\":%llu,\"grows\":%u}\n",
+			(unsigned long long) statistics.size, (unsigned long long) statistics.flushCount,
+			(unsigned long long) statistics.copyCommandCount, (unsigned long long) statistics.stallCount,
+			(unsigned long long) statistics.stallTime, statistics.growCount);
+	}
+
+	fflush(stdout);
+
+	vkuDestroyUploadRing(ring);
+}
+
+
+int main(int argc, char **argv)
+{
+	bench_context context;
+	memset(&context, 0, sizeof(context));
+
+	context.uploadCount = BENCH_DEFAULT_UPLOAD_COUNT;
+	context.frameCount = BENCH_DEFAULT_FRAME_COUNT;
+	context.uploadSize = BENCH_DEFAULT_UPLOAD_SIZE;
+
+	if (argc > 1)
+		context.uploadCount = (uint32_t) strtoul(argv[1], NULL, 10);
+
+	if (argc > 2)
+		context.frameCount = (uint32_t) strtoul(argv[2], NULL, 10);
+
+	if (argc > 3)
+		context.uploadSize = (VkDeviceSize) strtoull(argv[3], NULL, 10);
+
+	if (context.uploadCount == 0)
+		context.uploadCount = 1;
+
+	if (context.frameCount == 0)
+		context.frameCount = 1;
+
+	if (context.uploadSize == 0)
+		context.uploadSize = 1;
+
+
+	VkInstance instance = VK_NULL_HANDLE;
+
+	VkResult err = vkuCreateSimpleInstance(VK_MAKE_VERSION(1, 0, 0), VK_FALSE, NULL, &instance);
+
+	if (!err)
+		err = vkuGetPhysicalDevice(instance, &context.physicalDevice);
+
+	if (!err && !vkuGetQueueFamilyIndex(context.physicalDevice, &context.queueFamilyIndex))
+		err = VK_ERROR_INITIALIZATION_FAILED;
+
+	if (!err)
+		err = vkuCreateSimpleDevice(VK_FALSE, NULL, context.physicalDevice, context.queueFamilyIndex, &context.device);
+
+	if (!err)
+	{
+		vkGetDeviceQueue(context.device, context.queueFamilyIndex, 0, &context.queue);
+		vkGetPhysicalDeviceMemoryProperties(context.physicalDevice, &context.memoryProperties);
+
+		err = bench_createBuffer(&context, context.uploadCount * context.uploadSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &context.dstBuffer, &context.dstMemory);
+	}
+
+	if (!err)
+	{
+		context.data = (char*) malloc((size_t) (context.uploadCount * context.uploadSize));
+
+		if (!context.data)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	if (err)
+	{
+		fprintf(stderr, "{\"error\":\"%s\"}\n", vkuGetResultString(err));
+
+		if (context.dstBuffer)
+		{
+			vkDestroyBuffer(context.device, context.dstBuffer, NULL);
+			vkFreeMemory(context.device, context.dstMemory, NULL);
+		}
+
+		if (context.device)
+			vkDestroyDevice(context.device, NULL);
+
+		if (instance)
+			vkDestroyInstance(instance, NULL);
+
+		return 1;
+	}
+
+
+	for (size_t byteIndex = 0; byteIndex < (size_t) (context.uploadCount * context.uploadSize); byteIndex++)
+		context.data[byteIndex] = (char) byteIndex;
+
+	bench_stagingBuffers(&context);
+	bench_uploadRing(&context);
+
+
+	free(context.data);
+
+	vkDestroyBuffer(context.device, context.dstBuffer, NULL);
+	vkFreeMemory(context.device, context.dstMemory, NULL);
+
+	vkDestroyDevice(context.device, NULL);
+	vkDestroyInstance(instance, NULL);
+
+	return 0;
+}
@@ -14,6 +14,7 @@
 // Dependencies
 //     Vulkan (library)
 //     Windows (header) - needed for library loading on Windows
+//     POSIX (headers) - needed for memory mapping files and threads elsewhere
 //     Standard C Libraries (stdio, stdlib, string, assert) - needed for NULL, malloc()
 //                                                 calloc(), free(), memset(), assert()
 //
@@ -24,10 +25,64 @@
 //     Christian Vallentin <mail@vallentinsource.com>
 //
 // Version
-//     Last Modified Data: February 27, 2016
-//     Revision: 3
+//     Last Modified Data: October 17, 2026
+//     Revision: 4
 //
 // Revision History
+//     Revision 4, 2026/10/17
+//       - Implemented cached capability registry, used as a
+//         fast path by the extension/layer support checking.
+//       - Implemented single allocation/arena name blocks.
+//       - Implemented batch extension/layer support checking.
+//       - Implemented VkInstance and VkDevice creation from
+//         required/optional extension/layer specs.
+//       - Implemented ranked VkPhysicalDevice selection,
+//         vkuGetPhysicalDevice() now prefers a discrete GPU.
+//       - Implemented queue topology discovery (graphics, async
+//         compute and transfer) and VkDevice creation with a
+//         queue for each role.
+//       - Fixed vkuCreateDevice() using the wrong sType for
+//         the VkDeviceQueueCreateInfo.
+//       - Implemented VkDeviceMemory sub-allocator.
+//       - Implemented persistently mapped upload ring, which
+//         batches the uploads into a vkCmdCopyBuffer() per buffer.
+//       - Implemented per-thread, per-frame command pool sets,
+//         which reuse their command buffers.
+//       - Implemented VkPipelineCache loading (memory mapped and
+//         validated against the physical device) and saving.
+//       - Implemented parallel pipeline building on worker threads,
+//         each with its own VkPipelineCache.
+//       - Implemented growable per-frame descriptor set allocator,
+//         and VkDescriptorSetLayout cache.
+//         Implemented bindless descriptor heap, using
+//         VK_EXT_descriptor_indexing when available.
+//       - Implemented frame synchronization, with pooled fences
+//         and semaphores, deferred destruction, and timeline
+//         semaphores when available.
+//       - Implemented GPU timestamp profiler, with zone statistics
+//         and Chrome trace output.
+//       - Implemented VkAllocationCallbacks host allocator, with
+//         per-thread size classes and arenas.
+//       - Implemented device dispatch table, for calling the
+//         device-level commands without the loader.
+//       - Made vku's own heap allocations overridable with
+//         VKU_MALLOC() and friends, and countable with
+//         VKU_COUNT_ALLOCATIONS.
+//       - Implemented asynchronous VkInstance and VkDevice
+//         initialization on a background thread.
+//       - Implemented on-disk device profiles, which are used
+//         instead of enumerating while the driver is unchanged.
+//       - Implemented transient resource pools, which alias the
+//         memory of buffers and images with disjoint lifetimes.
+//       - Implemented pass graphs, which track resource state and
+//         merge the barriers of independent passes.
+//       - Implemented XXH64 hashed, reference counted shader module
+//         cache, and a VkSpecializationInfo builder.
+//       - Implemented a streamer, which copies memory mapped files to
+//         buffers in chunks on I/O threads and a transfer queue.
+//       - Implemented memory telemetry, with per heap budget snapshots
+//         from VK_EXT_memory_budget or the allocator, and thresholds.
+//
 //     Revision 3, 2016/02/27
 //       - Implemented simplified VkDevice creation
 //         and getting of QueueFamilyIndex.
@@ -79,6 +134,17 @@ extern "C" {
 #include <string.h> /* memset() */
 #include <assert.h> /* assert() */
 
+#ifdef _WIN32
+#	include <windows.h> /* QueryPerformanceCounter(), CreateFileMapping() */
+#else
+#	include <time.h> /* clock_gettime(), timespec_get(), clock() */
+#	include <fcntl.h> /* open() */
+#	include <unistd.h> /* close(), write(), fsync(), getpid() */
+#	include <sys/mman.h> /* mmap() */
+#	include <sys/stat.h> /* fstat() */
+#	include <pthread.h> /* pthread_create() */
+#endif
+
 
 // Used for developing, as vkel is
 // located next to the vku folder.
@@ -94,6 +160,102 @@ extern "C" {
 #define VKUAPI_ATTR static
 
 
+// The heap allocations vku makes itself. To route them elsewhere, define all of VKU_MALLOC, VKU_CALLOC,
+// VKU_REALLOC and VKU_FREE prior to including vku.h, and then free the memory vku returns (like the
+// extension/layer name lists) with VKU_FREE(). Alternatively define VKU_COUNT_ALLOCATIONS, to count
+// them with vkuGetAllocationCounters().
+#ifndef VKU_MALLOC
+#	ifdef VKU_COUNT_ALLOCATIONS
+#		define VKU_MALLOC(size) vku_countedMalloc(size)
+#		define VKU_CALLOC(count, size) vku_countedCalloc(count, size)
+#		define VKU_REALLOC(pointer, size) vku_countedRealloc(pointer, size)
+#		define VKU_FREE(pointer) vku_countedFree(pointer)
+#	else
+#		define VKU_MALLOC(size) malloc(size)
+#		define VKU_CALLOC(count, size) calloc(count, size)
+#		define VKU_REALLOC(pointer, size) realloc(pointer, size)
+#		define VKU_FREE(pointer) free(pointer)
+#	endif
+#endif
+
+
+#ifdef VKU_COUNT_ALLOCATIONS
+
+// The counters are per translation unit, like the rest of vku
+typedef struct VkuAllocationCounters
+{
+	uint64_t allocationCount;
+	uint64_t reallocationCount;
+	uint64_t freeCount;
+
+	// The sizes requested from malloc(), calloc() and realloc()
+	uint64_t allocatedSize;
+} VkuAllocationCounters;
+
+
+static volatile uint64_t vku_allocationCounters[4];
+
+static void vku_countAllocation(uint32_t counterIndex, uint64_t value)
+{
+#ifdef _WIN32
+	InterlockedAdd64((volatile LONG64*) &vku_allocationCounters[counterIndex], (LONG64) value);
+#else
+	__sync_add_and_fetch(&vku_allocationCounters[counterIndex], value);
+#endif
+}
+
+static void* vku_countedMalloc(size_t size)
+{
+	vku_countAllocation(0, 1);
+	vku_countAllocation(3, size);
+
+	return malloc(size);
+}
+
+static void* vku_countedCalloc(size_t count, size_t size)
+{
+	vku_countAllocation(0, 1);
+	vku_countAllocation(3, count * size);
+
+	return calloc(count, size);
+}
+
+static void* vku_countedRealloc(void *pointer, size_t size)
+{
+	vku_countAllocation(pointer ? 1 : 0, 1);
+	vku_countAllocation(3, size);
+
+	return realloc(pointer, size);
+}
+
+static void vku_countedFree(void *pointer)
+{
+	if (pointer)
+		vku_countAllocation(2, 1);
+
+	free(pointer);
+}
+
+
+VKUAPI_ATTR void vkuGetAllocationCounters(VkuAllocationCounters *counters)
+{
+	assert(counters);
+
+	counters->allocationCount = vku_allocationCounters[0];
+	counters->reallocationCount = vku_allocationCounters[1];
+	counters->freeCount = vku_allocationCounters[2];
+	counters->allocatedSize = vku_allocationCounters[3];
+}
+
+VKUAPI_ATTR void vkuResetAllocationCounters(void)
+{
+	for (uint32_t counterIndex = 0; counterIndex < 4; counterIndex++)
+		vku_allocationCounters[counterIndex] = 0;
+}
+
+#endif
+
+
 
 VKUAPI_ATTR const char* vkuGetResultString(const VkResult err)
 {
@@ -168,6 +330,36 @@ static void vku_strpy(char *dest, char *src)
 }
 
 
+// Monotonic time in nanoseconds, only meaningful as a difference
+static uint64_t vku_getTime(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (uint64_t) ((counter.QuadPart / frequency.QuadPart) * 1000000000ull +
+		((counter.QuadPart % frequency.QuadPart) * 1000000000ull) / frequency.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return ((uint64_t) time.tv_sec) * 1000000000ull + (uint64_t) time.tv_nsec;
+#elif defined(TIME_UTC)
+	// CLOCK_MONOTONIC is hidden when compiling with -std=c11 without a
+	// POSIX feature test macro, so fall back to the (non-monotonic) C11 clock
+	struct timespec time;
+	timespec_get(&time, TIME_UTC);
+
+	return ((uint64_t) time.tv_sec) * 1000000000ull + (uint64_t) time.tv_nsec;
+#else
+	// Plain C99 only has the processor time
+	return (uint64_t) ((((double) clock()) / CLOCKS_PER_SEC) * 1000000000.0);
+#endif
+}
+
+
 
 VKUAPI_ATTR void vkuDeleteNames(uint32_t nameCount, char **names)
 {
@@ -181,10 +373,10 @@ VKUAPI_ATTR void vkuDeleteNames(uint32_t nameCount, char **names)
 		if (!names[nameIndex])
 			continue;
 
-		free(names[nameIndex]);
+		VKU_FREE(names[nameIndex]);
 	}
 
-	free(names);
+	VKU_FREE(names);
 }
 
 
@@ -212,13 +404,13 @@ VKUAPI_ATTR char** vkuGetInstanceExtensionNames(const char *pLayerName, uint32_t
 		return NULL;
 
 
-	char **extensionNames = (char**) calloc(extPropertyCount, sizeof(char*));
+	char **extensionNames = (char**) VKU_CALLOC(extPropertyCount, sizeof(char*));
 
 	for (uint32_t extensionNameIndex = 0; extensionNameIndex < extPropertyCount; extensionNameIndex++)
-		extensionNames[extensionNameIndex] = (char*) calloc(VK_MAX_EXTENSION_NAME_SIZE, sizeof(char));
+		extensionNames[extensionNameIndex] = (char*) VKU_CALLOC(VK_MAX_EXTENSION_NAME_SIZE, sizeof(char));
 
 
-	VkExtensionProperties *extProperties = (VkExtensionProperties*) calloc(extPropertyCount, sizeof(VkExtensionProperties));
+	VkExtensionProperties *extProperties = (VkExtensionProperties*) VKU_CALLOC(extPropertyCount, sizeof(VkExtensionProperties));
 	assert(extProperties);
 
 
@@ -229,7 +421,7 @@ VKUAPI_ATTR char** vkuGetInstanceExtensionNames(const char *pLayerName, uint32_t
 		vku_strpy(extensionNames[extPropertyIndex], extProperties[extPropertyIndex].extensionName);
 
 
-	free(extProperties);
+	VKU_FREE(extProperties);
 
 
 	return extensionNames;
@@ -253,13 +445,13 @@ VKUAPI_ATTR char** vkuGetDeviceExtensionNames(VkPhysicalDevice physicalDevice, c
 		return NULL;
 
 
-	char **extensionNames = (char**) calloc(extPropertyCount, sizeof(char*));
+	char **extensionNames = (char**) VKU_CALLOC(extPropertyCount, sizeof(char*));
 
 	for (uint32_t extensionNameIndex = 0; extensionNameIndex < extPropertyCount; extensionNameIndex++)
-		extensionNames[extensionNameIndex] = (char*) calloc(VK_MAX_EXTENSION_NAME_SIZE, sizeof(char));
+		extensionNames[extensionNameIndex] = (char*) VKU_CALLOC(VK_MAX_EXTENSION_NAME_SIZE, sizeof(char));
 
 
-	VkExtensionProperties *extProperties = (VkExtensionProperties*) calloc(extPropertyCount, sizeof(VkExtensionProperties));
+	VkExtensionProperties *extProperties = (VkExtensionProperties*) VKU_CALLOC(extPropertyCount, sizeof(VkExtensionProperties));
 	assert(extProperties);
 
 
@@ -270,7 +462,7 @@ VKUAPI_ATTR char** vkuGetDeviceExtensionNames(VkPhysicalDevice physicalDevice, c
 		vku_strpy(extensionNames[extPropertyIndex], extProperties[extPropertyIndex].extensionName);
 
 
-	free(extProperties);
+	VKU_FREE(extProperties);
 
 
 	return extensionNames;
@@ -295,13 +487,13 @@ VKUAPI_ATTR char** vkuGetInstanceLayerNames(uint32_t *layerNameCount)
 		return NULL;
 
 
-	char **layerNames = (char**) calloc(layerPropertyCount, sizeof(char*));
+	char **layerNames = (char**) VKU_CALLOC(layerPropertyCount, sizeof(char*));
 
 	for (uint32_t layerNameIndex = 0; layerNameIndex < layerPropertyCount; layerNameIndex++)
-		layerNames[layerNameIndex] = (char*) calloc(VK_MAX_EXTENSION_NAME_SIZE, sizeof(char));
+		layerNames[layerNameIndex] = (char*) VKU_CALLOC(VK_MAX_EXTENSION_NAME_SIZE, sizeof(char));
 
 
-	VkLayerProperties *layerProperties = (VkLayerProperties*) calloc(layerPropertyCount, sizeof(VkLayerProperties));
+	VkLayerProperties *layerProperties = (VkLayerProperties*) VKU_CALLOC(layerPropertyCount, sizeof(VkLayerProperties));
 	assert(layerProperties);
 
 	err = vkEnumerateInstanceLayerProperties(&layerPropertyCount, layerProperties);
@@ -311,7 +503,7 @@ VKUAPI_ATTR char** vkuGetInstanceLayerNames(uint32_t *layerNameCount)
 		vku_strpy(layerNames[layerPropertyIndex], layerProperties[layerPropertyIndex].layerName);
 
 
-	free(layerProperties);
+	VKU_FREE(layerProperties);
 
 
 	return layerNames;
@@ -335,13 +527,13 @@ VKUAPI_ATTR char** vkuGetDeviceLayerNames(VkPhysicalDevice physicalDevice, uint3
 		return NULL;
 
 
-	char **layerNames = (char**) calloc(layerPropertyCount, sizeof(char*));
+	char **layerNames = (char**) VKU_CALLOC(layerPropertyCount, sizeof(char*));
 
 	for (uint32_t layerNameIndex = 0; layerNameIndex < layerPropertyCount; layerNameIndex++)
-		layerNames[layerNameIndex] = (char*) calloc(VK_MAX_EXTENSION_NAME_SIZE, sizeof(char));
+		layerNames[layerNameIndex] = (char*) VKU_CALLOC(VK_MAX_EXTENSION_NAME_SIZE, sizeof(char));
 
 
-	VkLayerProperties *layerProperties = (VkLayerProperties*) calloc(layerPropertyCount, sizeof(VkLayerProperties));
+	VkLayerProperties *layerProperties = (VkLayerProperties*) VKU_CALLOC(layerPropertyCount, sizeof(VkLayerProperties));
 	assert(layerProperties);
 
 	err = vkEnumerateDeviceLayerProperties(physicalDevice, &layerPropertyCount, layerProperties);
@@ -351,7 +543,7 @@ VKUAPI_ATTR char** vkuGetDeviceLayerNames(VkPhysicalDevice physicalDevice, uint3
 		vku_strpy(layerNames[layerPropertyIndex], layerProperties[layerPropertyIndex].layerName);
 
 
-	free(layerProperties);
+	VKU_FREE(layerProperties);
 
 
 	return layerNames;
@@ -359,357 +551,13090 @@ VKUAPI_ATTR char** vkuGetDeviceLayerNames(VkPhysicalDevice physicalDevice, uint3
 
 
 
-VKUAPI_ATTR VkBool32 vkuIsInstanceExtensionSupported(const char *pLayerName, const char *pExtensionName)
+// All the names are stored in a single allocation (or arena), with
+// the VkuNameBlock itself at the start. The name at nameIndex is
+// (names + nameOffsets[nameIndex]) and is null-terminated.
+typedef struct VkuNameBlock
 {
-	uint32_t extensionNameCount = 0;
-	char **extensionNames = vkuGetInstanceExtensionNames(pLayerName, &extensionNameCount);
+	uint32_t nameCount;
 
-	for (uint32_t extensionNameIndex = 0; extensionNameIndex < extensionNameCount; extensionNameIndex++)
-	{
-		if (vku_strcmp(extensionNames[extensionNameIndex], pExtensionName))
-		{
-			vkuDeleteInstanceExtensionNames(extensionNameCount, extensionNames);
+	const uint32_t *nameOffsets;
+	const uint32_t *nameLengths; // Excluding the null-terminator
 
-			return VK_TRUE;
-		}
-	}
+	const char *names;
+} VkuNameBlock;
 
-	vkuDeleteInstanceExtensionNames(extensionNameCount, extensionNames);
 
-	return VK_FALSE;
+#define VKU_NAME_BLOCK_ALIGNMENT sizeof(void*)
+
+
+VKUAPI_ATTR const char* vkuGetNameBlockName(const VkuNameBlock *nameBlock, uint32_t nameIndex)
+{
+	assert(nameBlock);
+	assert(nameIndex < nameBlock->nameCount);
+
+	return nameBlock->names + nameBlock->nameOffsets[nameIndex];
 }
 
-VKUAPI_ATTR VkBool32 vkuIsDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char *pLayerName, const char *pExtensionName)
+
+static size_t vku_nameBlockNamesOffset(uint32_t nameCount)
 {
-	uint32_t extensionNameCount = 0;
-	char **extensionNames = vkuGetDeviceExtensionNames(physicalDevice, pLayerName, &extensionNameCount);
+	const size_t arraysOffset = (sizeof(VkuNameBlock) + VKU_NAME_BLOCK_ALIGNMENT - 1) & ~(VKU_NAME_BLOCK_ALIGNMENT - 1);
 
-	for (uint32_t extensionNameIndex = 0; extensionNameIndex < extensionNameCount; extensionNameIndex++)
-	{
-		if (vku_strcmp(extensionNames[extensionNameIndex], pExtensionName))
-		{
-			vkuDeleteDeviceExtensionNames(extensionNameCount, extensionNames);
+	return arraysOffset + 2 * nameCount * sizeof(uint32_t);
+}
 
-			return VK_TRUE;
-		}
-	}
+static void vku_setNameBlockPointers(VkuNameBlock *nameBlock, uint32_t nameCount)
+{
+	const size_t arraysOffset = (sizeof(VkuNameBlock) + VKU_NAME_BLOCK_ALIGNMENT - 1) & ~(VKU_NAME_BLOCK_ALIGNMENT - 1);
 
-	vkuDeleteDeviceExtensionNames(extensionNameCount, extensionNames);
+	char *block = (char*) nameBlock;
 
-	return VK_FALSE;
+	nameBlock->nameCount = nameCount;
+	nameBlock->nameOffsets = (const uint32_t*) (block + arraysOffset);
+	nameBlock->nameLengths = nameBlock->nameOffsets + nameCount;
+	nameBlock->names = block + vku_nameBlockNamesOffset(nameCount);
 }
 
 
-VKUAPI_ATTR VkBool32 vkuIsInstanceLayerSupported(const char *pLayerName)
+// physicalDevice being VK_NULL_HANDLE means the instance layers/extensions are enumerated.
+// Both VkExtensionProperties and VkLayerProperties start with the name.
+static VkResult vku_enumerateNameProperties(VkBool32 layers, VkPhysicalDevice physicalDevice, const char *pLayerName, uint32_t *propertyCount, void *properties)
 {
-	uint32_t layerNameCount = 0;
-	char **layerNames = vkuGetInstanceLayerNames(&layerNameCount);
-
-	for (uint32_t layerNameIndex = 0; layerNameIndex < layerNameCount; layerNameIndex++)
+	if (layers)
 	{
-		if (vku_strcmp(layerNames[layerNameIndex], pLayerName))
-		{
-			vkuDeleteInstanceLayerNames(layerNameCount, layerNames);
+		if (physicalDevice)
+			return vkEnumerateDeviceLayerProperties(physicalDevice, propertyCount, (VkLayerProperties*) properties);
 
-			return VK_TRUE;
-		}
+		return vkEnumerateInstanceLayerProperties(propertyCount, (VkLayerProperties*) properties);
 	}
 
-	vkuDeleteInstanceLayerNames(layerNameCount, layerNames);
+	if (physicalDevice)
+		return vkEnumerateDeviceExtensionProperties(physicalDevice, pLayerName, propertyCount, (VkExtensionProperties*) properties);
 
-	return VK_FALSE;
+	return vkEnumerateInstanceExtensionProperties(pLayerName, propertyCount, (VkExtensionProperties*) properties);
 }
 
-VKUAPI_ATTR VkBool32 vkuIsDeviceLayerSupported(VkPhysicalDevice physicalDevice, const char *pLayerName)
+// Enumerates into an arena of arenaSize bytes, which must be at least the required size
+// for nameCount names. If there's more names now, then nameCount is updated and
+// VK_INCOMPLETE is returned. On success the used size is written to arenaSize.
+static VkResult vku_fillNameBlock(VkBool32 layers, VkPhysicalDevice physicalDevice, const char *pLayerName, uint32_t *nameCount, size_t *arenaSize, void *arena)
 {
-	uint32_t layerNameCount = 0;
-	char **layerNames = vkuGetDeviceLayerNames(physicalDevice, &layerNameCount);
+	const size_t propertyStride = layers ? sizeof(VkLayerProperties) : sizeof(VkExtensionProperties);
 
-	for (uint32_t layerNameIndex = 0; layerNameIndex < layerNameCount; layerNameIndex++)
+
+	// The properties are enumerated into the end of the arena and
+	// then compacted in place, as such the required size includes
+	// room for the properties themselves.
+	const size_t namesOffset = vku_nameBlockNamesOffset(*nameCount);
+
+	assert((*arenaSize) >= (namesOffset + (*nameCount) * propertyStride));
+
+
+	char *properties = ((char*) arena) + namesOffset;
+
+	VkResult err = VK_SUCCESS;
+
+	if ((*nameCount) > 0)
+		err = vku_enumerateNameProperties(layers, physicalDevice, pLayerName, nameCount, properties);
+
+	if (err == VK_INCOMPLETE)
 	{
-		if (vku_strcmp(layerNames[layerNameIndex], pLayerName))
-		{
-			vkuDeleteDeviceLayerNames(layerNameCount, layerNames);
+		// More names were added since the count was queried
+		err = vku_enumerateNameProperties(layers, physicalDevice, pLayerName, nameCount, NULL);
 
-			return VK_TRUE;
-		}
+		return err ? err : VK_INCOMPLETE;
 	}
+	else if (err)
+		return err;
 
-	vkuDeleteDeviceLayerNames(layerNameCount, layerNames);
-
-	return VK_FALSE;
-}
 
+	// The enumerated count can only have become smaller, in which case the
+	// offsets and lengths just end up being followed by some padding.
+	VkuNameBlock *nameBlock = (VkuNameBlock*) arena;
+	vku_setNameBlockPointers(nameBlock, *nameCount);
 
+	nameBlock->names = properties;
 
-VKUAPI_ATTR VkResult vkuCreateInstance(uint32_t apiVersion,
-	uint32_t enabledExtensionCount, const char* const* ppEnabledExtensionNames,
-	uint32_t enabledLayerCount, const char* const* ppEnabledLayerNames,
-	const VkAllocationCallbacks *pAllocator,
-	VkInstance *instance)
-{
-	VkApplicationInfo appInfo;
-	memset(&appInfo, 0, sizeof(appInfo));
+	uint32_t *nameOffsets = (uint32_t*) nameBlock->nameOffsets;
+	uint32_t *nameLengths = (uint32_t*) nameBlock->nameLengths;
 
-	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-	appInfo.pApplicationName = "VulkanApp";
-	appInfo.pEngineName = "VulkanEngine";
-	appInfo.apiVersion = apiVersion;
+	size_t nameOffset = 0;
 
+	for (uint32_t nameIndex = 0; nameIndex < (*nameCount); nameIndex++)
+	{
+		const char *name = properties + nameIndex * propertyStride;
+		const size_t nameLength = strlen(name);
 
-	VkInstanceCreateInfo instCreateInfo;
-	memset(&instCreateInfo, 0, sizeof(instCreateInfo));
+		// The destination never passes the source, as each
+		// name is shorter than the properties containing it.
+		memmove(properties + nameOffset, name, nameLength + 1);
 
-	instCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-	instCreateInfo.pNext = NULL;
-	instCreateInfo.pApplicationInfo = &appInfo;
+		nameOffsets[nameIndex] = (uint32_t) nameOffset;
+		nameLengths[nameIndex] = (uint32_t) nameLength;
 
+		nameOffset += nameLength + 1;
+	}
 
-	instCreateInfo.enabledExtensionCount = enabledExtensionCount;
-	instCreateInfo.ppEnabledExtensionNames = ppEnabledExtensionNames;
 
-	instCreateInfo.enabledLayerCount = enabledLayerCount;
-	instCreateInfo.ppEnabledLayerNames = ppEnabledLayerNames;
+	(*arenaSize) = namesOffset + nameOffset;
 
+	return VK_SUCCESS;
+}
 
-	return vkCreateInstance(&instCreateInfo, pAllocator, instance);
+static size_t vku_getNameBlockRequiredSize(VkBool32 layers, uint32_t nameCount)
+{
+	return vku_nameBlockNamesOffset(nameCount) + nameCount * (layers ? sizeof(VkLayerProperties) : sizeof(VkExtensionProperties));
 }
 
-VKUAPI_ATTR VkResult vkuCreateSimpleInstance(uint32_t apiVersion, VkBool32 enableValidation, const VkAllocationCallbacks *pAllocator, VkInstance *instance)
+static VkResult vku_writeNameBlock(VkBool32 layers, VkPhysicalDevice physicalDevice, const char *pLayerName, size_t *arenaSize, void *arena)
 {
-	uint32_t enabledExtensionCount = 0;
-	char **enabledExtensionNames = vkuGetInstanceExtensionNames(NULL, &enabledExtensionCount);
+	assert(arenaSize);
 
-	uint32_t actualExtensionCount = enabledExtensionCount;
 
+	uint32_t nameCount = 0;
+	VkResult err = vku_enumerateNameProperties(layers, physicalDevice, pLayerName, &nameCount, NULL);
 
-	uint32_t enabledLayerCount = 0;
-	char **enabledLayerNames = NULL;
+	if (err)
+		return err;
 
-	uint32_t actualLayerCount = enabledLayerCount;
 
+	const size_t requiredSize = vku_getNameBlockRequiredSize(layers, nameCount);
 
-	if (enableValidation)
+	if (!arena)
 	{
-		// Validation is enabled, so just add all the layers
+		(*arenaSize) = requiredSize;
 
-		enabledLayerNames = vkuGetInstanceLayerNames(&enabledLayerCount);
-		actualLayerCount = enabledLayerCount;
+		return VK_SUCCESS;
 	}
-	else
-	{
-		// Validation is not enabled, so remove the VK_EXT_debug_report extension
 
-		for (uint32_t enabledExtensionIndex = 0; enabledExtensionIndex < actualExtensionCount; enabledExtensionIndex++)
-		{
-			char *enabledExtensionName = enabledExtensionNames[enabledExtensionIndex];
+	assert((((size_t) arena) & (VKU_NAME_BLOCK_ALIGNMENT - 1)) == 0);
 
-			if (!vku_strcmp(enabledExtensionName, VK_EXT_DEBUG_REPORT_EXTENSION_NAME))
-			{
-				// If it's the last extension name, just decrement enabledExtensionCount
-				if (enabledExtensionIndex == (actualExtensionCount - 1))
-				{
-					enabledExtensionCount--;
-				}
-				else // If not, swap with the last extension name
-				{
-					enabledExtensionNames[enabledExtensionIndex] = enabledExtensionNames[actualExtensionCount - 1];
-					enabledExtensionNames[actualExtensionCount - 1] = enabledExtensionName;
+	if ((*arenaSize) < requiredSize)
+	{
+		(*arenaSize) = requiredSize;
 
-					// The first if will be called in the end, decrementing the enabledExtensionCount
-				}
-			}
-		}
+		return VK_INCOMPLETE;
 	}
 
 
-	VkResult err = vkuCreateInstance(apiVersion, enabledExtensionCount, enabledExtensionNames, enabledLayerCount, enabledLayerNames, pAllocator, instance);
-
-
-	// Remember to delete it by the actualExtensionCount and not the enabledExtensionCount
-	vkuDeleteInstanceExtensionNames(actualExtensionCount, enabledExtensionNames);
-	// enabledExtensionNames = NULL;
-
-	// Remember to delete it by the actualLayerCount and not the enabledLayerCount
-	vkuDeleteInstanceLayerNames(actualLayerCount, enabledLayerNames);
-	// enabledLayerNames = NULL;
+	err = vku_fillNameBlock(layers, physicalDevice, pLayerName, &nameCount, arenaSize, arena);
 
+	if (err == VK_INCOMPLETE)
+		(*arenaSize) = vku_getNameBlockRequiredSize(layers, nameCount);
 
 	return err;
 }
 
-
-
-VKUAPI_ATTR VkResult vkuGetPhysicalDevice(VkInstance instance, VkPhysicalDevice *physicalDevice)
+static VkResult vku_createNameBlock(VkBool32 layers, VkPhysicalDevice physicalDevice, const char *pLayerName, VkuNameBlock **nameBlock)
 {
-	assert(physicalDevice);
+	(*nameBlock) = NULL;
 
+	uint32_t nameCount = 0;
+	VkResult err = vku_enumerateNameProperties(layers, physicalDevice, pLayerName, &nameCount, NULL);
 
-	uint32_t gpuCount = 0;
-	VkResult err = vkEnumeratePhysicalDevices(instance, &gpuCount, NULL);
-	assert(!err);
-	assert(gpuCount > 0);
+	if (err)
+		return err;
 
-	// printf("GPUs: %d\n", gpuCount);
 
-	VkPhysicalDevice *physicalDevices = (VkPhysicalDevice*) calloc(gpuCount, sizeof(VkPhysicalDevice));
-	assert(physicalDevices);
+	void *block = NULL;
+	size_t blockSize = 0;
 
-	err = vkEnumeratePhysicalDevices(instance, &gpuCount, physicalDevices);
-	assert(!err);
+	do
+	{
+		VKU_FREE(block);
 
-	// Right now, just use the first encountered physical device
-	(*physicalDevice) = physicalDevices[0];
+		blockSize = vku_getNameBlockRequiredSize(layers, nameCount);
+		block = VKU_MALLOC(blockSize);
 
-	free(physicalDevices);
+		if (!block)
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
 
-	return err;
-}
+		err = vku_fillNameBlock(layers, physicalDevice, pLayerName, &nameCount, &blockSize, block);
+	}
+	while (err == VK_INCOMPLETE);
 
+	if (err)
+	{
+		VKU_FREE(block);
 
+		return err;
+	}
 
-VKUAPI_ATTR VkBool32 vkuGetQueueFamilyIndex(VkPhysicalDevice physicalDevice, uint32_t *queueFamilyIndex)
-{
-	assert(queueFamilyIndex);
 
+	// Give back the space used for enumerating the properties.
+	// If the block moved, then the pointers need to be updated.
+	const size_t namesOffset = ((VkuNameBlock*) block)->names - ((char*) block);
 
-	uint32_t queueCount;
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueCount, NULL);
-	assert(queueCount > 0);
+	void *shrunkBlock = VKU_REALLOC(block, blockSize);
 
-	VkQueueFamilyProperties *queueFamilyProperties = (VkQueueFamilyProperties*) calloc(queueCount, sizeof(VkQueueFamilyProperties));
-	assert(queueFamilyProperties);
+	if (shrunkBlock && (shrunkBlock != block))
+	{
+		block = shrunkBlock;
 
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueCount, queueFamilyProperties);
+		VkuNameBlock *nameBlock = (VkuNameBlock*) block;
+		vku_setNameBlockPointers(nameBlock, nameBlock->nameCount);
 
-	for ((*queueFamilyIndex) = 0; (*queueFamilyIndex) < queueCount; (*queueFamilyIndex)++)
-		if (queueFamilyProperties[(*queueFamilyIndex)].queueFlags & VK_QUEUE_GRAPHICS_BIT)
-			break;
+		nameBlock->names = ((char*) block) + namesOffset;
+	}
 
-	// assert((*queueFamilyIndex) < queueCount);
 
+	(*nameBlock) = (VkuNameBlock*) block;
 
-	free(queueFamilyProperties);
+	return VK_SUCCESS;
+}
 
 
-	if ((*queueFamilyIndex) < queueCount)
-		return VK_TRUE;
+// The vkuWrite*NameBlock() functions work like the Vulkan enumeration functions. If arena is NULL,
+// then the required size is written to arenaSize. If arenaSize is too small, then the required size is
+// written to arenaSize and VK_INCOMPLETE is returned. On success the used size is written to arenaSize,
+// which is smaller than the required size, as it includes scratch space used while enumerating.
+// The arena must be aligned to VKU_NAME_BLOCK_ALIGNMENT and starts with the VkuNameBlock.
 
-	return VK_FALSE;
+VKUAPI_ATTR VkResult vkuWriteInstanceExtensionNameBlock(const char *pLayerName, size_t *arenaSize, void *arena)
+{
+	return vku_writeNameBlock(VK_FALSE, VK_NULL_HANDLE, pLayerName, arenaSize, arena);
 }
 
+VKUAPI_ATTR VkResult vkuWriteDeviceExtensionNameBlock(VkPhysicalDevice physicalDevice, const char *pLayerName, size_t *arenaSize, void *arena)
+{
+	assert(physicalDevice);
 
+	return vku_writeNameBlock(VK_FALSE, physicalDevice, pLayerName, arenaSize, arena);
+}
 
-VKUAPI_ATTR VkResult vkuCreateDevice(
-	uint32_t enabledExtensionCount, const char* const* ppEnabledExtensionNames,
-	uint32_t enabledLayerCount, const char* const* ppEnabledLayerNames,
-	const VkAllocationCallbacks *pAllocator,
-	VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkDevice *device)
+VKUAPI_ATTR VkResult vkuWriteInstanceLayerNameBlock(size_t *arenaSize, void *arena)
 {
-	assert(device);
+	return vku_writeNameBlock(VK_TRUE, VK_NULL_HANDLE, NULL, arenaSize, arena);
+}
 
+VKUAPI_ATTR VkResult vkuWriteDeviceLayerNameBlock(VkPhysicalDevice physicalDevice, size_t *arenaSize, void *arena)
+{
+	assert(physicalDevice);
 
-	VkDeviceQueueCreateInfo queueCreateInfo;
-	memset(&queueCreateInfo, 0, sizeof(queueCreateInfo));
+	return vku_writeNameBlock(VK_TRUE, physicalDevice, NULL, arenaSize, arena);
+}
 
-	queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
 
-	const uint32_t queuePrioritiesCount = 1;
-	const float queuePriorities[1] = { 0.0f };
+// The vkuGet*NameBlock() functions return a single allocation,
+// which can be deleted using vkuDeleteNameBlock() or VKU_FREE().
+// NULL is returned if the enumeration fails.
 
-	queueCreateInfo.queueCount = queuePrioritiesCount;
-	queueCreateInfo.pQueuePriorities = queuePriorities;
+VKUAPI_ATTR VkuNameBlock* vkuGetInstanceExtensionNameBlock(const char *pLayerName)
+{
+	VkuNameBlock *nameBlock;
+	vku_createNameBlock(VK_FALSE, VK_NULL_HANDLE, pLayerName, &nameBlock);
 
+	return nameBlock;
+}
 
-	VkDeviceCreateInfo deviceCreateInfo;
-	memset(&deviceCreateInfo, 0, sizeof(deviceCreateInfo));
+VKUAPI_ATTR VkuNameBlock* vkuGetDeviceExtensionNameBlock(VkPhysicalDevice physicalDevice, const char *pLayerName)
+{
+	assert(physicalDevice);
 
-	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	deviceCreateInfo.pNext = NULL;
+	VkuNameBlock *nameBlock;
+	vku_createNameBlock(VK_FALSE, physicalDevice, pLayerName, &nameBlock);
 
-	deviceCreateInfo.queueCreateInfoCount = 1;
-	deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+	return nameBlock;
+}
 
-	deviceCreateInfo.pEnabledFeatures = NULL;
+VKUAPI_ATTR VkuNameBlock* vkuGetInstanceLayerNameBlock(void)
+{
+	VkuNameBlock *nameBlock;
+	vku_createNameBlock(VK_TRUE, VK_NULL_HANDLE, NULL, &nameBlock);
 
-	deviceCreateInfo.enabledExtensionCount = enabledExtensionCount;
-	deviceCreateInfo.ppEnabledExtensionNames = ppEnabledExtensionNames;
+	return nameBlock;
+}
 
-	deviceCreateInfo.enabledLayerCount = enabledLayerCount;
-	deviceCreateInfo.ppEnabledLayerNames = ppEnabledLayerNames;
+VKUAPI_ATTR VkuNameBlock* vkuGetDeviceLayerNameBlock(VkPhysicalDevice physicalDevice)
+{
+	assert(physicalDevice);
 
+	VkuNameBlock *nameBlock;
+	vku_createNameBlock(VK_TRUE, physicalDevice, NULL, &nameBlock);
 
-	return vkCreateDevice(physicalDevice, &deviceCreateInfo, pAllocator, device);
+	return nameBlock;
 }
 
-VKUAPI_ATTR VkResult vkuCreateSimpleDevice(VkBool32 enableValidation, const VkAllocationCallbacks *pAllocator, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkDevice *device)
+
+VKUAPI_ATTR void vkuDeleteNameBlock(VkuNameBlock *nameBlock)
 {
-	assert(device);
+	VKU_FREE(nameBlock);
+}
 
 
-	uint32_t enabledExtensionCount = 0;
-	char **enabledExtensionNames = vkuGetDeviceExtensionNames(physicalDevice, NULL, &enabledExtensionCount);
 
-	uint32_t actualExtensionCount = enabledExtensionCount;
+// The hash is 32-bit FNV-1a and is stable, so the hashes of well-known
+// names (e.g. VK_KHR_SWAPCHAIN_EXTENSION_NAME) can be precomputed.
+VKUAPI_ATTR uint32_t vkuHashName(const char *name)
+{
+	assert(name);
 
+	uint32_t hash = 2166136261u;
 
-	uint32_t enabledLayerCount = 0;
-	char **enabledLayerNames = NULL;
+	while (*name)
+	{
+		hash ^= (uint32_t) (*(const unsigned char*) name++);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+
+// Precomputed vkuHashName() of common extension and layer names, e.g. for the hashes passed to vkuGet*Support()
+
+#define VKU_HASH_KHR_SURFACE                         0x311266AEu
+#define VKU_HASH_KHR_WIN32_SURFACE                   0x1988D866u
+#define VKU_HASH_KHR_XLIB_SURFACE                    0xD61EBB2Cu
+#define VKU_HASH_KHR_XCB_SURFACE                     0xEF399ED0u
+#define VKU_HASH_KHR_WAYLAND_SURFACE                 0x8317B66Fu
+#define VKU_HASH_KHR_ANDROID_SURFACE                 0x06505DCAu
+#define VKU_HASH_EXT_METAL_SURFACE                   0x05524F8Eu
+#define VKU_HASH_KHR_GET_PHYSICAL_DEVICE_PROPERTIES2 0x6556FF70u
+#define VKU_HASH_KHR_PORTABILITY_ENUMERATION         0xF1DF32AAu
+#define VKU_HASH_EXT_DEBUG_REPORT                    0xA1D4D1D9u
+#define VKU_HASH_EXT_DEBUG_UTILS                     0x25456810u
+#define VKU_HASH_KHR_SWAPCHAIN                       0x2FAB4BBDu
+#define VKU_HASH_KHR_MAINTENANCE1                    0xA91F6641u
+#define VKU_HASH_KHR_PORTABILITY_SUBSET              0x724EF161u
+#define VKU_HASH_KHR_DEDICATED_ALLOCATION            0xA6E18667u
+#define VKU_HASH_KHR_GET_MEMORY_REQUIREMENTS2        0x3C8F0038u
+#define VKU_HASH_KHR_PUSH_DESCRIPTOR                 0x2368FF59u
+#define VKU_HASH_KHR_TIMELINE_SEMAPHORE              0x20A7A39Du
+#define VKU_HASH_KHR_DYNAMIC_RENDERING               0x5A58B403u
+#define VKU_HASH_KHR_SYNCHRONIZATION2                0x4E0B3089u
+#define VKU_HASH_EXT_DESCRIPTOR_INDEXING             0x3159762Bu
+#define VKU_HASH_EXT_MEMORY_BUDGET                   0xD05F701Cu
+#define VKU_HASH_EXT_PIPELINE_CREATION_FEEDBACK      0x12D3CF47u
+#define VKU_HASH_LAYER_KHRONOS_VALIDATION            0x0A40BF87u
+
+
+// physicalDevice being VK_NULL_HANDLE means the instance extensions are enumerated
+static VkResult vku_enumerateExtensionProperties(VkPhysicalDevice physicalDevice, const char *pLayerName, uint32_t *propertyCount, VkExtensionProperties **properties)
+{
+	assert(propertyCount);
+	assert(properties);
+
+
+	VkResult err;
+
+	(*propertyCount) = 0;
+	(*properties) = NULL;
+
+
+	do
+	{
+		uint32_t count = 0;
+
+		if (physicalDevice)
+			err = vkEnumerateDeviceExtensionProperties(physicalDevice, pLayerName, &count, NULL);
+		else
+			err = vkEnumerateInstanceExtensionProperties(pLayerName, &count, NULL);
+
+		if (err || (count < 1))
+			return err;
+
+
+		VKU_FREE(*properties);
+
+		(*properties) = (VkExtensionProperties*) VKU_CALLOC(count, sizeof(VkExtensionProperties));
+
+		if (!(*properties))
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+		if (physicalDevice)
+			err = vkEnumerateDeviceExtensionProperties(physicalDevice, pLayerName, &count, *properties);
+		else
+			err = vkEnumerateInstanceExtensionProperties(pLayerName, &count, *properties);
+
+		(*propertyCount) = count;
+	}
+	while (err == VK_INCOMPLETE); // The count changed in between the two calls
+
+	if (err)
+	{
+		VKU_FREE(*properties);
+
+		(*properties) = NULL;
+		(*propertyCount) = 0;
+	}
+
+	return err;
+}
+
+// physicalDevice being VK_NULL_HANDLE means the instance layers are enumerated
+static VkResult vku_enumerateLayerProperties(VkPhysicalDevice physicalDevice, uint32_t *propertyCount, VkLayerProperties **properties)
+{
+	assert(propertyCount);
+	assert(properties);
+
+
+	VkResult err;
+
+	(*propertyCount) = 0;
+	(*properties) = NULL;
+
+
+	do
+	{
+		uint32_t count = 0;
+
+		if (physicalDevice)
+			err = vkEnumerateDeviceLayerProperties(physicalDevice, &count, NULL);
+		else
+			err = vkEnumerateInstanceLayerProperties(&count, NULL);
+
+		if (err || (count < 1))
+			return err;
+
+
+		VKU_FREE(*properties);
+
+		(*properties) = (VkLayerProperties*) VKU_CALLOC(count, sizeof(VkLayerProperties));
+
+		if (!(*properties))
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+		if (physicalDevice)
+			err = vkEnumerateDeviceLayerProperties(physicalDevice, &count, *properties);
+		else
+			err = vkEnumerateInstanceLayerProperties(&count, *properties);
+
+		(*propertyCount) = count;
+	}
+	while (err == VK_INCOMPLETE); // The count changed in between the two calls
+
+	if (err)
+	{
+		VKU_FREE(*properties);
+
+		(*properties) = NULL;
+		(*propertyCount) = 0;
+	}
+
+	return err;
+}
+
+
+
+// A sorted table of names, ordered by (hash, name), such that
+// lookups are a binary search mostly comparing integers.
+// The hashes, name pointers and the name strings all live
+// in the same allocation, which is owned by nameHashes.
+typedef struct vku_name_table
+{
+	uint32_t nameCount;
+	uint32_t *nameHashes;
+	const char **names;
+} vku_name_table;
+
+
+static int vku_compareNameTableEntries(uint32_t hash1, const char *name1, uint32_t hash2, const char *name2)
+{
+	if (hash1 != hash2)
+		return (hash1 < hash2) ? -1 : 1;
+
+	return vku_strcmp(name1, name2);
+}
+
+static const char* vku_getNextName(const char *name, size_t stride)
+{
+	return name + (stride ? stride : (strlen(name) + 1));
+}
+
+// Names are read from count structs of stride bytes, starting at first. A stride
+// of 0 means the names are packed one after the other, e.g. "a\0bc\0d\0".
+static VkResult vku_createNameTable(uint32_t count, const char *first, size_t stride, vku_name_table *table)
+{
+	assert(table);
+
+	memset(table, 0, sizeof(vku_name_table));
+
+	if (count < 1)
+		return VK_SUCCESS;
+
+
+	size_t nameDataSize = 0;
+
+	const char *name = first;
+
+	for (uint32_t nameIndex = 0; nameIndex < count; nameIndex++, name = vku_getNextName(name, stride))
+		nameDataSize += strlen(name) + 1;
+
+
+	const size_t hashesSize = count * sizeof(uint32_t);
+	const size_t namesOffset = (hashesSize + sizeof(char*) - 1) & ~(sizeof(char*) - 1);
+	const size_t namesSize = count * sizeof(char*);
+
+	char *block = (char*) VKU_MALLOC(namesOffset + namesSize + nameDataSize);
+
+	if (!block)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	table->nameCount = count;
+	table->nameHashes = (uint32_t*) block;
+	table->names = (const char**) (block + namesOffset);
+
+	char *nameData = block + namesOffset + namesSize;
+
+
+	// Insertion sort, as the amount of extensions/layers is small
+	// and the enumeration order is often already close to sorted
+
+	name = first;
+
+	for (uint32_t nameIndex = 0; nameIndex < count; nameIndex++, name = vku_getNextName(name, stride))
+	{
+		const size_t nameSize = strlen(name) + 1;
+
+		memcpy(nameData, name, nameSize);
+
+		const uint32_t hash = vkuHashName(nameData);
+
+		uint32_t insertIndex = nameIndex;
+
+		while ((insertIndex > 0) && (vku_compareNameTableEntries(hash, nameData, table->nameHashes[insertIndex - 1], table->names[insertIndex - 1]) < 0))
+		{
+			table->nameHashes[insertIndex] = table->nameHashes[insertIndex - 1];
+			table->names[insertIndex] = table->names[insertIndex - 1];
+
+			insertIndex--;
+		}
+
+		table->nameHashes[insertIndex] = hash;
+		table->names[insertIndex] = nameData;
+
+		nameData += nameSize;
+	}
+
+
+	return VK_SUCCESS;
+}
+
+static void vku_destroyNameTable(vku_name_table *table)
+{
+	assert(table);
+
+	VKU_FREE(table->nameHashes);
+
+	memset(table, 0, sizeof(vku_name_table));
+}
+
+// Returns the index of the name or table->nameCount if it isn't found
+static uint32_t vku_findName(const vku_name_table *table, const char *name, uint32_t hash)
+{
+	uint32_t first = 0;
+	uint32_t last = table->nameCount;
+
+	while (first < last)
+	{
+		const uint32_t middle = first + (last - first) / 2;
+
+		const int cmp = vku_compareNameTableEntries(hash, name, table->nameHashes[middle], table->names[middle]);
+
+		if (cmp == 0)
+			return middle;
+
+		if (cmp < 0)
+			last = middle;
+		else
+			first = middle + 1;
+	}
+
+	return table->nameCount;
+}
+
+
+
+typedef struct VkuCapabilityRegistry_T* VkuCapabilityRegistry;
+
+struct VkuCapabilityRegistry_T
+{
+	// VK_NULL_HANDLE for an instance registry
+	VkPhysicalDevice physicalDevice;
+
+	vku_name_table layers;
+
+	// The extensions provided by the implementation, followed
+	// by the extensions provided by each layer, in the same
+	// (sorted) order as the layers table.
+	vku_name_table *extensions;
+
+	// Only set for the registry of a VkuDeviceProfile, in which case device selection
+	// and queue discovery use them instead of querying the physical device
+	const VkPhysicalDeviceProperties *pProperties;
+	const VkPhysicalDeviceMemoryProperties *pMemoryProperties;
+	uint32_t queueFamilyCount;
+	const VkQueueFamilyProperties *pQueueFamilyProperties;
+
+	VkuCapabilityRegistry pNextBound;
+};
+
+
+// Registries bound using vkuBindCapabilityRegistry(), used by
+// vkuIsInstance/Device*Supported() to avoid enumerating. Like every
+// function in vku, it's static, so each translation unit including
+// vku.h has its own list, and registries have to be bound in each.
+static VkuCapabilityRegistry vku_boundCapabilityRegistries = NULL;
+
+
+VKUAPI_ATTR void vkuDestroyCapabilityRegistry(VkuCapabilityRegistry registry);
+
+static VkResult vku_createCapabilityRegistry(VkPhysicalDevice physicalDevice, VkuCapabilityRegistry *registry)
+{
+	assert(registry);
+
+
+	(*registry) = (VkuCapabilityRegistry) VKU_CALLOC(1, sizeof(struct VkuCapabilityRegistry_T));
+
+	if (!(*registry))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	(*registry)->physicalDevice = physicalDevice;
+
+
+	uint32_t layerPropertyCount = 0;
+	VkLayerProperties *layerProperties = NULL;
+
+	VkResult err = vku_enumerateLayerProperties(physicalDevice, &layerPropertyCount, &layerProperties);
+
+	if (!err)
+		err = vku_createNameTable(layerPropertyCount, layerProperties ? layerProperties[0].layerName : NULL, sizeof(VkLayerProperties), &(*registry)->layers);
+
+	VKU_FREE(layerProperties);
+
+
+	if (!err)
+	{
+		(*registry)->extensions = (vku_name_table*) VKU_CALLOC((*registry)->layers.nameCount + 1, sizeof(vku_name_table));
+
+		if (!(*registry)->extensions)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+
+	for (uint32_t tableIndex = 0; !err && (tableIndex <= (*registry)->layers.nameCount); tableIndex++)
+	{
+		const char *pLayerName = (tableIndex > 0) ? (*registry)->layers.names[tableIndex - 1] : NULL;
+
+		uint32_t extPropertyCount = 0;
+		VkExtensionProperties *extProperties = NULL;
+
+		err = vku_enumerateExtensionProperties(physicalDevice, pLayerName, &extPropertyCount, &extProperties);
+
+		if (!err)
+			err = vku_createNameTable(extPropertyCount, extProperties ? extProperties[0].extensionName : NULL, sizeof(VkExtensionProperties), &(*registry)->extensions[tableIndex]);
+
+		VKU_FREE(extProperties);
+	}
+
+
+	if (err)
+	{
+		vkuDestroyCapabilityRegistry(*registry);
+
+		(*registry) = NULL;
+	}
+
+	return err;
+}
+
+
+VKUAPI_ATTR VkResult vkuCreateInstanceCapabilityRegistry(VkuCapabilityRegistry *registry)
+{
+	return vku_createCapabilityRegistry(VK_NULL_HANDLE, registry);
+}
+
+VKUAPI_ATTR VkResult vkuCreateDeviceCapabilityRegistry(VkPhysicalDevice physicalDevice, VkuCapabilityRegistry *registry)
+{
+	assert(physicalDevice);
+
+	return vku_createCapabilityRegistry(physicalDevice, registry);
+}
+
+
+VKUAPI_ATTR void vkuUnbindCapabilityRegistry(VkuCapabilityRegistry registry)
+{
+	for (VkuCapabilityRegistry *bound = &vku_boundCapabilityRegistries; *bound; bound = &(*bound)->pNextBound)
+	{
+		if ((*bound) == registry)
+		{
+			(*bound) = registry->pNextBound;
+			registry->pNextBound = NULL;
+
+			return;
+		}
+	}
+}
+
+// Binding isn't thread safe, bind the registries before
+// checking support from multiple threads.
+VKUAPI_ATTR void vkuBindCapabilityRegistry(VkuCapabilityRegistry registry)
+{
+	assert(registry);
+
+	// Only keep a single registry bound for each instance/physical device
+	for (VkuCapabilityRegistry bound = vku_boundCapabilityRegistries; bound; bound = bound->pNextBound)
+	{
+		if (bound->physicalDevice == registry->physicalDevice)
+		{
+			vkuUnbindCapabilityRegistry(bound);
+			break;
+		}
+	}
+
+	registry->pNextBound = vku_boundCapabilityRegistries;
+	vku_boundCapabilityRegistries = registry;
+}
+
+VKUAPI_ATTR void vkuDestroyCapabilityRegistry(VkuCapabilityRegistry registry)
+{
+	if (!registry)
+		return;
+
+	vkuUnbindCapabilityRegistry(registry);
+
+
+	if (registry->extensions)
+	{
+		for (uint32_t tableIndex = 0; tableIndex <= registry->layers.nameCount; tableIndex++)
+			vku_destroyNameTable(&registry->extensions[tableIndex]);
+
+		VKU_FREE(registry->extensions);
+	}
+
+	vku_destroyNameTable(&registry->layers);
+
+
+	VKU_FREE(registry);
+}
+
+
+static VkuCapabilityRegistry vku_findBoundCapabilityRegistry(VkPhysicalDevice physicalDevice)
+{
+	for (VkuCapabilityRegistry bound = vku_boundCapabilityRegistries; bound; bound = bound->pNextBound)
+		if (bound->physicalDevice == physicalDevice)
+			return bound;
+
+	return NULL;
+}
+
+
+// The same as vkGetPhysicalDevice*Properties(), unless a VkuDeviceProfile's registry is bound
+
+static void vku_getPhysicalDeviceProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties *properties)
+{
+	VkuCapabilityRegistry registry = vku_findBoundCapabilityRegistry(physicalDevice);
+
+	if (registry && registry->pProperties)
+		(*properties) = (*registry->pProperties);
+	else
+		vkGetPhysicalDeviceProperties(physicalDevice, properties);
+}
+
+static void vku_getPhysicalDeviceMemoryProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties *memoryProperties)
+{
+	VkuCapabilityRegistry registry = vku_findBoundCapabilityRegistry(physicalDevice);
+
+	if (registry && registry->pMemoryProperties)
+		(*memoryProperties) = (*registry->pMemoryProperties);
+	else
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, memoryProperties);
+}
+
+static void vku_getPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice physicalDevice, uint32_t *queueFamilyCount, VkQueueFamilyProperties *queueFamilyProperties)
+{
+	VkuCapabilityRegistry registry = vku_findBoundCapabilityRegistry(physicalDevice);
+
+	if (!registry || !registry->pQueueFamilyProperties)
+	{
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, queueFamilyCount, queueFamilyProperties);
+		return;
+	}
+
+	if (queueFamilyProperties)
+	{
+		if ((*queueFamilyCount) > registry->queueFamilyCount)
+			(*queueFamilyCount) = registry->queueFamilyCount;
+
+		memcpy(queueFamilyProperties, registry->pQueueFamilyProperties, (*queueFamilyCount) * sizeof(VkQueueFamilyProperties));
+	}
+	else
+		(*queueFamilyCount) = registry->queueFamilyCount;
+}
+
+
+VKUAPI_ATTR VkBool32 vkuRegistryHasLayer(VkuCapabilityRegistry registry, const char *pLayerName)
+{
+	assert(registry);
+	assert(pLayerName);
+
+	if (vku_findName(&registry->layers, pLayerName, vkuHashName(pLayerName)) < registry->layers.nameCount)
+		return VK_TRUE;
+
+	return VK_FALSE;
+}
+
+// Returns NULL if pLayerName isn't supported
+static const vku_name_table* vku_getRegistryExtensionTable(VkuCapabilityRegistry registry, const char *pLayerName)
+{
+	if (!pLayerName)
+		return &registry->extensions[0];
+
+	const uint32_t layerIndex = vku_findName(&registry->layers, pLayerName, vkuHashName(pLayerName));
+
+	if (layerIndex >= registry->layers.nameCount)
+		return NULL;
+
+	return &registry->extensions[layerIndex + 1];
+}
+
+VKUAPI_ATTR VkBool32 vkuRegistryHasExtension(VkuCapabilityRegistry registry, const char *pLayerName, const char *pExtensionName)
+{
+	assert(registry);
+	assert(pExtensionName);
+
+
+	const vku_name_table *extensions = vku_getRegistryExtensionTable(registry, pLayerName);
+
+	if (!extensions)
+		return VK_FALSE;
+
+	if (vku_findName(extensions, pExtensionName, vkuHashName(pExtensionName)) < extensions->nameCount)
+		return VK_TRUE;
+
+	return VK_FALSE;
+}
+
+
+
+VKUAPI_ATTR VkBool32 vkuIsInstanceExtensionSupported(const char *pLayerName, const char *pExtensionName)
+{
+	VkuCapabilityRegistry registry = vku_findBoundCapabilityRegistry(VK_NULL_HANDLE);
+
+	if (registry)
+		return vkuRegistryHasExtension(registry, pLayerName, pExtensionName);
+
+
+	uint32_t extensionNameCount = 0;
+	char **extensionNames = vkuGetInstanceExtensionNames(pLayerName, &extensionNameCount);
+
+	for (uint32_t extensionNameIndex = 0; extensionNameIndex < extensionNameCount; extensionNameIndex++)
+	{
+		if (!vku_strcmp(extensionNames[extensionNameIndex], pExtensionName))
+		{
+			vkuDeleteInstanceExtensionNames(extensionNameCount, extensionNames);
+
+			return VK_TRUE;
+		}
+	}
+
+	vkuDeleteInstanceExtensionNames(extensionNameCount, extensionNames);
+
+	return VK_FALSE;
+}
+
+VKUAPI_ATTR VkBool32 vkuIsDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char *pLayerName, const char *pExtensionName)
+{
+	VkuCapabilityRegistry registry = vku_findBoundCapabilityRegistry(physicalDevice);
+
+	if (registry)
+		return vkuRegistryHasExtension(registry, pLayerName, pExtensionName);
+
+
+	uint32_t extensionNameCount = 0;
+	char **extensionNames = vkuGetDeviceExtensionNames(physicalDevice, pLayerName, &extensionNameCount);
+
+	for (uint32_t extensionNameIndex = 0; extensionNameIndex < extensionNameCount; extensionNameIndex++)
+	{
+		if (!vku_strcmp(extensionNames[extensionNameIndex], pExtensionName))
+		{
+			vkuDeleteDeviceExtensionNames(extensionNameCount, extensionNames);
+
+			return VK_TRUE;
+		}
+	}
+
+	vkuDeleteDeviceExtensionNames(extensionNameCount, extensionNames);
+
+	return VK_FALSE;
+}
+
+
+VKUAPI_ATTR VkBool32 vkuIsInstanceLayerSupported(const char *pLayerName)
+{
+	VkuCapabilityRegistry registry = vku_findBoundCapabilityRegistry(VK_NULL_HANDLE);
+
+	if (registry)
+		return vkuRegistryHasLayer(registry, pLayerName);
+
+
+	uint32_t layerNameCount = 0;
+	char **layerNames = vkuGetInstanceLayerNames(&layerNameCount);
+
+	for (uint32_t layerNameIndex = 0; layerNameIndex < layerNameCount; layerNameIndex++)
+	{
+		if (!vku_strcmp(layerNames[layerNameIndex], pLayerName))
+		{
+			vkuDeleteInstanceLayerNames(layerNameCount, layerNames);
+
+			return VK_TRUE;
+		}
+	}
+
+	vkuDeleteInstanceLayerNames(layerNameCount, layerNames);
+
+	return VK_FALSE;
+}
+
+VKUAPI_ATTR VkBool32 vkuIsDeviceLayerSupported(VkPhysicalDevice physicalDevice, const char *pLayerName)
+{
+	VkuCapabilityRegistry registry = vku_findBoundCapabilityRegistry(physicalDevice);
+
+	if (registry)
+		return vkuRegistryHasLayer(registry, pLayerName);
+
+
+	uint32_t layerNameCount = 0;
+	char **layerNames = vkuGetDeviceLayerNames(physicalDevice, &layerNameCount);
+
+	for (uint32_t layerNameIndex = 0; layerNameIndex < layerNameCount; layerNameIndex++)
+	{
+		if (!vku_strcmp(layerNames[layerNameIndex], pLayerName))
+		{
+			vkuDeleteDeviceLayerNames(layerNameCount, layerNames);
+
+			return VK_TRUE;
+		}
+	}
+
+	vkuDeleteDeviceLayerNames(layerNameCount, layerNames);
+
+	return VK_FALSE;
+}
+
+
+
+// Checks the support of nameCount names, using a single enumeration (or the bound
+// registry), writing VK_TRUE/VK_FALSE for each name to supported. The hashes
+// (from vkuHashName()) can be given in nameHashes, otherwise pass NULL.
+static VkResult vku_getSupport(VkBool32 layers, VkPhysicalDevice physicalDevice, const char *pLayerName,
+	uint32_t nameCount, const char* const* ppNames, const uint32_t *nameHashes, VkBool32 *supported)
+{
+	assert(!nameCount || ppNames);
+	assert(!nameCount || supported);
+
+
+	uint32_t missingCount = 0;
+
+	VkuCapabilityRegistry registry = vku_findBoundCapabilityRegistry(physicalDevice);
+
+	if (registry)
+	{
+		const vku_name_table *table = layers ? &registry->layers : vku_getRegistryExtensionTable(registry, pLayerName);
+
+		for (uint32_t nameIndex = 0; nameIndex < nameCount; nameIndex++)
+		{
+			const uint32_t hash = nameHashes ? nameHashes[nameIndex] : vkuHashName(ppNames[nameIndex]);
+
+			supported[nameIndex] = (table && (vku_findName(table, ppNames[nameIndex], hash) < table->nameCount)) ? VK_TRUE : VK_FALSE;
+
+			if (!supported[nameIndex])
+				missingCount++;
+		}
+	}
+	else
+	{
+		VkuNameBlock *nameBlock;
+		VkResult err = vku_createNameBlock(layers, physicalDevice, pLayerName, &nameBlock);
+
+		// E.g. VK_ERROR_LAYER_NOT_PRESENT if pLayerName doesn't exist, or VK_ERROR_OUT_OF_HOST_MEMORY
+		if (err)
+		{
+			memset(supported, 0, nameCount * sizeof(VkBool32));
+
+			return err;
+		}
+
+
+		// Hash each of the supported names once, after which the names
+		// only have to be compared when the hashes are equal
+
+		uint32_t *supportedHashes = (uint32_t*) VKU_MALLOC((nameBlock->nameCount + 1) * sizeof(uint32_t));
+
+		if (!supportedHashes)
+		{
+			vkuDeleteNameBlock(nameBlock);
+
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+		}
+
+		for (uint32_t supportedIndex = 0; supportedIndex < nameBlock->nameCount; supportedIndex++)
+			supportedHashes[supportedIndex] = vkuHashName(vkuGetNameBlockName(nameBlock, supportedIndex));
+
+
+		for (uint32_t nameIndex = 0; nameIndex < nameCount; nameIndex++)
+		{
+			const uint32_t hash = nameHashes ? nameHashes[nameIndex] : vkuHashName(ppNames[nameIndex]);
+
+			supported[nameIndex] = VK_FALSE;
+
+			for (uint32_t supportedIndex = 0; supportedIndex < nameBlock->nameCount; supportedIndex++)
+			{
+				if ((supportedHashes[supportedIndex] == hash) && !vku_strcmp(vkuGetNameBlockName(nameBlock, supportedIndex), ppNames[nameIndex]))
+				{
+					supported[nameIndex] = VK_TRUE;
+					break;
+				}
+			}
+
+			if (!supported[nameIndex])
+				missingCount++;
+		}
+
+
+		VKU_FREE(supportedHashes);
+		vkuDeleteNameBlock(nameBlock);
+	}
+
+
+	if (missingCount > 0)
+		return layers ? VK_ERROR_LAYER_NOT_PRESENT : VK_ERROR_EXTENSION_NOT_PRESENT;
+
+	return VK_SUCCESS;
+}
+
+
+// The vkuGet*Support() functions return VK_SUCCESS if all the names are supported, and
+// VK_ERROR_EXTENSION_NOT_PRESENT/VK_ERROR_LAYER_NOT_PRESENT if one or more aren't.
+// If the enumeration fails, then its error is returned and nothing is supported.
+
+VKUAPI_ATTR VkResult vkuGetInstanceExtensionSupport(const char *pLayerName, uint32_t extensionNameCount, const char* const* ppExtensionNames, const uint32_t *extensionNameHashes, VkBool32 *supported)
+{
+	return vku_getSupport(VK_FALSE, VK_NULL_HANDLE, pLayerName, extensionNameCount, ppExtensionNames, extensionNameHashes, supported);
+}
+
+VKUAPI_ATTR VkResult vkuGetDeviceExtensionSupport(VkPhysicalDevice physicalDevice, const char *pLayerName, uint32_t extensionNameCount, const char* const* ppExtensionNames, const uint32_t *extensionNameHashes, VkBool32 *supported)
+{
+	assert(physicalDevice);
+
+	return vku_getSupport(VK_FALSE, physicalDevice, pLayerName, extensionNameCount, ppExtensionNames, extensionNameHashes, supported);
+}
+
+VKUAPI_ATTR VkResult vkuGetInstanceLayerSupport(uint32_t layerNameCount, const char* const* ppLayerNames, const uint32_t *layerNameHashes, VkBool32 *supported)
+{
+	return vku_getSupport(VK_TRUE, VK_NULL_HANDLE, NULL, layerNameCount, ppLayerNames, layerNameHashes, supported);
+}
+
+VKUAPI_ATTR VkResult vkuGetDeviceLayerSupport(VkPhysicalDevice physicalDevice, uint32_t layerNameCount, const char* const* ppLayerNames, const uint32_t *layerNameHashes, VkBool32 *supported)
+{
+	assert(physicalDevice);
+
+	return vku_getSupport(VK_TRUE, physicalDevice, NULL, layerNameCount, ppLayerNames, layerNameHashes, supported);
+}
+
+
+// Packs up to 32 VkBool32s into a bitmask, where bit n is supported[n]
+VKUAPI_ATTR uint32_t vkuGetSupportMask(uint32_t count, const VkBool32 *supported)
+{
+	assert(count <= 32);
+	assert(!count || supported);
+
+	uint32_t mask = 0;
+
+	for (uint32_t index = 0; index < count; index++)
+		if (supported[index])
+			mask |= 1u << index;
+
+	return mask;
+}
+
+
+
+// Describes which extensions/layers to enable. If a required extension/layer isn't
+// supported, then creation fails without calling vkCreateInstance()/vkCreateDevice().
+// Optional extensions/layers are only enabled if supported, which is written to
+// pOptionalExtensionsEnabled/pOptionalLayersEnabled if they aren't NULL.
+// Extensions provided by an enabled layer count as supported.
+typedef struct VkuExtensionSpec
+{
+	uint32_t requiredExtensionCount;
+	const char* const* ppRequiredExtensionNames;
+
+	uint32_t optionalExtensionCount;
+	const char* const* ppOptionalExtensionNames;
+
+	uint32_t requiredLayerCount;
+	const char* const* ppRequiredLayerNames;
+
+	uint32_t optionalLayerCount;
+	const char* const* ppOptionalLayerNames;
+
+	VkBool32 *pOptionalExtensionsEnabled;
+	VkBool32 *pOptionalLayersEnabled;
+} VkuExtensionSpec;
+
+
+// The resolved names, which point to the names in the spec
+typedef struct vku_resolved_spec
+{
+	uint32_t enabledExtensionCount;
+	const char **ppEnabledExtensionNames;
+
+	uint32_t enabledLayerCount;
+	const char **ppEnabledLayerNames;
+} vku_resolved_spec;
+
+
+static void vku_destroyResolvedSpec(vku_resolved_spec *resolved)
+{
+	VKU_FREE(resolved->ppEnabledExtensionNames);
+
+	memset(resolved, 0, sizeof(vku_resolved_spec));
+}
+
+// physicalDevice being VK_NULL_HANDLE means the spec is resolved against the instance
+static VkResult vku_resolveExtensionSpec(VkPhysicalDevice physicalDevice, const VkuExtensionSpec *spec, vku_resolved_spec *resolved)
+{
+	assert(spec);
+	assert(resolved);
+
+	memset(resolved, 0, sizeof(vku_resolved_spec));
+
+
+	const uint32_t extensionCount = spec->requiredExtensionCount + spec->optionalExtensionCount;
+	const uint32_t layerCount = spec->requiredLayerCount + spec->optionalLayerCount;
+
+	const uint32_t nameCount = extensionCount + layerCount;
+
+
+	// A single allocation for the resolved names and the support of each name, with the required
+	// names always placed before the optional names, followed by scratch memory for the extensions
+	// which are still missing when checking the extensions provided by the layers
+
+	const size_t pointerCount = (nameCount + 1) + extensionCount;
+	const size_t elementCount = (nameCount + 1) + extensionCount * 2;
+
+	char *block = (char*) VKU_CALLOC(1, pointerCount * sizeof(const char*) + elementCount * sizeof(uint32_t));
+
+	if (!block)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	const char **extensionNames = (const char**) block;
+	const char **layerNames = extensionNames + extensionCount;
+	const char **missingNames = extensionNames + (nameCount + 1);
+
+	VkBool32 *extensionsSupported = (VkBool32*) (block + pointerCount * sizeof(const char*));
+	VkBool32 *layersSupported = extensionsSupported + extensionCount;
+	VkBool32 *missingSupported = extensionsSupported + (nameCount + 1);
+	uint32_t *missingIndices = (uint32_t*) (missingSupported + extensionCount);
+
+
+	for (uint32_t nameIndex = 0; nameIndex < spec->requiredExtensionCount; nameIndex++)
+		extensionNames[nameIndex] = spec->ppRequiredExtensionNames[nameIndex];
+
+	for (uint32_t nameIndex = 0; nameIndex < spec->optionalExtensionCount; nameIndex++)
+		extensionNames[spec->requiredExtensionCount + nameIndex] = spec->ppOptionalExtensionNames[nameIndex];
+
+	for (uint32_t nameIndex = 0; nameIndex < spec->requiredLayerCount; nameIndex++)
+		layerNames[nameIndex] = spec->ppRequiredLayerNames[nameIndex];
+
+	for (uint32_t nameIndex = 0; nameIndex < spec->optionalLayerCount; nameIndex++)
+		layerNames[spec->requiredLayerCount + nameIndex] = spec->ppOptionalLayerNames[nameIndex];
+
+
+	VkResult err = VK_SUCCESS;
+
+
+	// Layers
+
+	if (layerCount > 0)
+		err = vku_getSupport(VK_TRUE, physicalDevice, NULL, layerCount, layerNames, NULL, layersSupported);
+
+	// A failed enumeration leaves the support unknown
+	if (err && (err != VK_ERROR_LAYER_NOT_PRESENT))
+	{
+		VKU_FREE(block);
+
+		return err;
+	}
+
+	for (uint32_t nameIndex = 0; nameIndex < spec->requiredLayerCount; nameIndex++)
+	{
+		if (!layersSupported[nameIndex])
+		{
+			VKU_FREE(block);
+
+			return VK_ERROR_LAYER_NOT_PRESENT;
+		}
+	}
+
+	// Missing optional layers are simply not enabled
+	err = VK_SUCCESS;
+
+
+	// Extensions, first the ones provided by the implementation
+	// and then the ones provided by each enabled layer
+
+	if (extensionCount > 0)
+		err = vku_getSupport(VK_FALSE, physicalDevice, NULL, extensionCount, extensionNames, NULL, extensionsSupported);
+
+	if (err && (err != VK_ERROR_EXTENSION_NOT_PRESENT))
+	{
+		VKU_FREE(block);
+
+		return err;
+	}
+
+	for (uint32_t layerIndex = 0; (err == VK_ERROR_EXTENSION_NOT_PRESENT) && (layerIndex < layerCount); layerIndex++)
+	{
+		if (!layersSupported[layerIndex])
+			continue;
+
+		// Only the extensions which are still missing are checked, using a single enumeration of the layer
+		uint32_t missingCount = 0;
+
+		for (uint32_t nameIndex = 0; nameIndex < extensionCount; nameIndex++)
+		{
+			if (!extensionsSupported[nameIndex])
+			{
+				missingNames[missingCount] = extensionNames[nameIndex];
+				missingIndices[missingCount++] = nameIndex;
+			}
+		}
+
+		err = vku_getSupport(VK_FALSE, physicalDevice, layerNames[layerIndex], missingCount, missingNames, NULL, missingSupported);
+
+		if (err && (err != VK_ERROR_EXTENSION_NOT_PRESENT))
+		{
+			VKU_FREE(block);
+
+			return err;
+		}
+
+		for (uint32_t missingIndex = 0; missingIndex < missingCount; missingIndex++)
+			extensionsSupported[missingIndices[missingIndex]] = missingSupported[missingIndex];
+	}
+
+	for (uint32_t nameIndex = 0; nameIndex < spec->requiredExtensionCount; nameIndex++)
+	{
+		if (!extensionsSupported[nameIndex])
+		{
+			VKU_FREE(block);
+
+			return VK_ERROR_EXTENSION_NOT_PRESENT;
+		}
+	}
+
+
+	// Report which optional extensions/layers are enabled
+
+	if (spec->pOptionalExtensionsEnabled)
+		for (uint32_t nameIndex = 0; nameIndex < spec->optionalExtensionCount; nameIndex++)
+			spec->pOptionalExtensionsEnabled[nameIndex] = extensionsSupported[spec->requiredExtensionCount + nameIndex];
+
+	if (spec->pOptionalLayersEnabled)
+		for (uint32_t nameIndex = 0; nameIndex < spec->optionalLayerCount; nameIndex++)
+			spec->pOptionalLayersEnabled[nameIndex] = layersSupported[spec->requiredLayerCount + nameIndex];
+
+
+	// Remove the unsupported names, while keeping the order
+
+	for (uint32_t nameIndex = 0; nameIndex < extensionCount; nameIndex++)
+		if (extensionsSupported[nameIndex])
+			extensionNames[resolved->enabledExtensionCount++] = extensionNames[nameIndex];
+
+	// The layer names are moved to follow the enabled extension names
+	for (uint32_t nameIndex = 0; nameIndex < layerCount; nameIndex++)
+		if (layersSupported[nameIndex])
+			extensionNames[resolved->enabledExtensionCount + resolved->enabledLayerCount++] = layerNames[nameIndex];
+
+
+	resolved->ppEnabledExtensionNames = extensionNames;
+	resolved->ppEnabledLayerNames = extensionNames + resolved->enabledExtensionCount;
+
+	return VK_SUCCESS;
+}
+
+
+
+VKUAPI_ATTR VkResult vkuCreateInstance(uint32_t apiVersion,
+	uint32_t enabledExtensionCount, const char* const* ppEnabledExtensionNames,
+	uint32_t enabledLayerCount, const char* const* ppEnabledLayerNames,
+	const VkAllocationCallbacks *pAllocator,
+	VkInstance *instance)
+{
+	VkApplicationInfo appInfo;
+	memset(&appInfo, 0, sizeof(appInfo));
+
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "VulkanApp";
+	appInfo.pEngineName = "VulkanEngine";
+	appInfo.apiVersion = apiVersion;
+
+
+	VkInstanceCreateInfo instCreateInfo;
+	memset(&instCreateInfo, 0, sizeof(instCreateInfo));
+
+	instCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instCreateInfo.pNext = NULL;
+	instCreateInfo.pApplicationInfo = &appInfo;
+
+
+	instCreateInfo.enabledExtensionCount = enabledExtensionCount;
+	instCreateInfo.ppEnabledExtensionNames = ppEnabledExtensionNames;
+
+	instCreateInfo.enabledLayerCount = enabledLayerCount;
+	instCreateInfo.ppEnabledLayerNames = ppEnabledLayerNames;
+
+
+	return vkCreateInstance(&instCreateInfo, pAllocator, instance);
+}
+
+VKUAPI_ATTR VkResult vkuCreateSimpleInstance(uint32_t apiVersion, VkBool32 enableValidation, const VkAllocationCallbacks *pAllocator, VkInstance *instance)
+{
+	uint32_t enabledExtensionCount = 0;
+	char **enabledExtensionNames = vkuGetInstanceExtensionNames(NULL, &enabledExtensionCount);
+
+	uint32_t actualExtensionCount = enabledExtensionCount;
+
+
+	uint32_t enabledLayerCount = 0;
+	char **enabledLayerNames = NULL;
+
+	uint32_t actualLayerCount = enabledLayerCount;
+
+
+	if (enableValidation)
+	{
+		// Validation is enabled, so just add all the layers
+
+		enabledLayerNames = vkuGetInstanceLayerNames(&enabledLayerCount);
+		actualLayerCount = enabledLayerCount;
+	}
+	else
+	{
+		// Validation is not enabled, so remove the VK_EXT_debug_report extension
+
+		for (uint32_t enabledExtensionIndex = 0; enabledExtensionIndex < actualExtensionCount; enabledExtensionIndex++)
+		{
+			char *enabledExtensionName = enabledExtensionNames[enabledExtensionIndex];
+
+			if (!vku_strcmp(enabledExtensionName, VK_EXT_DEBUG_REPORT_EXTENSION_NAME))
+			{
+				// If it's the last extension name, just decrement enabledExtensionCount
+				if (enabledExtensionIndex == (actualExtensionCount - 1))
+				{
+					enabledExtensionCount--;
+				}
+				else // If not, swap with the last extension name
+				{
+					enabledExtensionNames[enabledExtensionIndex] = enabledExtensionNames[actualExtensionCount - 1];
+					enabledExtensionNames[actualExtensionCount - 1] = enabledExtensionName;
+
+					// The first if will be called in the end, decrementing the enabledExtensionCount
+				}
+			}
+		}
+	}
+
+
+	VkResult err = vkuCreateInstance(apiVersion, enabledExtensionCount, enabledExtensionNames, enabledLayerCount, enabledLayerNames, pAllocator, instance);
+
+
+	// Remember to delete it by the actualExtensionCount and not the enabledExtensionCount
+	vkuDeleteInstanceExtensionNames(actualExtensionCount, enabledExtensionNames);
+	// enabledExtensionNames = NULL;
+
+	// Remember to delete it by the actualLayerCount and not the enabledLayerCount
+	vkuDeleteInstanceLayerNames(actualLayerCount, enabledLayerNames);
+	// enabledLayerNames = NULL;
+
+
+	return err;
+}
+
+
+
+VKUAPI_ATTR VkResult vkuCreateInstanceFromSpec(uint32_t apiVersion, const VkuExtensionSpec *spec, const VkAllocationCallbacks *pAllocator, VkInstance *instance)
+{
+	assert(instance);
+
+
+	vku_resolved_spec resolved;
+	VkResult err = vku_resolveExtensionSpec(VK_NULL_HANDLE, spec, &resolved);
+
+	if (err)
+		return err;
+
+
+	err = vkuCreateInstance(apiVersion,
+		resolved.enabledExtensionCount, resolved.ppEnabledExtensionNames,
+		resolved.enabledLayerCount, resolved.ppEnabledLayerNames,
+		pAllocator, instance);
+
+
+	vku_destroyResolvedSpec(&resolved);
+
+	return err;
+}
+
+
+
+typedef enum VkuDeviceSelectPolicy
+{
+	// Discrete > integrated > virtual > CPU, then the most device local memory
+	VKU_DEVICE_SELECT_POLICY_PREFER_DISCRETE = 0,
+	// The most device local memory, then discrete > integrated > virtual > CPU
+	VKU_DEVICE_SELECT_POLICY_PREFER_MAX_MEMORY = 1,
+	// The device matching pPipelineCacheUUID, otherwise the same as PREFER_DISCRETE
+	VKU_DEVICE_SELECT_POLICY_MATCH_UUID = 2
+} VkuDeviceSelectPolicy;
+
+
+typedef enum VkuDeviceUnsuitableFlagBits
+{
+	VKU_DEVICE_UNSUITABLE_QUEUE_FLAGS_BIT = 0x00000001,
+	VKU_DEVICE_UNSUITABLE_EXTENSIONS_BIT = 0x00000002,
+	VKU_DEVICE_UNSUITABLE_API_VERSION_BIT = 0x00000004,
+	VKU_DEVICE_UNSUITABLE_LIMITS_BIT = 0x00000008
+} VkuDeviceUnsuitableFlagBits;
+typedef VkFlags VkuDeviceUnsuitableFlags;
+
+
+// Everything the ranking is based on, gathered by vkuGetPhysicalDeviceRank().
+// It can also be filled in by hand, to test vkuScorePhysicalDeviceRanks().
+typedef struct VkuPhysicalDeviceRank
+{
+	VkPhysicalDevice physicalDevice;
+	VkPhysicalDeviceProperties properties;
+
+	// The size of the largest device local heap
+	VkDeviceSize deviceLocalMemorySize;
+
+	// The flags of all the queue families combined
+	VkQueueFlags queueFlags;
+
+	// Queue families with compute but no graphics,
+	// and queue families with only transfer
+	uint32_t computeOnlyQueueFamilyCount;
+	uint32_t transferOnlyQueueFamilyCount;
+
+	VkBool32 requiredExtensionsSupported;
+
+	// Written by vkuScorePhysicalDeviceRanks()
+	VkuDeviceUnsuitableFlags unsuitableFlags;
+	VkBool32 uuidMatches;
+	int64_t score;
+} VkuPhysicalDeviceRank;
+
+
+typedef int64_t (VKAPI_PTR *PFN_vkuScorePhysicalDevice)(void *pUserData, const VkuPhysicalDeviceRank *rank);
+
+typedef struct VkuDeviceSelectInfo
+{
+	VkuDeviceSelectPolicy policy;
+
+	// VK_UUID_SIZE bytes compared with VkPhysicalDeviceProperties::pipelineCacheUUID
+	const uint8_t *pPipelineCacheUUID;
+
+	uint32_t minApiVersion;
+	VkQueueFlags requiredQueueFlags;
+
+	uint32_t requiredExtensionCount;
+	const char* const* ppRequiredExtensionNames;
+
+	// Physical devices with lower VkPhysicalDeviceLimits are unsuitable, 0 means any
+	uint32_t minImageDimension2D;
+	uint32_t minStorageBufferRange;
+	uint32_t minPushConstantsSize;
+	uint32_t minComputeSharedMemorySize;
+	uint32_t minComputeWorkGroupInvocations;
+
+	// If not NULL, then the returned value is added to the score of the policy
+	PFN_vkuScorePhysicalDevice pfnScore;
+	void *pUserData;
+} VkuDeviceSelectInfo;
+
+
+VKUAPI_ATTR const char* vkuGetPhysicalDeviceTypeString(VkPhysicalDeviceType deviceType)
+{
+	switch (deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_OTHER:
+		return "Other";
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		return "Integrated GPU";
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		return "Discrete GPU";
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		return "Virtual GPU";
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		return "CPU";
+	default:
+		return "Unknown";
+	}
+}
+
+
+VKUAPI_ATTR VkResult vkuGetPhysicalDeviceRank(VkPhysicalDevice physicalDevice, const VkuDeviceSelectInfo *selectInfo, VkuPhysicalDeviceRank *rank)
+{
+	assert(physicalDevice);
+	assert(rank);
+
+
+	memset(rank, 0, sizeof(VkuPhysicalDeviceRank));
+
+	rank->physicalDevice = physicalDevice;
+
+	vku_getPhysicalDeviceProperties(physicalDevice, &rank->properties);
+
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vku_getPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	for (uint32_t heapIndex = 0; heapIndex < memoryProperties.memoryHeapCount; heapIndex++)
+		if (memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			if (memoryProperties.memoryHeaps[heapIndex].size > rank->deviceLocalMemorySize)
+				rank->deviceLocalMemorySize = memoryProperties.memoryHeaps[heapIndex].size;
+
+
+	uint32_t queueFamilyCount = 0;
+	vku_getPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, NULL);
+
+	if (queueFamilyCount > 0)
+	{
+		VkQueueFamilyProperties *queueFamilyProperties = (VkQueueFamilyProperties*) VKU_CALLOC(queueFamilyCount, sizeof(VkQueueFamilyProperties));
+
+		if (!queueFamilyProperties)
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+		vku_getPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties);
+
+		for (uint32_t queueFamilyIndex = 0; queueFamilyIndex < queueFamilyCount; queueFamilyIndex++)
+		{
+			const VkQueueFlags queueFlags = queueFamilyProperties[queueFamilyIndex].queueFlags;
+
+			if (queueFamilyProperties[queueFamilyIndex].queueCount < 1)
+				continue;
+
+			rank->queueFlags |= queueFlags;
+
+			if ((queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFlags & VK_QUEUE_GRAPHICS_BIT))
+				rank->computeOnlyQueueFamilyCount++;
+
+			if ((queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+				rank->transferOnlyQueueFamilyCount++;
+		}
+
+		VKU_FREE(queueFamilyProperties);
+	}
+
+
+	rank->requiredExtensionsSupported = VK_TRUE;
+
+	if (selectInfo && (selectInfo->requiredExtensionCount > 0))
+	{
+		VkBool32 *supported = (VkBool32*) VKU_CALLOC(selectInfo->requiredExtensionCount, sizeof(VkBool32));
+
+		if (!supported)
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+		VkResult err = vku_getSupport(VK_FALSE, physicalDevice, NULL, selectInfo->requiredExtensionCount, selectInfo->ppRequiredExtensionNames, NULL, supported);
+
+		VKU_FREE(supported);
+
+		if (err == VK_ERROR_EXTENSION_NOT_PRESENT)
+			rank->requiredExtensionsSupported = VK_FALSE;
+		else if (err)
+			return err;
+	}
+
+
+	return VK_SUCCESS;
+}
+
+
+static int64_t vku_getPhysicalDeviceTypeScore(VkPhysicalDeviceType deviceType)
+{
+	switch (deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		return 4;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		return 3;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		return 2;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+// Scores the ranks and sorts them from best to worst, where the
+// unsuitable ranks are placed last. Equal ranks keep their order.
+VKUAPI_ATTR void vkuScorePhysicalDeviceRanks(uint32_t rankCount, VkuPhysicalDeviceRank *ranks, const VkuDeviceSelectInfo *selectInfo)
+{
+	assert(!rankCount || ranks);
+
+
+	VkuDeviceSelectInfo defaultSelectInfo;
+	memset(&defaultSelectInfo, 0, sizeof(defaultSelectInfo));
+
+	if (!selectInfo)
+		selectInfo = &defaultSelectInfo;
+
+
+	for (uint32_t rankIndex = 0; rankIndex < rankCount; rankIndex++)
+	{
+		VkuPhysicalDeviceRank *rank = &ranks[rankIndex];
+
+		rank->unsuitableFlags = 0;
+
+		if ((rank->queueFlags & selectInfo->requiredQueueFlags) != selectInfo->requiredQueueFlags)
+			rank->unsuitableFlags |= VKU_DEVICE_UNSUITABLE_QUEUE_FLAGS_BIT;
+
+		if (!rank->requiredExtensionsSupported)
+			rank->unsuitableFlags |= VKU_DEVICE_UNSUITABLE_EXTENSIONS_BIT;
+
+		if (rank->properties.apiVersion < selectInfo->minApiVersion)
+			rank->unsuitableFlags |= VKU_DEVICE_UNSUITABLE_API_VERSION_BIT;
+
+		const VkPhysicalDeviceLimits *limits = &rank->properties.limits;
+
+		if ((limits->maxImageDimension2D < selectInfo->minImageDimension2D) ||
+			(limits->maxStorageBufferRange < selectInfo->minStorageBufferRange) ||
+			(limits->maxPushConstantsSize < selectInfo->minPushConstantsSize) ||
+			(limits->maxComputeSharedMemorySize < selectInfo->minComputeSharedMemorySize) ||
+			(limits->maxComputeWorkGroupInvocations < selectInfo->minComputeWorkGroupInvocations))
+			rank->unsuitableFlags |= VKU_DEVICE_UNSUITABLE_LIMITS_BIT;
+
+
+		rank->uuidMatches = VK_FALSE;
+
+		if (selectInfo->pPipelineCacheUUID)
+			rank->uuidMatches = memcmp(rank->properties.pipelineCacheUUID, selectInfo->pPipelineCacheUUID, VK_UUID_SIZE) ? VK_FALSE : VK_TRUE;
+
+
+		// Memory in MiB fits in 32 bits, the type score in 3 bits and the
+		// queue score in a few bits, which leaves room for the UUID bit
+
+		const int64_t typeScore = vku_getPhysicalDeviceTypeScore(rank->properties.deviceType);
+		const int64_t memoryScore = (int64_t) (rank->deviceLocalMemorySize >> 20) & 0xFFFFFFFF;
+		const int64_t queueScore = (rank->computeOnlyQueueFamilyCount ? 2 : 0) + (rank->transferOnlyQueueFamilyCount ? 1 : 0);
+
+		switch (selectInfo->policy)
+		{
+		case VKU_DEVICE_SELECT_POLICY_PREFER_MAX_MEMORY:
+			rank->score = (memoryScore << 8) | (typeScore << 4) | queueScore;
+			break;
+
+		case VKU_DEVICE_SELECT_POLICY_MATCH_UUID:
+			rank->score = (((int64_t) rank->uuidMatches) << 48) | (typeScore << 40) | (memoryScore << 4) | queueScore;
+			break;
+
+		case VKU_DEVICE_SELECT_POLICY_PREFER_DISCRETE:
+		default:
+			rank->score = (typeScore << 40) | (memoryScore << 4) | queueScore;
+			break;
+		}
+
+		if (selectInfo->pfnScore)
+			rank->score += selectInfo->pfnScore(selectInfo->pUserData, rank);
+	}
+
+
+	// Insertion sort, as the amount of physical devices is small and it's stable
+
+	for (uint32_t rankIndex = 1; rankIndex < rankCount; rankIndex++)
+	{
+		VkuPhysicalDeviceRank rank = ranks[rankIndex];
+
+		uint32_t insertIndex = rankIndex;
+
+		while (insertIndex > 0)
+		{
+			const VkuPhysicalDeviceRank *previous = &ranks[insertIndex - 1];
+
+			const VkBool32 better = (!rank.unsuitableFlags && previous->unsuitableFlags)
+				|| (!rank.unsuitableFlags == !previous->unsuitableFlags && (rank.score > previous->score));
+
+			if (!better)
+				break;
+
+			ranks[insertIndex] = ranks[insertIndex - 1];
+			insertIndex--;
+		}
+
+		ranks[insertIndex] = rank;
+	}
+}
+
+
+// Works like the Vulkan enumeration functions, if ranks is NULL then the amount of physical
+// devices is written to rankCount. The ranks are sorted from best to worst, including the
+// unsuitable physical devices, such that it can be logged why a physical device was chosen.
+VKUAPI_ATTR VkResult vkuRankPhysicalDevices(VkInstance instance, const VkuDeviceSelectInfo *selectInfo, uint32_t *rankCount, VkuPhysicalDeviceRank *ranks)
+{
+	assert(rankCount);
+
+
+	if (!ranks)
+		return vkEnumeratePhysicalDevices(instance, rankCount, NULL);
+
+
+	uint32_t physicalDeviceCount = 0;
+	VkResult err = vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, NULL);
+
+	if (err)
+		return err;
+
+	if (physicalDeviceCount < 1)
+	{
+		(*rankCount) = 0;
+
+		return VK_SUCCESS;
+	}
+
+
+	VkPhysicalDevice *physicalDevices = (VkPhysicalDevice*) VKU_CALLOC(physicalDeviceCount, sizeof(VkPhysicalDevice));
+
+	if (!physicalDevices)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	err = vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices);
+
+	// If physical devices were added in between, then the ones returned are ranked
+	if (err == VK_INCOMPLETE)
+		err = VK_SUCCESS;
+
+	if (err)
+	{
+		VKU_FREE(physicalDevices);
+
+		return err;
+	}
+
+
+	// All the physical devices are ranked, even if rankCount is
+	// smaller, otherwise the best one could be left out
+
+	VkuPhysicalDeviceRank *allRanks = (VkuPhysicalDeviceRank*) VKU_CALLOC(physicalDeviceCount, sizeof(VkuPhysicalDeviceRank));
+
+	if (!allRanks)
+	{
+		VKU_FREE(physicalDevices);
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	for (uint32_t physicalDeviceIndex = 0; !err && (physicalDeviceIndex < physicalDeviceCount); physicalDeviceIndex++)
+		err = vkuGetPhysicalDeviceRank(physicalDevices[physicalDeviceIndex], selectInfo, &allRanks[physicalDeviceIndex]);
+
+	VKU_FREE(physicalDevices);
+
+	if (err)
+	{
+		VKU_FREE(allRanks);
+
+		return err;
+	}
+
+
+	vkuScorePhysicalDeviceRanks(physicalDeviceCount, allRanks, selectInfo);
+
+
+	if ((*rankCount) > physicalDeviceCount)
+		(*rankCount) = physicalDeviceCount;
+
+	memcpy(ranks, allRanks, (*rankCount) * sizeof(VkuPhysicalDeviceRank));
+
+	err = ((*rankCount) < physicalDeviceCount) ? VK_INCOMPLETE : VK_SUCCESS;
+
+	VKU_FREE(allRanks);
+
+
+	return err;
+}
+
+
+// Returns VK_ERROR_INITIALIZATION_FAILED if there's no suitable physical device
+VKUAPI_ATTR VkResult vkuSelectPhysicalDevice(VkInstance instance, const VkuDeviceSelectInfo *selectInfo, VkPhysicalDevice *physicalDevice)
+{
+	assert(physicalDevice);
+
+
+	(*physicalDevice) = VK_NULL_HANDLE;
+
+
+	uint32_t rankCount = 0;
+	VkResult err = vkuRankPhysicalDevices(instance, selectInfo, &rankCount, NULL);
+
+	if (err)
+		return err;
+
+	if (rankCount < 1)
+		return VK_ERROR_INITIALIZATION_FAILED;
+
+
+	VkuPhysicalDeviceRank *ranks = (VkuPhysicalDeviceRank*) VKU_CALLOC(rankCount, sizeof(VkuPhysicalDeviceRank));
+
+	if (!ranks)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	err = vkuRankPhysicalDevices(instance, selectInfo, &rankCount, ranks);
+
+	if (err == VK_INCOMPLETE)
+		err = VK_SUCCESS; // The best one is still first
+
+	if (!err)
+	{
+		if ((rankCount > 0) && ranks[0].physicalDevice && !ranks[0].unsuitableFlags)
+			(*physicalDevice) = ranks[0].physicalDevice;
+		else
+			err = VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+	VKU_FREE(ranks);
+
+
+	return err;
+}
+
+
+VKUAPI_ATTR VkResult vkuGetPhysicalDevice(VkInstance instance, VkPhysicalDevice *physicalDevice)
+{
+	assert(physicalDevice);
+
+	// Prefer a discrete GPU over the first encountered physical device
+	return vkuSelectPhysicalDevice(instance, NULL, physicalDevice);
+}
+
+
+
+VKUAPI_ATTR VkBool32 vkuGetQueueFamilyIndex(VkPhysicalDevice physicalDevice, uint32_t *queueFamilyIndex)
+{
+	assert(queueFamilyIndex);
+
+
+	uint32_t queueCount;
+	vku_getPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueCount, NULL);
+	assert(queueCount > 0);
+
+	VkQueueFamilyProperties *queueFamilyProperties = (VkQueueFamilyProperties*) VKU_CALLOC(queueCount, sizeof(VkQueueFamilyProperties));
+	assert(queueFamilyProperties);
+
+	vku_getPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueCount, queueFamilyProperties);
+
+	for ((*queueFamilyIndex) = 0; (*queueFamilyIndex) < queueCount; (*queueFamilyIndex)++)
+		if (queueFamilyProperties[(*queueFamilyIndex)].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			break;
+
+	// assert((*queueFamilyIndex) < queueCount);
+
+
+	VKU_FREE(queueFamilyProperties);
+
+
+	if ((*queueFamilyIndex) < queueCount)
+		return VK_TRUE;
+
+	return VK_FALSE;
+}
+
+
+
+typedef enum VkuQueueRole
+{
+	VKU_QUEUE_ROLE_GRAPHICS = 0,
+	VKU_QUEUE_ROLE_COMPUTE = 1,
+	VKU_QUEUE_ROLE_TRANSFER = 2,
+	VKU_QUEUE_ROLE_COUNT = 3
+} VkuQueueRole;
+
+
+typedef struct VkuQueueTopology
+{
+	// For each role the queue family index, or VK_QUEUE_FAMILY_IGNORED if no queue family can do it
+	uint32_t queueFamilyIndices[VKU_QUEUE_ROLE_COUNT];
+
+	// For each role the queue index within its queue family. Roles sharing a queue
+	// family get separate queues, as long as the queue family has enough queues.
+	uint32_t queueIndices[VKU_QUEUE_ROLE_COUNT];
+
+	// For each role, if the queue family isn't shared with the roles before it, i.e. an async
+	// compute queue family (no graphics) or a transfer only queue family (no graphics or compute).
+	VkBool32 dedicated[VKU_QUEUE_ROLE_COUNT];
+} VkuQueueTopology;
+
+
+typedef struct VkuQueues
+{
+	VkQueue queues[VKU_QUEUE_ROLE_COUNT];
+	uint32_t queueFamilyIndices[VKU_QUEUE_ROLE_COUNT];
+} VkuQueues;
+
+
+static uint32_t vku_findQueueFamily(uint32_t queueFamilyCount, const VkQueueFamilyProperties *queueFamilyProperties, VkQueueFlags requiredFlags, VkQueueFlags excludedFlags)
+{
+	for (uint32_t queueFamilyIndex = 0; queueFamilyIndex < queueFamilyCount; queueFamilyIndex++)
+	{
+		const VkQueueFlags queueFlags = queueFamilyProperties[queueFamilyIndex].queueFlags;
+
+		if (queueFamilyProperties[queueFamilyIndex].queueCount < 1)
+			continue;
+
+		if (((queueFlags & requiredFlags) == requiredFlags) && !(queueFlags & excludedFlags))
+			return queueFamilyIndex;
+	}
+
+	return VK_QUEUE_FAMILY_IGNORED;
+}
+
+// Graphics uses the first queue family with graphics. Compute prefers a queue family with
+// compute but without graphics (async compute), falling back to the graphics queue family.
+// Transfer prefers a queue family with only transfer, then async compute, then graphics.
+VKUAPI_ATTR VkResult vkuGetQueueTopology(VkPhysicalDevice physicalDevice, VkuQueueTopology *topology)
+{
+	assert(physicalDevice);
+	assert(topology);
+
+
+	for (uint32_t role = 0; role < VKU_QUEUE_ROLE_COUNT; role++)
+	{
+		topology->queueFamilyIndices[role] = VK_QUEUE_FAMILY_IGNORED;
+		topology->queueIndices[role] = 0;
+		topology->dedicated[role] = VK_FALSE;
+	}
+
+
+	uint32_t queueFamilyCount = 0;
+	vku_getPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, NULL);
+
+	if (queueFamilyCount < 1)
+		return VK_ERROR_INITIALIZATION_FAILED;
+
+	VkQueueFamilyProperties *queueFamilyProperties = (VkQueueFamilyProperties*) VKU_CALLOC(queueFamilyCount, sizeof(VkQueueFamilyProperties));
+
+	if (!queueFamilyProperties)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	vku_getPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties);
+
+
+	uint32_t *queueFamilyIndices = topology->queueFamilyIndices;
+
+	queueFamilyIndices[VKU_QUEUE_ROLE_GRAPHICS] = vku_findQueueFamily(queueFamilyCount, queueFamilyProperties, VK_QUEUE_GRAPHICS_BIT, 0);
+
+
+	queueFamilyIndices[VKU_QUEUE_ROLE_COMPUTE] = vku_findQueueFamily(queueFamilyCount, queueFamilyProperties, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+
+	if (queueFamilyIndices[VKU_QUEUE_ROLE_COMPUTE] == VK_QUEUE_FAMILY_IGNORED)
+		if ((queueFamilyIndices[VKU_QUEUE_ROLE_GRAPHICS] != VK_QUEUE_FAMILY_IGNORED) && (queueFamilyProperties[queueFamilyIndices[VKU_QUEUE_ROLE_GRAPHICS]].queueFlags & VK_QUEUE_COMPUTE_BIT))
+			queueFamilyIndices[VKU_QUEUE_ROLE_COMPUTE] = queueFamilyIndices[VKU_QUEUE_ROLE_GRAPHICS];
+
+	if (queueFamilyIndices[VKU_QUEUE_ROLE_COMPUTE] == VK_QUEUE_FAMILY_IGNORED)
+		queueFamilyIndices[VKU_QUEUE_ROLE_COMPUTE] = vku_findQueueFamily(queueFamilyCount, queueFamilyProperties, VK_QUEUE_COMPUTE_BIT, 0);
+
+
+	// Graphics and compute queues always support transfer, even if VK_QUEUE_TRANSFER_BIT isn't reported
+
+	queueFamilyIndices[VKU_QUEUE_ROLE_TRANSFER] = vku_findQueueFamily(queueFamilyCount, queueFamilyProperties, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+
+	if (queueFamilyIndices[VKU_QUEUE_ROLE_TRANSFER] == VK_QUEUE_FAMILY_IGNORED)
+		if (queueFamilyIndices[VKU_QUEUE_ROLE_COMPUTE] != queueFamilyIndices[VKU_QUEUE_ROLE_GRAPHICS])
+			queueFamilyIndices[VKU_QUEUE_ROLE_TRANSFER] = queueFamilyIndices[VKU_QUEUE_ROLE_COMPUTE];
+
+	if (queueFamilyIndices[VKU_QUEUE_ROLE_TRANSFER] == VK_QUEUE_FAMILY_IGNORED)
+		queueFamilyIndices[VKU_QUEUE_ROLE_TRANSFER] = queueFamilyIndices[VKU_QUEUE_ROLE_GRAPHICS];
+
+	if (queueFamilyIndices[VKU_QUEUE_ROLE_TRANSFER] == VK_QUEUE_FAMILY_IGNORED)
+		queueFamilyIndices[VKU_QUEUE_ROLE_TRANSFER] = queueFamilyIndices[VKU_QUEUE_ROLE_COMPUTE];
+
+	if (queueFamilyIndices[VKU_QUEUE_ROLE_TRANSFER] == VK_QUEUE_FAMILY_IGNORED)
+		queueFamilyIndices[VKU_QUEUE_ROLE_TRANSFER] = vku_findQueueFamily(queueFamilyCount, queueFamilyProperties, VK_QUEUE_TRANSFER_BIT, 0);
+
+
+	// Give the roles sharing a queue family separate queues, while there's enough
+
+	for (uint32_t role = 0; role < VKU_QUEUE_ROLE_COUNT; role++)
+	{
+		if (queueFamilyIndices[role] == VK_QUEUE_FAMILY_IGNORED)
+			continue;
+
+		uint32_t sharingCount = 0;
+
+		for (uint32_t previousRole = 0; previousRole < role; previousRole++)
+			if (queueFamilyIndices[previousRole] == queueFamilyIndices[role])
+				sharingCount++;
+
+		const uint32_t queueCount = queueFamilyProperties[queueFamilyIndices[role]].queueCount;
+
+		topology->queueIndices[role] = (sharingCount < queueCount) ? sharingCount : (queueCount - 1);
+		topology->dedicated[role] = (sharingCount == 0) ? VK_TRUE : VK_FALSE;
+	}
+
+
+	VKU_FREE(queueFamilyProperties);
+
+
+	return VK_SUCCESS;
+}
+
+
+// Creates a VkDeviceQueueCreateInfo for each distinct queue family in the topology, with
+// a priority for each queue. The priority of a queue shared by multiple roles is the
+// highest of their priorities. The create infos must have room for VKU_QUEUE_ROLE_COUNT
+// elements and the priorities for VKU_QUEUE_ROLE_COUNT * VKU_QUEUE_ROLE_COUNT elements.
+// Returns the amount of create infos.
+static uint32_t vku_getQueueCreateInfos(const VkuQueueTopology *topology, const float *rolePriorities, float *priorities, VkDeviceQueueCreateInfo *queueCreateInfos)
+{
+	uint32_t queueCreateInfoCount = 0;
+
+	for (uint32_t role = 0; role < VKU_QUEUE_ROLE_COUNT; role++)
+	{
+		const uint32_t queueFamilyIndex = topology->queueFamilyIndices[role];
+
+		if (queueFamilyIndex == VK_QUEUE_FAMILY_IGNORED)
+			continue;
+
+		const float priority = rolePriorities ? rolePriorities[role] : 1.0f;
+
+
+		uint32_t queueCreateInfoIndex = 0;
+
+		while ((queueCreateInfoIndex < queueCreateInfoCount) && (queueCreateInfos[queueCreateInfoIndex].queueFamilyIndex != queueFamilyIndex))
+			queueCreateInfoIndex++;
+
+		VkDeviceQueueCreateInfo *queueCreateInfo = &queueCreateInfos[queueCreateInfoIndex];
+
+		if (queueCreateInfoIndex == queueCreateInfoCount)
+		{
+			memset(queueCreateInfo, 0, sizeof(VkDeviceQueueCreateInfo));
+
+			queueCreateInfo->sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueCreateInfo->queueFamilyIndex = queueFamilyIndex;
+
+			queueCreateInfo->pQueuePriorities = &priorities[queueCreateInfoIndex * VKU_QUEUE_ROLE_COUNT];
+
+			queueCreateInfoCount++;
+		}
+
+
+		float *queuePriorities = (float*) queueCreateInfo->pQueuePriorities;
+		const uint32_t queueIndex = topology->queueIndices[role];
+
+		assert(queueIndex < VKU_QUEUE_ROLE_COUNT);
+
+		if (queueIndex >= queueCreateInfo->queueCount)
+		{
+			// The queue indices of a topology filled in by hand can skip queues, which get the lowest priority
+			for (uint32_t skippedIndex = queueCreateInfo->queueCount; skippedIndex < queueIndex; skippedIndex++)
+				queuePriorities[skippedIndex] = 0.0f;
+
+			queueCreateInfo->queueCount = queueIndex + 1;
+			queuePriorities[queueIndex] = priority;
+		}
+		else if (priority > queuePriorities[queueIndex])
+			queuePriorities[queueIndex] = priority;
+	}
+
+	return queueCreateInfoCount;
+}
+
+
+
+static VkResult vku_createDevice(
+	uint32_t enabledExtensionCount, const char* const* ppEnabledExtensionNames,
+	uint32_t enabledLayerCount, const char* const* ppEnabledLayerNames,
+	const VkAllocationCallbacks *pAllocator,
+	VkPhysicalDevice physicalDevice, uint32_t queueCreateInfoCount, const VkDeviceQueueCreateInfo *queueCreateInfos, VkDevice *device)
+{
+	assert(device);
+
+
+	VkDeviceCreateInfo deviceCreateInfo;
+	memset(&deviceCreateInfo, 0, sizeof(deviceCreateInfo));
+
+	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.pNext = NULL;
+
+	deviceCreateInfo.queueCreateInfoCount = queueCreateInfoCount;
+	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos;
+
+	deviceCreateInfo.pEnabledFeatures = NULL;
+
+	deviceCreateInfo.enabledExtensionCount = enabledExtensionCount;
+	deviceCreateInfo.ppEnabledExtensionNames = ppEnabledExtensionNames;
+
+	deviceCreateInfo.enabledLayerCount = enabledLayerCount;
+	deviceCreateInfo.ppEnabledLayerNames = ppEnabledLayerNames;
+
+
+	return vkCreateDevice(physicalDevice, &deviceCreateInfo, pAllocator, device);
+}
+
+VKUAPI_ATTR VkResult vkuCreateDevice(
+	uint32_t enabledExtensionCount, const char* const* ppEnabledExtensionNames,
+	uint32_t enabledLayerCount, const char* const* ppEnabledLayerNames,
+	const VkAllocationCallbacks *pAllocator,
+	VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkDevice *device)
+{
+	assert(device);
+
+
+	VkDeviceQueueCreateInfo queueCreateInfo;
+	memset(&queueCreateInfo, 0, sizeof(queueCreateInfo));
+
+	queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+	const uint32_t queuePrioritiesCount = 1;
+	const float queuePriorities[1] = { 0.0f };
+
+	queueCreateInfo.queueCount = queuePrioritiesCount;
+	queueCreateInfo.pQueuePriorities = queuePriorities;
+
+
+	return vku_createDevice(enabledExtensionCount, ppEnabledExtensionNames, enabledLayerCount, ppEnabledLayerNames, pAllocator, physicalDevice, 1, &queueCreateInfo, device);
+}
+
+// Creates a VkDevice with a queue for each role in the topology, and gets the VkQueues.
+// The rolePriorities are VKU_QUEUE_ROLE_COUNT priorities, if NULL they're all 1.0.
+VKUAPI_ATTR VkResult vkuCreateDeviceWithQueues(
+	uint32_t enabledExtensionCount, const char* const* ppEnabledExtensionNames,
+	uint32_t enabledLayerCount, const char* const* ppEnabledLayerNames,
+	const VkAllocationCallbacks *pAllocator,
+	VkPhysicalDevice physicalDevice, const VkuQueueTopology *topology, const float *rolePriorities, VkDevice *device, VkuQueues *queues)
+{
+	assert(topology);
+	assert(device);
+	assert(queues);
+
+
+	float priorities[VKU_QUEUE_ROLE_COUNT * VKU_QUEUE_ROLE_COUNT];
+	VkDeviceQueueCreateInfo queueCreateInfos[VKU_QUEUE_ROLE_COUNT];
+
+	const uint32_t queueCreateInfoCount = vku_getQueueCreateInfos(topology, rolePriorities, priorities, queueCreateInfos);
+
+	if (queueCreateInfoCount < 1)
+		return VK_ERROR_INITIALIZATION_FAILED;
+
+
+	VkResult err = vku_createDevice(enabledExtensionCount, ppEnabledExtensionNames, enabledLayerCount, ppEnabledLayerNames, pAllocator, physicalDevice, queueCreateInfoCount, queueCreateInfos, device);
+
+	if (err)
+		return err;
+
+
+	for (uint32_t role = 0; role < VKU_QUEUE_ROLE_COUNT; role++)
+	{
+		queues->queueFamilyIndices[role] = topology->queueFamilyIndices[role];
+		queues->queues[role] = VK_NULL_HANDLE;
+
+		if (topology->queueFamilyIndices[role] != VK_QUEUE_FAMILY_IGNORED)
+			vkGetDeviceQueue(*device, topology->queueFamilyIndices[role], topology->queueIndices[role], &queues->queues[role]);
+	}
+
+
+	return VK_SUCCESS;
+}
+
+VKUAPI_ATTR VkResult vkuCreateSimpleDevice(VkBool32 enableValidation, const VkAllocationCallbacks *pAllocator, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkDevice *device)
+{
+	assert(device);
+
+
+	uint32_t enabledExtensionCount = 0;
+	char **enabledExtensionNames = vkuGetDeviceExtensionNames(physicalDevice, NULL, &enabledExtensionCount);
+
+	uint32_t actualExtensionCount = enabledExtensionCount;
+
+
+	uint32_t enabledLayerCount = 0;
+	char **enabledLayerNames = NULL;
+
+	uint32_t actualLayerCount = enabledLayerCount;
+
+
+	if (enableValidation)
+	{
+		// Validation is enabled, so just add all the layers
+
+		enabledLayerNames = vkuGetDeviceLayerNames(physicalDevice, &enabledLayerCount);
+		actualLayerCount = enabledLayerCount;
+	}
+	else
+	{
+		// Validation is not enabled, so remove the VK_EXT_debug_report extension
+
+		for (uint32_t enabledExtensionIndex = 0; enabledExtensionIndex < actualExtensionCount; enabledExtensionIndex++)
+		{
+			char *enabledExtensionName = enabledExtensionNames[enabledExtensionIndex];
+
+			if (!vku_strcmp(enabledExtensionName, VK_EXT_DEBUG_REPORT_EXTENSION_NAME))
+			{
+				// If it's the last extension name, just decrement enabledExtensionCount
+				if (enabledExtensionIndex == (actualExtensionCount - 1))
+				{
+					enabledExtensionCount--;
+				}
+				else // If not, swap with the last extension name
+				{
+					enabledExtensionNames[enabledExtensionIndex] = enabledExtensionNames[actualExtensionCount - 1];
+					enabledExtensionNames[actualExtensionCount - 1] = enabledExtensionName;
+
+					// The first if will be called in the end, decrementing the enabledExtensionCount
+				}
+			}
+		}
+	}
+
+
+	VkResult err = vkuCreateDevice(enabledExtensionCount, enabledExtensionNames, enabledLayerCount, enabledLayerNames, pAllocator, physicalDevice, queueFamilyIndex, device);
+
+
+	// Remember to delete it by the actualExtensionCount and not the enabledExtensionCount
+	vkuDeleteInstanceExtensionNames(actualExtensionCount, enabledExtensionNames);
+	// enabledExtensionNames = NULL;
+
+	// Remember to delete it by the actualLayerCount and not the enabledLayerCount
+	vkuDeleteInstanceLayerNames(actualLayerCount, enabledLayerNames);
+	// enabledLayerNames = NULL;
+
+
+	return err;
+}
+
+
+
+VKUAPI_ATTR VkResult vkuCreateDeviceFromSpec(const VkuExtensionSpec *spec, const VkAllocationCallbacks *pAllocator, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkDevice *device)
+{
+	assert(device);
+
+
+	vku_resolved_spec resolved;
+	VkResult err = vku_resolveExtensionSpec(physicalDevice, spec, &resolved);
+
+	if (err)
+		return err;
+
+
+	err = vkuCreateDevice(
+		resolved.enabledExtensionCount, resolved.ppEnabledExtensionNames,
+		resolved.enabledLayerCount, resolved.ppEnabledLayerNames,
+		pAllocator, physicalDevice, queueFamilyIndex, device);
+
+
+	vku_destroyResolvedSpec(&resolved);
+
+	return err;
+}
+
+
+
+VKUAPI_ATTR VkResult vkuCreateDeviceFromSpecWithQueues(const VkuExtensionSpec *spec, const VkAllocationCallbacks *pAllocator,
+	VkPhysicalDevice physicalDevice, const VkuQueueTopology *topology, const float *rolePriorities, VkDevice *device, VkuQueues *queues)
+{
+	assert(device);
+
+
+	vku_resolved_spec resolved;
+	VkResult err = vku_resolveExtensionSpec(physicalDevice, spec, &resolved);
+
+	if (err)
+		return err;
+
+
+	err = vkuCreateDeviceWithQueues(
+		resolved.enabledExtensionCount, resolved.ppEnabledExtensionNames,
+		resolved.enabledLayerCount, resolved.ppEnabledLayerNames,
+		pAllocator, physicalDevice, topology, rolePriorities, device, queues);
+
+
+	vku_destroyResolvedSpec(&resolved);
+
+	return err;
+}
+
+
+
+// The device-level commands of the dispatch table. Each list is an X-macro, called with the name of each command.
+#define VKU_DEVICE_COMMANDS_1_0(X) \
+	X(vkDestroyDevice) \
+	X(vkGetDeviceQueue) \
+	X(vkQueueSubmit) \
+	X(vkQueueWaitIdle) \
+	X(vkDeviceWaitIdle) \
+	X(vkAllocateMemory) \
+	X(vkFreeMemory) \
+	X(vkMapMemory) \
+	X(vkUnmapMemory) \
+	X(vkFlushMappedMemoryRanges) \
+	X(vkInvalidateMappedMemoryRanges) \
+	X(vkGetDeviceMemoryCommitment) \
+	X(vkBindBufferMemory) \
+	X(vkBindImageMemory) \
+	X(vkGetBufferMemoryRequirements) \
+	X(vkGetImageMemoryRequirements) \
+	X(vkGetImageSparseMemoryRequirements) \
+	X(vkQueueBindSparse) \
+	X(vkCreateFence) \
+	X(vkDestroyFence) \
+	X(vkResetFences) \
+	X(vkGetFenceStatus) \
+	X(vkWaitForFences) \
+	X(vkCreateSemaphore) \
+	X(vkDestroySemaphore) \
+	X(vkCreateEvent) \
+	X(vkDestroyEvent) \
+	X(vkGetEventStatus) \
+	X(vkSetEvent) \
+	X(vkResetEvent) \
+	X(vkCreateQueryPool) \
+	X(vkDestroyQueryPool) \
+	X(vkGetQueryPoolResults) \
+	X(vkCreateBuffer) \
+	X(vkDestroyBuffer) \
+	X(vkCreateBufferView) \
+	X(vkDestroyBufferView) \
+	X(vkCreateImage) \
+	X(vkDestroyImage) \
+	X(vkGetImageSubresourceLayout) \
+	X(vkCreateImageView) \
+	X(vkDestroyImageView) \
+	X(vkCreateShaderModule) \
+	X(vkDestroyShaderModule) \
+	X(vkCreatePipelineCache) \
+	X(vkDestroyPipelineCache) \
+	X(vkGetPipelineCacheData) \
+	X(vkMergePipelineCaches) \
+	X(vkCreateGraphicsPipelines) \
+	X(vkCreateComputePipelines) \
+	X(vkDestroyPipeline) \
+	X(vkCreatePipelineLayout) \
+	X(vkDestroyPipelineLayout) \
+	X(vkCreateSampler) \
+	X(vkDestroySampler) \
+	X(vkCreateDescriptorSetLayout) \
+	X(vkDestroyDescriptorSetLayout) \
+	X(vkCreateDescriptorPool) \
+	X(vkDestroyDescriptorPool) \
+	X(vkResetDescriptorPool) \
+	X(vkAllocateDescriptorSets) \
+	X(vkFreeDescriptorSets) \
+	X(vkUpdateDescriptorSets) \
+	X(vkCreateFramebuffer) \
+	X(vkDestroyFramebuffer) \
+	X(vkCreateRenderPass) \
+	X(vkDestroyRenderPass) \
+	X(vkGetRenderAreaGranularity) \
+	X(vkCreateCommandPool) \
+	X(vkDestroyCommandPool) \
+	X(vkResetCommandPool) \
+	X(vkAllocateCommandBuffers) \
+	X(vkFreeCommandBuffers) \
+	X(vkBeginCommandBuffer) \
+	X(vkEndCommandBuffer) \
+	X(vkResetCommandBuffer) \
+	X(vkCmdBindPipeline) \
+	X(vkCmdSetViewport) \
+	X(vkCmdSetScissor) \
+	X(vkCmdSetLineWidth) \
+	X(vkCmdSetDepthBias) \
+	X(vkCmdSetBlendConstants) \
+	X(vkCmdSetDepthBounds) \
+	X(vkCmdSetStencilCompareMask) \
+	X(vkCmdSetStencilWriteMask) \
+	X(vkCmdSetStencilReference) \
+	X(vkCmdBindDescriptorSets) \
+	X(vkCmdBindIndexBuffer) \
+	X(vkCmdBindVertexBuffers) \
+	X(vkCmdDraw) \
+	X(vkCmdDrawIndexed) \
+	X(vkCmdDrawIndirect) \
+	X(vkCmdDrawIndexedIndirect) \
+	X(vkCmdDispatch) \
+	X(vkCmdDispatchIndirect) \
+	X(vkCmdCopyBuffer) \
+	X(vkCmdCopyImage) \
+	X(vkCmdBlitImage) \
+	X(vkCmdCopyBufferToImage) \
+	X(vkCmdCopyImageToBuffer) \
+	X(vkCmdUpdateBuffer) \
+	X(vkCmdFillBuffer) \
+	X(vkCmdClearColorImage) \
+	X(vkCmdClearDepthStencilImage) \
+	X(vkCmdClearAttachments) \
+	X(vkCmdResolveImage) \
+	X(vkCmdSetEvent) \
+	X(vkCmdResetEvent) \
+	X(vkCmdWaitEvents) \
+	X(vkCmdPipelineBarrier) \
+	X(vkCmdBeginQuery) \
+	X(vkCmdEndQuery) \
+	X(vkCmdResetQueryPool) \
+	X(vkCmdWriteTimestamp) \
+	X(vkCmdCopyQueryPoolResults) \
+	X(vkCmdPushConstants) \
+	X(vkCmdBeginRenderPass) \
+	X(vkCmdNextSubpass) \
+	X(vkCmdEndRenderPass) \
+	X(vkCmdExecuteCommands)
+
+#ifdef VK_VERSION_1_1
+#define VKU_DEVICE_COMMANDS_1_1(X) \
+	X(vkBindBufferMemory2) \
+	X(vkBindImageMemory2) \
+	X(vkGetDeviceGroupPeerMemoryFeatures) \
+	X(vkCmdSetDeviceMask) \
+	X(vkCmdDispatchBase) \
+	X(vkGetImageMemoryRequirements2) \
+	X(vkGetBufferMemoryRequirements2) \
+	X(vkGetImageSparseMemoryRequirements2) \
+	X(vkTrimCommandPool) \
+	X(vkGetDeviceQueue2) \
+	X(vkCreateSamplerYcbcrConversion) \
+	X(vkDestroySamplerYcbcrConversion) \
+	X(vkCreateDescriptorUpdateTemplate) \
+	X(vkDestroyDescriptorUpdateTemplate) \
+	X(vkUpdateDescriptorSetWithTemplate) \
+	X(vkGetDescriptorSetLayoutSupport)
+#else
+#define VKU_DEVICE_COMMANDS_1_1(X)
+#endif
+
+#ifdef VK_VERSION_1_2
+#define VKU_DEVICE_COMMANDS_1_2(X) \
+	X(vkCmdDrawIndirectCount) \
+	X(vkCmdDrawIndexedIndirectCount) \
+	X(vkCreateRenderPass2) \
+	X(vkCmdBeginRenderPass2) \
+	X(vkCmdNextSubpass2) \
+	X(vkCmdEndRenderPass2) \
+	X(vkResetQueryPool) \
+	X(vkGetSemaphoreCounterValue) \
+	X(vkWaitSemaphores) \
+	X(vkSignalSemaphore) \
+	X(vkGetBufferDeviceAddress) \
+	X(vkGetBufferOpaqueCaptureAddress) \
+	X(vkGetDeviceMemoryOpaqueCaptureAddress)
+#else
+#define VKU_DEVICE_COMMANDS_1_2(X)
+#endif
+
+#ifdef VK_KHR_swapchain
+#define VKU_DEVICE_COMMANDS_KHR_SWAPCHAIN(X) \
+	X(vkCreateSwapchainKHR) \
+	X(vkDestroySwapchainKHR) \
+	X(vkGetSwapchainImagesKHR) \
+	X(vkAcquireNextImageKHR) \
+	X(vkQueuePresentKHR)
+#else
+#define VKU_DEVICE_COMMANDS_KHR_SWAPCHAIN(X)
+#endif
+
+#ifdef VK_KHR_push_descriptor
+#define VKU_DEVICE_COMMANDS_KHR_PUSH_DESCRIPTOR(X) \
+	X(vkCmdPushDescriptorSetKHR)
+#else
+#define VKU_DEVICE_COMMANDS_KHR_PUSH_DESCRIPTOR(X)
+#endif
+
+#ifdef VK_KHR_dynamic_rendering
+#define VKU_DEVICE_COMMANDS_KHR_DYNAMIC_RENDERING(X) \
+	X(vkCmdBeginRenderingKHR) \
+	X(vkCmdEndRenderingKHR)
+#else
+#define VKU_DEVICE_COMMANDS_KHR_DYNAMIC_RENDERING(X)
+#endif
+
+#ifdef VK_KHR_synchronization2
+#define VKU_DEVICE_COMMANDS_KHR_SYNCHRONIZATION_2(X) \
+	X(vkCmdPipelineBarrier2KHR) \
+	X(vkQueueSubmit2KHR)
+#else
+#define VKU_DEVICE_COMMANDS_KHR_SYNCHRONIZATION_2(X)
+#endif
+
+#ifdef VK_EXT_debug_utils
+#define VKU_DEVICE_COMMANDS_EXT_DEBUG_UTILS(X) \
+	X(vkSetDebugUtilsObjectNameEXT) \
+	X(vkCmdBeginDebugUtilsLabelEXT) \
+	X(vkCmdEndDebugUtilsLabelEXT) \
+	X(vkCmdInsertDebugUtilsLabelEXT)
+#else
+#define VKU_DEVICE_COMMANDS_EXT_DEBUG_UTILS(X)
+#endif
+
+#define VKU_DEVICE_COMMANDS(X) \
+	VKU_DEVICE_COMMANDS_1_0(X) \
+	VKU_DEVICE_COMMANDS_1_1(X) \
+	VKU_DEVICE_COMMANDS_1_2(X) \
+	VKU_DEVICE_COMMANDS_KHR_SWAPCHAIN(X) \
+	VKU_DEVICE_COMMANDS_KHR_PUSH_DESCRIPTOR(X) \
+	VKU_DEVICE_COMMANDS_KHR_DYNAMIC_RENDERING(X) \
+	VKU_DEVICE_COMMANDS_KHR_SYNCHRONIZATION_2(X) \
+	VKU_DEVICE_COMMANDS_EXT_DEBUG_UTILS(X)
+
+
+// Calls a command through a VkuDeviceDispatch, straight into the driver of its device, for example:
+// VKU_DISPATCH(dispatch, vkCmdDraw)(commandBuffer, 3, 1, 0, 0);
+#define VKU_DISPATCH(dispatch, command) ((dispatch)->command)
+
+
+// The device-level commands of a VkDevice, which skip the loader's trampolines. There's a table
+// for each VkDevice, and the commands may only be used with that device and its child objects.
+typedef struct VkuDeviceDispatch
+{
+	VkDevice device;
+
+#define VKU_DECLARE_DEVICE_COMMAND(command) PFN_##command command;
+	VKU_DEVICE_COMMANDS(VKU_DECLARE_DEVICE_COMMAND)
+#undef VKU_DECLARE_DEVICE_COMMAND
+} VkuDeviceDispatch;
+
+
+// Loads the table with vkGetDeviceProcAddr(), call it right after creating the device, e.g. with vkuCreateDevice().
+// The commands of versions and extensions the device doesn't have (or weren't enabled) are NULL. Returns
+// VK_ERROR_INITIALIZATION_FAILED if any Vulkan 1.0 command is missing.
+VKUAPI_ATTR VkResult vkuLoadDeviceDispatch(VkDevice device, VkuDeviceDispatch *dispatch)
+{
+	assert(device);
+	assert(dispatch);
+
+
+	memset(dispatch, 0, sizeof(VkuDeviceDispatch));
+
+	dispatch->device = device;
+
+#define VKU_LOAD_DEVICE_COMMAND(command) dispatch->command = (PFN_##command) vkGetDeviceProcAddr(device, #command);
+	VKU_DEVICE_COMMANDS(VKU_LOAD_DEVICE_COMMAND)
+#undef VKU_LOAD_DEVICE_COMMAND
+
+
+	VkBool32 complete = VK_TRUE;
+
+#define VKU_CHECK_DEVICE_COMMAND(command) complete &= (dispatch->command != NULL) ? VK_TRUE : VK_FALSE;
+	VKU_DEVICE_COMMANDS_1_0(VKU_CHECK_DEVICE_COMMAND)
+#undef VKU_CHECK_DEVICE_COMMAND
+
+	return complete ? VK_SUCCESS : VK_ERROR_INITIALIZATION_FAILED;
+}
+
+
+
+// The default size of the VkDeviceMemory blocks, which are sub-allocated using a
+// buddy allocator. Sub-allocations are at least VKU_MIN_SUB_ALLOCATION_SIZE bytes.
+#define VKU_DEFAULT_MEMORY_BLOCK_SIZE (64ull * 1024ull * 1024ull)
+#define VKU_MIN_SUB_ALLOCATION_SIZE 256ull
+
+
+typedef struct VkuAllocator_T* VkuAllocator;
+typedef struct VkuAllocation_T* VkuAllocation;
+
+
+typedef struct VkuAllocatorCreateInfo
+{
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	// The size of each VkDeviceMemory block (rounded up to a power of two),
+	// 0 means VKU_DEFAULT_MEMORY_BLOCK_SIZE
+	VkDeviceSize blockSize;
+
+	// Allocations larger than this get their own VkDeviceMemory, 0 means blockSize / 2
+	VkDeviceSize dedicatedThreshold;
+
+	// Used for vkAllocateMemory() and vkFreeMemory()
+	const VkAllocationCallbacks *pAllocator;
+} VkuAllocatorCreateInfo;
+
+
+typedef struct VkuAllocationCreateInfo
+{
+	VkMemoryPropertyFlags requiredFlags;
+	VkMemoryPropertyFlags preferredFlags;
+
+	// VK_TRUE for buffers and linear images, VK_FALSE for optimal images.
+	// Linear and optimal resources are placed in different blocks, such
+	// that bufferImageGranularity never has to be accounted for.
+	VkBool32 linear;
+
+	// Always give the allocation its own VkDeviceMemory
+	VkBool32 dedicated;
+} VkuAllocationCreateInfo;
+
+
+typedef struct VkuAllocationInfo
+{
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+
+	uint32_t memoryTypeIndex;
+
+	// Host visible memory is persistently mapped, otherwise NULL
+	void *pMappedData;
+
+	VkBool32 dedicated;
+} VkuAllocationInfo;
+
+
+typedef struct VkuHeapStatistics
+{
+	// VkDeviceMemory blocks and dedicated allocations
+	uint32_t blockCount;
+	uint32_t dedicatedAllocationCount;
+
+	// Sub-allocations and dedicated allocations
+	uint32_t allocationCount;
+
+	// The total size of the VkDeviceMemory allocated from the heap
+	VkDeviceSize allocatedSize;
+
+	// The total requested size of the allocations, the
+	// difference to allocatedSize is the fragmentation
+	VkDeviceSize usedSize;
+} VkuHeapStatistics;
+
+typedef struct VkuAllocatorStatistics
+{
+	uint32_t memoryHeapCount;
+	VkuHeapStatistics heaps[VK_MAX_MEMORY_HEAPS];
+
+	// The amount of live VkDeviceMemory objects, to compare against maxMemoryAllocationCount
+	uint32_t deviceMemoryCount;
+} VkuAllocatorStatistics;
+
+
+typedef struct vku_memory_block
+{
+	VkDeviceMemory memory;
+	void *pMappedData;
+
+	VkDeviceSize size;
+
+	// The block is a complete binary tree of nodes, where the leaves are VKU_MIN_SUB_ALLOCATION_SIZE.
+	// Each node stores (1 + order) of the largest free node in its subtree, where a node of
+	// order n is (VKU_MIN_SUB_ALLOCATION_SIZE << n) bytes. 0 means nothing is free.
+	uint32_t maxOrder;
+	uint8_t *nodes;
+
+	uint32_t allocationCount;
+	VkDeviceSize usedSize;
+
+	struct vku_memory_block *pNext;
+} vku_memory_block;
+
+
+struct VkuAllocation_T
+{
+	// NULL for dedicated allocations
+	vku_memory_block *block;
+
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+
+	uint32_t memoryTypeIndex;
+	uint32_t order;
+	VkBool32 linear;
+
+	void *pMappedData;
+};
+
+
+struct VkuAllocator_T
+{
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	const VkAllocationCallbacks *pAllocator;
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	uint32_t maxMemoryAllocationCount;
+
+	VkDeviceSize blockSize;
+	VkDeviceSize dedicatedThreshold;
+
+	// The blocks of each memory type, for linear [0] and optimal [1] resources
+	vku_memory_block *blocks[VK_MAX_MEMORY_TYPES][2];
+
+	VkuAllocatorStatistics statistics;
+};
+
+
+static uint32_t vku_log2Ceil(VkDeviceSize value)
+{
+	uint32_t log2 = 0;
+
+	while ((1ull << log2) < value)
+		log2++;
+
+	return log2;
+}
+
+
+// Returns VK_ERROR_FEATURE_NOT_PRESENT if no memory type has the requiredFlags. Memory types
+// with all the preferredFlags are picked first, then the ones with the most of them.
+VKUAPI_ATTR VkResult vkuFindMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties *memoryProperties, uint32_t memoryTypeBits,
+	VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags, uint32_t *memoryTypeIndex)
+{
+	assert(memoryProperties);
+	assert(memoryTypeIndex);
+
+
+	(*memoryTypeIndex) = VK_MAX_MEMORY_TYPES;
+
+	uint32_t bestPreferredCount = 0;
+
+	for (uint32_t typeIndex = 0; typeIndex < memoryProperties->memoryTypeCount; typeIndex++)
+	{
+		if (!(memoryTypeBits & (1u << typeIndex)))
+			continue;
+
+		const VkMemoryPropertyFlags propertyFlags = memoryProperties->memoryTypes[typeIndex].propertyFlags;
+
+		if ((propertyFlags & requiredFlags) != requiredFlags)
+			continue;
+
+
+		uint32_t preferredCount = 1;
+
+		for (VkMemoryPropertyFlags preferredBits = propertyFlags & preferredFlags; preferredBits; preferredBits &= preferredBits - 1)
+			preferredCount++;
+
+		if (preferredCount > bestPreferredCount)
+		{
+			(*memoryTypeIndex) = typeIndex;
+			bestPreferredCount = preferredCount;
+		}
+	}
+
+
+	if ((*memoryTypeIndex) == VK_MAX_MEMORY_TYPES)
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+
+	return VK_SUCCESS;
+}
+
+
+static VkResult vku_allocateDeviceMemory(VkuAllocator allocator, uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory *memory, void **pMappedData)
+{
+	if (allocator->statistics.deviceMemoryCount >= allocator->maxMemoryAllocationCount)
+		return VK_ERROR_TOO_MANY_OBJECTS;
+
+
+	VkMemoryAllocateInfo allocateInfo;
+	memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = size;
+	allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkResult err = vkAllocateMemory(allocator->device, &allocateInfo, allocator->pAllocator, memory);
+
+	if (err)
+		return err;
+
+
+	(*pMappedData) = NULL;
+
+	if (allocator->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		err = vkMapMemory(allocator->device, *memory, 0, VK_WHOLE_SIZE, 0, pMappedData);
+
+		if (err)
+		{
+			vkFreeMemory(allocator->device, *memory, allocator->pAllocator);
+			(*memory) = VK_NULL_HANDLE;
+
+			return err;
+		}
+	}
+
+
+	const uint32_t heapIndex = allocator->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+
+	allocator->statistics.deviceMemoryCount++;
+	allocator->statistics.heaps[heapIndex].allocatedSize += size;
+
+	return VK_SUCCESS;
+}
+
+static void vku_freeDeviceMemory(VkuAllocator allocator, uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory memory)
+{
+	// Freeing implicitly unmaps the memory
+	vkFreeMemory(allocator->device, memory, allocator->pAllocator);
+
+
+	const uint32_t heapIndex = allocator->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+
+	allocator->statistics.deviceMemoryCount--;
+	allocator->statistics.heaps[heapIndex].allocatedSize -= size;
+}
+
+
+static VkResult vku_createMemoryBlock(VkuAllocator allocator, uint32_t memoryTypeIndex, VkDeviceSize blockSize, vku_memory_block **block)
+{
+	const uint32_t maxOrder = vku_log2Ceil(blockSize / VKU_MIN_SUB_ALLOCATION_SIZE);
+	const size_t nodeCount = (((size_t) 2) << maxOrder) - 1;
+
+
+	(*block) = (vku_memory_block*) VKU_CALLOC(1, sizeof(vku_memory_block));
+
+	if (!(*block))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	(*block)->nodes = (uint8_t*) VKU_MALLOC(nodeCount);
+
+	if (!(*block)->nodes)
+	{
+		VKU_FREE(*block);
+		(*block) = NULL;
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+
+	VkResult err = vku_allocateDeviceMemory(allocator, memoryTypeIndex, blockSize, &(*block)->memory, &(*block)->pMappedData);
+
+	if (err)
+	{
+		VKU_FREE((*block)->nodes);
+		VKU_FREE(*block);
+		(*block) = NULL;
+
+		return err;
+	}
+
+
+	(*block)->size = blockSize;
+	(*block)->maxOrder = maxOrder;
+
+	// Everything is free, so each node stores its own order
+	for (uint32_t depth = 0; depth <= maxOrder; depth++)
+	{
+		const size_t firstNode = (((size_t) 1) << depth) - 1;
+		memset((*block)->nodes + firstNode, (int) (maxOrder - depth + 1), ((size_t) 1) << depth);
+	}
+
+
+	const uint32_t heapIndex = allocator->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	allocator->statistics.heaps[heapIndex].blockCount++;
+
+	return VK_SUCCESS;
+}
+
+static void vku_destroyMemoryBlock(VkuAllocator allocator, uint32_t memoryTypeIndex, vku_memory_block *block)
+{
+	vku_freeDeviceMemory(allocator, memoryTypeIndex, block->size, block->memory);
+
+	const uint32_t heapIndex = allocator->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	allocator->statistics.heaps[heapIndex].blockCount--;
+
+	VKU_FREE(block->nodes);
+	VKU_FREE(block);
+}
+
+
+static void vku_updateBlockNodeParents(vku_memory_block *block, size_t node, uint32_t order)
+{
+	uint8_t *nodes = block->nodes;
+
+	while (node > 0)
+	{
+		node = (node - 1) / 2;
+		order++;
+
+		const uint8_t left = nodes[node * 2 + 1];
+		const uint8_t right = nodes[node * 2 + 2];
+
+		// If both children are entirely free, then they merge
+		if ((left == order) && (right == order))
+			nodes[node] = (uint8_t) (order + 1);
+		else
+			nodes[node] = (left > right) ? left : right;
+	}
+}
+
+// Returns VK_FALSE if the block doesn't have a free node of the order
+static VkBool32 vku_allocateFromBlock(vku_memory_block *block, uint32_t order, VkDeviceSize *offset)
+{
+	uint8_t *nodes = block->nodes;
+
+	if ((order > block->maxOrder) || (nodes[0] < (order + 1)))
+		return VK_FALSE;
+
+
+	size_t node = 0;
+
+	for (uint32_t nodeOrder = block->maxOrder; nodeOrder > order; nodeOrder--)
+	{
+		// Prefer the left child, which keeps the allocations packed towards the start
+		node = node * 2 + 1;
+
+		if (nodes[node] < (order + 1))
+			node++;
+	}
+
+	nodes[node] = 0;
+
+	vku_updateBlockNodeParents(block, node, order);
+
+
+	const uint32_t depth = block->maxOrder - order;
+	const size_t firstNode = (((size_t) 1) << depth) - 1;
+
+	(*offset) = ((VkDeviceSize) (node - firstNode)) * (VKU_MIN_SUB_ALLOCATION_SIZE << order);
+
+	return VK_TRUE;
+}
+
+static void vku_freeFromBlock(vku_memory_block *block, uint32_t order, VkDeviceSize offset)
+{
+	const uint32_t depth = block->maxOrder - order;
+	const size_t firstNode = (((size_t) 1) << depth) - 1;
+
+	const size_t node = firstNode + (size_t) (offset / (VKU_MIN_SUB_ALLOCATION_SIZE << order));
+
+	assert(block->nodes[node] == 0);
+
+	block->nodes[node] = (uint8_t) (order + 1);
+
+	vku_updateBlockNodeParents(block, node, order);
+}
+
+
+VKUAPI_ATTR VkResult vkuCreateAllocator(const VkuAllocatorCreateInfo *createInfo, VkuAllocator *allocator)
+{
+	assert(createInfo);
+	assert(createInfo->physicalDevice);
+	assert(createInfo->device);
+	assert(allocator);
+
+
+	(*allocator) = (VkuAllocator) VKU_CALLOC(1, sizeof(struct VkuAllocator_T));
+
+	if (!(*allocator))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*allocator)->physicalDevice = createInfo->physicalDevice;
+	(*allocator)->device = createInfo->device;
+	(*allocator)->pAllocator = createInfo->pAllocator;
+
+	vkGetPhysicalDeviceMemoryProperties(createInfo->physicalDevice, &(*allocator)->memoryProperties);
+
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(createInfo->physicalDevice, &properties);
+
+	(*allocator)->maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+
+	VkDeviceSize blockSize = createInfo->blockSize ? createInfo->blockSize : VKU_DEFAULT_MEMORY_BLOCK_SIZE;
+
+	if (blockSize < VKU_MIN_SUB_ALLOCATION_SIZE)
+		blockSize = VKU_MIN_SUB_ALLOCATION_SIZE;
+
+	(*allocator)->blockSize = 1ull << vku_log2Ceil(blockSize);
+	(*allocator)->dedicatedThreshold = createInfo->dedicatedThreshold ? createInfo->dedicatedThreshold : ((*allocator)->blockSize / 2);
+
+	// Anything larger than a block has to go to dedicated memory anyway
+	if ((*allocator)->dedicatedThreshold > (*allocator)->blockSize)
+		(*allocator)->dedicatedThreshold = (*allocator)->blockSize;
+
+	(*allocator)->statistics.memoryHeapCount = (*allocator)->memoryProperties.memoryHeapCount;
+
+
+	return VK_SUCCESS;
+}
+
+// All the allocations must be freed before destroying the allocator
+VKUAPI_ATTR void vkuDestroyAllocator(VkuAllocator allocator)
+{
+	if (!allocator)
+		return;
+
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < VK_MAX_MEMORY_TYPES; memoryTypeIndex++)
+	{
+		for (uint32_t tiling = 0; tiling < 2; tiling++)
+		{
+			vku_memory_block *block = allocator->blocks[memoryTypeIndex][tiling];
+
+			while (block)
+			{
+				vku_memory_block *next = block->pNext;
+
+				assert(block->allocationCount == 0);
+				vku_destroyMemoryBlock(allocator, memoryTypeIndex, block);
+
+				block = next;
+			}
+		}
+	}
+
+	VKU_FREE(allocator);
+}
+
+
+static VkResult vku_allocateFromMemoryType(VkuAllocator allocator, uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceSize alignment,
+	VkBool32 linear, VkBool32 dedicated, struct VkuAllocation_T *allocation)
+{
+	VkResult err;
+
+	allocation->memoryTypeIndex = memoryTypeIndex;
+	allocation->size = size;
+	allocation->linear = linear;
+
+
+	// Buddy nodes are aligned to their own size, so rounding the
+	// size up to the alignment also takes care of the alignment
+
+	const VkDeviceSize nodeSize = (size > alignment) ? size : alignment;
+
+	// Dedicated allocations start at offset 0, so they are aligned to anything
+	if (dedicated || (size > allocator->dedicatedThreshold) || (nodeSize > allocator->blockSize))
+	{
+		allocation->block = NULL;
+		allocation->offset = 0;
+		allocation->order = 0;
+
+		err = vku_allocateDeviceMemory(allocator, memoryTypeIndex, size, &allocation->memory, &allocation->pMappedData);
+
+		if (!err)
+		{
+			const uint32_t heapIndex = allocator->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+			allocator->statistics.heaps[heapIndex].dedicatedAllocationCount++;
+		}
+
+		return err;
+	}
+
+
+	const uint32_t order = vku_log2Ceil((nodeSize + VKU_MIN_SUB_ALLOCATION_SIZE - 1) / VKU_MIN_SUB_ALLOCATION_SIZE);
+
+	vku_memory_block **blocks = &allocator->blocks[memoryTypeIndex][linear ? 0 : 1];
+
+	vku_memory_block *block = *blocks;
+
+	for (; block; block = block->pNext)
+		if (vku_allocateFromBlock(block, order, &allocation->offset))
+			break;
+
+
+	if (!block)
+	{
+		// Don't let a single block take more than an 8th of a small heap,
+		// and try smaller blocks if the heap doesn't have room for it
+
+		const uint32_t heapIndex = allocator->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		const VkDeviceSize minBlockSize = VKU_MIN_SUB_ALLOCATION_SIZE << order;
+
+		VkDeviceSize blockSize = allocator->blockSize;
+
+		while (((blockSize / 2) >= minBlockSize) && (blockSize > (allocator->memoryProperties.memoryHeaps[heapIndex].size / 8)))
+			blockSize /= 2;
+
+		do
+		{
+			err = vku_createMemoryBlock(allocator, memoryTypeIndex, blockSize, &block);
+			blockSize /= 2;
+		}
+		while ((err == VK_ERROR_OUT_OF_DEVICE_MEMORY) && (blockSize >= minBlockSize));
+
+		if (err)
+			return err;
+
+		if (!vku_allocateFromBlock(block, order, &allocation->offset))
+		{
+			vku_destroyMemoryBlock(allocator, memoryTypeIndex, block);
+			return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		}
+
+		block->pNext = *blocks;
+		(*blocks) = block;
+	}
+
+
+	allocation->block = block;
+	allocation->memory = block->memory;
+	allocation->order = order;
+	allocation->pMappedData = block->pMappedData ? (((char*) block->pMappedData) + allocation->offset) : NULL;
+
+	block->allocationCount++;
+	block->usedSize += size;
+
+
+	return VK_SUCCESS;
+}
+
+static void vku_freeAllocationMemory(VkuAllocator allocator, struct VkuAllocation_T *allocation)
+{
+	const uint32_t memoryTypeIndex = allocation->memoryTypeIndex;
+
+
+	if (!allocation->block)
+	{
+		vku_freeDeviceMemory(allocator, memoryTypeIndex, allocation->size, allocation->memory);
+
+		const uint32_t heapIndex = allocator->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		allocator->statistics.heaps[heapIndex].dedicatedAllocationCount--;
+
+		return;
+	}
+
+
+	vku_memory_block *block = allocation->block;
+
+	vku_freeFromBlock(block, allocation->order, allocation->offset);
+
+	block->allocationCount--;
+	block->usedSize -= allocation->size;
+
+
+	// Free empty blocks, except if it's the only block (to avoid
+	// allocating and freeing the same block again and again)
+
+	vku_memory_block **blocks = &allocator->blocks[memoryTypeIndex][allocation->linear ? 0 : 1];
+
+	if ((block->allocationCount == 0) && !(((*blocks) == block) && !block->pNext))
+	{
+		for (vku_memory_block **link = blocks; *link; link = &(*link)->pNext)
+		{
+			if ((*link) == block)
+			{
+				(*link) = block->pNext;
+				break;
+			}
+		}
+
+		vku_destroyMemoryBlock(allocator, memoryTypeIndex, block);
+	}
+}
+
+
+VKUAPI_ATTR VkResult vkuAllocateMemory(VkuAllocator allocator, const VkMemoryRequirements *memoryRequirements, const VkuAllocationCreateInfo *createInfo, VkuAllocation *allocation)
+{
+	assert(allocator);
+	assert(memoryRequirements);
+	assert(createInfo);
+	assert(allocation);
+
+
+	(*allocation) = VK_NULL_HANDLE;
+
+
+	uint32_t memoryTypeIndex;
+	VkResult err = vkuFindMemoryTypeIndex(&allocator->memoryProperties, memoryRequirements->memoryTypeBits, createInfo->requiredFlags, createInfo->preferredFlags, &memoryTypeIndex);
+
+	if (err)
+		return err;
+
+
+	struct VkuAllocation_T *newAllocation = (struct VkuAllocation_T*) VKU_CALLOC(1, sizeof(struct VkuAllocation_T));
+
+	if (!newAllocation)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	const VkDeviceSize alignment = memoryRequirements->alignment ? memoryRequirements->alignment : 1;
+
+	err = vku_allocateFromMemoryType(allocator, memoryTypeIndex, memoryRequirements->size, alignment, createInfo->linear, createInfo->dedicated, newAllocation);
+
+	// If the preferred memory type is out of memory, then fall back to the other memory types
+	if ((err == VK_ERROR_OUT_OF_DEVICE_MEMORY) && createInfo->preferredFlags)
+	{
+		const uint32_t remainingTypeBits = memoryRequirements->memoryTypeBits & ~(1u << memoryTypeIndex);
+
+		if (!vkuFindMemoryTypeIndex(&allocator->memoryProperties, remainingTypeBits, createInfo->requiredFlags, 0, &memoryTypeIndex))
+			err = vku_allocateFromMemoryType(allocator, memoryTypeIndex, memoryRequirements->size, alignment, createInfo->linear, createInfo->dedicated, newAllocation);
+	}
+
+	if (err)
+	{
+		VKU_FREE(newAllocation);
+
+		return err;
+	}
+
+
+	const uint32_t heapIndex = allocator->memoryProperties.memoryTypes[newAllocation->memoryTypeIndex].heapIndex;
+
+	allocator->statistics.heaps[heapIndex].allocationCount++;
+	allocator->statistics.heaps[heapIndex].usedSize += newAllocation->size;
+
+
+	(*allocation) = newAllocation;
+
+	return VK_SUCCESS;
+}
+
+VKUAPI_ATTR void vkuFreeMemory(VkuAllocator allocator, VkuAllocation allocation)
+{
+	assert(allocator);
+
+	if (!allocation)
+		return;
+
+
+	const uint32_t heapIndex = allocator->memoryProperties.memoryTypes[allocation->memoryTypeIndex].heapIndex;
+
+	allocator->statistics.heaps[heapIndex].allocationCount--;
+	allocator->statistics.heaps[heapIndex].usedSize -= allocation->size;
+
+
+	vku_freeAllocationMemory(allocator, allocation);
+
+	VKU_FREE(allocation);
+}
+
+
+// Allocates and binds memory for the buffer, createInfo->linear is ignored
+VKUAPI_ATTR VkResult vkuAllocateBufferMemory(VkuAllocator allocator, VkBuffer buffer, const VkuAllocationCreateInfo *createInfo, VkuAllocation *allocation)
+{
+	assert(allocator);
+	assert(createInfo);
+
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(allocator->device, buffer, &memoryRequirements);
+
+	VkuAllocationCreateInfo bufferCreateInfo = *createInfo;
+	bufferCreateInfo.linear = VK_TRUE;
+
+	VkResult err = vkuAllocateMemory(allocator, &memoryRequirements, &bufferCreateInfo, allocation);
+
+	if (err)
+		return err;
+
+
+	err = vkBindBufferMemory(allocator->device, buffer, (*allocation)->memory, (*allocation)->offset);
+
+	if (err)
+	{
+		vkuFreeMemory(allocator, *allocation);
+		(*allocation) = VK_NULL_HANDLE;
+	}
+
+	return err;
+}
+
+// Allocates and binds memory for the image, createInfo->linear must match the image's tiling
+VKUAPI_ATTR VkResult vkuAllocateImageMemory(VkuAllocator allocator, VkImage image, const VkuAllocationCreateInfo *createInfo, VkuAllocation *allocation)
+{
+	assert(allocator);
+	assert(createInfo);
+
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(allocator->device, image, &memoryRequirements);
+
+	VkResult err = vkuAllocateMemory(allocator, &memoryRequirements, createInfo, allocation);
+
+	if (err)
+		return err;
+
+
+	err = vkBindImageMemory(allocator->device, image, (*allocation)->memory, (*allocation)->offset);
+
+	if (err)
+	{
+		vkuFreeMemory(allocator, *allocation);
+		(*allocation) = VK_NULL_HANDLE;
+	}
+
+	return err;
+}
+
+
+VKUAPI_ATTR void vkuGetAllocationInfo(VkuAllocation allocation, VkuAllocationInfo *allocationInfo)
+{
+	assert(allocation);
+	assert(allocationInfo);
+
+	allocationInfo->memory = allocation->memory;
+	allocationInfo->offset = allocation->offset;
+	allocationInfo->size = allocation->size;
+	allocationInfo->memoryTypeIndex = allocation->memoryTypeIndex;
+	allocationInfo->pMappedData = allocation->pMappedData;
+	allocationInfo->dedicated = allocation->block ? VK_FALSE : VK_TRUE;
+}
+
+
+VKUAPI_ATTR void vkuGetAllocatorStatistics(VkuAllocator allocator, VkuAllocatorStatistics *statistics)
+{
+	assert(allocator);
+	assert(statistics);
+
+	(*statistics) = allocator->statistics;
+}
+
+
+
+// Called for each allocation the defragmentation wants to move. The data has to be copied from the
+// old memory and offset to the new memory and offset (e.g. using vkCmdCopyBuffer), and the resource
+// has to be recreated and bound to the new memory. Return VK_FALSE to keep the allocation where it is.
+typedef VkBool32 (VKAPI_PTR *PFN_vkuDefragmentMove)(void *pUserData, VkuAllocation allocation,
+	VkDeviceMemory oldMemory, VkDeviceSize oldOffset, VkDeviceMemory newMemory, VkDeviceSize newOffset, VkDeviceSize size);
+
+
+typedef struct VkuDefragmentStatistics
+{
+	uint32_t allocationsMoved;
+	VkDeviceSize bytesMoved;
+	uint32_t blocksFreed;
+} VkuDefragmentStatistics;
+
+
+// Moves the allocations out of the least used blocks and into the other blocks of the same
+// memory type, after which the emptied blocks are freed. Dedicated allocations aren't moved.
+// Allocations are only known through their handles, so the caller passes them all in.
+VKUAPI_ATTR VkResult vkuDefragmentAllocator(VkuAllocator allocator, uint32_t allocationCount, const VkuAllocation *allocations,
+	PFN_vkuDefragmentMove pfnMove, void *pUserData, VkuDefragmentStatistics *statistics)
+{
+	assert(allocator);
+	assert(!allocationCount || allocations);
+	assert(pfnMove);
+
+
+	VkuDefragmentStatistics defragmentStatistics;
+	memset(&defragmentStatistics, 0, sizeof(defragmentStatistics));
+
+	const uint32_t blocksBefore = allocator->statistics.deviceMemoryCount;
+
+
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < allocator->memoryProperties.memoryTypeCount; memoryTypeIndex++)
+	{
+		for (uint32_t tiling = 0; tiling < 2; tiling++)
+		{
+			vku_memory_block *blocks = allocator->blocks[memoryTypeIndex][tiling];
+
+			if (!blocks || !blocks->pNext)
+				continue;
+
+
+			// The least used block is the source, then the other blocks are the destinations
+
+			vku_memory_block *source = blocks;
+
+			for (vku_memory_block *block = blocks; block; block = block->pNext)
+				if (block->usedSize < source->usedSize)
+					source = block;
+
+
+			for (uint32_t allocationIndex = 0; allocationIndex < allocationCount; allocationIndex++)
+			{
+				struct VkuAllocation_T *allocation = allocations[allocationIndex];
+
+				if (!allocation || (allocation->block != source))
+					continue;
+
+
+				vku_memory_block *destination = NULL;
+				VkDeviceSize newOffset = 0;
+
+				for (vku_memory_block *block = allocator->blocks[memoryTypeIndex][tiling]; block; block = block->pNext)
+				{
+					if ((block != source) && vku_allocateFromBlock(block, allocation->order, &newOffset))
+					{
+						destination = block;
+						break;
+					}
+				}
+
+				if (!destination)
+					break; // The other blocks are full
+
+
+				if (!pfnMove(pUserData, allocation, allocation->memory, allocation->offset, destination->memory, newOffset, allocation->size))
+				{
+					vku_freeFromBlock(destination, allocation->order, newOffset);
+					continue;
+				}
+
+
+				vku_freeFromBlock(source, allocation->order, allocation->offset);
+
+				source->allocationCount--;
+				source->usedSize -= allocation->size;
+
+				destination->allocationCount++;
+				destination->usedSize += allocation->size;
+
+				allocation->block = destination;
+				allocation->memory = destination->memory;
+				allocation->offset = newOffset;
+				allocation->pMappedData = destination->pMappedData ? (((char*) destination->pMappedData) + newOffset) : NULL;
+
+				defragmentStatistics.allocationsMoved++;
+				defragmentStatistics.bytesMoved += allocation->size;
+			}
+
+
+			if (source->allocationCount == 0)
+			{
+				vku_memory_block **link = &allocator->blocks[memoryTypeIndex][tiling];
+
+				while ((*link) != source)
+					link = &(*link)->pNext;
+
+				(*link) = source->pNext;
+
+				vku_destroyMemoryBlock(allocator, memoryTypeIndex, source);
+			}
+		}
+	}
+
+
+	defragmentStatistics.blocksFreed = blocksBefore - allocator->statistics.deviceMemoryCount;
+
+	if (statistics)
+		(*statistics) = defragmentStatistics;
+
+	return VK_SUCCESS;
+}
+
+
+
+// The default size of the upload ring, and the default amount of flushes
+// that can be in flight before vkuFlushUploadRing() waits for the oldest one.
+#define VKU_DEFAULT_UPLOAD_RING_SIZE (16ull * 1024ull * 1024ull)
+#define VKU_DEFAULT_UPLOAD_RING_FLUSH_COUNT 4
+
+// The alignment of each upload within the ring
+#define VKU_UPLOAD_RING_ALIGNMENT 16ull
+
+
+typedef struct VkuUploadRing_T* VkuUploadRing;
+
+
+typedef struct VkuUploadRingCreateInfo
+{
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	// The queue the copies are submitted to, e.g. the one from vkuGetQueueFamilyIndex()
+	uint32_t queueFamilyIndex;
+	VkQueue queue;
+
+	// If not NULL the ring's memory is allocated from it,
+	// otherwise the ring allocates its own VkDeviceMemory
+	VkuAllocator allocator;
+
+	// 0 means VKU_DEFAULT_UPLOAD_RING_SIZE
+	VkDeviceSize size;
+
+	// 0 means VKU_DEFAULT_UPLOAD_RING_FLUSH_COUNT
+	uint32_t maxFlushesInFlight;
+
+	// When the ring wraps into in-flight data, VK_TRUE doubles the size
+	// of the ring, while VK_FALSE waits for the data to be copied
+	VkBool32 allowGrowth;
+
+	// If dstStageMask isn't 0, then each flush ends with a memory barrier making the copies
+	// visible to dstStageMask/dstAccessMask on the queue. Otherwise the caller has to
+	// synchronize, e.g. by waiting on the semaphore passed to vkuFlushUploadRing().
+	VkPipelineStageFlags dstStageMask;
+	VkAccessFlags dstAccessMask;
+
+	// Used for vkCreateBuffer(), vkAllocateMemory() etc.
+	const VkAllocationCallbacks *pAllocator;
+} VkuUploadRingCreateInfo;
+
+
+typedef struct VkuUploadRingStatistics
+{
+	// The current size of the ring
+	VkDeviceSize size;
+
+	uint64_t uploadCount;
+	VkDeviceSize uploadedSize;
+
+	// Each flush records a single vkCmdCopyBuffer() per destination buffer, and
+	// another one each time an upload overlaps an earlier one of the same flush
+	uint64_t flushCount;
+	uint64_t copyCommandCount;
+
+	// The times an upload or flush had to wait for the GPU, and the total time waited in nanoseconds
+	uint64_t stallCount;
+	uint64_t stallTime;
+
+	uint32_t growCount;
+} VkuUploadRingStatistics;
+
+
+typedef struct vku_upload_backing
+{
+	VkBuffer buffer;
+	VkDeviceSize size;
+
+	// allocation is used if the ring has an allocator, otherwise memory
+	VkuAllocation allocation;
+	VkDeviceMemory memory;
+
+	char *pMappedData;
+
+	// Retired backings are destroyed once this many flushes have completed
+	uint64_t lastFlush;
+
+	struct vku_upload_backing *pNext;
+} vku_upload_backing;
+
+
+typedef struct vku_upload_copy
+{
+	VkBuffer dstBuffer;
+	VkBufferCopy region;
+
+	// The order of the upload, which keeps the sorting stable
+	uint32_t order;
+} vku_upload_copy;
+
+
+typedef struct vku_upload_flush
+{
+	VkCommandBuffer commandBuffer;
+	VkFence fence;
+
+	// The ring position up to which the copied data reaches,
+	// and the generation of the backing it was copied from
+	VkDeviceSize endPosition;
+	uint32_t generation;
+} vku_upload_flush;
+
+
+struct VkuUploadRing_T
+{
+	VkDevice device;
+	VkQueue queue;
+	VkuAllocator allocator;
+	const VkAllocationCallbacks *pAllocator;
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+
+	VkBool32 allowGrowth;
+
+	VkPipelineStageFlags dstStageMask;
+	VkAccessFlags dstAccessMask;
+
+	// The backing is replaced whenever the ring grows, the old ones are
+	// kept in retiredBackings until the flushes copying from them complete
+	vku_upload_backing backing;
+	uint32_t generation;
+
+	vku_upload_backing *retiredBackings;
+
+	// Monotonic positions, the offset into the ring is (position % backing.size).
+	// Everything from tail to head is either pending or in flight.
+	VkDeviceSize head;
+	VkDeviceSize tail;
+
+	// The pending uploads, regions is scratch memory for vkuFlushUploadRing()
+	uint32_t copyCount;
+	uint32_t copyCapacity;
+	vku_upload_copy *copies;
+	VkBufferCopy *regions;
+
+	VkCommandPool commandPool;
+
+	// A ring of maxFlushesInFlight flushes, of which flushesInFlight are in flight starting at firstFlush
+	uint32_t maxFlushesInFlight;
+	uint32_t firstFlush;
+	uint32_t flushesInFlight;
+	vku_upload_flush *flushes;
+
+	uint64_t submittedFlushCount;
+	uint64_t completedFlushCount;
+
+	VkuUploadRingStatistics statistics;
+};
+
+
+static VkResult vku_createUploadBacking(VkuUploadRing ring, VkDeviceSize size, vku_upload_backing *backing)
+{
+	memset(backing, 0, sizeof(vku_upload_backing));
+
+	backing->size = size;
+
+
+	VkBufferCreateInfo bufferCreateInfo;
+	memset(&bufferCreateInfo, 0, sizeof(bufferCreateInfo));
+
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkResult err = vkCreateBuffer(ring->device, &bufferCreateInfo, ring->pAllocator, &backing->buffer);
+
+	if (err)
+		return err;
+
+
+	// Host coherent memory, such that the writes never have to be flushed
+	const VkMemoryPropertyFlags requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	if (ring->allocator)
+	{
+		VkuAllocationCreateInfo allocationCreateInfo;
+		memset(&allocationCreateInfo, 0, sizeof(allocationCreateInfo));
+
+		allocationCreateInfo.requiredFlags = requiredFlags;
+		allocationCreateInfo.linear = VK_TRUE;
+		allocationCreateInfo.dedicated = VK_TRUE;
+
+		err = vkuAllocateBufferMemory(ring->allocator, backing->buffer, &allocationCreateInfo, &backing->allocation);
+
+		if (!err)
+			backing->pMappedData = (char*) backing->allocation->pMappedData;
+	}
+	else
+	{
+		VkMemoryRequirements memoryRequirements;
+		vkGetBufferMemoryRequirements(ring->device, backing->buffer, &memoryRequirements);
+
+		VkMemoryAllocateInfo allocateInfo;
+		memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = memoryRequirements.size;
+
+		err = vkuFindMemoryTypeIndex(&ring->memoryProperties, memoryRequirements.memoryTypeBits, requiredFlags, 0, &allocateInfo.memoryTypeIndex);
+
+		if (!err)
+			err = vkAllocateMemory(ring->device, &allocateInfo, ring->pAllocator, &backing->memory);
+
+		if (!err)
+			err = vkBindBufferMemory(ring->device, backing->buffer, backing->memory, 0);
+
+		if (!err)
+			err = vkMapMemory(ring->device, backing->memory, 0, VK_WHOLE_SIZE, 0, (void**) &backing->pMappedData);
+
+		if (err && backing->memory)
+		{
+			vkFreeMemory(ring->device, backing->memory, ring->pAllocator);
+			backing->memory = VK_NULL_HANDLE;
+		}
+	}
+
+
+	if (err)
+	{
+		vkDestroyBuffer(ring->device, backing->buffer, ring->pAllocator);
+		backing->buffer = VK_NULL_HANDLE;
+
+		return err;
+	}
+
+	return VK_SUCCESS;
+}
+
+static void vku_destroyUploadBacking(VkuUploadRing ring, vku_upload_backing *backing)
+{
+	vkDestroyBuffer(ring->device, backing->buffer, ring->pAllocator);
+
+	// Freeing implicitly unmaps the memory
+	if (backing->allocation)
+		vkuFreeMemory(ring->allocator, backing->allocation);
+	else
+		vkFreeMemory(ring->device, backing->memory, ring->pAllocator);
+}
+
+
+// Retires the completed flushes, if waitOldest is VK_TRUE then it
+// first waits for the oldest flush in flight to complete.
+static VkResult vku_retireUploadFlushes(VkuUploadRing ring, VkBool32 waitOldest)
+{
+	while (ring->flushesInFlight > 0)
+	{
+		vku_upload_flush *flush = &ring->flushes[ring->firstFlush];
+
+		VkResult err;
+
+		if (waitOldest)
+		{
+			err = vkWaitForFences(ring->device, 1, &flush->fence, VK_TRUE, UINT64_MAX);
+			waitOldest = VK_FALSE;
+		}
+		else
+			err = vkGetFenceStatus(ring->device, flush->fence);
+
+		if (err == VK_NOT_READY)
+			break;
+		else if (err)
+			return err;
+
+
+		if ((flush->generation == ring->generation) && (flush->endPosition > ring->tail))
+			ring->tail = flush->endPosition;
+
+		ring->firstFlush = (ring->firstFlush + 1) % ring->maxFlushesInFlight;
+		ring->flushesInFlight--;
+		ring->completedFlushCount++;
+	}
+
+
+	vku_upload_backing **link = &ring->retiredBackings;
+
+	while (*link)
+	{
+		vku_upload_backing *backing = (*link);
+
+		if (backing->lastFlush <= ring->completedFlushCount)
+		{
+			(*link) = backing->pNext;
+
+			vku_destroyUploadBacking(ring, backing);
+			VKU_FREE(backing);
+		}
+		else
+			link = &backing->pNext;
+	}
+
+	return VK_SUCCESS;
+}
+
+static VkResult vku_stallUploadRing(VkuUploadRing ring)
+{
+	const uint64_t stallStart = vku_getTime();
+
+	const VkResult err = vku_retireUploadFlushes(ring, VK_TRUE);
+
+	ring->statistics.stallCount++;
+	ring->statistics.stallTime += vku_getTime() - stallStart;
+
+	return err;
+}
+
+
+static int vku_compareUploadCopies(const void *a, const void *b)
+{
+	const vku_upload_copy *copyA = (const vku_upload_copy*) a;
+	const vku_upload_copy *copyB = (const vku_upload_copy*) b;
+
+	if (copyA->dstBuffer != copyB->dstBuffer)
+		return (copyA->dstBuffer < copyB->dstBuffer) ? -1 : 1;
+
+	return (copyA->order < copyB->order) ? -1 : ((copyA->order > copyB->order) ? 1 : 0);
+}
+
+
+// Returns VK_TRUE if region's destination range overlaps any of the regions
+static VkBool32 vku_overlapsUploadRegions(const VkBufferCopy *regions, uint32_t regionCount, const VkBufferCopy *region)
+{
+	for (uint32_t regionIndex = 0; regionIndex < regionCount; regionIndex++)
+	{
+		if ((region->dstOffset < (regions[regionIndex].dstOffset + regions[regionIndex].size)) &&
+			(regions[regionIndex].dstOffset < (region->dstOffset + region->size)))
+			return VK_TRUE;
+	}
+
+	return VK_FALSE;
+}
+
+
+// Submits the pending uploads, where the uploads to each buffer are copied by a single
+// vkCmdCopyBuffer() and adjacent uploads are merged into a single region. An upload
+// overlapping an earlier upload to the same buffer within the flush starts another
+// vkCmdCopyBuffer() after a transfer barrier, such that the later upload is the one kept.
+// If signalSemaphore isn't VK_NULL_HANDLE it's signaled when the copies have completed.
+VKUAPI_ATTR VkResult vkuFlushUploadRing(VkuUploadRing ring, VkSemaphore signalSemaphore)
+{
+	assert(ring);
+
+
+	if ((ring->copyCount == 0) && (signalSemaphore == VK_NULL_HANDLE))
+		return VK_SUCCESS;
+
+
+	VkResult err = vku_retireUploadFlushes(ring, VK_FALSE);
+
+	if (!err && (ring->flushesInFlight == ring->maxFlushesInFlight))
+		err = vku_stallUploadRing(ring);
+
+	if (err)
+		return err;
+
+
+	vku_upload_flush *flush = &ring->flushes[(ring->firstFlush + ring->flushesInFlight) % ring->maxFlushesInFlight];
+
+	err = vkResetFences(ring->device, 1, &flush->fence);
+
+	if (err)
+		return err;
+
+
+	VkCommandBufferBeginInfo beginInfo;
+	memset(&beginInfo, 0, sizeof(beginInfo));
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	err = vkBeginCommandBuffer(flush->commandBuffer, &beginInfo);
+
+	if (err)
+		return err;
+
+
+	qsort(ring->copies, ring->copyCount, sizeof(vku_upload_copy), vku_compareUploadCopies);
+
+	for (uint32_t copyIndex = 0; copyIndex < ring->copyCount;)
+	{
+		const VkBuffer dstBuffer = ring->copies[copyIndex].dstBuffer;
+
+		uint32_t regionCount = 0;
+
+		// The destination range spanned by the regions, which
+		// skips the search when uploads don't go back and forth
+		VkDeviceSize rangeStart = 0;
+		VkDeviceSize rangeEnd = 0;
+
+		for (; (copyIndex < ring->copyCount) && (ring->copies[copyIndex].dstBuffer == dstBuffer); copyIndex++)
+		{
+			const VkBufferCopy *region = &ring->copies[copyIndex].region;
+
+			// The regions of a vkCmdCopyBuffer() must not overlap
+			if ((regionCount > 0) && (region->dstOffset < rangeEnd) && (rangeStart < (region->dstOffset + region->size)) &&
+				vku_overlapsUploadRegions(ring->regions, regionCount, region))
+			{
+				vkCmdCopyBuffer(flush->commandBuffer, ring->backing.buffer, dstBuffer, regionCount, ring->regions);
+
+				ring->statistics.copyCommandCount++;
+
+				VkMemoryBarrier memoryBarrier;
+				memset(&memoryBarrier, 0, sizeof(memoryBarrier));
+
+				memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+				vkCmdPipelineBarrier(flush->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+
+				regionCount = 0;
+			}
+
+			if (regionCount == 0)
+			{
+				rangeStart = region->dstOffset;
+				rangeEnd = region->dstOffset + region->size;
+			}
+			else
+			{
+				if (region->dstOffset < rangeStart)
+					rangeStart = region->dstOffset;
+
+				if ((region->dstOffset + region->size) > rangeEnd)
+					rangeEnd = region->dstOffset + region->size;
+			}
+
+			if (regionCount > 0)
+			{
+				VkBufferCopy *previous = &ring->regions[regionCount - 1];
+
+				if (((previous->srcOffset + previous->size) == region->srcOffset) &&
+					((previous->dstOffset + previous->size) == region->dstOffset))
+				{
+					previous->size += region->size;
+					continue;
+				}
+			}
+
+			ring->regions[regionCount++] = (*region);
+		}
+
+		vkCmdCopyBuffer(flush->commandBuffer, ring->backing.buffer, dstBuffer, regionCount, ring->regions);
+
+		ring->statistics.copyCommandCount++;
+	}
+
+
+	if (ring->dstStageMask && (ring->copyCount > 0))
+	{
+		VkMemoryBarrier memoryBarrier;
+		memset(&memoryBarrier, 0, sizeof(memoryBarrier));
+
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = ring->dstAccessMask;
+
+		vkCmdPipelineBarrier(flush->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, ring->dstStageMask, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+	}
+
+
+	err = vkEndCommandBuffer(flush->commandBuffer);
+
+	if (err)
+		return err;
+
+
+	VkSubmitInfo submitInfo;
+	memset(&submitInfo, 0, sizeof(submitInfo));
+
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &flush->commandBuffer;
+
+	if (signalSemaphore != VK_NULL_HANDLE)
+	{
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &signalSemaphore;
+	}
+
+	err = vkQueueSubmit(ring->queue, 1, &submitInfo, flush->fence);
+
+	if (err)
+		return err;
+
+
+	flush->endPosition = ring->head;
+	flush->generation = ring->generation;
+
+	ring->flushesInFlight++;
+	ring->submittedFlushCount++;
+
+	ring->copyCount = 0;
+
+	ring->statistics.flushCount++;
+
+	return VK_SUCCESS;
+}
+
+
+static VkResult vku_growUploadRing(VkuUploadRing ring, VkDeviceSize minSize)
+{
+	VkDeviceSize size = ring->backing.size * 2;
+
+	while (size < minSize)
+		size *= 2;
+
+
+	// The pending uploads are copied from the current buffer, and only
+	// the caller knows when their data has been written to it
+	assert(ring->copyCount == 0);
+
+	vku_upload_backing backing;
+	VkResult err = vku_createUploadBacking(ring, size, &backing);
+
+	if (err)
+		return err;
+
+
+	if (ring->flushesInFlight > 0)
+	{
+		vku_upload_backing *retiredBacking = (vku_upload_backing*) VKU_MALLOC(sizeof(vku_upload_backing));
+
+		if (!retiredBacking)
+		{
+			vku_destroyUploadBacking(ring, &backing);
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+		}
+
+		(*retiredBacking) = ring->backing;
+		retiredBacking->lastFlush = ring->submittedFlushCount;
+		retiredBacking->pNext = ring->retiredBackings;
+
+		ring->retiredBackings = retiredBacking;
+	}
+	else
+		vku_destroyUploadBacking(ring, &ring->backing);
+
+
+	ring->backing = backing;
+	ring->generation++;
+
+	ring->head = 0;
+	ring->tail = 0;
+
+	ring->statistics.size = size;
+	ring->statistics.growCount++;
+
+	return VK_SUCCESS;
+}
+
+
+// Reserves size bytes of the ring, without splitting them across the end of the ring.
+// Never flushes the pending uploads, as their data might not have been written yet,
+// instead it returns VK_NOT_READY if they have to be flushed to make room.
+static VkResult vku_allocateUploadRegion(VkuUploadRing ring, VkDeviceSize size, VkDeviceSize *offset)
+{
+	VkResult err;
+
+	if (size > ring->backing.size)
+	{
+		if (!ring->allowGrowth)
+			return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		else if (ring->copyCount > 0)
+			return VK_NOT_READY;
+
+		err = vku_growUploadRing(ring, size);
+
+		if (err)
+			return err;
+	}
+
+
+	VkBool32 retired = VK_FALSE;
+
+	for (;;)
+	{
+		const VkDeviceSize ringSize = ring->backing.size;
+
+		// If the ring is empty, then start over at the beginning of it
+		if (ring->head == ring->tail)
+		{
+			ring->head = ((ring->head + ringSize - 1) / ringSize) * ringSize;
+			ring->tail = ring->head;
+		}
+
+
+		VkDeviceSize position = (ring->head + VKU_UPLOAD_RING_ALIGNMENT - 1) & ~(VKU_UPLOAD_RING_ALIGNMENT - 1);
+
+		if (((position % ringSize) + size) > ringSize)
+			position += ringSize - (position % ringSize);
+
+		if ((position + size - ring->tail) <= ringSize)
+		{
+			ring->head = position + size;
+			(*offset) = position % ringSize;
+
+			return VK_SUCCESS;
+		}
+
+
+		// The ring wrapped into data that's still pending or in flight
+		if (!retired)
+		{
+			err = vku_retireUploadFlushes(ring, VK_FALSE);
+			retired = VK_TRUE;
+		}
+		else if (ring->copyCount > 0)
+			return VK_NOT_READY;
+		else if (ring->allowGrowth)
+			err = vku_growUploadRing(ring, size);
+		else if (ring->flushesInFlight > 0)
+			err = vku_stallUploadRing(ring);
+		else
+			ring->tail = ring->head;
+
+		if (err)
+			return err;
+	}
+}
+
+
+static VkResult vku_addUploadCopy(VkuUploadRing ring, VkBuffer dstBuffer, VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkDeviceSize size)
+{
+	if (ring->copyCount == ring->copyCapacity)
+	{
+		const uint32_t copyCapacity = ring->copyCapacity ? (ring->copyCapacity * 2) : 64;
+
+		vku_upload_copy *copies = (vku_upload_copy*) VKU_REALLOC(ring->copies, copyCapacity * sizeof(vku_upload_copy));
+
+		if (!copies)
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+		ring->copies = copies;
+
+
+		VkBufferCopy *regions = (VkBufferCopy*) VKU_REALLOC(ring->regions, copyCapacity * sizeof(VkBufferCopy));
+
+		if (!regions)
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+		ring->regions = regions;
+		ring->copyCapacity = copyCapacity;
+	}
+
+
+	vku_upload_copy *copy = &ring->copies[ring->copyCount];
+
+	copy->dstBuffer = dstBuffer;
+	copy->region.srcOffset = srcOffset;
+	copy->region.dstOffset = dstOffset;
+	copy->region.size = size;
+	copy->order = ring->copyCount;
+
+	ring->copyCount++;
+
+	ring->statistics.uploadCount++;
+	ring->statistics.uploadedSize += size;
+
+	return VK_SUCCESS;
+}
+
+
+VKUAPI_ATTR void vkuDestroyUploadRing(VkuUploadRing ring);
+
+VKUAPI_ATTR VkResult vkuCreateUploadRing(const VkuUploadRingCreateInfo *createInfo, VkuUploadRing *ring)
+{
+	assert(createInfo);
+	assert(createInfo->physicalDevice);
+	assert(createInfo->device);
+	assert(createInfo->queue);
+	assert(ring);
+
+
+	(*ring) = (VkuUploadRing) VKU_CALLOC(1, sizeof(struct VkuUploadRing_T));
+
+	if (!(*ring))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*ring)->device = createInfo->device;
+	(*ring)->queue = createInfo->queue;
+	(*ring)->allocator = createInfo->allocator;
+	(*ring)->pAllocator = createInfo->pAllocator;
+
+	(*ring)->allowGrowth = createInfo->allowGrowth;
+
+	(*ring)->dstStageMask = createInfo->dstStageMask;
+	(*ring)->dstAccessMask = createInfo->dstAccessMask;
+
+	(*ring)->maxFlushesInFlight = createInfo->maxFlushesInFlight ? createInfo->maxFlushesInFlight : VKU_DEFAULT_UPLOAD_RING_FLUSH_COUNT;
+
+	vkGetPhysicalDeviceMemoryProperties(createInfo->physicalDevice, &(*ring)->memoryProperties);
+
+
+	VkDeviceSize size = createInfo->size ? createInfo->size : VKU_DEFAULT_UPLOAD_RING_SIZE;
+	size = (size + VKU_UPLOAD_RING_ALIGNMENT - 1) & ~(VKU_UPLOAD_RING_ALIGNMENT - 1);
+
+	VkResult err = vku_createUploadBacking(*ring, size, &(*ring)->backing);
+
+	if (err)
+	{
+		VKU_FREE(*ring);
+		(*ring) = NULL;
+
+		return err;
+	}
+
+	(*ring)->statistics.size = size;
+
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo;
+	memset(&commandPoolCreateInfo, 0, sizeof(commandPoolCreateInfo));
+
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = createInfo->queueFamilyIndex;
+
+	err = vkCreateCommandPool(createInfo->device, &commandPoolCreateInfo, createInfo->pAllocator, &(*ring)->commandPool);
+
+
+	if (!err)
+	{
+		(*ring)->flushes = (vku_upload_flush*) VKU_CALLOC((*ring)->maxFlushesInFlight, sizeof(vku_upload_flush));
+
+		if (!(*ring)->flushes)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+	memset(&commandBufferAllocateInfo, 0, sizeof(commandBufferAllocateInfo));
+
+	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferAllocateInfo.commandPool = (*ring)->commandPool;
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferAllocateInfo.commandBufferCount = 1;
+
+	VkFenceCreateInfo fenceCreateInfo;
+	memset(&fenceCreateInfo, 0, sizeof(fenceCreateInfo));
+
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	for (uint32_t flushIndex = 0; !err && (flushIndex < (*ring)->maxFlushesInFlight); flushIndex++)
+	{
+		err = vkAllocateCommandBuffers(createInfo->device, &commandBufferAllocateInfo, &(*ring)->flushes[flushIndex].commandBuffer);
+
+		if (!err)
+			err = vkCreateFence(createInfo->device, &fenceCreateInfo, createInfo->pAllocator, &(*ring)->flushes[flushIndex].fence);
+	}
+
+
+	if (err)
+	{
+		vkuDestroyUploadRing(*ring);
+		(*ring) = NULL;
+
+		return err;
+	}
+
+	return VK_SUCCESS;
+}
+
+// Waits for the flushes in flight, the pending uploads are discarded
+VKUAPI_ATTR void vkuDestroyUploadRing(VkuUploadRing ring)
+{
+	if (!ring)
+		return;
+
+	while (ring->flushesInFlight > 0)
+	{
+		if (vku_retireUploadFlushes(ring, VK_TRUE))
+			break;
+	}
+
+
+	while (ring->retiredBackings)
+	{
+		vku_upload_backing *backing = ring->retiredBackings;
+		ring->retiredBackings = backing->pNext;
+
+		vku_destroyUploadBacking(ring, backing);
+		VKU_FREE(backing);
+	}
+
+	vku_destroyUploadBacking(ring, &ring->backing);
+
+
+	if (ring->flushes)
+	{
+		for (uint32_t flushIndex = 0; flushIndex < ring->maxFlushesInFlight; flushIndex++)
+		{
+			if (ring->flushes[flushIndex].fence != VK_NULL_HANDLE)
+				vkDestroyFence(ring->device, ring->flushes[flushIndex].fence, ring->pAllocator);
+		}
+	}
+
+	// Destroying the pool frees the command buffers
+	if (ring->commandPool != VK_NULL_HANDLE)
+		vkDestroyCommandPool(ring->device, ring->commandPool, ring->pAllocator);
+
+
+	VKU_FREE(ring->flushes);
+	VKU_FREE(ring->copies);
+	VKU_FREE(ring->regions);
+	VKU_FREE(ring);
+}
+
+
+// Reserves size bytes of the ring to be copied to dstBuffer at dstOffset by the next
+// flush, the caller writes the data to (*ppData) before calling vkuFlushUploadRing().
+// Returns VK_NOT_READY if the pending uploads fill the ring, in which case the caller
+// has to call vkuFlushUploadRing() and try again. Returns VK_ERROR_OUT_OF_DEVICE_MEMORY
+// if size is larger than the ring and it can't grow.
+VKUAPI_ATTR VkResult vkuUploadRingAllocate(VkuUploadRing ring, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size, void **ppData)
+{
+	assert(ring);
+	assert(dstBuffer);
+	assert(size > 0);
+	assert(ppData);
+
+
+	(*ppData) = NULL;
+
+	VkDeviceSize offset;
+	VkResult err = vku_allocateUploadRegion(ring, size, &offset);
+
+	if (err)
+		return err;
+
+	err = vku_addUploadCopy(ring, dstBuffer, offset, dstOffset, size);
+
+	if (err)
+		return err;
+
+
+	(*ppData) = ring->backing.pMappedData + offset;
+
+	return VK_SUCCESS;
+}
+
+// Copies the data into the ring, to be copied to dstBuffer at dstOffset by the next flush.
+// Data larger than the ring is split into multiple uploads, unless the ring can grow.
+VKUAPI_ATTR VkResult vkuUploadRingCopy(VkuUploadRing ring, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *pData, VkDeviceSize size)
+{
+	assert(ring);
+	assert(pData);
+
+
+	const char *data = (const char*) pData;
+
+	while (size > 0)
+	{
+		VkDeviceSize uploadSize = size;
+
+		// Half the ring, such that the next part can be written while the previous one is copied
+		if (!ring->allowGrowth && (uploadSize > ring->backing.size))
+			uploadSize = ring->backing.size / 2;
+
+
+		// The previous parts have already been written, so they can be flushed
+		void *mappedData;
+		VkResult err = vkuUploadRingAllocate(ring, dstBuffer, dstOffset, uploadSize, &mappedData);
+
+		if (err == VK_NOT_READY)
+		{
+			err = vkuFlushUploadRing(ring, VK_NULL_HANDLE);
+
+			if (!err)
+				err = vkuUploadRingAllocate(ring, dstBuffer, dstOffset, uploadSize, &mappedData);
+		}
+
+		if (err)
+			return err;
+
+		memcpy(mappedData, data, (size_t) uploadSize);
+
+
+		data += uploadSize;
+		dstOffset += uploadSize;
+		size -= uploadSize;
+	}
+
+	return VK_SUCCESS;
+}
+
+
+// Waits for all the flushes in flight, it doesn't flush the pending uploads
+VKUAPI_ATTR VkResult vkuWaitUploadRingIdle(VkuUploadRing ring)
+{
+	assert(ring);
+
+	while (ring->flushesInFlight > 0)
+	{
+		const VkResult err = vku_retireUploadFlushes(ring, VK_TRUE);
+
+		if (err)
+			return err;
+	}
+
+	return VK_SUCCESS;
+}
+
+
+VKUAPI_ATTR void vkuGetUploadRingStatistics(VkuUploadRing ring, VkuUploadRingStatistics *statistics)
+{
+	assert(ring);
+	assert(statistics);
+
+	(*statistics) = ring->statistics;
+}
+
+
+// Used for padding data written by different threads, to avoid false sharing
+#define VKU_CACHE_LINE_SIZE 64
+
+
+typedef struct VkuCommandPoolSet_T* VkuCommandPoolSet;
+
+
+typedef struct VkuCommandPoolSetCreateInfo
+{
+	VkDevice device;
+	uint32_t queueFamilyIndex;
+
+	// A VkCommandPool is created for each thread for each frame in flight
+	uint32_t threadCount;
+	uint32_t frameCount;
+
+	// Used for vkCreateCommandPool(). The pools are reset as a whole, so
+	// VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT is never needed.
+	VkCommandPoolCreateFlags flags;
+
+	const VkAllocationCallbacks *pAllocator;
+} VkuCommandPoolSetCreateInfo;
+
+
+typedef struct VkuCommandPoolSetStatistics
+{
+	// The command buffers allocated across all the pools, which are reused rather than freed
+	uint32_t primaryCommandBufferCount;
+	uint32_t secondaryCommandBufferCount;
+
+	uint64_t acquireCount;
+	uint64_t resetCount;
+} VkuCommandPoolSetStatistics;
+
+
+typedef struct vku_thread_command_pool
+{
+	VkCommandPool commandPool;
+
+	// The primary [0] and secondary [1] command buffers,
+	// of which the first usedCounts are in use this frame
+	uint32_t usedCounts[2];
+	uint32_t commandBufferCounts[2];
+	VkCommandBuffer *commandBuffers[2];
+
+	uint64_t acquireCount;
+
+	// Each pool is only written by its own thread
+	char padding[VKU_CACHE_LINE_SIZE];
+} vku_thread_command_pool;
+
+
+struct VkuCommandPoolSet_T
+{
+	VkDevice device;
+	const VkAllocationCallbacks *pAllocator;
+
+	uint32_t threadCount;
+	uint32_t frameCount;
+
+	uint32_t frameIndex;
+
+	// frameCount * threadCount pools, where the pools of each frame are next to each other
+	vku_thread_command_pool *pools;
+
+	uint64_t resetCount;
+};
+
+
+VKUAPI_ATTR void vkuDestroyCommandPoolSet(VkuCommandPoolSet commandPoolSet);
+
+VKUAPI_ATTR VkResult vkuCreateCommandPoolSet(const VkuCommandPoolSetCreateInfo *createInfo, VkuCommandPoolSet *commandPoolSet)
+{
+	assert(createInfo);
+	assert(createInfo->device);
+	assert(createInfo->threadCount > 0);
+	assert(createInfo->frameCount > 0);
+	assert(commandPoolSet);
+
+
+	(*commandPoolSet) = (VkuCommandPoolSet) VKU_CALLOC(1, sizeof(struct VkuCommandPoolSet_T));
+
+	if (!(*commandPoolSet))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*commandPoolSet)->device = createInfo->device;
+	(*commandPoolSet)->pAllocator = createInfo->pAllocator;
+	(*commandPoolSet)->threadCount = createInfo->threadCount;
+	(*commandPoolSet)->frameCount = createInfo->frameCount;
+
+	const uint32_t poolCount = createInfo->threadCount * createInfo->frameCount;
+
+	(*commandPoolSet)->pools = (vku_thread_command_pool*) VKU_CALLOC(poolCount, sizeof(vku_thread_command_pool));
+
+	if (!(*commandPoolSet)->pools)
+	{
+		VKU_FREE(*commandPoolSet);
+		(*commandPoolSet) = NULL;
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo;
+	memset(&commandPoolCreateInfo, 0, sizeof(commandPoolCreateInfo));
+
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = createInfo->flags;
+	commandPoolCreateInfo.queueFamilyIndex = createInfo->queueFamilyIndex;
+
+	for (uint32_t poolIndex = 0; poolIndex < poolCount; poolIndex++)
+	{
+		VkResult err = vkCreateCommandPool(createInfo->device, &commandPoolCreateInfo, createInfo->pAllocator, &(*commandPoolSet)->pools[poolIndex].commandPool);
+
+		if (err)
+		{
+			vkuDestroyCommandPoolSet(*commandPoolSet);
+			(*commandPoolSet) = NULL;
+
+			return err;
+		}
+	}
+
+
+	return VK_SUCCESS;
+}
+
+// None of the command buffers may be pending execution
+VKUAPI_ATTR void vkuDestroyCommandPoolSet(VkuCommandPoolSet commandPoolSet)
+{
+	if (!commandPoolSet)
+		return;
+
+	const uint32_t poolCount = commandPoolSet->threadCount * commandPoolSet->frameCount;
+
+	for (uint32_t poolIndex = 0; poolIndex < poolCount; poolIndex++)
+	{
+		vku_thread_command_pool *pool = &commandPoolSet->pools[poolIndex];
+
+		// Destroying the pool frees the command buffers
+		if (pool->commandPool != VK_NULL_HANDLE)
+			vkDestroyCommandPool(commandPoolSet->device, pool->commandPool, commandPoolSet->pAllocator);
+
+		VKU_FREE(pool->commandBuffers[0]);
+		VKU_FREE(pool->commandBuffers[1]);
+	}
+
+	VKU_FREE(commandPoolSet->pools);
+	VKU_FREE(commandPoolSet);
+}
+
+
+// Makes frameIndex the current frame, and resets its command pools. If fence isn't
+// VK_NULL_HANDLE, then it first waits for it, which should be the fence of the
+// submission that last used the frame's command buffers.
+// Must not be called while any thread is acquiring command buffers.
+VKUAPI_ATTR VkResult vkuBeginCommandPoolSetFrame(VkuCommandPoolSet commandPoolSet, uint32_t frameIndex, VkFence fence)
+{
+	assert(commandPoolSet);
+	assert(frameIndex < commandPoolSet->frameCount);
+
+
+	VkResult err;
+
+	if (fence != VK_NULL_HANDLE)
+	{
+		err = vkWaitForFences(commandPoolSet->device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+		if (err)
+			return err;
+	}
+
+
+	vku_thread_command_pool *pools = commandPoolSet->pools + frameIndex * commandPoolSet->threadCount;
+
+	for (uint32_t threadIndex = 0; threadIndex < commandPoolSet->threadCount; threadIndex++)
+	{
+		vku_thread_command_pool *pool = &pools[threadIndex];
+
+		// Unused pools have nothing to reset
+		if ((pool->usedCounts[0] == 0) && (pool->usedCounts[1] == 0))
+			continue;
+
+		err = vkResetCommandPool(commandPoolSet->device, pool->commandPool, 0);
+
+		if (err)
+			return err;
+
+		pool->usedCounts[0] = 0;
+		pool->usedCounts[1] = 0;
+
+		commandPoolSet->resetCount++;
+	}
+
+	commandPoolSet->frameIndex = frameIndex;
+
+	return VK_SUCCESS;
+}
+
+
+// Gets a command buffer from the thread's pool for the current frame, which is only
+// valid until the frame is begun again. Each thread must use its own threadIndex,
+// in which case no synchronization is needed between the threads.
+VKUAPI_ATTR VkResult vkuAcquireCommandBuffer(VkuCommandPoolSet commandPoolSet, uint32_t threadIndex, VkCommandBufferLevel level, VkCommandBuffer *commandBuffer)
+{
+	assert(commandPoolSet);
+	assert(threadIndex < commandPoolSet->threadCount);
+	assert((level == VK_COMMAND_BUFFER_LEVEL_PRIMARY) || (level == VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+	assert(commandBuffer);
+
+
+	vku_thread_command_pool *pool = &commandPoolSet->pools[commandPoolSet->frameIndex * commandPoolSet->threadCount + threadIndex];
+
+	const uint32_t levelIndex = (level == VK_COMMAND_BUFFER_LEVEL_PRIMARY) ? 0 : 1;
+
+
+	if (pool->usedCounts[levelIndex] == pool->commandBufferCounts[levelIndex])
+	{
+		// Allocate in batches, doubling the amount each time
+		const uint32_t allocateCount = pool->commandBufferCounts[levelIndex] ? pool->commandBufferCounts[levelIndex] : 4;
+		const uint32_t commandBufferCount = pool->commandBufferCounts[levelIndex] + allocateCount;
+
+		VkCommandBuffer *commandBuffers = (VkCommandBuffer*) VKU_REALLOC(pool->commandBuffers[levelIndex], commandBufferCount * sizeof(VkCommandBuffer));
+
+		if (!commandBuffers)
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+		pool->commandBuffers[levelIndex] = commandBuffers;
+
+
+		VkCommandBufferAllocateInfo allocateInfo;
+		memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = pool->commandPool;
+		allocateInfo.level = level;
+		allocateInfo.commandBufferCount = allocateCount;
+
+		VkResult err = vkAllocateCommandBuffers(commandPoolSet->device, &allocateInfo, commandBuffers + pool->commandBufferCounts[levelIndex]);
+
+		if (err)
+			return err;
+
+		pool->commandBufferCounts[levelIndex] = commandBufferCount;
+	}
+
+
+	(*commandBuffer) = pool->commandBuffers[levelIndex][pool->usedCounts[levelIndex]++];
+
+	pool->acquireCount++;
+
+	return VK_SUCCESS;
+}
+
+
+// Must not be called while any thread is acquiring command buffers
+VKUAPI_ATTR void vkuGetCommandPoolSetStatistics(VkuCommandPoolSet commandPoolSet, VkuCommandPoolSetStatistics *statistics)
+{
+	assert(commandPoolSet);
+	assert(statistics);
+
+
+	memset(statistics, 0, sizeof(VkuCommandPoolSetStatistics));
+
+	const uint32_t poolCount = commandPoolSet->threadCount * commandPoolSet->frameCount;
+
+	for (uint32_t poolIndex = 0; poolIndex < poolCount; poolIndex++)
+	{
+		const vku_thread_command_pool *pool = &commandPoolSet->pools[poolIndex];
+
+		statistics->primaryCommandBufferCount += pool->commandBufferCounts[0];
+		statistics->secondaryCommandBufferCount += pool->commandBufferCounts[1];
+		statistics->acquireCount += pool->acquireCount;
+	}
+
+	statistics->resetCount = commandPoolSet->resetCount;
+}
+
+
+typedef struct vku_mapped_file
+{
+	const void *data;
+	size_t size;
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+} vku_mapped_file;
+
+
+// Maps the whole file read-only, returns VK_FALSE if it doesn't exist, is empty or couldn't be mapped
+static VkBool32 vku_mapFile(const char *path, vku_mapped_file *mappedFile)
+{
+	memset(mappedFile, 0, sizeof(vku_mapped_file));
+
+#ifdef _WIN32
+	mappedFile->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (mappedFile->file == INVALID_HANDLE_VALUE)
+		return VK_FALSE;
+
+	LARGE_INTEGER fileSize;
+
+	if (GetFileSizeEx(mappedFile->file, &fileSize) && (fileSize.QuadPart > 0))
+	{
+		mappedFile->mapping = CreateFileMappingA(mappedFile->file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (mappedFile->mapping)
+		{
+			mappedFile->data = MapViewOfFile(mappedFile->mapping, FILE_MAP_READ, 0, 0, 0);
+			mappedFile->size = (size_t) fileSize.QuadPart;
+
+			if (mappedFile->data)
+				return VK_TRUE;
+
+			CloseHandle(mappedFile->mapping);
+		}
+	}
+
+	CloseHandle(mappedFile->file);
+#else
+	const int file = open(path, O_RDONLY);
+
+	if (file < 0)
+		return VK_FALSE;
+
+	struct stat fileStat;
+
+	if ((fstat(file, &fileStat) == 0) && (fileStat.st_size > 0))
+	{
+		void *data = mmap(NULL, (size_t) fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (data != MAP_FAILED)
+		{
+			mappedFile->data = data;
+			mappedFile->size = (size_t) fileStat.st_size;
+		}
+	}
+
+	// The mapping stays valid after closing the file
+	close(file);
+
+	if (mappedFile->data)
+		return VK_TRUE;
+#endif
+
+	memset(mappedFile, 0, sizeof(vku_mapped_file));
+
+	return VK_FALSE;
+}
+
+static void vku_unmapFile(vku_mapped_file *mappedFile)
+{
+	if (!mappedFile->data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mappedFile->data);
+	CloseHandle(mappedFile->mapping);
+	CloseHandle(mappedFile->file);
+#else
+	munmap((void*) mappedFile->data, mappedFile->size);
+#endif
+
+	memset(mappedFile, 0, sizeof(vku_mapped_file));
+}
+
+
+// Writes the data to a temporary file next to the path, and then renames it to the path, such
+// that the file is either the old or the new one, and never partially written. The temporary
+// file is created exclusively with a unique name, so concurrent saves don't clobber each other.
+static VkBool32 vku_writeFileAtomic(const char *path, const void *data, size_t size)
+{
+	// Room for ".<process id>.<unique>.tmp"
+	const size_t tempPathSize = strlen(path) + 48;
+
+	char *tempPath = (char*) VKU_MALLOC(tempPathSize);
+
+	if (!tempPath)
+		return VK_FALSE;
+
+
+#ifdef _WIN32
+	const unsigned long processId = (unsigned long) GetCurrentProcessId();
+#else
+	const unsigned long processId = (unsigned long) getpid();
+#endif
+
+	// Threads have their own stack, so mixing in the address of a local
+	// keeps the names of concurrent saves within the process apart
+	const int local = 0;
+	const uint64_t unique = vku_getTime() ^ ((uint64_t) (uintptr_t) &local);
+
+	const char *bytes = (const char*) data;
+	size_t remaining = size;
+
+	VkBool32 created = VK_FALSE;
+	VkBool32 written = VK_FALSE;
+
+	for (uint32_t attempt = 0; !created && (attempt < 16); attempt++)
+	{
+		snprintf(tempPath, tempPathSize, "%s.%lu.%llx.tmp", path, processId, (unsigned long long) (unique + attempt));
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(tempPath, GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		if (file == INVALID_HANDLE_VALUE)
+			continue;
+
+		created = VK_TRUE;
+		written = VK_TRUE;
+
+		while (written && (remaining > 0))
+		{
+			const DWORD chunkSize = (remaining > 0x40000000) ? 0x40000000 : (DWORD) remaining;
+			DWORD chunkWritten = 0;
+
+			written = (WriteFile(file, bytes, chunkSize, &chunkWritten, NULL) && (chunkWritten == chunkSize)) ? VK_TRUE : VK_FALSE;
+
+			bytes += chunkWritten;
+			remaining -= chunkWritten;
+		}
+
+		if (written)
+			written = FlushFileBuffers(file) ? VK_TRUE : VK_FALSE;
+
+		if (!CloseHandle(file))
+			written = VK_FALSE;
+#else
+		const int file = open(tempPath, O_WRONLY | O_CREAT | O_EXCL, 0666);
+
+		if (file < 0)
+			continue;
+
+		created = VK_TRUE;
+		written = VK_TRUE;
+
+		while (written && (remaining > 0))
+		{
+			const ssize_t chunkWritten = write(file, bytes, remaining);
+
+			written = (chunkWritten > 0);
+
+			if (written)
+			{
+				bytes += chunkWritten;
+				remaining -= (size_t) chunkWritten;
+			}
+		}
+
+		// Make sure the data is on disk before the rename is
+		if (written)
+			written = (fsync(file) == 0);
+
+		if (close(file) != 0)
+			written = VK_FALSE;
+#endif
+	}
+
+
+	if (written)
+	{
+#ifdef _WIN32
+		written = MoveFileExA(tempPath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? VK_TRUE : VK_FALSE;
+#else
+		written = (rename(tempPath, path) == 0);
+#endif
+	}
+
+	if (created && !written)
+		remove(tempPath);
+
+	VKU_FREE(tempPath);
+
+	return written;
+}
+
+
+
+typedef struct VkuPipelineCacheStatistics
+{
+	// VK_TRUE if the file existed and matched the physical device
+	VkBool32 loaded;
+	size_t loadedSize;
+
+	// Nanoseconds spent mapping, validating and creating the VkPipelineCache
+	uint64_t loadTime;
+
+	size_t savedSize;
+
+	// Nanoseconds spent getting the data and writing it
+	uint64_t saveTime;
+
+	// Counted by vkuRecordPipelineCreationFeedback(), where hitCount
+	// is the pipelines which were found in the pipeline cache
+	uint32_t pipelineCount;
+	uint32_t hitCount;
+	uint64_t pipelineCreationTime;
+} VkuPipelineCacheStatistics;
+
+
+static uint32_t vku_readUint32LE(const uint8_t *bytes)
+{
+	return ((uint32_t) bytes[0]) | (((uint32_t) bytes[1]) << 8) | (((uint32_t) bytes[2]) << 16) | (((uint32_t) bytes[3]) << 24);
+}
+
+
+// Checks the header of the VkPipelineCache data against the physical device's vendorID,
+// deviceID and pipelineCacheUUID. Data from another driver or device is either ignored
+// by vkCreatePipelineCache(), or at worst makes it fail.
+VKUAPI_ATTR VkBool32 vkuIsPipelineCacheDataCompatible(VkPhysicalDevice physicalDevice, size_t dataSize, const void *pData)
+{
+	assert(physicalDevice);
+
+
+	// The header is written as bytes, with the least significant byte first
+	const size_t headerSize = 16 + VK_UUID_SIZE;
+
+	if (!pData || (dataSize < headerSize))
+		return VK_FALSE;
+
+	const uint8_t *header = (const uint8_t*) pData;
+
+	if ((vku_readUint32LE(header) < headerSize) || (vku_readUint32LE(header) > dataSize))
+		return VK_FALSE;
+
+	if (vku_readUint32LE(header + 4) != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+		return VK_FALSE;
+
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	if (vku_readUint32LE(header + 8) != properties.vendorID)
+		return VK_FALSE;
+
+	if (vku_readUint32LE(header + 12) != properties.deviceID)
+		return VK_FALSE;
+
+	if (memcmp(header + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		return VK_FALSE;
+
+	return VK_TRUE;
+}
+
+
+// Creates a VkPipelineCache from the file at path, which is memory mapped. If the file doesn't
+// exist or doesn't match the physical device, then an empty VkPipelineCache is created.
+// The statistics are optional.
+VKUAPI_ATTR VkResult vkuLoadPipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const char *path,
+	const VkAllocationCallbacks *pAllocator, VkPipelineCache *pipelineCache, VkuPipelineCacheStatistics *statistics)
+{
+	assert(physicalDevice);
+	assert(device);
+	assert(path);
+	assert(pipelineCache);
+
+
+	const uint64_t loadStart = vku_getTime();
+
+
+	VkPipelineCacheCreateInfo createInfo;
+	memset(&createInfo, 0, sizeof(createInfo));
+
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	vku_mapped_file mappedFile;
+
+	if (vku_mapFile(path, &mappedFile))
+	{
+		if (vkuIsPipelineCacheDataCompatible(physicalDevice, mappedFile.size, mappedFile.data))
+		{
+			createInfo.initialDataSize = mappedFile.size;
+			createInfo.pInitialData = mappedFile.data;
+		}
+	}
+
+
+	VkResult err = vkCreatePipelineCache(device, &createInfo, pAllocator, pipelineCache);
+
+	// The data could still be corrupt, in which case start over with an empty cache
+	if (err && createInfo.pInitialData)
+	{
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = NULL;
+
+		err = vkCreatePipelineCache(device, &createInfo, pAllocator, pipelineCache);
+	}
+
+	vku_unmapFile(&mappedFile);
+
+
+	if (statistics)
+	{
+		statistics->loaded = (!err && createInfo.pInitialData) ? VK_TRUE : VK_FALSE;
+		statistics->loadedSize = statistics->loaded ? createInfo.initialDataSize : 0;
+		statistics->loadTime = vku_getTime() - loadStart;
+	}
+
+	return err;
+}
+
+
+// Saves the VkPipelineCache to the file at path, by writing a temporary file and renaming it.
+// Returns VK_ERROR_INITIALIZATION_FAILED if the file couldn't be written. The statistics are optional.
+VKUAPI_ATTR VkResult vkuSavePipelineCache(VkDevice device, VkPipelineCache pipelineCache, const char *path, VkuPipelineCacheStatistics *statistics)
+{
+	assert(device);
+	assert(pipelineCache);
+	assert(path);
+
+
+	const uint64_t saveStart = vku_getTime();
+
+
+	size_t dataSize = 0;
+	void *data = NULL;
+
+	VkResult err;
+
+	// Other threads can add to the cache in between the calls
+	do
+	{
+		err = vkGetPipelineCacheData(device, pipelineCache, &dataSize, NULL);
+
+		if (err)
+			break;
+
+		void *newData = VKU_REALLOC(data, dataSize);
+
+		if (!newData && (dataSize > 0))
+		{
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+			break;
+		}
+
+		data = newData;
+
+		err = vkGetPipelineCacheData(device, pipelineCache, &dataSize, data);
+	}
+	while (err == VK_INCOMPLETE);
+
+
+	if (!err && !vku_writeFileAtomic(path, data, dataSize))
+		err = VK_ERROR_INITIALIZATION_FAILED;
+
+	VKU_FREE(data);
+
+
+	if (statistics)
+	{
+		statistics->savedSize = err ? 0 : dataSize;
+		statistics->saveTime = vku_getTime() - saveStart;
+	}
+
+	return err;
+}
+
+
+#ifdef VK_EXT_pipeline_creation_feedback
+
+// Counts a pipeline created with a VkPipelineCreationFeedbackCreateInfoEXT,
+// where feedback is its pPipelineCreationFeedback.
+VKUAPI_ATTR void vkuRecordPipelineCreationFeedback(VkuPipelineCacheStatistics *statistics, const VkPipelineCreationFeedbackEXT *feedback)
+{
+	assert(statistics);
+	assert(feedback);
+
+
+	if (!(feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT))
+		return;
+
+	statistics->pipelineCount++;
+	statistics->pipelineCreationTime += feedback->duration;
+
+	if (feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT)
+		statistics->hitCount++;
+}
+
+#endif
+
+
+// A snapshot of everything vku queries about a physical device: its properties, memory properties, queue
+// families, layers and extensions (including the extensions provided by each layer), and the properties of
+// the formats asked for. It's stored next to the pipeline cache, and keyed by the vendorID, deviceID,
+// apiVersion, driverVersion and pipelineCacheUUID, so it's invalidated by a driver update.
+
+#define VKU_DEVICE_PROFILE_MAGIC 0x50554B56u // "VKUP"
+#define VKU_DEVICE_PROFILE_VERSION 1
+
+// The file is the header followed by, each aligned to 8 bytes:
+//  - VkPhysicalDeviceProperties
+//  - VkPhysicalDeviceMemoryProperties
+//  - VkQueueFamilyProperties[queueFamilyCount]
+//  - vku_profile_format[formatCount]
+//  - uint32_t[layerCount + 1], the extension count of the implementation and of each layer
+//  - nameDataSize bytes of packed names, the layers and then the extensions of the implementation and each layer
+// The file is only read by the same build on the same machine, so everything is written as is.
+typedef struct vku_device_profile_header
+{
+	uint32_t magic;
+	uint32_t version;
+
+	// Guards against the structs changing, e.g. with newer Vulkan headers
+	uint32_t headerSize;
+	uint32_t propertiesSize;
+	uint32_t memoryPropertiesSize;
+
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t apiVersion;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+
+	uint32_t queueFamilyCount;
+	uint32_t formatCount;
+	uint32_t layerCount;
+	uint32_t nameDataSize;
+
+	uint64_t size;
+} vku_device_profile_header;
+
+
+typedef struct vku_profile_format
+{
+	VkFormat format;
+	VkFormatProperties properties;
+} vku_profile_format;
+
+
+// Pointers into the profile data
+typedef struct vku_device_profile_layout
+{
+	const vku_device_profile_header *header;
+
+	const VkPhysicalDeviceProperties *properties;
+	const VkPhysicalDeviceMemoryProperties *memoryProperties;
+	const VkQueueFamilyProperties *queueFamilyProperties;
+	const vku_profile_format *formats;
+	const uint32_t *extensionCounts;
+	const char *names;
+} vku_device_profile_layout;
+
+
+typedef struct VkuDeviceProfileStatistics
+{
+	// VK_TRUE if the file existed and matched the physical device, otherwise the profile was
+	// created by enumerating, and saved is VK_TRUE if it was written to the file
+	VkBool32 loaded;
+	VkBool32 saved;
+
+	size_t size;
+
+	// Nanoseconds spent mapping and validating, or enumerating and saving, and creating the registry
+	uint64_t loadTime;
+} VkuDeviceProfileStatistics;
+
+
+typedef struct VkuDeviceProfile_T* VkuDeviceProfile;
+
+struct VkuDeviceProfile_T
+{
+	// The data is either the mapped file or allocated
+	vku_mapped_file mappedFile;
+	void *data;
+
+	vku_device_profile_layout layout;
+
+	VkuCapabilityRegistry registry;
+};
+
+
+static size_t vku_alignProfileOffset(size_t offset)
+{
+	return (offset + 7) & ~((size_t) 7);
+}
+
+// Validates the profile data against the physical device's properties and the formats asked for,
+// and sets the layout. Returns VK_FALSE if it's stale, incomplete or corrupt.
+static VkBool32 vku_getDeviceProfileLayout(const void *data, size_t size, const VkPhysicalDeviceProperties *properties,
+	uint32_t formatCount, const VkFormat *pFormats, vku_device_profile_layout *layout)
+{
+	const vku_device_profile_header *header = (const vku_device_profile_header*) data;
+
+	if (size < sizeof(vku_device_profile_header))
+		return VK_FALSE;
+
+	if ((header->magic != VKU_DEVICE_PROFILE_MAGIC) || (header->version != VKU_DEVICE_PROFILE_VERSION))
+		return VK_FALSE;
+
+	if ((header->headerSize != sizeof(vku_device_profile_header)) || (header->propertiesSize != sizeof(VkPhysicalDeviceProperties)) ||
+		(header->memoryPropertiesSize != sizeof(VkPhysicalDeviceMemoryProperties)) || (header->size != size))
+		return VK_FALSE;
+
+
+	// The driver or device changed
+	if ((header->vendorID != properties->vendorID) || (header->deviceID != properties->deviceID) ||
+		(header->apiVersion != properties->apiVersion) || (header->driverVersion != properties->driverVersion) ||
+		memcmp(header->pipelineCacheUUID, properties->pipelineCacheUUID, VK_UUID_SIZE))
+		return VK_FALSE;
+
+
+	// The counts are bounded by the size of the file, before computing the offsets
+	if ((header->queueFamilyCount > size) || (header->formatCount > size) || (header->layerCount > size) || (header->nameDataSize > size))
+		return VK_FALSE;
+
+	const uint8_t *bytes = (const uint8_t*) data;
+	size_t offset = vku_alignProfileOffset(sizeof(vku_device_profile_header));
+
+	layout->header = header;
+
+	layout->properties = (const VkPhysicalDeviceProperties*) (bytes + offset);
+	offset = vku_alignProfileOffset(offset + sizeof(VkPhysicalDeviceProperties));
+
+	layout->memoryProperties = (const VkPhysicalDeviceMemoryProperties*) (bytes + offset);
+	offset = vku_alignProfileOffset(offset + sizeof(VkPhysicalDeviceMemoryProperties));
+
+	layout->queueFamilyProperties = (const VkQueueFamilyProperties*) (bytes + offset);
+	offset = vku_alignProfileOffset(offset + header->queueFamilyCount * sizeof(VkQueueFamilyProperties));
+
+	layout->formats = (const vku_profile_format*) (bytes + offset);
+	offset = vku_alignProfileOffset(offset + header->formatCount * sizeof(vku_profile_format));
+
+	layout->extensionCounts = (const uint32_t*) (bytes + offset);
+	offset = vku_alignProfileOffset(offset + (header->layerCount + 1) * sizeof(uint32_t));
+
+	layout->names = (const char*) (bytes + offset);
+
+	if (offset + header->nameDataSize != size)
+		return VK_FALSE;
+
+
+	// Every name must be null terminated within the name data
+	size_t nameCount = header->layerCount;
+
+	for (uint32_t tableIndex = 0; tableIndex <= header->layerCount; tableIndex++)
+		nameCount += layout->extensionCounts[tableIndex];
+
+	size_t terminatorCount = 0;
+
+	for (uint32_t nameDataIndex = 0; nameDataIndex < header->nameDataSize; nameDataIndex++)
+		if (layout->names[nameDataIndex] == '\0')
+			terminatorCount++;
+
+	if ((terminatorCount != nameCount) || (header->nameDataSize && (layout->names[header->nameDataSize - 1] != '\0')))
+		return VK_FALSE;
+
+
+	// A profile missing one of the formats asked for is recreated
+	for (uint32_t formatIndex = 0; formatIndex < formatCount; formatIndex++)
+	{
+		uint32_t profileFormatIndex = 0;
+
+		while ((profileFormatIndex < header->formatCount) && (layout->formats[profileFormatIndex].format != pFormats[formatIndex]))
+			profileFormatIndex++;
+
+		if (profileFormatIndex >= header->formatCount)
+			return VK_FALSE;
+	}
+
+
+	return VK_TRUE;
+}
+
+
+// Enumerates everything about the physical device and writes it as profile data
+static VkResult vku_createDeviceProfileData(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceProperties *properties,
+	uint32_t formatCount, const VkFormat *pFormats, void **data, size_t *size)
+{
+	(*data) = NULL;
+	(*size) = 0;
+
+
+	uint32_t layerCount = 0;
+	VkLayerProperties *layers = NULL;
+
+	VkResult err = vku_enumerateLayerProperties(physicalDevice, &layerCount, &layers);
+
+	if (err)
+		return err;
+
+
+	// The extensions of the implementation, followed by the extensions of each layer
+	uint32_t *extensionCounts = (uint32_t*) VKU_CALLOC(layerCount + 1, sizeof(uint32_t));
+	VkExtensionProperties **extensions = (VkExtensionProperties**) VKU_CALLOC(layerCount + 1, sizeof(VkExtensionProperties*));
+
+	if (!extensionCounts || !extensions)
+		err = VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	for (uint32_t tableIndex = 0; !err && (tableIndex <= layerCount); tableIndex++)
+		err = vku_enumerateExtensionProperties(physicalDevice, (tableIndex > 0) ? layers[tableIndex - 1].layerName : NULL, &extensionCounts[tableIndex], &extensions[tableIndex]);
+
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, NULL);
+
+
+	size_t nameDataSize = 0;
+
+	for (uint32_t layerIndex = 0; !err && (layerIndex < layerCount); layerIndex++)
+		nameDataSize += strlen(layers[layerIndex].layerName) + 1;
+
+	for (uint32_t tableIndex = 0; !err && (tableIndex <= layerCount); tableIndex++)
+		for (uint32_t extensionIndex = 0; extensionIndex < extensionCounts[tableIndex]; extensionIndex++)
+			nameDataSize += strlen(extensions[tableIndex][extensionIndex].extensionName) + 1;
+
+
+	size_t offset = vku_alignProfileOffset(sizeof(vku_device_profile_header));
+
+	const size_t propertiesOffset = offset;
+	offset = vku_alignProfileOffset(offset + sizeof(VkPhysicalDeviceProperties));
+
+	const size_t memoryPropertiesOffset = offset;
+	offset = vku_alignProfileOffset(offset + sizeof(VkPhysicalDeviceMemoryProperties));
+
+	const size_t queueFamiliesOffset = offset;
+	offset = vku_alignProfileOffset(offset + queueFamilyCount * sizeof(VkQueueFamilyProperties));
+
+	const size_t formatsOffset = offset;
+	offset = vku_alignProfileOffset(offset + formatCount * sizeof(vku_profile_format));
+
+	const size_t extensionCountsOffset = offset;
+	offset = vku_alignProfileOffset(offset + (layerCount + 1) * sizeof(uint32_t));
+
+	const size_t namesOffset = offset;
+	const size_t dataSize = offset + nameDataSize;
+
+
+	uint8_t *bytes = NULL;
+
+	if (!err)
+	{
+		bytes = (uint8_t*) VKU_CALLOC(1, dataSize);
+
+		if (!bytes)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	if (!err)
+	{
+		vku_device_profile_header *header = (vku_device_profile_header*) bytes;
+
+		header->magic = VKU_DEVICE_PROFILE_MAGIC;
+		header->version = VKU_DEVICE_PROFILE_VERSION;
+		header->headerSize = sizeof(vku_device_profile_header);
+		header->propertiesSize = sizeof(VkPhysicalDeviceProperties);
+		header->memoryPropertiesSize = sizeof(VkPhysicalDeviceMemoryProperties);
+
+		header->vendorID = properties->vendorID;
+		header->deviceID = properties->deviceID;
+		header->apiVersion = properties->apiVersion;
+		header->driverVersion = properties->driverVersion;
+		memcpy(header->pipelineCacheUUID, properties->pipelineCacheUUID, VK_UUID_SIZE);
+
+		header->queueFamilyCount = queueFamilyCount;
+		header->formatCount = formatCount;
+		header->layerCount = layerCount;
+		header->nameDataSize = (uint32_t) nameDataSize;
+		header->size = dataSize;
+
+
+		memcpy(bytes + propertiesOffset, properties, sizeof(VkPhysicalDeviceProperties));
+
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, (VkPhysicalDeviceMemoryProperties*) (bytes + memoryPropertiesOffset));
+
+		uint32_t queriedQueueFamilyCount = queueFamilyCount;
+
+		if (queueFamilyCount > 0)
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queriedQueueFamilyCount, (VkQueueFamilyProperties*) (bytes + queueFamiliesOffset));
+
+		vku_profile_format *formats = (vku_profile_format*) (bytes + formatsOffset);
+
+		for (uint32_t formatIndex = 0; formatIndex < formatCount; formatIndex++)
+		{
+			formats[formatIndex].format = pFormats[formatIndex];
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, pFormats[formatIndex], &formats[formatIndex].properties);
+		}
+
+		memcpy(bytes + extensionCountsOffset, extensionCounts, (layerCount + 1) * sizeof(uint32_t));
+
+
+		char *names = (char*) (bytes + namesOffset);
+
+		for (uint32_t layerIndex = 0; layerIndex < layerCount; layerIndex++)
+		{
+			const size_t nameSize = strlen(layers[layerIndex].layerName) + 1;
+
+			memcpy(names, layers[layerIndex].layerName, nameSize);
+			names += nameSize;
+		}
+
+		for (uint32_t tableIndex = 0; tableIndex <= layerCount; tableIndex++)
+		{
+			for (uint32_t extensionIndex = 0; extensionIndex < extensionCounts[tableIndex]; extensionIndex++)
+			{
+				const size_t nameSize = strlen(extensions[tableIndex][extensionIndex].extensionName) + 1;
+
+				memcpy(names, extensions[tableIndex][extensionIndex].extensionName, nameSize);
+				names += nameSize;
+			}
+		}
+
+
+		(*data) = bytes;
+		(*size) = dataSize;
+	}
+
+
+	for (uint32_t tableIndex = 0; extensions && (tableIndex <= layerCount); tableIndex++)
+		VKU_FREE(extensions[tableIndex]);
+
+	VKU_FREE(extensions);
+	VKU_FREE(extensionCounts);
+	VKU_FREE(layers);
+
+	return err;
+}
+
+
+// Creates the registry from the profile's names, instead of enumerating
+static VkResult vku_createDeviceProfileRegistry(VkPhysicalDevice physicalDevice, const vku_device_profile_layout *layout, VkuCapabilityRegistry *registry)
+{
+	(*registry) = (VkuCapabilityRegistry) VKU_CALLOC(1, sizeof(struct VkuCapabilityRegistry_T));
+
+	if (!(*registry))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	(*registry)->physicalDevice = physicalDevice;
+
+
+	const uint32_t layerCount = layout->header->layerCount;
+	const char *names = layout->names;
+
+	VkResult err = vku_createNameTable(layerCount, names, 0, &(*registry)->layers);
+
+	for (uint32_t layerIndex = 0; layerIndex < layerCount; layerIndex++)
+		names = vku_getNextName(names, 0);
+
+
+	if (!err)
+	{
+		(*registry)->extensions = (vku_name_table*) VKU_CALLOC(layerCount + 1, sizeof(vku_name_table));
+
+		if (!(*registry)->extensions)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	// The profile's extension tables are in enumeration order, while the
+	// registry's extension tables are in the sorted order of the layers
+	const char *tableNames = names;
+
+	for (uint32_t tableIndex = 0; !err && (tableIndex <= layerCount); tableIndex++)
+	{
+		uint32_t registryIndex = 0;
+
+		if (tableIndex > 0)
+		{
+			const char *pLayerName = layout->names;
+
+			for (uint32_t layerIndex = 1; layerIndex < tableIndex; layerIndex++)
+				pLayerName = vku_getNextName(pLayerName, 0);
+
+			registryIndex = vku_findName(&(*registry)->layers, pLayerName, vkuHashName(pLayerName)) + 1;
+		}
+
+		err = vku_createNameTable(layout->extensionCounts[tableIndex], tableNames, 0, &(*registry)->extensions[registryIndex]);
+
+		for (uint32_t extensionIndex = 0; extensionIndex < layout->extensionCounts[tableIndex]; extensionIndex++)
+			tableNames = vku_getNextName(tableNames, 0);
+	}
+
+
+	if (err)
+	{
+		vkuDestroyCapabilityRegistry(*registry);
+
+		(*registry) = NULL;
+
+		return err;
+	}
+
+
+	(*registry)->pProperties = layout->properties;
+	(*registry)->pMemoryProperties = layout->memoryProperties;
+	(*registry)->queueFamilyCount = layout->header->queueFamilyCount;
+	(*registry)->pQueueFamilyProperties = layout->queueFamilyProperties;
+
+	return VK_SUCCESS;
+}
+
+
+VKUAPI_ATTR void vkuDestroyDeviceProfile(VkuDeviceProfile profile);
+
+// Memory maps the profile at path, if it matches the physical device (only using vkGetPhysicalDeviceProperties()),
+// then nothing is enumerated. Otherwise the profile is created by enumerating and saved to path, a failure to
+// save isn't an error. The path is optional, e.g. next to the pipeline cache. The statistics are optional.
+VKUAPI_ATTR VkResult vkuLoadDeviceProfile(VkPhysicalDevice physicalDevice, const char *path, uint32_t formatCount, const VkFormat *pFormats,
+	VkuDeviceProfile *profile, VkuDeviceProfileStatistics *statistics)
+{
+	assert(physicalDevice);
+	assert(!formatCount || pFormats);
+	assert(profile);
+
+
+	const uint64_t loadStart = vku_getTime();
+
+
+	(*profile) = (VkuDeviceProfile) VKU_CALLOC(1, sizeof(struct VkuDeviceProfile_T));
+
+	if (!(*profile))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	VkBool32 loaded = VK_FALSE;
+	VkBool32 saved = VK_FALSE;
+
+	size_t size = 0;
+
+	if (path && vku_mapFile(path, &(*profile)->mappedFile))
+	{
+		loaded = vku_getDeviceProfileLayout((*profile)->mappedFile.data, (*profile)->mappedFile.size, &properties, formatCount, pFormats, &(*profile)->layout);
+
+		if (loaded)
+			size = (*profile)->mappedFile.size;
+		else
+			vku_unmapFile(&(*profile)->mappedFile);
+	}
+
+
+	VkResult err = VK_SUCCESS;
+
+	if (!loaded)
+	{
+		err = vku_createDeviceProfileData(physicalDevice, &properties, formatCount, pFormats, &(*profile)->data, &size);
+
+		if (!err)
+		{
+			const VkBool32 valid = vku_getDeviceProfileLayout((*profile)->data, size, &properties, formatCount, pFormats, &(*profile)->layout);
+			assert(valid);
+			(void) valid;
+
+			if (path)
+				saved = vku_writeFileAtomic(path, (*profile)->data, size);
+		}
+	}
+
+	if (!err)
+		err = vku_createDeviceProfileRegistry(physicalDevice, &(*profile)->layout, &(*profile)->registry);
+
+
+	if (err)
+	{
+		vkuDestroyDeviceProfile(*profile);
+		(*profile) = NULL;
+
+		return err;
+	}
+
+
+	if (statistics)
+	{
+		statistics->loaded = loaded;
+		statistics->saved = saved;
+		statistics->size = size;
+		statistics->loadTime = vku_getTime() - loadStart;
+	}
+
+	return VK_SUCCESS;
+}
+
+VKUAPI_ATTR void vkuDestroyDeviceProfile(VkuDeviceProfile profile)
+{
+	if (!profile)
+		return;
+
+
+	vkuDestroyCapabilityRegistry(profile->registry);
+
+	vku_unmapFile(&profile->mappedFile);
+	VKU_FREE(profile->data);
+
+	VKU_FREE(profile);
+}
+
+
+// The registry is owned by the profile. Bind it using vkuBindCapabilityRegistry(), such that the
+// support checking, vkuSelectPhysicalDevice() and vkuGetQueueTopology() use the profile.
+VKUAPI_ATTR VkuCapabilityRegistry vkuGetDeviceProfileRegistry(VkuDeviceProfile profile)
+{
+	assert(profile);
+
+	return profile->registry;
+}
+
+VKUAPI_ATTR const VkPhysicalDeviceProperties* vkuGetDeviceProfileProperties(VkuDeviceProfile profile)
+{
+	assert(profile);
+
+	return profile->layout.properties;
+}
+
+VKUAPI_ATTR const VkPhysicalDeviceMemoryProperties* vkuGetDeviceProfileMemoryProperties(VkuDeviceProfile profile)
+{
+	assert(profile);
+
+	return profile->layout.memoryProperties;
+}
+
+VKUAPI_ATTR const VkQueueFamilyProperties* vkuGetDeviceProfileQueueFamilyProperties(VkuDeviceProfile profile, uint32_t *queueFamilyCount)
+{
+	assert(profile);
+	assert(queueFamilyCount);
+
+	(*queueFamilyCount) = profile->layout.header->queueFamilyCount;
+
+	return profile->layout.queueFamilyProperties;
+}
+
+// Returns VK_FALSE if the format wasn't given to vkuLoadDeviceProfile()
+VKUAPI_ATTR VkBool32 vkuGetDeviceProfileFormatProperties(VkuDeviceProfile profile, VkFormat format, VkFormatProperties *formatProperties)
+{
+	assert(profile);
+	assert(formatProperties);
+
+
+	for (uint32_t formatIndex = 0; formatIndex < profile->layout.header->formatCount; formatIndex++)
+	{
+		if (profile->layout.formats[formatIndex].format == format)
+		{
+			(*formatProperties) = profile->layout.formats[formatIndex].properties;
+			return VK_TRUE;
+		}
+	}
+
+	return VK_FALSE;
+}
+
+
+// Minimal threads, mutexes, condition variables, thread-local storage and atomics, used internally
+
+typedef struct vku_thread
+{
+	void (*function)(void *pArgument);
+	void *pArgument;
+
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+} vku_thread;
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION vku_mutex;
+typedef CONDITION_VARIABLE vku_condition;
+#else
+typedef pthread_mutex_t vku_mutex;
+typedef pthread_cond_t vku_condition;
+#endif
+
+#ifdef _WIN32
+typedef DWORD vku_tls_key;
+#	define VKU_TLS_DESTRUCTOR_CALL WINAPI
+#else
+typedef pthread_key_t vku_tls_key;
+#	define VKU_TLS_DESTRUCTOR_CALL
+#endif
+
+// Called with the thread's value when a thread exits, if the value isn't NULL
+typedef void (VKU_TLS_DESTRUCTOR_CALL *vku_tls_destructor)(void *value);
+
+
+#ifdef _WIN32
+static DWORD WINAPI vku_threadMain(LPVOID pThread)
+#else
+static void* vku_threadMain(void *pThread)
+#endif
+{
+	vku_thread *thread = (vku_thread*) pThread;
+	thread->function(thread->pArgument);
+
+	return 0;
+}
+
+// The thread must stay at the same address until it's joined
+static VkBool32 vku_createThread(vku_thread *thread, void (*function)(void *pArgument), void *pArgument)
+{
+	thread->function = function;
+	thread->pArgument = pArgument;
+
+#ifdef _WIN32
+	thread->handle = CreateThread(NULL, 0, vku_threadMain, thread, 0, NULL);
+	return thread->handle ? VK_TRUE : VK_FALSE;
+#else
+	return (pthread_create(&thread->handle, NULL, vku_threadMain, thread) == 0) ? VK_TRUE : VK_FALSE;
+#endif
+}
+
+static void vku_joinThread(vku_thread *thread)
+{
+#ifdef _WIN32
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+}
+
+
+static void vku_initMutex(vku_mutex *mutex)
+{
+#ifdef _WIN32
+	InitializeCriticalSection(mutex);
+#else
+	pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+static void vku_destroyMutex(vku_mutex *mutex)
+{
+#ifdef _WIN32
+	DeleteCriticalSection(mutex);
+#else
+	pthread_mutex_destroy(mutex);
+#endif
+}
+
+static void vku_lockMutex(vku_mutex *mutex)
+{
+#ifdef _WIN32
+	EnterCriticalSection(mutex);
+#else
+	pthread_mutex_lock(mutex);
+#endif
+}
+
+static void vku_unlockMutex(vku_mutex *mutex)
+{
+#ifdef _WIN32
+	LeaveCriticalSection(mutex);
+#else
+	pthread_mutex_unlock(mutex);
+#endif
+}
+
+
+static void vku_initCondition(vku_condition *condition)
+{
+#ifdef _WIN32
+	InitializeConditionVariable(condition);
+#else
+	pthread_cond_init(condition, NULL);
+#endif
+}
+
+static void vku_destroyCondition(vku_condition *condition)
+{
+#ifdef _WIN32
+	(void) condition;
+#else
+	pthread_cond_destroy(condition);
+#endif
+}
+
+// The mutex must be locked
+static void vku_waitCondition(vku_condition *condition, vku_mutex *mutex)
+{
+#ifdef _WIN32
+	SleepConditionVariableCS(condition, mutex, INFINITE);
+#else
+	pthread_cond_wait(condition, mutex);
+#endif
+}
+
+static void vku_broadcastCondition(vku_condition *condition)
+{
+#ifdef _WIN32
+	WakeAllConditionVariable(condition);
+#else
+	pthread_cond_broadcast(condition);
+#endif
+}
+
+
+// Atomics with full barriers, used by the lock-free parts
+
+static uint64_t vku_atomicCompareExchange64(volatile uint64_t *value, uint64_t expected, uint64_t desired)
+{
+#ifdef _WIN32
+	return (uint64_t) InterlockedCompareExchange64((volatile LONG64*) value, (LONG64) desired, (LONG64) expected);
+#else
+	return __sync_val_compare_and_swap(value, expected, desired);
+#endif
+}
+
+// Also atomic on 32-bit platforms, where a 64-bit load can tear
+static uint64_t vku_atomicLoad64(volatile uint64_t *value)
+{
+	return vku_atomicCompareExchange64(value, 0, 0);
+}
+
+// Returns the new value
+static uint32_t vku_atomicAdd32(volatile uint32_t *value, uint32_t addend)
+{
+#ifdef _WIN32
+	return (uint32_t) InterlockedAdd((volatile LONG*) value, (LONG) addend);
+#else
+	return __sync_add_and_fetch(value, addend);
+#endif
+}
+
+// Returns the previous value
+static uint32_t vku_atomicOr32(volatile uint32_t *value, uint32_t bits)
+{
+#ifdef _WIN32
+	return (uint32_t) InterlockedOr((volatile LONG*) value, (LONG) bits);
+#else
+	return __sync_fetch_and_or(value, bits);
+#endif
+}
+
+// Returns the previous value
+static uint32_t vku_atomicAnd32(volatile uint32_t *value, uint32_t bits)
+{
+#ifdef _WIN32
+	return (uint32_t) InterlockedAnd((volatile LONG*) value, (LONG) bits);
+#else
+	return __sync_fetch_and_and(value, bits);
+#endif
+}
+
+// Returns the new value
+static uint64_t vku_atomicAdd64(volatile uint64_t *value, uint64_t addend)
+{
+#ifdef _WIN32
+	return (uint64_t) InterlockedAdd64((volatile LONG64*) value, (LONG64) addend);
+#else
+	return __sync_add_and_fetch(value, addend);
+#endif
+}
+
+
+// Windows uses fiber local storage, as only that calls a destructor on thread exit
+static VkBool32 vku_createTlsKey(vku_tls_key *key, vku_tls_destructor destructor)
+{
+#ifdef _WIN32
+	(*key) = FlsAlloc(destructor);
+	return ((*key) != FLS_OUT_OF_INDEXES) ? VK_TRUE : VK_FALSE;
+#else
+	return (pthread_key_create(key, destructor) == 0) ? VK_TRUE : VK_FALSE;
+#endif
+}
+
+// On Windows this calls the destructor for the values of the threads
+// which are still running, while pthread_key_delete() doesn't
+static void vku_destroyTlsKey(vku_tls_key key)
+{
+#ifdef _WIN32
+	FlsFree(key);
+#else
+	pthread_key_delete(key);
+#endif
+}
+
+static void* vku_getTlsValue(vku_tls_key key)
+{
+#ifdef _WIN32
+	return FlsGetValue(key);
+#else
+	return pthread_getspecific(key);
+#endif
+}
+
+static VkBool32 vku_setTlsValue(vku_tls_key key, void *value)
+{
+#ifdef _WIN32
+	return FlsSetValue(key, value) ? VK_TRUE : VK_FALSE;
+#else
+	return (pthread_setspecific(key, value) == 0) ? VK_TRUE : VK_FALSE;
+#endif
+}
+
+
+
+typedef struct VkuPipelineBuilder_T* VkuPipelineBuilder;
+typedef struct VkuPipelineBatch_T* VkuPipelineBatch;
+
+
+// Called from a worker thread when a pipeline of a batch has been created, where result is
+// the VkResult of creating it. pipelineIndex is the index into the batch's create infos.
+typedef void (VKAPI_PTR *PFN_vkuPipelineBuilt)(void *pUserData, uint32_t pipelineIndex, VkResult result, VkPipeline pipeline);
+
+
+typedef struct VkuPipelineBuilderCreateInfo
+{
+	VkDevice device;
+
+	// 0 means 1 worker thread
+	uint32_t threadCount;
+
+	// Optional, each worker thread's VkPipelineCache starts out with the data of this cache,
+	// and they're merged back into it by vkuMergePipelineBuilderCaches() and when destroyed
+	VkPipelineCache pipelineCache;
+
+	// Used for the pipelines and the worker thread's VkPipelineCaches
+	const VkAllocationCallbacks *pAllocator;
+} VkuPipelineBuilderCreateInfo;
+
+
+typedef struct VkuPipelineBuilderStatistics
+{
+	uint32_t threadCount;
+
+	uint32_t pipelineCount;
+	uint32_t failedPipelineCount;
+
+	// The nanoseconds spent creating pipelines summed across the worker threads,
+	// compared to the wall time this shows how well the building scales
+	uint64_t buildTime;
+} VkuPipelineBuilderStatistics;
+
+
+typedef enum vku_pipeline_type
+{
+	VKU_PIPELINE_TYPE_GRAPHICS,
+	VKU_PIPELINE_TYPE_COMPUTE
+} vku_pipeline_type;
+
+
+struct VkuPipelineBatch_T
+{
+	// NULL once the builder has been destroyed, by then the batch has completed
+	VkuPipelineBuilder builder;
+
+	vku_pipeline_type type;
+	uint32_t pipelineCount;
+
+	const VkGraphicsPipelineCreateInfo *pGraphicsCreateInfos;
+	const VkComputePipelineCreateInfo *pComputeCreateInfos;
+	VkPipeline *pPipelines;
+
+	PFN_vkuPipelineBuilt pfnBuilt;
+	void *pUserData;
+
+	// The next pipeline to be started, and the amount of completed pipelines
+	uint32_t nextPipelineIndex;
+	uint32_t completedPipelineCount;
+
+	// The first error, if any
+	VkResult result;
+
+	// The batches with pipelines left to start are queued in the builder
+	struct VkuPipelineBatch_T *pNext;
+
+	// All the batches which haven't been destroyed are linked in the builder
+	struct VkuPipelineBatch_T *pPrevLive;
+	struct VkuPipelineBatch_T *pNextLive;
+};
+
+
+typedef struct vku_pipeline_worker
+{
+	VkuPipelineBuilder builder;
+
+	vku_thread thread;
+	VkPipelineCache pipelineCache;
+} vku_pipeline_worker;
+
+
+struct VkuPipelineBuilder_T
+{
+	VkDevice device;
+	VkPipelineCache pipelineCache;
+	const VkAllocationCallbacks *pAllocator;
+
+	uint32_t threadCount;
+	vku_pipeline_worker *workers;
+
+	// Guards everything below it
+	vku_mutex mutex;
+
+	// Signaled when a batch is queued, and when a batch completes
+	vku_condition workCondition;
+	vku_condition completeCondition;
+
+	VkuPipelineBatch firstBatch;
+	VkuPipelineBatch lastBatch;
+
+	// The batches to detach when the builder is destroyed
+	VkuPipelineBatch liveBatches;
+
+	VkBool32 exiting;
+
+	VkuPipelineBuilderStatistics statistics;
+};
+
+
+static void vku_pipelineWorkerMain(void *pWorker)
+{
+	vku_pipeline_worker *worker = (vku_pipeline_worker*) pWorker;
+	VkuPipelineBuilder builder = worker->builder;
+
+	vku_lockMutex(&builder->mutex);
+
+	for (;;)
+	{
+		while (!builder->firstBatch && !builder->exiting)
+			vku_waitCondition(&builder->workCondition, &builder->mutex);
+
+		// The queued batches are completed before exiting
+		if (!builder->firstBatch)
+			break;
+
+
+		VkuPipelineBatch batch = builder->firstBatch;
+		const uint32_t pipelineIndex = batch->nextPipelineIndex++;
+
+		if (batch->nextPipelineIndex == batch->pipelineCount)
+		{
+			builder->firstBatch = batch->pNext;
+
+			if (!builder->firstBatch)
+				builder->lastBatch = NULL;
+		}
+
+		vku_unlockMutex(&builder->mutex);
+
+
+		const uint64_t buildStart = vku_getTime();
+
+		VkPipeline *pipeline = &batch->pPipelines[pipelineIndex];
+		VkResult err;
+
+		if (batch->type == VKU_PIPELINE_TYPE_GRAPHICS)
+			err = vkCreateGraphicsPipelines(builder->device, worker->pipelineCache, 1, &batch->pGraphicsCreateInfos[pipelineIndex], builder->pAllocator, pipeline);
+		else
+			err = vkCreateComputePipelines(builder->device, worker->pipelineCache, 1, &batch->pComputeCreateInfos[pipelineIndex], builder->pAllocator, pipeline);
+
+		const uint64_t buildTime = vku_getTime() - buildStart;
+
+		if (err)
+			(*pipeline) = VK_NULL_HANDLE;
+
+		if (batch->pfnBuilt)
+			batch->pfnBuilt(batch->pUserData, pipelineIndex, err, *pipeline);
+
+
+		vku_lockMutex(&builder->mutex);
+
+		builder->statistics.pipelineCount++;
+		builder->statistics.buildTime += buildTime;
+
+		if (err)
+		{
+			builder->statistics.failedPipelineCount++;
+
+			if (batch->result == VK_SUCCESS)
+				batch->result = err;
+		}
+
+		if (++batch->completedPipelineCount == batch->pipelineCount)
+			vku_broadcastCondition(&builder->completeCondition);
+	}
+
+	vku_unlockMutex(&builder->mutex);
+}
+
+
+VKUAPI_ATTR void vkuDestroyPipelineBuilder(VkuPipelineBuilder builder);
+
+VKUAPI_ATTR VkResult vkuCreatePipelineBuilder(const VkuPipelineBuilderCreateInfo *createInfo, VkuPipelineBuilder *builder)
+{
+	assert(createInfo);
+	assert(createInfo->device);
+	assert(builder);
+
+
+	(*builder) = (VkuPipelineBuilder) VKU_CALLOC(1, sizeof(struct VkuPipelineBuilder_T));
+
+	if (!(*builder))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	const uint32_t threadCount = createInfo->threadCount ? createInfo->threadCount : 1;
+
+	(*builder)->device = createInfo->device;
+	(*builder)->pipelineCache = createInfo->pipelineCache;
+	(*builder)->pAllocator = createInfo->pAllocator;
+
+	(*builder)->statistics.threadCount = threadCount;
+
+	vku_initMutex(&(*builder)->mutex);
+	vku_initCondition(&(*builder)->workCondition);
+	vku_initCondition(&(*builder)->completeCondition);
+
+
+	(*builder)->workers = (vku_pipeline_worker*) VKU_CALLOC(threadCount, sizeof(vku_pipeline_worker));
+
+	if (!(*builder)->workers)
+	{
+		vkuDestroyPipelineBuilder(*builder);
+		(*builder) = NULL;
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+
+	// Get the data to start the worker caches out with
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo;
+	memset(&pipelineCacheCreateInfo, 0, sizeof(pipelineCacheCreateInfo));
+
+	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	void *initialData = NULL;
+	VkResult err = VK_SUCCESS;
+
+	if (createInfo->pipelineCache != VK_NULL_HANDLE)
+	{
+		err = vkGetPipelineCacheData(createInfo->device, createInfo->pipelineCache, &pipelineCacheCreateInfo.initialDataSize, NULL);
+
+		if (!err && (pipelineCacheCreateInfo.initialDataSize > 0))
+		{
+			initialData = VKU_MALLOC(pipelineCacheCreateInfo.initialDataSize);
+
+			if (!initialData)
+				err = VK_ERROR_OUT_OF_HOST_MEMORY;
+			else
+				err = vkGetPipelineCacheData(createInfo->device, createInfo->pipelineCache, &pipelineCacheCreateInfo.initialDataSize, initialData);
+
+			// If the cache grew in between, then the data is just partial
+			if (err == VK_INCOMPLETE)
+				err = VK_SUCCESS;
+		}
+
+		pipelineCacheCreateInfo.pInitialData = initialData;
+	}
+
+
+	for (uint32_t threadIndex = 0; !err && (threadIndex < threadCount); threadIndex++)
+	{
+		vku_pipeline_worker *worker = &(*builder)->workers[threadIndex];
+
+		worker->builder = (*builder);
+
+		err = vkCreatePipelineCache(createInfo->device, &pipelineCacheCreateInfo, createInfo->pAllocator, &worker->pipelineCache);
+
+		if (err)
+			break;
+
+		if (!vku_createThread(&worker->thread, vku_pipelineWorkerMain, worker))
+		{
+			vkDestroyPipelineCache(createInfo->device, worker->pipelineCache, createInfo->pAllocator);
+			worker->pipelineCache = VK_NULL_HANDLE;
+
+			err = VK_ERROR_INITIALIZATION_FAILED;
+			break;
+		}
+
+		(*builder)->threadCount++;
+	}
+
+	VKU_FREE(initialData);
+
+
+	if (err)
+	{
+		vkuDestroyPipelineBuilder(*builder);
+		(*builder) = NULL;
+
+		return err;
+	}
+
+	return VK_SUCCESS;
+}
+
+
+// Merges the worker thread's VkPipelineCaches into the builder's pipelineCache.
+// Can be called while building, in which case it only includes the pipelines built so far.
+VKUAPI_ATTR VkResult vkuMergePipelineBuilderCaches(VkuPipelineBuilder builder)
+{
+	assert(builder);
+	assert(builder->pipelineCache);
+
+
+	VkPipelineCache *pipelineCaches = (VkPipelineCache*) VKU_MALLOC(builder->threadCount * sizeof(VkPipelineCache));
+
+	if (!pipelineCaches)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	for (uint32_t threadIndex = 0; threadIndex < builder->threadCount; threadIndex++)
+		pipelineCaches[threadIndex] = builder->workers[threadIndex].pipelineCache;
+
+	const VkResult err = vkMergePipelineCaches(builder->device, builder->pipelineCache, builder->threadCount, pipelineCaches);
+
+	VKU_FREE(pipelineCaches);
+
+	return err;
+}
+
+
+// Completes the queued batches, merges the caches and then destroys the builder.
+// The batches themselves still have to be destroyed, which can be done afterwards.
+VKUAPI_ATTR void vkuDestroyPipelineBuilder(VkuPipelineBuilder builder)
+{
+	if (!builder)
+		return;
+
+
+	vku_lockMutex(&builder->mutex);
+
+	builder->exiting = VK_TRUE;
+	vku_broadcastCondition(&builder->workCondition);
+
+	vku_unlockMutex(&builder->mutex);
+
+
+	for (uint32_t threadIndex = 0; threadIndex < builder->threadCount; threadIndex++)
+		vku_joinThread(&builder->workers[threadIndex].thread);
+
+	// The workers completed every batch before exiting, so the
+	// remaining batches don't need the builder anymore
+	for (VkuPipelineBatch batch = builder->liveBatches; batch; batch = batch->pNextLive)
+	{
+		assert(batch->completedPipelineCount == batch->pipelineCount);
+		batch->builder = NULL;
+	}
+
+	if (builder->pipelineCache != VK_NULL_HANDLE)
+		vkuMergePipelineBuilderCaches(builder);
+
+	for (uint32_t threadIndex = 0; threadIndex < builder->threadCount; threadIndex++)
+		vkDestroyPipelineCache(builder->device, builder->workers[threadIndex].pipelineCache, builder->pAllocator);
+
+
+	vku_destroyCondition(&builder->completeCondition);
+	vku_destroyCondition(&builder->workCondition);
+	vku_destroyMutex(&builder->mutex);
+
+	VKU_FREE(builder->workers);
+	VKU_FREE(builder);
+}
+
+
+static VkResult vku_queuePipelineBatch(VkuPipelineBuilder builder, vku_pipeline_type type, uint32_t pipelineCount,
+	const VkGraphicsPipelineCreateInfo *pGraphicsCreateInfos, const VkComputePipelineCreateInfo *pComputeCreateInfos,
+	VkPipeline *pPipelines, PFN_vkuPipelineBuilt pfnBuilt, void *pUserData, VkuPipelineBatch *batch)
+{
+	assert(builder);
+	assert(pPipelines);
+	assert(batch);
+
+
+	(*batch) = (VkuPipelineBatch) VKU_CALLOC(1, sizeof(struct VkuPipelineBatch_T));
+
+	if (!(*batch))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*batch)->builder = builder;
+	(*batch)->type = type;
+	(*batch)->pipelineCount = pipelineCount;
+	(*batch)->pGraphicsCreateInfos = pGraphicsCreateInfos;
+	(*batch)->pComputeCreateInfos = pComputeCreateInfos;
+	(*batch)->pPipelines = pPipelines;
+	(*batch)->pfnBuilt = pfnBuilt;
+	(*batch)->pUserData = pUserData;
+	(*batch)->result = VK_SUCCESS;
+
+
+	vku_lockMutex(&builder->mutex);
+
+	(*batch)->pNextLive = builder->liveBatches;
+
+	if (builder->liveBatches)
+		builder->liveBatches->pPrevLive = (*batch);
+
+	builder->liveBatches = (*batch);
+
+
+	if (pipelineCount > 0)
+	{
+		if (builder->lastBatch)
+			builder->lastBatch->pNext = (*batch);
+		else
+			builder->firstBatch = (*batch);
+
+		builder->lastBatch = (*batch);
+
+		vku_broadcastCondition(&builder->workCondition);
+	}
+
+	vku_unlockMutex(&builder->mutex);
+
+
+	return VK_SUCCESS;
+}
+
+// Queues the pipelines to be created by the worker threads, and returns right away. The create infos
+// and pPipelines must stay valid until the batch has completed. pfnBuilt and pUserData are optional.
+VKUAPI_ATTR VkResult vkuBuildGraphicsPipelines(VkuPipelineBuilder builder, uint32_t createInfoCount, const VkGraphicsPipelineCreateInfo *pCreateInfos,
+	VkPipeline *pPipelines, PFN_vkuPipelineBuilt pfnBuilt, void *pUserData, VkuPipelineBatch *batch)
+{
+	return vku_queuePipelineBatch(builder, VKU_PIPELINE_TYPE_GRAPHICS, createInfoCount, pCreateInfos, NULL, pPipelines, pfnBuilt, pUserData, batch);
+}
+
+VKUAPI_ATTR VkResult vkuBuildComputePipelines(VkuPipelineBuilder builder, uint32_t createInfoCount, const VkComputePipelineCreateInfo *pCreateInfos,
+	VkPipeline *pPipelines, PFN_vkuPipelineBuilt pfnBuilt, void *pUserData, VkuPipelineBatch *batch)
+{
+	return vku_queuePipelineBatch(builder, VKU_PIPELINE_TYPE_COMPUTE, createInfoCount, NULL, pCreateInfos, pPipelines, pfnBuilt, pUserData, batch);
+}
+
+
+// Returns VK_NOT_READY while the batch is building, otherwise
+// VK_SUCCESS or the first error of the pipelines
+VKUAPI_ATTR VkResult vkuGetPipelineBatchStatus(VkuPipelineBatch batch)
+{
+	assert(batch);
+
+
+	VkuPipelineBuilder builder = batch->builder;
+
+	if (!builder)
+		return batch->result;
+
+	vku_lockMutex(&builder->mutex);
+
+	const VkResult result = (batch->completedPipelineCount == batch->pipelineCount) ? batch->result : VK_NOT_READY;
+
+	vku_unlockMutex(&builder->mutex);
+
+	return result;
+}
+
+// Waits for the batch to complete, returns VK_SUCCESS or the first error of the pipelines
+VKUAPI_ATTR VkResult vkuWaitPipelineBatch(VkuPipelineBatch batch)
+{
+	assert(batch);
+
+
+	VkuPipelineBuilder builder = batch->builder;
+
+	if (!builder)
+		return batch->result;
+
+	vku_lockMutex(&builder->mutex);
+
+	while (batch->completedPipelineCount != batch->pipelineCount)
+		vku_waitCondition(&builder->completeCondition, &builder->mutex);
+
+	const VkResult result = batch->result;
+
+	vku_unlockMutex(&builder->mutex);
+
+	return result;
+}
+
+// Waits for the batch to complete before destroying it, either before or after the builder
+VKUAPI_ATTR void vkuDestroyPipelineBatch(VkuPipelineBatch batch)
+{
+	if (!batch)
+		return;
+
+	vkuWaitPipelineBatch(batch);
+
+
+	VkuPipelineBuilder builder = batch->builder;
+
+	if (builder)
+	{
+		vku_lockMutex(&builder->mutex);
+
+		if (batch->pPrevLive)
+			batch->pPrevLive->pNextLive = batch->pNextLive;
+		else
+			builder->liveBatches = batch->pNextLive;
+
+		if (batch->pNextLive)
+			batch->pNextLive->pPrevLive = batch->pPrevLive;
+
+		vku_unlockMutex(&builder->mutex);
+	}
+
+	VKU_FREE(batch);
+}
+
+
+VKUAPI_ATTR void vkuGetPipelineBuilderStatistics(VkuPipelineBuilder builder, VkuPipelineBuilderStatistics *statistics)
+{
+	assert(builder);
+	assert(statistics);
+
+
+	vku_lockMutex(&builder->mutex);
+
+	(*statistics) = builder->statistics;
+
+	vku_unlockMutex(&builder->mutex);
+}
+
+
+// The core descriptor types, from VK_DESCRIPTOR_TYPE_SAMPLER to VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT
+#define VKU_DESCRIPTOR_TYPE_COUNT 11
+
+// The default amount of sets in the first pool of each frame, each following pool doubles it
+#define VKU_DEFAULT_DESCRIPTOR_POOL_SETS 64
+#define VKU_MAX_DESCRIPTOR_POOL_SETS 4096
+
+
+typedef struct VkuDescriptorLayoutCache_T* VkuDescriptorLayoutCache;
+typedef struct VkuDescriptorAllocator_T* VkuDescriptorAllocator;
+
+
+typedef struct vku_descriptor_layout
+{
+	uint32_t hash;
+	VkDescriptorSetLayout layout;
+
+	VkDescriptorSetLayoutCreateFlags flags;
+
+	// Sorted by binding, the immutable samplers are stored after the bindings
+	uint32_t bindingCount;
+	VkDescriptorSetLayoutBinding *bindings;
+
+	// The amount of each descriptor type in a set with the layout
+	uint32_t descriptorCounts[VKU_DESCRIPTOR_TYPE_COUNT];
+} vku_descriptor_layout;
+
+
+struct VkuDescriptorLayoutCache_T
+{
+	VkDevice device;
+	const VkAllocationCallbacks *pAllocator;
+
+	vku_mutex mutex;
+
+	// The same layouts, sorted by hash and by handle
+	uint32_t layoutCount;
+	uint32_t layoutCapacity;
+	vku_descriptor_layout **layoutsByHash;
+	vku_descriptor_layout **layoutsByHandle;
+
+	uint64_t hitCount;
+};
+
+
+static uint32_t vku_hashBytes(uint32_t hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char*) data;
+
+	for (size_t byteIndex = 0; byteIndex < size; byteIndex++)
+	{
+		hash ^= (uint32_t) bytes[byteIndex];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+
+static int vku_compareLayoutBindings(const void *a, const void *b)
+{
+	const uint32_t bindingA = ((const VkDescriptorSetLayoutBinding*) a)->binding;
+	const uint32_t bindingB = ((const VkDescriptorSetLayoutBinding*) b)->binding;
+
+	return (bindingA < bindingB) ? -1 : ((bindingA > bindingB) ? 1 : 0);
+}
+
+
+// Copies the bindings sorted by binding into a single allocation, which is what the cache compares
+static VkResult vku_createDescriptorLayout(const VkDescriptorSetLayoutCreateInfo *createInfo, vku_descriptor_layout **layout)
+{
+	uint32_t immutableSamplerCount = 0;
+
+	for (uint32_t bindingIndex = 0; bindingIndex < createInfo->bindingCount; bindingIndex++)
+	{
+		if (createInfo->pBindings[bindingIndex].pImmutableSamplers)
+			immutableSamplerCount += createInfo->pBindings[bindingIndex].descriptorCount;
+	}
+
+
+	const size_t size = sizeof(vku_descriptor_layout) +
+		createInfo->bindingCount * sizeof(VkDescriptorSetLayoutBinding) +
+		immutableSamplerCount * sizeof(VkSampler);
+
+	(*layout) = (vku_descriptor_layout*) VKU_CALLOC(1, size);
+
+	if (!(*layout))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*layout)->flags = createInfo->flags;
+	(*layout)->bindingCount = createInfo->bindingCount;
+	(*layout)->bindings = (VkDescriptorSetLayoutBinding*) ((*layout) + 1);
+
+	if (createInfo->bindingCount > 0)
+		memcpy((*layout)->bindings, createInfo->pBindings, createInfo->bindingCount * sizeof(VkDescriptorSetLayoutBinding));
+
+	qsort((*layout)->bindings, createInfo->bindingCount, sizeof(VkDescriptorSetLayoutBinding), vku_compareLayoutBindings);
+
+
+	VkSampler *immutableSamplers = (VkSampler*) ((*layout)->bindings + createInfo->bindingCount);
+
+	uint32_t hash = vku_hashBytes(2166136261u, &createInfo->flags, sizeof(createInfo->flags));
+
+	for (uint32_t bindingIndex = 0; bindingIndex < createInfo->bindingCount; bindingIndex++)
+	{
+		VkDescriptorSetLayoutBinding *binding = &(*layout)->bindings[bindingIndex];
+
+		hash = vku_hashBytes(hash, &binding->binding, sizeof(binding->binding));
+		hash = vku_hashBytes(hash, &binding->descriptorType, sizeof(binding->descriptorType));
+		hash = vku_hashBytes(hash, &binding->descriptorCount, sizeof(binding->descriptorCount));
+		hash = vku_hashBytes(hash, &binding->stageFlags, sizeof(binding->stageFlags));
+
+		if (binding->pImmutableSamplers)
+		{
+			memcpy(immutableSamplers, binding->pImmutableSamplers, binding->descriptorCount * sizeof(VkSampler));
+			binding->pImmutableSamplers = immutableSamplers;
+
+			hash = vku_hashBytes(hash, immutableSamplers, binding->descriptorCount * sizeof(VkSampler));
+
+			immutableSamplers += binding->descriptorCount;
+		}
+
+		if ((uint32_t) binding->descriptorType < VKU_DESCRIPTOR_TYPE_COUNT)
+			(*layout)->descriptorCounts[binding->descriptorType] += binding->descriptorCount;
+	}
+
+	(*layout)->hash = hash;
+
+	return VK_SUCCESS;
+}
+
+static VkBool32 vku_isDescriptorLayoutEqual(const vku_descriptor_layout *layoutA, const vku_descriptor_layout *layoutB)
+{
+	if ((layoutA->hash != layoutB->hash) || (layoutA->flags != layoutB->flags) || (layoutA->bindingCount != layoutB->bindingCount))
+		return VK_FALSE;
+
+	for (uint32_t bindingIndex = 0; bindingIndex < layoutA->bindingCount; bindingIndex++)
+	{
+		const VkDescriptorSetLayoutBinding *bindingA = &layoutA->bindings[bindingIndex];
+		const VkDescriptorSetLayoutBinding *bindingB = &layoutB->bindings[bindingIndex];
+
+		if ((bindingA->binding != bindingB->binding) ||
+			(bindingA->descriptorType != bindingB->descriptorType) ||
+			(bindingA->descriptorCount != bindingB->descriptorCount) ||
+			(bindingA->stageFlags != bindingB->stageFlags))
+			return VK_FALSE;
+
+		if ((bindingA->pImmutableSamplers == NULL) != (bindingB->pImmutableSamplers == NULL))
+			return VK_FALSE;
+
+		if (bindingA->pImmutableSamplers && memcmp(bindingA->pImmutableSamplers, bindingB->pImmutableSamplers, bindingA->descriptorCount * sizeof(VkSampler)))
+			return VK_FALSE;
+	}
+
+	return VK_TRUE;
+}
+
+
+VKUAPI_ATTR VkResult vkuCreateDescriptorLayoutCache(VkDevice device, const VkAllocationCallbacks *pAllocator, VkuDescriptorLayoutCache *cache)
+{
+	assert(device);
+	assert(cache);
+
+
+	(*cache) = (VkuDescriptorLayoutCache) VKU_CALLOC(1, sizeof(struct VkuDescriptorLayoutCache_T));
+
+	if (!(*cache))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	(*cache)->device = device;
+	(*cache)->pAllocator = pAllocator;
+
+	vku_initMutex(&(*cache)->mutex);
+
+	return VK_SUCCESS;
+}
+
+// Destroys the cached VkDescriptorSetLayouts
+VKUAPI_ATTR void vkuDestroyDescriptorLayoutCache(VkuDescriptorLayoutCache cache)
+{
+	if (!cache)
+		return;
+
+	for (uint32_t layoutIndex = 0; layoutIndex < cache->layoutCount; layoutIndex++)
+	{
+		vkDestroyDescriptorSetLayout(cache->device, cache->layoutsByHash[layoutIndex]->layout, cache->pAllocator);
+		VKU_FREE(cache->layoutsByHash[layoutIndex]);
+	}
+
+	vku_destroyMutex(&cache->mutex);
+
+	VKU_FREE(cache->layoutsByHash);
+	VKU_FREE(cache->layoutsByHandle);
+	VKU_FREE(cache);
+}
+
+
+// Returns the index of the first layout in the cache with a hash greater than or equal to hash
+static uint32_t vku_lowerBoundLayoutHash(VkuDescriptorLayoutCache cache, uint32_t hash)
+{
+	uint32_t first = 0, last = cache->layoutCount;
+
+	while (first < last)
+	{
+		const uint32_t middle = first + (last - first) / 2;
+
+		if (cache->layoutsByHash[middle]->hash < hash)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	return first;
+}
+
+// Returns the index of the first layout in the cache with a handle greater than or equal to layout
+static uint32_t vku_lowerBoundLayoutHandle(VkuDescriptorLayoutCache cache, VkDescriptorSetLayout layout)
+{
+	uint32_t first = 0, last = cache->layoutCount;
+
+	while (first < last)
+	{
+		const uint32_t middle = first + (last - first) / 2;
+
+		if (cache->layoutsByHandle[middle]->layout < layout)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	return first;
+}
+
+
+// Gets the VkDescriptorSetLayout from the cache, or creates it if it isn't in it. The bindings are
+// compared regardless of their order. The pNext chain isn't compared, so layouts with one shouldn't
+// use the cache. The layout is owned by the cache. The cache is internally synchronized.
+VKUAPI_ATTR VkResult vkuGetDescriptorSetLayout(VkuDescriptorLayoutCache cache, const VkDescriptorSetLayoutCreateInfo *createInfo, VkDescriptorSetLayout *layout)
+{
+	assert(cache);
+	assert(createInfo);
+	assert(layout);
+
+
+	vku_descriptor_layout *descriptorLayout;
+	VkResult err = vku_createDescriptorLayout(createInfo, &descriptorLayout);
+
+	if (err)
+		return err;
+
+
+	vku_lockMutex(&cache->mutex);
+
+	uint32_t hashIndex = vku_lowerBoundLayoutHash(cache, descriptorLayout->hash);
+
+	for (uint32_t layoutIndex = hashIndex; (layoutIndex < cache->layoutCount) && (cache->layoutsByHash[layoutIndex]->hash == descriptorLayout->hash); layoutIndex++)
+	{
+		if (vku_isDescriptorLayoutEqual(cache->layoutsByHash[layoutIndex], descriptorLayout))
+		{
+			(*layout) = cache->layoutsByHash[layoutIndex]->layout;
+
+			cache->hitCount++;
+
+			vku_unlockMutex(&cache->mutex);
+
+			VKU_FREE(descriptorLayout);
+
+			return VK_SUCCESS;
+		}
+	}
+
+
+	if (cache->layoutCount == cache->layoutCapacity)
+	{
+		const uint32_t layoutCapacity = cache->layoutCapacity ? (cache->layoutCapacity * 2) : 16;
+
+		vku_descriptor_layout **layoutsByHash = (vku_descriptor_layout**) VKU_REALLOC(cache->layoutsByHash, layoutCapacity * sizeof(vku_descriptor_layout*));
+
+		if (layoutsByHash)
+			cache->layoutsByHash = layoutsByHash;
+
+		vku_descriptor_layout **layoutsByHandle = (vku_descriptor_layout**) VKU_REALLOC(cache->layoutsByHandle, layoutCapacity * sizeof(vku_descriptor_layout*));
+
+		if (layoutsByHandle)
+			cache->layoutsByHandle = layoutsByHandle;
+
+		if (!layoutsByHash || !layoutsByHandle)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+		else
+			cache->layoutCapacity = layoutCapacity;
+	}
+
+	if (!err)
+		err = vkCreateDescriptorSetLayout(cache->device, createInfo, cache->pAllocator, &descriptorLayout->layout);
+
+	if (err)
+	{
+		vku_unlockMutex(&cache->mutex);
+
+		VKU_FREE(descriptorLayout);
+
+		return err;
+	}
+
+
+	const uint32_t handleIndex = vku_lowerBoundLayoutHandle(cache, descriptorLayout->layout);
+
+	memmove(cache->layoutsByHash + hashIndex + 1, cache->layoutsByHash + hashIndex, (cache->layoutCount - hashIndex) * sizeof(vku_descriptor_layout*));
+	memmove(cache->layoutsByHandle + handleIndex + 1, cache->layoutsByHandle + handleIndex, (cache->layoutCount - handleIndex) * sizeof(vku_descriptor_layout*));
+
+	cache->layoutsByHash[hashIndex] = descriptorLayout;
+	cache->layoutsByHandle[handleIndex] = descriptorLayout;
+	cache->layoutCount++;
+
+	(*layout) = descriptorLayout->layout;
+
+	vku_unlockMutex(&cache->mutex);
+
+	return VK_SUCCESS;
+}
+
+
+// Returns the descriptor counts of a layout from the cache, or NULL if it isn't in it
+static const uint32_t* vku_getCachedDescriptorCounts(VkuDescriptorLayoutCache cache, VkDescriptorSetLayout layout)
+{
+	const uint32_t *descriptorCounts = NULL;
+
+	vku_lockMutex(&cache->mutex);
+
+	const uint32_t handleIndex = vku_lowerBoundLayoutHandle(cache, layout);
+
+	// The cached layouts are never freed, so the counts stay valid
+	if ((handleIndex < cache->layoutCount) && (cache->layoutsByHandle[handleIndex]->layout == layout))
+		descriptorCounts = cache->layoutsByHandle[handleIndex]->descriptorCounts;
+
+	vku_unlockMutex(&cache->mutex);
+
+	return descriptorCounts;
+}
+
+
+
+typedef struct VkuDescriptorAllocatorCreateInfo
+{
+	VkDevice device;
+
+	// A chain of pools is kept for each frame in flight
+	uint32_t frameCount;
+
+	// Optional, the layouts from the cache are used to size the pools from the observed usage
+	VkuDescriptorLayoutCache layoutCache;
+
+	// The amount of sets in the first pool, 0 means VKU_DEFAULT_DESCRIPTOR_POOL_SETS
+	uint32_t maxSets;
+
+	// Optional, the amount of each descriptor type per set, which the observed usage can only
+	// increase. If not given, then every core descriptor type gets 4 per set.
+	uint32_t poolSizeCount;
+	const VkDescriptorPoolSize *pPoolSizes;
+
+	const VkAllocationCallbacks *pAllocator;
+} VkuDescriptorAllocatorCreateInfo;
+
+
+typedef struct VkuDescriptorAllocatorStatistics
+{
+	uint32_t poolCount;
+
+	uint64_t allocatedSetCount;
+
+	// The times an allocation failed and moved on to the next pool in the chain
+	uint64_t poolExhaustedCount;
+
+	uint64_t resetCount;
+
+	uint32_t cachedLayoutCount;
+	uint64_t layoutCacheHitCount;
+} VkuDescriptorAllocatorStatistics;
+
+
+typedef struct vku_descriptor_pool_chain
+{
+	// The pools up to currentPool have been used this frame
+	uint32_t poolCount;
+	uint32_t currentPool;
+	VkDescriptorPool *pools;
+
+	// The amount of sets in the first pool, and the amount of sets allocated this frame
+	uint32_t maxSets;
+	uint32_t setCount;
+} vku_descriptor_pool_chain;
+
+// Remembers the descriptor counts of recently used layouts, to avoid locking the layout cache
+#define VKU_DESCRIPTOR_COUNTS_CACHE_SIZE 64
+
+typedef struct vku_descriptor_counts_entry
+{
+	VkDescriptorSetLayout layout;
+	const uint32_t *descriptorCounts;
+} vku_descriptor_counts_entry;
+
+
+struct VkuDescriptorAllocator_T
+{
+	VkDevice device;
+	const VkAllocationCallbacks *pAllocator;
+
+	VkuDescriptorLayoutCache layoutCache;
+
+	uint32_t maxSets;
+
+	// Used to size the pools until there's observed usage
+	uint32_t poolSizeCount;
+	VkDescriptorPoolSize *poolSizes;
+
+	// The observed usage, the total amount of each descriptor type in the allocated sets
+	// with a layout from the layout cache, and the amount of those sets
+	uint64_t observedDescriptorCounts[VKU_DESCRIPTOR_TYPE_COUNT];
+	uint64_t observedSetCount;
+
+	vku_descriptor_counts_entry descriptorCountsCache[VKU_DESCRIPTOR_COUNTS_CACHE_SIZE];
+
+	uint32_t frameCount;
+	uint32_t frameIndex;
+	vku_descriptor_pool_chain *frames;
+
+	VkuDescriptorAllocatorStatistics statistics;
+};
+
+
+VKUAPI_ATTR void vkuDestroyDescriptorAllocator(VkuDescriptorAllocator allocator);
+
+VKUAPI_ATTR VkResult vkuCreateDescriptorAllocator(const VkuDescriptorAllocatorCreateInfo *createInfo, VkuDescriptorAllocator *allocator)
+{
+	assert(createInfo);
+	assert(createInfo->device);
+	assert(createInfo->frameCount > 0);
+	assert(allocator);
+
+
+	(*allocator) = (VkuDescriptorAllocator) VKU_CALLOC(1, sizeof(struct VkuDescriptorAllocator_T));
+
+	if (!(*allocator))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*allocator)->device = createInfo->device;
+	(*allocator)->pAllocator = createInfo->pAllocator;
+	(*allocator)->layoutCache = createInfo->layoutCache;
+	(*allocator)->maxSets = createInfo->maxSets ? createInfo->maxSets : VKU_DEFAULT_DESCRIPTOR_POOL_SETS;
+	(*allocator)->frameCount = createInfo->frameCount;
+
+	(*allocator)->frames = (vku_descriptor_pool_chain*) VKU_CALLOC(createInfo->frameCount, sizeof(vku_descriptor_pool_chain));
+
+
+	const uint32_t poolSizeCount = createInfo->poolSizeCount ? createInfo->poolSizeCount : VKU_DESCRIPTOR_TYPE_COUNT;
+
+	(*allocator)->poolSizes = (VkDescriptorPoolSize*) VKU_MALLOC(poolSizeCount * sizeof(VkDescriptorPoolSize));
+
+	if (!(*allocator)->frames || !(*allocator)->poolSizes)
+	{
+		vkuDestroyDescriptorAllocator(*allocator);
+		(*allocator) = NULL;
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+
+	(*allocator)->poolSizeCount = poolSizeCount;
+
+	for (uint32_t frameIndex = 0; frameIndex < createInfo->frameCount; frameIndex++)
+		(*allocator)->frames[frameIndex].maxSets = (*allocator)->maxSets;
+
+	for (uint32_t poolSizeIndex = 0; poolSizeIndex < poolSizeCount; poolSizeIndex++)
+	{
+		if (createInfo->poolSizeCount)
+			(*allocator)->poolSizes[poolSizeIndex] = createInfo->pPoolSizes[poolSizeIndex];
+		else
+		{
+			(*allocator)->poolSizes[poolSizeIndex].type = (VkDescriptorType) poolSizeIndex;
+			(*allocator)->poolSizes[poolSizeIndex].descriptorCount = 4;
+		}
+	}
+
+
+	return VK_SUCCESS;
+}
+
+// None of the descriptor sets may be in use
+VKUAPI_ATTR void vkuDestroyDescriptorAllocator(VkuDescriptorAllocator allocator)
+{
+	if (!allocator)
+		return;
+
+	if (allocator->frames)
+	{
+		for (uint32_t frameIndex = 0; frameIndex < allocator->frameCount; frameIndex++)
+		{
+			vku_descriptor_pool_chain *chain = &allocator->frames[frameIndex];
+
+			// Destroying the pools frees the sets
+			for (uint32_t poolIndex = 0; poolIndex < chain->poolCount; poolIndex++)
+				vkDestroyDescriptorPool(allocator->device, chain->pools[poolIndex], allocator->pAllocator);
+
+			VKU_FREE(chain->pools);
+		}
+	}
+
+	VKU_FREE(allocator->frames);
+	VKU_FREE(allocator->poolSizes);
+	VKU_FREE(allocator);
+}
+
+
+// The pool sizes are the given pool sizes merged with the observed usage, taking the larger of
+// the two for each type, such that layouts which aren't in the layout cache keep fitting. The
+// pool is also made large enough for requiredCounts, the descriptors of the sets being allocated.
+static VkResult vku_createDescriptorPool(VkuDescriptorAllocator allocator, uint32_t maxSets, const uint32_t *requiredCounts, VkDescriptorPool *pool)
+{
+	uint32_t descriptorsPerSet[VKU_DESCRIPTOR_TYPE_COUNT];
+	memset(descriptorsPerSet, 0, sizeof(descriptorsPerSet));
+
+	// Like vkCreateDescriptorPool(), the given pool sizes of the same type add up
+	uint32_t extensionPoolSizeCount = 0;
+
+	for (uint32_t poolSizeIndex = 0; poolSizeIndex < allocator->poolSizeCount; poolSizeIndex++)
+	{
+		const VkDescriptorPoolSize *poolSize = &allocator->poolSizes[poolSizeIndex];
+
+		if (((uint32_t) poolSize->type) < VKU_DESCRIPTOR_TYPE_COUNT)
+			descriptorsPerSet[poolSize->type] += poolSize->descriptorCount;
+		else
+			extensionPoolSizeCount++;
+	}
+
+	// The average set of the observed usage, rounded up
+	for (uint32_t type = 0; (type < VKU_DESCRIPTOR_TYPE_COUNT) && (allocator->observedSetCount > 0); type++)
+	{
+		const uint64_t observedPerSet = (allocator->observedDescriptorCounts[type] + allocator->observedSetCount - 1) / allocator->observedSetCount;
+
+		if (observedPerSet > descriptorsPerSet[type])
+			descriptorsPerSet[type] = (uint32_t) observedPerSet;
+	}
+
+
+	VkDescriptorPoolSize poolSizes[VKU_DESCRIPTOR_TYPE_COUNT];
+	VkDescriptorPoolSize *allocatedPoolSizes = NULL;
+
+	VkDescriptorPoolSize *pPoolSizes = poolSizes;
+
+	if (extensionPoolSizeCount > 0)
+	{
+		allocatedPoolSizes = (VkDescriptorPoolSize*) VKU_MALLOC((VKU_DESCRIPTOR_TYPE_COUNT + extensionPoolSizeCount) * sizeof(VkDescriptorPoolSize));
+
+		if (!allocatedPoolSizes)
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+		pPoolSizes = allocatedPoolSizes;
+	}
+
+
+	uint32_t poolSizeCount = 0;
+
+	for (uint32_t type = 0; type < VKU_DESCRIPTOR_TYPE_COUNT; type++)
+	{
+		uint32_t descriptorCount = descriptorsPerSet[type] * maxSets;
+
+		if (requiredCounts && (requiredCounts[type] > descriptorCount))
+			descriptorCount = requiredCounts[type];
+
+		if (descriptorCount == 0)
+			continue;
+
+		pPoolSizes[poolSizeCount].type = (VkDescriptorType) type;
+		pPoolSizes[poolSizeCount].descriptorCount = descriptorCount;
+		poolSizeCount++;
+	}
+
+	// The types from extensions aren't observed, so they're just scaled
+	for (uint32_t poolSizeIndex = 0; poolSizeIndex < allocator->poolSizeCount; poolSizeIndex++)
+	{
+		const VkDescriptorPoolSize *poolSize = &allocator->poolSizes[poolSizeIndex];
+
+		if (((uint32_t) poolSize->type) < VKU_DESCRIPTOR_TYPE_COUNT)
+			continue;
+
+		pPoolSizes[poolSizeCount].type = poolSize->type;
+		pPoolSizes[poolSizeCount].descriptorCount = poolSize->descriptorCount * maxSets;
+		poolSizeCount++;
+	}
+
+
+	VkDescriptorPoolCreateInfo poolCreateInfo;
+	memset(&poolCreateInfo, 0, sizeof(poolCreateInfo));
+
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = maxSets;
+	poolCreateInfo.poolSizeCount = poolSizeCount;
+	poolCreateInfo.pPoolSizes = pPoolSizes;
+
+	const VkResult err = vkCreateDescriptorPool(allocator->device, &poolCreateInfo, allocator->pAllocator, pool);
+
+	VKU_FREE(allocatedPoolSizes);
+
+	return err;
+}
+
+
+// Also sums the descriptor counts of the sets into requestCounts
+static void vku_observeDescriptorSets(VkuDescriptorAllocator allocator, uint32_t descriptorSetCount, const VkDescriptorSetLayout *pSetLayouts, uint32_t *requestCounts)
+{
+	memset(requestCounts, 0, VKU_DESCRIPTOR_TYPE_COUNT * sizeof(uint32_t));
+
+	if (!allocator->layoutCache)
+		return;
+
+	for (uint32_t setIndex = 0; setIndex < descriptorSetCount; setIndex++)
+	{
+		const VkDescriptorSetLayout layout = pSetLayouts[setIndex];
+
+		vku_descriptor_counts_entry *entry = &allocator->descriptorCountsCache[vku_hashBytes(2166136261u, &layout, sizeof(layout)) % VKU_DESCRIPTOR_COUNTS_CACHE_SIZE];
+
+		if (entry->layout != layout)
+		{
+			const uint32_t *descriptorCounts = vku_getCachedDescriptorCounts(allocator->layoutCache, layout);
+
+			// Layouts which aren't in the cache aren't observed
+			if (!descriptorCounts)
+				continue;
+
+			entry->layout = layout;
+			entry->descriptorCounts = descriptorCounts;
+		}
+
+		for (uint32_t type = 0; type < VKU_DESCRIPTOR_TYPE_COUNT; type++)
+		{
+			allocator->observedDescriptorCounts[type] += entry->descriptorCounts[type];
+			requestCounts[type] += entry->descriptorCounts[type];
+		}
+
+		allocator->observedSetCount++;
+	}
+}
+
+
+// Allocates the descriptor sets from the current frame's pools, if the current pool is exhausted
+// then it moves on to the next pool in the chain, creating it if needed. The sets are only valid
+// until the frame is begun again, and must not be freed individually.
+VKUAPI_ATTR VkResult vkuAllocateDescriptorSets(VkuDescriptorAllocator allocator, uint32_t descriptorSetCount, const VkDescriptorSetLayout *pSetLayouts, VkDescriptorSet *pDescriptorSets)
+{
+	assert(allocator);
+	assert(pSetLayouts);
+	assert(pDescriptorSets);
+
+
+	uint32_t requestCounts[VKU_DESCRIPTOR_TYPE_COUNT];
+	vku_observeDescriptorSets(allocator, descriptorSetCount, pSetLayouts, requestCounts);
+
+
+	vku_descriptor_pool_chain *chain = &allocator->frames[allocator->frameIndex];
+
+	VkDescriptorSetAllocateInfo allocateInfo;
+	memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorSetCount = descriptorSetCount;
+	allocateInfo.pSetLayouts = pSetLayouts;
+
+	for (;;)
+	{
+		VkBool32 createdPool = VK_FALSE;
+
+		if (chain->currentPool == chain->poolCount)
+		{
+			VkDescriptorPool *pools = (VkDescriptorPool*) VKU_REALLOC(chain->pools, (chain->poolCount + 1) * sizeof(VkDescriptorPool));
+
+			if (!pools)
+				return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+			chain->pools = pools;
+
+
+			// Each pool in the chain is twice as large as the previous one
+			uint32_t maxSets = chain->maxSets;
+
+			for (uint32_t poolIndex = 0; (poolIndex < chain->poolCount) && (maxSets < VKU_MAX_DESCRIPTOR_POOL_SETS); poolIndex++)
+				maxSets *= 2;
+
+			if (maxSets < descriptorSetCount)
+				maxSets = descriptorSetCount;
+
+			const VkResult err = vku_createDescriptorPool(allocator, maxSets, requestCounts, &chain->pools[chain->poolCount]);
+
+			if (err)
+				return err;
+
+			chain->poolCount++;
+			allocator->statistics.poolCount++;
+
+			createdPool = VK_TRUE;
+		}
+
+
+		allocateInfo.descriptorPool = chain->pools[chain->currentPool];
+
+		const VkResult err = vkAllocateDescriptorSets(allocator->device, &allocateInfo, pDescriptorSets);
+
+		if (!err)
+		{
+			chain->setCount += descriptorSetCount;
+
+			allocator->statistics.allocatedSetCount += descriptorSetCount;
+			return VK_SUCCESS;
+		}
+
+		// Depending on the driver an exhausted pool gives VK_ERROR_OUT_OF_POOL_MEMORY,
+		// VK_ERROR_FRAGMENTED_POOL or VK_ERROR_OUT_OF_DEVICE_MEMORY, so any error moves
+		// on to the next pool. Only failing on a new pool is an actual error.
+		if (createdPool || (err == VK_ERROR_OUT_OF_HOST_MEMORY))
+			return err;
+
+		chain->currentPool++;
+		allocator->statistics.poolExhaustedCount++;
+	}
+}
+
+
+// Makes frameIndex the current frame, and resets its pools. If fence isn't VK_NULL_HANDLE,
+// then it first waits for it, which should be the fence of the submission that last
+// used the frame's descriptor sets.
+VKUAPI_ATTR VkResult vkuBeginDescriptorAllocatorFrame(VkuDescriptorAllocator allocator, uint32_t frameIndex, VkFence fence)
+{
+	assert(allocator);
+	assert(frameIndex < allocator->frameCount);
+
+
+	VkResult err;
+
+	if (fence != VK_NULL_HANDLE)
+	{
+		err = vkWaitForFences(allocator->device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+		if (err)
+			return err;
+	}
+
+
+	vku_descriptor_pool_chain *chain = &allocator->frames[frameIndex];
+
+	if (chain->currentPool > 0)
+	{
+		// The frame needed more than one pool, so replace the chain with a single pool
+		// large enough for the whole frame, which is created by the next allocation
+		for (uint32_t poolIndex = 0; poolIndex < chain->poolCount; poolIndex++)
+			vkDestroyDescriptorPool(allocator->device, chain->pools[poolIndex], allocator->pAllocator);
+
+		allocator->statistics.poolCount -= chain->poolCount;
+		chain->poolCount = 0;
+
+		while ((chain->maxSets < chain->setCount) && (chain->maxSets < VKU_MAX_DESCRIPTOR_POOL_SETS))
+			chain->maxSets *= 2;
+	}
+	else if (chain->poolCount > 0)
+	{
+		err = vkResetDescriptorPool(allocator->device, chain->pools[0], 0);
+
+		if (err)
+			return err;
+
+		allocator->statistics.resetCount++;
+	}
+
+	chain->currentPool = 0;
+	chain->setCount = 0;
+
+	allocator->frameIndex = frameIndex;
+
+	return VK_SUCCESS;
+}
+
+
+VKUAPI_ATTR void vkuGetDescriptorAllocatorStatistics(VkuDescriptorAllocator allocator, VkuDescriptorAllocatorStatistics *statistics)
+{
+	assert(allocator);
+	assert(statistics);
+
+
+	(*statistics) = allocator->statistics;
+
+	if (allocator->layoutCache)
+	{
+		vku_lockMutex(&allocator->layoutCache->mutex);
+
+		statistics->cachedLayoutCount = allocator->layoutCache->layoutCount;
+		statistics->layoutCacheHitCount = allocator->layoutCache->hitCount;
+
+		vku_unlockMutex(&allocator->layoutCache->mutex);
+	}
+}
+
+
+// The default amount of slots of each resource type in the bindless heap
+#define VKU_DEFAULT_BINDLESS_CAPACITY 4096
+
+#define VKU_BINDLESS_NO_SLOT 0xFFFFFFFFu
+
+
+typedef struct VkuBindlessHeap_T* VkuBindlessHeap;
+
+
+// Each resource type has its own descriptor set, with a single array at binding 0.
+// The sets are bound in this order, see vkuCmdBindBindlessHeap().
+typedef enum VkuBindlessType
+{
+	VKU_BINDLESS_TYPE_SAMPLED_IMAGE = 0,
+	VKU_BINDLESS_TYPE_STORAGE_IMAGE = 1,
+	VKU_BINDLESS_TYPE_STORAGE_BUFFER = 2,
+	VKU_BINDLESS_TYPE_SAMPLER = 3,
+	VKU_BINDLESS_TYPE_COUNT = 4
+} VkuBindlessType;
+
+
+typedef struct VkuBindlessHeapCreateInfo
+{
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	// VK_TRUE if the device was created with VK_EXT_descriptor_indexing (which can be checked with
+	// vkuIsDeviceExtensionSupported()) and its update after bind and partially bound features.
+	// Then there's a single update-after-bind set for each type. Otherwise there's a set for each
+	// type for each frame in flight, and the capacities are limited to the per stage limits.
+	VkBool32 descriptorIndexing;
+	uint32_t frameCount;
+
+	// The amount of slots for each type, 0 means VKU_DEFAULT_BINDLESS_CAPACITY
+	uint32_t capacities[VKU_BINDLESS_TYPE_COUNT];
+
+	// Without descriptor indexing the bindings aren't partially bound, so every descriptor of a binding
+	// a shader statically uses has to be valid, regardless of which slots it reads. The empty slots are
+	// written with these, and they're required unless descriptorIndexing is VK_TRUE.
+	VkImageView defaultSampledImageView;
+	VkImageView defaultStorageImageView;
+	VkBuffer defaultStorageBuffer;
+	VkSampler defaultSampler;
+
+	const VkAllocationCallbacks *pAllocator;
+} VkuBindlessHeapCreateInfo;
+
+
+typedef struct VkuBindlessHeapStatistics
+{
+	VkBool32 descriptorIndexing;
+
+	uint32_t capacities[VKU_BINDLESS_TYPE_COUNT];
+	uint32_t slotCounts[VKU_BINDLESS_TYPE_COUNT];
+
+	// The vkUpdateDescriptorSets() calls, the VkWriteDescriptorSets passed
+	// to them, and the descriptors they wrote
+	uint64_t updateCount;
+	uint64_t writeCount;
+	uint64_t descriptorCount;
+} VkuBindlessHeapStatistics;
+
+
+typedef struct vku_bindless_table
+{
+	VkDescriptorType descriptorType;
+	uint32_t capacity;
+
+	VkDescriptorSetLayout layout;
+
+	// The free slots are a lock-free stack linked through nextSlots, where the head is
+	// (tag << 32) | slot. The slots removed during each frame are kept in another stack
+	// for that frame, until the frame begins again and they're safe to reuse.
+	volatile uint64_t freeHead;
+	volatile uint64_t *retiredHeads;
+	volatile uint32_t *nextSlots;
+
+	volatile uint32_t slotCount;
+
+	// The descriptor of each slot, either imageInfos (images and samplers) or bufferInfos
+	VkDescriptorImageInfo *imageInfos;
+	VkDescriptorBufferInfo *bufferInfos;
+
+	// A bit for each slot for each set, which is set when the slot needs to be written to the set
+	uint32_t dirtyWordCount;
+	volatile uint32_t *dirtyWords;
+} vku_bindless_table;
+
+
+struct VkuBindlessHeap_T
+{
+	VkDevice device;
+	const VkAllocationCallbacks *pAllocator;
+
+	VkBool32 descriptorIndexing;
+
+	uint32_t frameCount;
+	uint32_t frameIndex;
+
+	// The default descriptors, for heaps without descriptor indexing
+	VkDescriptorImageInfo defaultImageInfos[VKU_BINDLESS_TYPE_COUNT];
+	VkDescriptorBufferInfo defaultBufferInfo;
+
+	vku_bindless_table tables[VKU_BINDLESS_TYPE_COUNT];
+
+	// setCount * VKU_BINDLESS_TYPE_COUNT sets, where setCount is 1 with
+	// descriptor indexing, and otherwise one for each frame
+	uint32_t setCount;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet *sets;
+
+	// Scratch memory for vkuFlushBindlessHeap(), with room for the most runs of
+	// consecutive slots there can be, such that flushing never allocates
+	VkWriteDescriptorSet *writes;
+
+	uint64_t updateCount;
+	uint64_t writeCount;
+	uint64_t descriptorCount;
+};
+
+
+static uint32_t vku_popBindlessSlot(volatile uint64_t *head, volatile uint32_t *nextSlots)
+{
+	uint64_t oldHead = vku_atomicLoad64(head);
+
+	for (;;)
+	{
+		const uint32_t slot = (uint32_t) oldHead;
+
+		if (slot == VKU_BINDLESS_NO_SLOT)
+			return VKU_BINDLESS_NO_SLOT;
+
+		// The tag changes with every exchange, so if another thread popped the slot in the
+		// meantime, then the exchange fails even if the slot was pushed back (ABA)
+		const uint64_t newHead = (((oldHead >> 32) + 1) << 32) | nextSlots[slot];
+		const uint64_t previousHead = vku_atomicCompareExchange64(head, oldHead, newHead);
+
+		if (previousHead == oldHead)
+			return slot;
+
+		oldHead = previousHead;
+	}
+}
+
+// Pushes the chain of slots from firstSlot to lastSlot, which are linked through nextSlots
+static void vku_pushBindlessSlots(volatile uint64_t *head, volatile uint32_t *nextSlots, uint32_t firstSlot, uint32_t lastSlot)
+{
+	uint64_t oldHead = vku_atomicLoad64(head);
+
+	for (;;)
+	{
+		nextSlots[lastSlot] = (uint32_t) oldHead;
+
+		const uint64_t newHead = (((oldHead >> 32) + 1) << 32) | firstSlot;
+		const uint64_t previousHead = vku_atomicCompareExchange64(head, oldHead, newHead);
+
+		if (previousHead == oldHead)
+			return;
+
+		oldHead = previousHead;
+	}
+}
+
+
+// Marks the slot to be written to every set
+static void vku_markBindlessSlot(VkuBindlessHeap heap, vku_bindless_table *table, uint32_t slot)
+{
+	for (uint32_t setIndex = 0; setIndex < heap->setCount; setIndex++)
+		vku_atomicOr32(&table->dirtyWords[setIndex * table->dirtyWordCount + slot / 32], 1u << (slot % 32));
+}
+
+static void vku_setBindlessSlotToDefault(VkuBindlessHeap heap, VkuBindlessType type, uint32_t slot)
+{
+	vku_bindless_table *table = &heap->tables[type];
+
+	if (table->bufferInfos)
+		table->bufferInfos[slot] = heap->defaultBufferInfo;
+	else
+		table->imageInfos[slot] = heap->defaultImageInfos[type];
+
+	vku_markBindlessSlot(heap, table, slot);
+}
+
+
+static VkResult vku_createBindlessTable(VkuBindlessHeap heap, VkuBindlessType type, VkDescriptorType descriptorType, uint32_t capacity)
+{
+	vku_bindless_table *table = &heap->tables[type];
+
+	table->descriptorType = descriptorType;
+	table->capacity = capacity;
+	table->dirtyWordCount = (capacity + 31) / 32;
+
+	table->retiredHeads = (volatile uint64_t*) VKU_MALLOC(heap->frameCount * sizeof(uint64_t));
+	table->nextSlots = (volatile uint32_t*) VKU_MALLOC(capacity * sizeof(uint32_t));
+	table->dirtyWords = (volatile uint32_t*) VKU_CALLOC(heap->setCount * table->dirtyWordCount, sizeof(uint32_t));
+
+	if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+		table->bufferInfos = (VkDescriptorBufferInfo*) VKU_CALLOC(capacity, sizeof(VkDescriptorBufferInfo));
+	else
+		table->imageInfos = (VkDescriptorImageInfo*) VKU_CALLOC(capacity, sizeof(VkDescriptorImageInfo));
+
+	if (!table->retiredHeads || !table->nextSlots || !table->dirtyWords || (!table->bufferInfos && !table->imageInfos))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	// Every slot starts out free
+	for (uint32_t slot = 0; slot < capacity; slot++)
+		table->nextSlots[slot] = ((slot + 1) < capacity) ? (slot + 1) : VKU_BINDLESS_NO_SLOT;
+
+	table->freeHead = (capacity > 0) ? 0 : VKU_BINDLESS_NO_SLOT;
+
+	for (uint32_t frameIndex = 0; frameIndex < heap->frameCount; frameIndex++)
+		table->retiredHeads[frameIndex] = VKU_BINDLESS_NO_SLOT;
+
+
+	VkDescriptorSetLayoutBinding binding;
+	memset(&binding, 0, sizeof(binding));
+
+	binding.binding = 0;
+	binding.descriptorType = descriptorType;
+	binding.descriptorCount = capacity;
+	binding.stageFlags = VK_SHADER_STAGE_ALL;
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo;
+	memset(&layoutCreateInfo, 0, sizeof(layoutCreateInfo));
+
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = 1;
+	layoutCreateInfo.pBindings = &binding;
+
+#ifdef VK_EXT_descriptor_indexing
+	// Slots can be written while the set is bound, as long as they
+	// aren't used, and only the used slots have to be valid
+	const VkDescriptorBindingFlagsEXT bindingFlags =
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+		VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT |
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCreateInfo;
+	memset(&bindingFlagsCreateInfo, 0, sizeof(bindingFlagsCreateInfo));
+
+	bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsCreateInfo.bindingCount = 1;
+	bindingFlagsCreateInfo.pBindingFlags = &bindingFlags;
+
+	if (heap->descriptorIndexing)
+	{
+		layoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+		layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	}
+#endif
+
+	return vkCreateDescriptorSetLayout(heap->device, &layoutCreateInfo, heap->pAllocator, &table->layout);
+}
+
+static void vku_destroyBindlessTable(VkuBindlessHeap heap, vku_bindless_table *table)
+{
+	if (table->layout != VK_NULL_HANDLE)
+		vkDestroyDescriptorSetLayout(heap->device, table->layout, heap->pAllocator);
+
+	VKU_FREE((void*) table->retiredHeads);
+	VKU_FREE((void*) table->nextSlots);
+	VKU_FREE((void*) table->dirtyWords);
+	VKU_FREE(table->imageInfos);
+	VKU_FREE(table->bufferInfos);
+}
+
+
+VKUAPI_ATTR void vkuDestroyBindlessHeap(VkuBindlessHeap heap);
+VKUAPI_ATTR void vkuFlushBindlessHeap(VkuBindlessHeap heap);
+
+// Returns VK_ERROR_INITIALIZATION_FAILED if descriptorIndexing is VK_FALSE and a default descriptor is missing
+VKUAPI_ATTR VkResult vkuCreateBindlessHeap(const VkuBindlessHeapCreateInfo *createInfo, VkuBindlessHeap *heap)
+{
+	assert(createInfo);
+	assert(createInfo->physicalDevice);
+	assert(createInfo->device);
+	assert(createInfo->frameCount > 0);
+	assert(heap);
+
+
+	(*heap) = (VkuBindlessHeap) VKU_CALLOC(1, sizeof(struct VkuBindlessHeap_T));
+
+	if (!(*heap))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*heap)->device = createInfo->device;
+	(*heap)->pAllocator = createInfo->pAllocator;
+	(*heap)->frameCount = createInfo->frameCount;
+
+#ifdef VK_EXT_descriptor_indexing
+	(*heap)->descriptorIndexing = createInfo->descriptorIndexing;
+#endif
+
+	(*heap)->setCount = (*heap)->descriptorIndexing ? 1 : createInfo->frameCount;
+
+
+	if (!(*heap)->descriptorIndexing && (
+		(createInfo->defaultSampledImageView == VK_NULL_HANDLE) ||
+		(createInfo->defaultStorageImageView == VK_NULL_HANDLE) ||
+		(createInfo->defaultStorageBuffer == VK_NULL_HANDLE) ||
+		(createInfo->defaultSampler == VK_NULL_HANDLE)))
+	{
+		VKU_FREE(*heap);
+		(*heap) = NULL;
+
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(createInfo->physicalDevice, &properties);
+
+	const VkDescriptorType descriptorTypes[VKU_BINDLESS_TYPE_COUNT] = {
+		VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_SAMPLER
+	};
+
+	const uint32_t perStageLimits[VKU_BINDLESS_TYPE_COUNT] = {
+		properties.limits.maxPerStageDescriptorSampledImages,
+		properties.limits.maxPerStageDescriptorStorageImages,
+		properties.limits.maxPerStageDescriptorStorageBuffers,
+		properties.limits.maxPerStageDescriptorSamplers
+	};
+
+
+	VkResult err = VK_SUCCESS;
+
+	VkDescriptorPoolSize poolSizes[VKU_BINDLESS_TYPE_COUNT];
+
+	for (uint32_t type = 0; !err && (type < VKU_BINDLESS_TYPE_COUNT); type++)
+	{
+		uint32_t capacity = createInfo->capacities[type] ? createInfo->capacities[type] : VKU_DEFAULT_BINDLESS_CAPACITY;
+
+		if (!(*heap)->descriptorIndexing && (capacity > perStageLimits[type]))
+			capacity = perStageLimits[type];
+
+		err = vku_createBindlessTable(*heap, (VkuBindlessType) type, descriptorTypes[type], capacity);
+
+		poolSizes[type].type = descriptorTypes[type];
+		poolSizes[type].descriptorCount = capacity * (*heap)->setCount;
+	}
+
+
+	if (!err)
+	{
+		VkDescriptorPoolCreateInfo poolCreateInfo;
+		memset(&poolCreateInfo, 0, sizeof(poolCreateInfo));
+
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.maxSets = (*heap)->setCount * VKU_BINDLESS_TYPE_COUNT;
+		poolCreateInfo.poolSizeCount = VKU_BINDLESS_TYPE_COUNT;
+		poolCreateInfo.pPoolSizes = poolSizes;
+
+#ifdef VK_EXT_descriptor_indexing
+		if ((*heap)->descriptorIndexing)
+			poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+#endif
+
+		err = vkCreateDescriptorPool(createInfo->device, &poolCreateInfo, createInfo->pAllocator, &(*heap)->descriptorPool);
+	}
+
+
+	if (!err)
+	{
+		uint32_t writeCapacity = 0;
+
+		for (uint32_t type = 0; type < VKU_BINDLESS_TYPE_COUNT; type++)
+			writeCapacity += ((*heap)->tables[type].capacity + 1) / 2;
+
+		(*heap)->sets = (VkDescriptorSet*) VKU_CALLOC((*heap)->setCount * VKU_BINDLESS_TYPE_COUNT, sizeof(VkDescriptorSet));
+		(*heap)->writes = (VkWriteDescriptorSet*) VKU_CALLOC(writeCapacity ? writeCapacity : 1, sizeof(VkWriteDescriptorSet));
+
+		if (!(*heap)->sets || !(*heap)->writes)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	VkDescriptorSetLayout layouts[VKU_BINDLESS_TYPE_COUNT];
+
+	for (uint32_t type = 0; type < VKU_BINDLESS_TYPE_COUNT; type++)
+		layouts[type] = (*heap)->tables[type].layout;
+
+	VkDescriptorSetAllocateInfo allocateInfo;
+	memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = (*heap)->descriptorPool;
+	allocateInfo.descriptorSetCount = VKU_BINDLESS_TYPE_COUNT;
+	allocateInfo.pSetLayouts = layouts;
+
+	for (uint32_t setIndex = 0; !err && (setIndex < (*heap)->setCount); setIndex++)
+		err = vkAllocateDescriptorSets(createInfo->device, &allocateInfo, (*heap)->sets + setIndex * VKU_BINDLESS_TYPE_COUNT);
+
+
+	if (err)
+	{
+		vkuDestroyBindlessHeap(*heap);
+		(*heap) = NULL;
+
+		return err;
+	}
+
+
+	// Without descriptor indexing, fill every slot with the default descriptors
+	if (!(*heap)->descriptorIndexing)
+	{
+		(*heap)->defaultImageInfos[VKU_BINDLESS_TYPE_SAMPLED_IMAGE].imageView = createInfo->defaultSampledImageView;
+		(*heap)->defaultImageInfos[VKU_BINDLESS_TYPE_SAMPLED_IMAGE].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		(*heap)->defaultImageInfos[VKU_BINDLESS_TYPE_STORAGE_IMAGE].imageView = createInfo->defaultStorageImageView;
+		(*heap)->defaultImageInfos[VKU_BINDLESS_TYPE_STORAGE_IMAGE].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		(*heap)->defaultBufferInfo.buffer = createInfo->defaultStorageBuffer;
+		(*heap)->defaultBufferInfo.range = VK_WHOLE_SIZE;
+
+		(*heap)->defaultImageInfos[VKU_BINDLESS_TYPE_SAMPLER].sampler = createInfo->defaultSampler;
+
+		for (uint32_t type = 0; type < VKU_BINDLESS_TYPE_COUNT; type++)
+		{
+			for (uint32_t slot = 0; slot < (*heap)->tables[type].capacity; slot++)
+				vku_setBindlessSlotToDefault(*heap, (VkuBindlessType) type, slot);
+		}
+
+		vkuFlushBindlessHeap(*heap);
+	}
+
+
+	return VK_SUCCESS;
+}
+
+// None of the sets may be in use
+VKUAPI_ATTR void vkuDestroyBindlessHeap(VkuBindlessHeap heap)
+{
+	if (!heap)
+		return;
+
+	// Destroying the pool frees the sets
+	if (heap->descriptorPool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(heap->device, heap->descriptorPool, heap->pAllocator);
+
+	for (uint32_t type = 0; type < VKU_BINDLESS_TYPE_COUNT; type++)
+		vku_destroyBindlessTable(heap, &heap->tables[type]);
+
+	VKU_FREE(heap->sets);
+	VKU_FREE(heap->writes);
+	VKU_FREE(heap);
+}
+
+
+static VkResult vku_addBindlessSlot(VkuBindlessHeap heap, VkuBindlessType type, uint32_t *handle)
+{
+	vku_bindless_table *table = &heap->tables[type];
+
+	(*handle) = vku_popBindlessSlot(&table->freeHead, table->nextSlots);
+
+	if ((*handle) == VKU_BINDLESS_NO_SLOT)
+		return VK_ERROR_TOO_MANY_OBJECTS;
+
+	vku_atomicAdd32(&table->slotCount, 1);
+
+	return VK_SUCCESS;
+}
+
+// Adds a sampled (VKU_BINDLESS_TYPE_SAMPLED_IMAGE) or storage (VKU_BINDLESS_TYPE_STORAGE_IMAGE) image,
+// the handle is the index into the type's array. Returns VK_ERROR_TOO_MANY_OBJECTS if the heap is full.
+// Adding and removing is lock-free, and can be done from any thread.
+VKUAPI_ATTR VkResult vkuAddBindlessImage(VkuBindlessHeap heap, VkuBindlessType type, VkImageView imageView, VkImageLayout imageLayout, uint32_t *handle)
+{
+	assert(heap);
+	assert((type == VKU_BINDLESS_TYPE_SAMPLED_IMAGE) || (type == VKU_BINDLESS_TYPE_STORAGE_IMAGE));
+	assert(handle);
+
+
+	const VkResult err = vku_addBindlessSlot(heap, type, handle);
+
+	if (err)
+		return err;
+
+
+	vku_bindless_table *table = &heap->tables[type];
+
+	table->imageInfos[*handle].sampler = VK_NULL_HANDLE;
+	table->imageInfos[*handle].imageView = imageView;
+	table->imageInfos[*handle].imageLayout = imageLayout;
+
+	vku_markBindlessSlot(heap, table, *handle);
+
+	return VK_SUCCESS;
+}
+
+VKUAPI_ATTR VkResult vkuAddBindlessBuffer(VkuBindlessHeap heap, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t *handle)
+{
+	assert(heap);
+	assert(handle);
+
+
+	const VkResult err = vku_addBindlessSlot(heap, VKU_BINDLESS_TYPE_STORAGE_BUFFER, handle);
+
+	if (err)
+		return err;
+
+
+	vku_bindless_table *table = &heap->tables[VKU_BINDLESS_TYPE_STORAGE_BUFFER];
+
+	table->bufferInfos[*handle].buffer = buffer;
+	table->bufferInfos[*handle].offset = offset;
+	table->bufferInfos[*handle].range = range;
+
+	vku_markBindlessSlot(heap, table, *handle);
+
+	return VK_SUCCESS;
+}
+
+VKUAPI_ATTR VkResult vkuAddBindlessSampler(VkuBindlessHeap heap, VkSampler sampler, uint32_t *handle)
+{
+	assert(heap);
+	assert(handle);
+
+
+	const VkResult err = vku_addBindlessSlot(heap, VKU_BINDLESS_TYPE_SAMPLER, handle);
+
+	if (err)
+		return err;
+
+
+	vku_bindless_table *table = &heap->tables[VKU_BINDLESS_TYPE_SAMPLER];
+
+	table->imageInfos[*handle].sampler = sampler;
+	table->imageInfos[*handle].imageView = VK_NULL_HANDLE;
+	table->imageInfos[*handle].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	vku_markBindlessSlot(heap, table, *handle);
+
+	return VK_SUCCESS;
+}
+
+// The handle is reused once the current frame begins again, so
+// it must not be used by commands recorded after this
+VKUAPI_ATTR void vkuRemoveBindless(VkuBindlessHeap heap, VkuBindlessType type, uint32_t handle)
+{
+	assert(heap);
+	assert(type < VKU_BINDLESS_TYPE_COUNT);
+	assert(handle < heap->tables[type].capacity);
+
+
+	vku_bindless_table *table = &heap->tables[type];
+
+	vku_pushBindlessSlots(&table->retiredHeads[heap->frameIndex], table->nextSlots, handle, handle);
+
+	vku_atomicAdd32(&table->slotCount, (uint32_t) -1);
+}
+
+
+// Adds a VkWriteDescriptorSet for the slots from firstSlot to lastSlot
+static void vku_addBindlessWrite(VkuBindlessHeap heap, uint32_t *writeCount, VkDescriptorSet set, vku_bindless_table *table, uint32_t firstSlot, uint32_t lastSlot)
+{
+	VkWriteDescriptorSet *write = &heap->writes[(*writeCount)++];
+	memset(write, 0, sizeof(VkWriteDescriptorSet));
+
+	write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write->dstSet = set;
+	write->dstBinding = 0;
+	write->dstArrayElement = firstSlot;
+	write->descriptorCount = lastSlot - firstSlot + 1;
+	write->descriptorType = table->descriptorType;
+
+	// The descriptors of consecutive slots are already next to each other
+	if (table->bufferInfos)
+		write->pBufferInfo = table->bufferInfos + firstSlot;
+	else
+		write->pImageInfo = table->imageInfos + firstSlot;
+}
+
+// Writes the slots added since the last flush to the current frame's sets, using a single
+// vkUpdateDescriptorSets() with a VkWriteDescriptorSet for each run of consecutive slots.
+// With descriptor indexing it can be called any time before submitting, otherwise it has
+// to be called before the sets are bound. It can be called while adding and removing.
+VKUAPI_ATTR void vkuFlushBindlessHeap(VkuBindlessHeap heap)
+{
+	assert(heap);
+
+
+	const uint32_t setIndex = heap->descriptorIndexing ? 0 : heap->frameIndex;
+
+	uint32_t writeCount = 0;
+	uint64_t descriptorCount = 0;
+
+	for (uint32_t type = 0; type < VKU_BINDLESS_TYPE_COUNT; type++)
+	{
+		vku_bindless_table *table = &heap->tables[type];
+
+		const VkDescriptorSet set = heap->sets[setIndex * VKU_BINDLESS_TYPE_COUNT + type];
+		volatile uint32_t *dirtyWords = table->dirtyWords + setIndex * table->dirtyWordCount;
+
+		uint32_t firstSlot = VKU_BINDLESS_NO_SLOT;
+
+		for (uint32_t wordIndex = 0; wordIndex < table->dirtyWordCount; wordIndex++)
+		{
+			const uint32_t dirtyBits = vku_atomicAnd32(&dirtyWords[wordIndex], 0);
+
+			if ((dirtyBits == 0) && (firstSlot == VKU_BINDLESS_NO_SLOT))
+				continue;
+
+			for (uint32_t bit = 0; bit < 32; bit++)
+			{
+				const uint32_t slot = wordIndex * 32 + bit;
+
+				if (dirtyBits & (1u << bit))
+				{
+					if (firstSlot == VKU_BINDLESS_NO_SLOT)
+						firstSlot = slot;
+				}
+				else if (firstSlot != VKU_BINDLESS_NO_SLOT)
+				{
+					vku_addBindlessWrite(heap, &writeCount, set, table, firstSlot, slot - 1);
+
+					descriptorCount += slot - firstSlot;
+					firstSlot = VKU_BINDLESS_NO_SLOT;
+				}
+			}
+		}
+
+		if (firstSlot != VKU_BINDLESS_NO_SLOT)
+		{
+			vku_addBindlessWrite(heap, &writeCount, set, table, firstSlot, table->capacity - 1);
+
+			descriptorCount += table->capacity - firstSlot;
+		}
+	}
+
+
+	if (writeCount > 0)
+	{
+		vkUpdateDescriptorSets(heap->device, writeCount, heap->writes, 0, NULL);
+
+		heap->updateCount++;
+		heap->writeCount += writeCount;
+		heap->descriptorCount += descriptorCount;
+	}
+}
+
+
+// Makes frameIndex the current frame, reuses the slots removed the last time the frame was current,
+// and flushes the heap. The frame's previous submission must have completed, and no other thread
+// may add or remove while this is called.
+VKUAPI_ATTR void vkuBeginBindlessHeapFrame(VkuBindlessHeap heap, uint32_t frameIndex)
+{
+	assert(heap);
+	assert(frameIndex < heap->frameCount);
+
+
+	for (uint32_t type = 0; type < VKU_BINDLESS_TYPE_COUNT; type++)
+	{
+		vku_bindless_table *table = &heap->tables[type];
+
+		const uint32_t firstSlot = (uint32_t) table->retiredHeads[frameIndex];
+
+		if (firstSlot == VKU_BINDLESS_NO_SLOT)
+			continue;
+
+		table->retiredHeads[frameIndex] = VKU_BINDLESS_NO_SLOT;
+
+
+		uint32_t lastSlot = firstSlot;
+
+		for (;;)
+		{
+			if (!heap->descriptorIndexing)
+				vku_setBindlessSlotToDefault(heap, (VkuBindlessType) type, lastSlot);
+
+			if (table->nextSlots[lastSlot] == VKU_BINDLESS_NO_SLOT)
+				break;
+
+			lastSlot = table->nextSlots[lastSlot];
+		}
+
+		vku_pushBindlessSlots(&table->freeHead, table->nextSlots, firstSlot, lastSlot);
+	}
+
+
+	heap->frameIndex = frameIndex;
+
+	vkuFlushBindlessHeap(heap);
+}
+
+
+// The layouts are in the order of VkuBindlessType, for creating the VkPipelineLayout
+VKUAPI_ATTR void vkuGetBindlessDescriptorSetLayouts(VkuBindlessHeap heap, VkDescriptorSetLayout layouts[VKU_BINDLESS_TYPE_COUNT])
+{
+	assert(heap);
+	assert(layouts);
+
+	for (uint32_t type = 0; type < VKU_BINDLESS_TYPE_COUNT; type++)
+		layouts[type] = heap->tables[type].layout;
+}
+
+// Binds the current frame's sets at firstSet and the following sets, in the order of VkuBindlessType
+VKUAPI_ATTR void vkuCmdBindBindlessHeap(VkuBindlessHeap heap, VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet)
+{
+	assert(heap);
+	assert(commandBuffer);
+
+
+	const uint32_t setIndex = heap->descriptorIndexing ? 0 : heap->frameIndex;
+
+	vkCmdBindDescriptorSets(commandBuffer, pipelineBindPoint, layout, firstSet, VKU_BINDLESS_TYPE_COUNT, heap->sets + setIndex * VKU_BINDLESS_TYPE_COUNT, 0, NULL);
+}
+
+
+VKUAPI_ATTR void vkuGetBindlessHeapStatistics(VkuBindlessHeap heap, VkuBindlessHeapStatistics *statistics)
+{
+	assert(heap);
+	assert(statistics);
+
+
+	statistics->descriptorIndexing = heap->descriptorIndexing;
+
+	for (uint32_t type = 0; type < VKU_BINDLESS_TYPE_COUNT; type++)
+	{
+		statistics->capacities[type] = heap->tables[type].capacity;
+		statistics->slotCounts[type] = heap->tables[type].slotCount;
+	}
+
+	statistics->updateCount = heap->updateCount;
+	statistics->writeCount = heap->writeCount;
+	statistics->descriptorCount = heap->descriptorCount;
+}
+
+
+typedef struct VkuFrameSync_T* VkuFrameSync;
+
+
+// Called when a frame's deferred destruction is due
+typedef void (VKAPI_PTR *PFN_vkuDeferredDestroy)(void *pUserData);
+
+
+typedef struct VkuFrameSyncCreateInfo
+{
+	VkDevice device;
+
+	// The amount of frames in flight
+	uint32_t frameCount;
+
+	// VK_TRUE to wait for the frames with a single timeline semaphore, for which the device must have been
+	// created with the Vulkan 1.2 timelineSemaphore feature. Otherwise there's a fence for each frame.
+	VkBool32 timelineSemaphore;
+
+	const VkAllocationCallbacks *pAllocator;
+} VkuFrameSyncCreateInfo;
+
+
+typedef struct VkuFrameSyncStatistics
+{
+	VkBool32 timelineSemaphore;
+
+	uint64_t frameCount;
+
+	// The fences and semaphores created for the pools
+	uint32_t fenceCount;
+	uint32_t semaphoreCount;
+
+	uint64_t deferredDestroyCount;
+
+	// Waiting for a frame's previous submissions in vkuBeginFrame(), where a stall is a wait
+	// that actually blocked. The times are in nanoseconds.
+	uint64_t waitCount;
+	uint64_t stallCount;
+	uint64_t waitTime;
+	uint64_t lastWaitTime;
+	uint64_t maxWaitTime;
+} VkuFrameSyncStatistics;
+
+
+typedef enum vku_deferred_type
+{
+	VKU_DEFERRED_TYPE_CALLBACK = 0,
+	VKU_DEFERRED_TYPE_BUFFER = 1,
+	VKU_DEFERRED_TYPE_IMAGE = 2,
+	VKU_DEFERRED_TYPE_IMAGE_VIEW = 3,
+	VKU_DEFERRED_TYPE_MEMORY = 4
+} vku_deferred_type;
+
+typedef struct vku_deferred_destroy
+{
+	vku_deferred_type type;
+
+	union
+	{
+		struct
+		{
+			PFN_vkuDeferredDestroy pfnDestroy;
+			void *pUserData;
+		} callback;
+
+		VkBuffer buffer;
+		VkImage image;
+		VkImageView imageView;
+
+		struct
+		{
+			VkuAllocator allocator;
+			VkuAllocation allocation;
+		} memory;
+	} object;
+} vku_deferred_destroy;
+
+
+typedef struct vku_sync_frame
+{
+	// Signaled by vkuSignalFrame(), either the fence or the timeline value
+	VkBool32 pending;
+	VkFence fence;
+	uint64_t timelineValue;
+
+	// The pooled fences and semaphores acquired during the frame
+	uint32_t fenceCount, fenceCapacity;
+	VkFence *fences;
+
+	uint32_t semaphoreCount, semaphoreCapacity;
+	VkSemaphore *semaphores;
+
+	uint32_t deferredCount, deferredCapacity;
+	vku_deferred_destroy *deferred;
+} vku_sync_frame;
+
+
+struct VkuFrameSync_T
+{
+	VkDevice device;
+	const VkAllocationCallbacks *pAllocator;
+
+	VkBool32 timelineSemaphore;
+	VkSemaphore timeline;
+	uint64_t timelineValue;
+
+	uint32_t frameCount;
+	uint32_t frameIndex;
+	vku_sync_frame *frames;
+
+	// Guards the pools and the frames' lists, which are used from any thread
+	vku_mutex mutex;
+
+	uint32_t freeFenceCount, freeFenceCapacity;
+	VkFence *freeFences;
+
+	uint32_t freeSemaphoreCount, freeSemaphoreCapacity;
+	VkSemaphore *freeSemaphores;
+
+	VkuFrameSyncStatistics statistics;
+};
+
+
+// Makes room for one more element in an array that grows by doubling
+static VkBool32 vku_reserveArray(void **elements, uint32_t count, uint32_t *capacity, size_t elementSize)
+{
+	if (count < (*capacity))
+		return VK_TRUE;
+
+	const uint32_t newCapacity = (*capacity) ? ((*capacity) * 2) : 16;
+
+	void *newElements = VKU_REALLOC(*elements, newCapacity * elementSize);
+
+	if (!newElements)
+		return VK_FALSE;
+
+	(*elements) = newElements;
+	(*capacity) = newCapacity;
+
+	return VK_TRUE;
+}
+
+
+static void vku_runDeferredDestroy(VkuFrameSync sync, const vku_deferred_destroy *deferred)
+{
+	switch (deferred->type)
+	{
+		case VKU_DEFERRED_TYPE_CALLBACK:
+			deferred->object.callback.pfnDestroy(deferred->object.callback.pUserData);
+			break;
+
+		case VKU_DEFERRED_TYPE_BUFFER:
+			vkDestroyBuffer(sync->device, deferred->object.buffer, sync->pAllocator);
+			break;
+
+		case VKU_DEFERRED_TYPE_IMAGE:
+			vkDestroyImage(sync->device, deferred->object.image, sync->pAllocator);
+			break;
+
+		case VKU_DEFERRED_TYPE_IMAGE_VIEW:
+			vkDestroyImageView(sync->device, deferred->object.imageView, sync->pAllocator);
+			break;
+
+		case VKU_DEFERRED_TYPE_MEMORY:
+			vkuFreeMemory(deferred->object.memory.allocator, deferred->object.memory.allocation);
+			break;
+	}
+}
+
+// Runs the frame's deferred destruction, and returns its fences and semaphores to the pools
+static VkResult vku_recycleSyncFrame(VkuFrameSync sync, vku_sync_frame *frame)
+{
+	VkResult err = VK_SUCCESS;
+
+	vku_lockMutex(&sync->mutex);
+
+	// Take the deferred destruction, such that it runs unlocked, and the callbacks can use the frame sync
+	vku_deferred_destroy *deferred = frame->deferred;
+	uint32_t deferredCount = frame->deferredCount;
+	uint32_t deferredCapacity = frame->deferredCapacity;
+
+	frame->deferred = NULL;
+	frame->deferredCount = 0;
+	frame->deferredCapacity = 0;
+
+	sync->statistics.deferredDestroyCount += deferredCount;
+
+
+	// The pools have room for every fence and semaphore that was ever created
+	if (frame->fenceCount > 0)
+	{
+		err = vkResetFences(sync->device, frame->fenceCount, frame->fences);
+
+		memcpy(sync->freeFences + sync->freeFenceCount, frame->fences, frame->fenceCount * sizeof(VkFence));
+
+		sync->freeFenceCount += frame->fenceCount;
+		frame->fenceCount = 0;
+	}
+
+	if (frame->semaphoreCount > 0)
+	{
+		memcpy(sync->freeSemaphores + sync->freeSemaphoreCount, frame->semaphores, frame->semaphoreCount * sizeof(VkSemaphore));
+
+		sync->freeSemaphoreCount += frame->semaphoreCount;
+		frame->semaphoreCount = 0;
+	}
+
+	vku_unlockMutex(&sync->mutex);
+
+
+	for (uint32_t i = 0; i < deferredCount; i++)
+		vku_runDeferredDestroy(sync, &deferred[i]);
+
+
+	// Give the array back to the frame, unless a callback deferred more
+	vku_lockMutex(&sync->mutex);
+
+	if (!frame->deferred)
+	{
+		frame->deferred = deferred;
+		frame->deferredCapacity = deferredCapacity;
+
+		deferred = NULL;
+	}
+
+	vku_unlockMutex(&sync->mutex);
+
+	VKU_FREE(deferred);
+
+	return err;
+}
+
+
+VKUAPI_ATTR void vkuDestroyFrameSync(VkuFrameSync sync);
+
+VKUAPI_ATTR VkResult vkuCreateFrameSync(const VkuFrameSyncCreateInfo *createInfo, VkuFrameSync *sync)
+{
+	assert(createInfo);
+	assert(createInfo->device);
+	assert(createInfo->frameCount > 0);
+	assert(sync);
+
+
+	(*sync) = (VkuFrameSync) VKU_CALLOC(1, sizeof(struct VkuFrameSync_T));
+
+	if (!(*sync))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*sync)->device = createInfo->device;
+	(*sync)->pAllocator = createInfo->pAllocator;
+	(*sync)->frameCount = createInfo->frameCount;
+
+	// The first vkuBeginFrame() begins frame 0
+	(*sync)->frameIndex = createInfo->frameCount - 1;
+
+	vku_initMutex(&(*sync)->mutex);
+
+	(*sync)->frames = (vku_sync_frame*) VKU_CALLOC(createInfo->frameCount, sizeof(vku_sync_frame));
+
+	if (!(*sync)->frames)
+	{
+		vkuDestroyFrameSync(*sync);
+		(*sync) = NULL;
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+
+	VkResult err = VK_SUCCESS;
+
+#ifdef VK_VERSION_1_2
+	if (createInfo->timelineSemaphore)
+	{
+		VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo;
+		memset(&semaphoreTypeCreateInfo, 0, sizeof(semaphoreTypeCreateInfo));
+
+		semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		semaphoreTypeCreateInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo;
+		memset(&semaphoreCreateInfo, 0, sizeof(semaphoreCreateInfo));
+
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+		err = vkCreateSemaphore(createInfo->device, &semaphoreCreateInfo, createInfo->pAllocator, &(*sync)->timeline);
+
+		(*sync)->timelineSemaphore = VK_TRUE;
+	}
+#endif
+
+	if (!(*sync)->timelineSemaphore)
+	{
+		VkFenceCreateInfo fenceCreateInfo;
+		memset(&fenceCreateInfo, 0, sizeof(fenceCreateInfo));
+
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		for (uint32_t frameIndex = 0; !err && (frameIndex < createInfo->frameCount); frameIndex++)
+			err = vkCreateFence(createInfo->device, &fenceCreateInfo, createInfo->pAllocator, &(*sync)->frames[frameIndex].fence);
+	}
+
+
+	if (err)
+	{
+		vkuDestroyFrameSync(*sync);
+		(*sync) = NULL;
+
+		return err;
+	}
+
+
+	(*sync)->statistics.timelineSemaphore = (*sync)->timelineSemaphore;
+
+	return VK_SUCCESS;
+}
+
+// Runs the remaining deferred destruction, so the device must be idle
+VKUAPI_ATTR void vkuDestroyFrameSync(VkuFrameSync sync)
+{
+	if (!sync)
+		return;
+
+
+	for (uint32_t frameIndex = 0; sync->frames && (frameIndex < sync->frameCount); frameIndex++)
+	{
+		vku_sync_frame *frame = &sync->frames[frameIndex];
+
+		for (uint32_t i = 0; i < frame->deferredCount; i++)
+			vku_runDeferredDestroy(sync, &frame->deferred[i]);
+
+		for (uint32_t i = 0; i < frame->fenceCount; i++)
+			vkDestroyFence(sync->device, frame->fences[i], sync->pAllocator);
+
+		for (uint32_t i = 0; i < frame->semaphoreCount; i++)
+			vkDestroySemaphore(sync->device, frame->semaphores[i], sync->pAllocator);
+
+		if (frame->fence != VK_NULL_HANDLE)
+			vkDestroyFence(sync->device, frame->fence, sync->pAllocator);
+
+		VKU_FREE(frame->fences);
+		VKU_FREE(frame->semaphores);
+		VKU_FREE(frame->deferred);
+	}
+
+	for (uint32_t i = 0; i < sync->freeFenceCount; i++)
+		vkDestroyFence(sync->device, sync->freeFences[i], sync->pAllocator);
+
+	for (uint32_t i = 0; i < sync->freeSemaphoreCount; i++)
+		vkDestroySemaphore(sync->device, sync->freeSemaphores[i], sync->pAllocator);
+
+	if (sync->timeline != VK_NULL_HANDLE)
+		vkDestroySemaphore(sync->device, sync->timeline, sync->pAllocator);
+
+	vku_destroyMutex(&sync->mutex);
+
+	VKU_FREE(sync->frames);
+	VKU_FREE(sync->freeFences);
+	VKU_FREE(sync->freeSemaphores);
+	VKU_FREE(sync);
+}
+
+
+// Waits for the frame's previous submissions
+static VkResult vku_waitSyncFrame(VkuFrameSync sync, vku_sync_frame *frame)
+{
+	VkResult err;
+	VkBool32 stalled = VK_FALSE;
+
+	const uint64_t startTime = vku_getTime();
+
+#ifdef VK_VERSION_1_2
+	if (sync->timelineSemaphore)
+	{
+		uint64_t value;
+
+		err = vkGetSemaphoreCounterValue(sync->device, sync->timeline, &value);
+
+		if (!err && (value < frame->timelineValue))
+		{
+			VkSemaphoreWaitInfo waitInfo;
+			memset(&waitInfo, 0, sizeof(waitInfo));
+
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &sync->timeline;
+			waitInfo.pValues = &frame->timelineValue;
+
+			stalled = VK_TRUE;
+
+			err = vkWaitSemaphores(sync->device, &waitInfo, UINT64_MAX);
+		}
+	}
+	else
+#endif
+	{
+		err = vkGetFenceStatus(sync->device, frame->fence);
+
+		if (err == VK_NOT_READY)
+		{
+			stalled = VK_TRUE;
+
+			err = vkWaitForFences(sync->device, 1, &frame->fence, VK_TRUE, UINT64_MAX);
+		}
+
+		if (!err)
+			err = vkResetFences(sync->device, 1, &frame->fence);
+	}
+
+	const uint64_t waitTime = vku_getTime() - startTime;
+
+	vku_lockMutex(&sync->mutex);
+
+	sync->statistics.waitCount++;
+	sync->statistics.stallCount += stalled ? 1 : 0;
+	sync->statistics.waitTime += waitTime;
+	sync->statistics.lastWaitTime = waitTime;
+
+	if (waitTime > sync->statistics.maxWaitTime)
+		sync->statistics.maxWaitTime = waitTime;
+
+	vku_unlockMutex(&sync->mutex);
+
+	return err;
+}
+
+// Begins the next frame, and returns its index for the other per-frame objects. Waits for the
+// frame's previous submissions (if vkuSignalFrame() was called for them), then runs its deferred
+// destruction and recycles its fences and semaphores. Only one thread may begin and signal frames.
+VKUAPI_ATTR VkResult vkuBeginFrame(VkuFrameSync sync, uint32_t *frameIndex)
+{
+	assert(sync);
+	assert(frameIndex);
+
+
+	const uint32_t nextFrameIndex = (sync->frameIndex + 1) % sync->frameCount;
+
+	vku_sync_frame *frame = &sync->frames[nextFrameIndex];
+
+	VkResult err;
+
+	if (frame->pending)
+	{
+		err = vku_waitSyncFrame(sync, frame);
+
+		if (err)
+			return err;
+
+		frame->pending = VK_FALSE;
+	}
+
+	err = vku_recycleSyncFrame(sync, frame);
+
+	if (err)
+		return err;
+
+
+	vku_lockMutex(&sync->mutex);
+
+	sync->frameIndex = nextFrameIndex;
+	sync->statistics.frameCount++;
+
+	vku_unlockMutex(&sync->mutex);
+
+	(*frameIndex) = nextFrameIndex;
+
+	return VK_SUCCESS;
+}
+
+// Signals the current frame once all the work submitted to the queue so far has completed, with an empty
+// submission that signals the frame's fence or the next timeline value. Call it once per frame after the
+// frame's last submission. With several queues, use the queue that waits for the others.
+VKUAPI_ATTR VkResult vkuSignalFrame(VkuFrameSync sync, VkQueue queue)
+{
+	assert(sync);
+	assert(queue);
+
+
+	vku_sync_frame *frame = &sync->frames[sync->frameIndex];
+
+	assert(!frame->pending);
+
+	VkResult err;
+
+#ifdef VK_VERSION_1_2
+	if (sync->timelineSemaphore)
+	{
+		const uint64_t timelineValue = sync->timelineValue + 1;
+
+		VkTimelineSemaphoreSubmitInfo timelineSubmitInfo;
+		memset(&timelineSubmitInfo, 0, sizeof(timelineSubmitInfo));
+
+		timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineSubmitInfo.signalSemaphoreValueCount = 1;
+		timelineSubmitInfo.pSignalSemaphoreValues = &timelineValue;
+
+		VkSubmitInfo submitInfo;
+		memset(&submitInfo, 0, sizeof(submitInfo));
+
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineSubmitInfo;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &sync->timeline;
+
+		err = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+
+		if (err)
+			return err;
+
+		sync->timelineValue = timelineValue;
+		frame->timelineValue = timelineValue;
+	}
+	else
+#endif
+	{
+		err = vkQueueSubmit(queue, 0, NULL, frame->fence);
+
+		if (err)
+			return err;
+	}
+
+	frame->pending = VK_TRUE;
+
+	return VK_SUCCESS;
+}
+
+
+// Gets an unsignaled fence, which is reset and reused once the current frame begins again.
+// It must be submitted during the frame, and can be used from any thread.
+VKUAPI_ATTR VkResult vkuAcquireFence(VkuFrameSync sync, VkFence *fence)
+{
+	assert(sync);
+	assert(fence);
+
+
+	VkResult err = VK_SUCCESS;
+
+	vku_lockMutex(&sync->mutex);
+
+	vku_sync_frame *frame = &sync->frames[sync->frameIndex];
+
+	if (!vku_reserveArray((void**) &frame->fences, frame->fenceCount, &frame->fenceCapacity, sizeof(VkFence)))
+		err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	else if (sync->freeFenceCount > 0)
+		(*fence) = sync->freeFences[--sync->freeFenceCount];
+	else if (!vku_reserveArray((void**) &sync->freeFences, sync->statistics.fenceCount, &sync->freeFenceCapacity, sizeof(VkFence)))
+		err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	else
+	{
+		VkFenceCreateInfo fenceCreateInfo;
+		memset(&fenceCreateInfo, 0, sizeof(fenceCreateInfo));
+
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		err = vkCreateFence(sync->device, &fenceCreateInfo, sync->pAllocator, fence);
+
+		if (!err)
+			sync->statistics.fenceCount++;
+	}
+
+	if (!err)
+		frame->fences[frame->fenceCount++] = (*fence);
+
+	vku_unlockMutex(&sync->mutex);
+
+	return err;
+}
+
+// Gets a binary semaphore, which is reused once the current frame begins again.
+// Its signal and wait must both be submitted during the frame, and it can be used from any thread.
+VKUAPI_ATTR VkResult vkuAcquireSemaphore(VkuFrameSync sync, VkSemaphore *semaphore)
+{
+	assert(sync);
+	assert(semaphore);
+
+
+	VkResult err = VK_SUCCESS;
+
+	vku_lockMutex(&sync->mutex);
+
+	vku_sync_frame *frame = &sync->frames[sync->frameIndex];
+
+	if (!vku_reserveArray((void**) &frame->semaphores, frame->semaphoreCount, &frame->semaphoreCapacity, sizeof(VkSemaphore)))
+		err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	else if (sync->freeSemaphoreCount > 0)
+		(*semaphore) = sync->freeSemaphores[--sync->freeSemaphoreCount];
+	else if (!vku_reserveArray((void**) &sync->freeSemaphores, sync->statistics.semaphoreCount, &sync->freeSemaphoreCapacity, sizeof(VkSemaphore)))
+		err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	else
+	{
+		VkSemaphoreCreateInfo semaphoreCreateInfo;
+		memset(&semaphoreCreateInfo, 0, sizeof(semaphoreCreateInfo));
+
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		err = vkCreateSemaphore(sync->device, &semaphoreCreateInfo, sync->pAllocator, semaphore);
+
+		if (!err)
+			sync->statistics.semaphoreCount++;
+	}
+
+	if (!err)
+		frame->semaphores[frame->semaphoreCount++] = (*semaphore);
+
+	vku_unlockMutex(&sync->mutex);
+
+	return err;
+}
+
+
+static VkResult vku_deferDestroy(VkuFrameSync sync, const vku_deferred_destroy *deferred)
+{
+	VkResult err = VK_SUCCESS;
+
+	vku_lockMutex(&sync->mutex);
+
+	vku_sync_frame *frame = &sync->frames[sync->frameIndex];
+
+	if (vku_reserveArray((void**) &frame->deferred, frame->deferredCount, &frame->deferredCapacity, sizeof(vku_deferred_destroy)))
+		frame->deferred[frame->deferredCount++] = (*deferred);
+	else
+		err = VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	vku_unlockMutex(&sync->mutex);
+
+	return err;
+}
+
+// Calls pfnDestroy once the current frame's submissions have completed, that is when the
+// current frame begins again. The deferring functions can be used from any thread.
+VKUAPI_ATTR VkResult vkuDeferDestruction(VkuFrameSync sync, PFN_vkuDeferredDestroy pfnDestroy, void *pUserData)
+{
+	assert(sync);
+	assert(pfnDestroy);
+
+	vku_deferred_destroy deferred;
+	memset(&deferred, 0, sizeof(deferred));
+
+	deferred.type = VKU_DEFERRED_TYPE_CALLBACK;
+	deferred.object.callback.pfnDestroy = pfnDestroy;
+	deferred.object.callback.pUserData = pUserData;
+
+	return vku_deferDestroy(sync, &deferred);
+}
+
+// The buffer, image and image view are destroyed with the frame sync's pAllocator
+VKUAPI_ATTR VkResult vkuDeferDestroyBuffer(VkuFrameSync sync, VkBuffer buffer)
+{
+	assert(sync);
+
+	vku_deferred_destroy deferred;
+	memset(&deferred, 0, sizeof(deferred));
+
+	deferred.type = VKU_DEFERRED_TYPE_BUFFER;
+	deferred.object.buffer = buffer;
+
+	return vku_deferDestroy(sync, &deferred);
+}
+
+VKUAPI_ATTR VkResult vkuDeferDestroyImage(VkuFrameSync sync, VkImage image)
+{
+	assert(sync);
+
+	vku_deferred_destroy deferred;
+	memset(&deferred, 0, sizeof(deferred));
+
+	deferred.type = VKU_DEFERRED_TYPE_IMAGE;
+	deferred.object.image = image;
+
+	return vku_deferDestroy(sync, &deferred);
+}
+
+VKUAPI_ATTR VkResult vkuDeferDestroyImageView(VkuFrameSync sync, VkImageView imageView)
+{
+	assert(sync);
+
+	vku_deferred_destroy deferred;
+	memset(&deferred, 0, sizeof(deferred));
+
+	deferred.type = VKU_DEFERRED_TYPE_IMAGE_VIEW;
+	deferred.object.imageView = imageView;
+
+	return vku_deferDestroy(sync, &deferred);
+}
+
+// The allocation is freed with vkuFreeMemory()
+VKUAPI_ATTR VkResult vkuDeferFreeMemory(VkuFrameSync sync, VkuAllocator allocator, VkuAllocation allocation)
+{
+	assert(sync);
+	assert(allocator);
+
+	vku_deferred_destroy deferred;
+	memset(&deferred, 0, sizeof(deferred));
+
+	deferred.type = VKU_DEFERRED_TYPE_MEMORY;
+	deferred.object.memory.allocator = allocator;
+	deferred.object.memory.allocation = allocation;
+
+	return vku_deferDestroy(sync, &deferred);
+}
+
+
+VKUAPI_ATTR void vkuGetFrameSyncStatistics(VkuFrameSync sync, VkuFrameSyncStatistics *statistics)
+{
+	assert(sync);
+	assert(statistics);
+
+	vku_lockMutex(&sync->mutex);
+
+	(*statistics) = sync->statistics;
+
+	vku_unlockMutex(&sync->mutex);
+}
+
+
+// The default amount of zones each frame can record
+#define VKU_DEFAULT_PROFILER_ZONES 256
+
+// The amount of recent samples of each zone kept for the percentiles
+#define VKU_PROFILER_SAMPLE_COUNT 256
+
+// The amount of recent zones kept for vkuWriteProfilerTrace()
+#define VKU_PROFILER_TRACE_CAPACITY 65536
+
+#define VKU_PROFILER_MAX_DEPTH 32
+
+
+typedef struct VkuProfiler_T* VkuProfiler;
+
+
+typedef struct VkuProfilerCreateInfo
+{
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	// The queue family the command buffers are submitted to, which must support timestamps
+	uint32_t queueFamilyIndex;
+
+	// The amount of frames in flight, each frame has its own VkQueryPool
+	uint32_t frameCount;
+
+	// 0 means VKU_DEFAULT_PROFILER_ZONES
+	uint32_t maxZonesPerFrame;
+
+	const VkAllocationCallbacks *pAllocator;
+} VkuProfilerCreateInfo;
+
+
+// The times are in nanoseconds, of the last VKU_PROFILER_SAMPLE_COUNT samples,
+// except for count, which is the amount of times the zone was ever recorded.
+typedef struct VkuProfilerZoneStatistics
+{
+	const char *pName;
+
+	uint64_t count;
+
+	uint64_t lastTime;
+	uint64_t minTime;
+	uint64_t avgTime;
+	uint64_t p99Time;
+	uint64_t maxTime;
+} VkuProfilerZoneStatistics;
+
+
+typedef struct VkuProfilerStatistics
+{
+	// The frames whose results were read back, and those that weren't available yet and were dropped
+	uint64_t resolvedFrameCount;
+	uint64_t droppedFrameCount;
+
+	// The zones that didn't fit in their frame's query pool
+	uint64_t overflowZoneCount;
+
+	uint32_t zoneNameCount;
+} VkuProfilerStatistics;
+
+
+typedef struct vku_profiler_zone_name
+{
+	char *pName;
+	uint32_t hash;
+
+	uint64_t count;
+
+	// The ring of recent samples
+	uint32_t sampleCount;
+	uint32_t nextSample;
+	uint64_t samples[VKU_PROFILER_SAMPLE_COUNT];
+} vku_profiler_zone_name;
+
+
+// A zone recorded into a frame, its timestamps are queries 2 * zoneIndex and 2 * zoneIndex + 1
+typedef struct vku_profiler_zone
+{
+	uint32_t nameIndex;
+	uint32_t depth;
+} vku_profiler_zone;
+
+
+typedef struct vku_profiler_trace_event
+{
+	uint32_t nameIndex;
+	uint32_t depth;
+	uint64_t startTime;
+	uint64_t duration;
+} vku_profiler_trace_event;
+
+
+typedef struct vku_profiler_frame
+{
+	VkQueryPool queryPool;
+
+	VkBool32 recorded;
+	uint32_t zoneCount;
+	vku_profiler_zone *zones;
+} vku_profiler_frame;
+
+
+struct VkuProfiler_T
+{
+	VkDevice device;
+	const VkAllocationCallbacks *pAllocator;
+
+	// Converts timestamp ticks to nanoseconds
+	double timestampPeriod;
+	uint64_t timestampMask;
+
+	uint32_t maxZonesPerFrame;
+
+	uint32_t frameCount;
+	vku_profiler_frame *frames;
+	vku_profiler_frame *currentFrame;
+
+	// The zones that have begun but not ended in the current frame
+	uint32_t depth;
+	uint32_t openZones[VKU_PROFILER_MAX_DEPTH];
+
+	// The zone names, looked up with an open addressing hash table of indices
+	uint32_t nameCount, nameCapacity;
+	vku_profiler_zone_name *names;
+
+	uint32_t nameTableSize;
+	uint32_t *nameTable;
+
+	// Results read back from the query pools
+	uint64_t *timestamps;
+
+	// The first timestamp ever read back, which is time 0 of the trace
+	VkBool32 hasBaseTimestamp;
+	uint64_t baseTimestamp;
+
+	uint32_t traceCount;
+	uint32_t nextTraceEvent;
+	vku_profiler_trace_event *traceEvents;
+
+	VkuProfilerStatistics statistics;
+};
+
+
+VKUAPI_ATTR void vkuDestroyProfiler(VkuProfiler profiler);
+
+// Returns VK_ERROR_FEATURE_NOT_PRESENT if the queue family doesn't support timestamps
+VKUAPI_ATTR VkResult vkuCreateProfiler(const VkuProfilerCreateInfo *createInfo, VkuProfiler *profiler)
+{
+	assert(createInfo);
+	assert(createInfo->physicalDevice);
+	assert(createInfo->device);
+	assert(createInfo->frameCount > 0);
+	assert(profiler);
+
+
+	uint32_t queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(createInfo->physicalDevice, &queueFamilyCount, NULL);
+
+	if (createInfo->queueFamilyIndex >= queueFamilyCount)
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+
+	VkQueueFamilyProperties *queueFamilies = (VkQueueFamilyProperties*) VKU_MALLOC(queueFamilyCount * sizeof(VkQueueFamilyProperties));
+
+	if (!queueFamilies)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	vkGetPhysicalDeviceQueueFamilyProperties(createInfo->physicalDevice, &queueFamilyCount, queueFamilies);
+
+	const uint32_t timestampValidBits = queueFamilies[createInfo->queueFamilyIndex].timestampValidBits;
+
+	VKU_FREE(queueFamilies);
+
+	if (timestampValidBits == 0)
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(createInfo->physicalDevice, &properties);
+
+
+	(*profiler) = (VkuProfiler) VKU_CALLOC(1, sizeof(struct VkuProfiler_T));
+
+	if (!(*profiler))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*profiler)->device = createInfo->device;
+	(*profiler)->pAllocator = createInfo->pAllocator;
+	(*profiler)->timestampPeriod = (double) properties.limits.timestampPeriod;
+	(*profiler)->timestampMask = (timestampValidBits >= 64) ? UINT64_MAX : ((((uint64_t) 1) << timestampValidBits) - 1);
+	(*profiler)->maxZonesPerFrame = createInfo->maxZonesPerFrame ? createInfo->maxZonesPerFrame : VKU_DEFAULT_PROFILER_ZONES;
+	(*profiler)->frameCount = createInfo->frameCount;
+
+	(*profiler)->frames = (vku_profiler_frame*) VKU_CALLOC(createInfo->frameCount, sizeof(vku_profiler_frame));
+	(*profiler)->timestamps = (uint64_t*) VKU_MALLOC(2 * (*profiler)->maxZonesPerFrame * sizeof(uint64_t));
+	(*profiler)->traceEvents = (vku_profiler_trace_event*) VKU_MALLOC(VKU_PROFILER_TRACE_CAPACITY * sizeof(vku_profiler_trace_event));
+
+	if (!(*profiler)->frames || !(*profiler)->timestamps || !(*profiler)->traceEvents)
+	{
+		vkuDestroyProfiler(*profiler);
+		(*profiler) = NULL;
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo;
+	memset(&queryPoolCreateInfo, 0, sizeof(queryPoolCreateInfo));
+
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = 2 * (*profiler)->maxZonesPerFrame;
+
+	VkResult err = VK_SUCCESS;
+
+	for (uint32_t frameIndex = 0; !err && (frameIndex < createInfo->frameCount); frameIndex++)
+	{
+		vku_profiler_frame *frame = &(*profiler)->frames[frameIndex];
+
+		frame->zones = (vku_profiler_zone*) VKU_MALLOC((*profiler)->maxZonesPerFrame * sizeof(vku_profiler_zone));
+
+		if (!frame->zones)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+		else
+			err = vkCreateQueryPool(createInfo->device, &queryPoolCreateInfo, createInfo->pAllocator, &frame->queryPool);
+	}
+
+	if (err)
+	{
+		vkuDestroyProfiler(*profiler);
+		(*profiler) = NULL;
+
+		return err;
+	}
+
+
+	return VK_SUCCESS;
+}
+
+// None of the frames' command buffers may be pending
+VKUAPI_ATTR void vkuDestroyProfiler(VkuProfiler profiler)
+{
+	if (!profiler)
+		return;
+
+
+	for (uint32_t frameIndex = 0; profiler->frames && (frameIndex < profiler->frameCount); frameIndex++)
+	{
+		vku_profiler_frame *frame = &profiler->frames[frameIndex];
+
+		if (frame->queryPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(profiler->device, frame->queryPool, profiler->pAllocator);
+
+		VKU_FREE(frame->zones);
+	}
+
+	for (uint32_t nameIndex = 0; nameIndex < profiler->nameCount; nameIndex++)
+		VKU_FREE(profiler->names[nameIndex].pName);
+
+	VKU_FREE(profiler->frames);
+	VKU_FREE(profiler->names);
+	VKU_FREE(profiler->nameTable);
+	VKU_FREE(profiler->timestamps);
+	VKU_FREE(profiler->traceEvents);
+	VKU_FREE(profiler);
+}
+
+
+static VkBool32 vku_growProfilerNameTable(VkuProfiler profiler)
+{
+	const uint32_t tableSize = profiler->nameTableSize ? (profiler->nameTableSize * 2) : 64;
+
+	uint32_t *table = (uint32_t*) VKU_MALLOC(tableSize * sizeof(uint32_t));
+
+	if (!table)
+		return VK_FALSE;
+
+	for (uint32_t i = 0; i < tableSize; i++)
+		table[i] = UINT32_MAX;
+
+	for (uint32_t nameIndex = 0; nameIndex < profiler->nameCount; nameIndex++)
+	{
+		uint32_t i = profiler->names[nameIndex].hash & (tableSize - 1);
+
+		while (table[i] != UINT32_MAX)
+			i = (i + 1) & (tableSize - 1);
+
+		table[i] = nameIndex;
+	}
+
+	VKU_FREE(profiler->nameTable);
+
+	profiler->nameTable = table;
+	profiler->nameTableSize = tableSize;
+
+	return VK_TRUE;
+}
+
+// Finds or adds the name, returns UINT32_MAX if out of memory
+static uint32_t vku_getProfilerZoneName(VkuProfiler profiler, const char *pName)
+{
+	const size_t nameLength = strlen(pName);
+	const uint32_t hash = vku_hashBytes(2166136261u, pName, nameLength);
+
+	for (uint32_t i = hash & (profiler->nameTableSize - 1); profiler->nameTableSize > 0; i = (i + 1) & (profiler->nameTableSize - 1))
+	{
+		const uint32_t nameIndex = profiler->nameTable[i];
+
+		if (nameIndex == UINT32_MAX)
+			break;
+
+		if ((profiler->names[nameIndex].hash == hash) && (strcmp(profiler->names[nameIndex].pName, pName) == 0))
+			return nameIndex;
+	}
+
+
+	// Keep the table at most half full
+	if ((2 * (profiler->nameCount + 1)) > profiler->nameTableSize)
+	{
+		if (!vku_growProfilerNameTable(profiler))
+			return UINT32_MAX;
+	}
+
+	if (profiler->nameCount == profiler->nameCapacity)
+	{
+		const uint32_t nameCapacity = profiler->nameCapacity ? (profiler->nameCapacity * 2) : 16;
+
+		vku_profiler_zone_name *names = (vku_profiler_zone_name*) VKU_REALLOC(profiler->names, nameCapacity * sizeof(vku_profiler_zone_name));
+
+		if (!names)
+			return UINT32_MAX;
+
+		profiler->names = names;
+		profiler->nameCapacity = nameCapacity;
+	}
+
+
+	vku_profiler_zone_name *name = &profiler->names[profiler->nameCount];
+	memset(name, 0, sizeof(vku_profiler_zone_name));
+
+	name->pName = (char*) VKU_MALLOC(nameLength + 1);
+
+	if (!name->pName)
+		return UINT32_MAX;
+
+	memcpy(name->pName, pName, nameLength + 1);
+	name->hash = hash;
+
+	uint32_t i = hash & (profiler->nameTableSize - 1);
+
+	while (profiler->nameTable[i] != UINT32_MAX)
+		i = (i + 1) & (profiler->nameTableSize - 1);
+
+	profiler->nameTable[i] = profiler->nameCount;
+
+	profiler->statistics.zoneNameCount = profiler->nameCount + 1;
+
+	return profiler->nameCount++;
+}
+
+
+// Reads back the frame's timestamps, without waiting
+static void vku_resolveProfilerFrame(VkuProfiler profiler, vku_profiler_frame *frame)
+{
+	const VkResult err = vkGetQueryPoolResults(profiler->device, frame->queryPool, 0, 2 * frame->zoneCount,
+		2 * frame->zoneCount * sizeof(uint64_t), profiler->timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (err)
+	{
+		profiler->statistics.droppedFrameCount++;
+		return;
+	}
+
+	profiler->statistics.resolvedFrameCount++;
+
+
+	if (!profiler->hasBaseTimestamp)
+	{
+		profiler->baseTimestamp = profiler->timestamps[0];
+		profiler->hasBaseTimestamp = VK_TRUE;
+	}
+
+	for (uint32_t zoneIndex = 0; zoneIndex < frame->zoneCount; zoneIndex++)
+	{
+		const vku_profiler_zone *zone = &frame->zones[zoneIndex];
+
+		const uint64_t beginTicks = profiler->timestamps[2 * zoneIndex];
+		const uint64_t endTicks = profiler->timestamps[2 * zoneIndex + 1];
+
+		// The timestamps wrap around at timestampValidBits
+		const uint64_t duration = (uint64_t) ((double) ((endTicks - beginTicks) & profiler->timestampMask) * profiler->timestampPeriod);
+		const uint64_t startTime = (uint64_t) ((double) ((beginTicks - profiler->baseTimestamp) & profiler->timestampMask) * profiler->timestampPeriod);
+
+
+		vku_profiler_zone_name *name = &profiler->names[zone->nameIndex];
+
+		name->count++;
+		name->samples[name->nextSample] = duration;
+		name->nextSample = (name->nextSample + 1) % VKU_PROFILER_SAMPLE_COUNT;
+
+		if (name->sampleCount < VKU_PROFILER_SAMPLE_COUNT)
+			name->sampleCount++;
+
+
+		vku_profiler_trace_event *event = &profiler->traceEvents[profiler->nextTraceEvent];
+
+		event->nameIndex = zone->nameIndex;
+		event->depth = zone->depth;
+		event->startTime = startTime;
+		event->duration = duration;
+
+		profiler->nextTraceEvent = (profiler->nextTraceEvent + 1) % VKU_PROFILER_TRACE_CAPACITY;
+
+		if (profiler->traceCount < VKU_PROFILER_TRACE_CAPACITY)
+			profiler->traceCount++;
+	}
+}
+
+// Begins recording the frame's zones, into command buffers that are submitted after commandBuffer. The frame's
+// previous submissions must have completed, their results are read back now, frameCount frames after they were
+// recorded, so the GPU is never waited for. Resets the frame's query pool in commandBuffer, outside a render pass.
+VKUAPI_ATTR void vkuBeginProfilerFrame(VkuProfiler profiler, uint32_t frameIndex, VkCommandBuffer commandBuffer)
+{
+	assert(profiler);
+	assert(frameIndex < profiler->frameCount);
+	assert(commandBuffer);
+	assert(profiler->depth == 0);
+
+
+	vku_profiler_frame *frame = &profiler->frames[frameIndex];
+
+	if (frame->recorded && (frame->zoneCount > 0))
+		vku_resolveProfilerFrame(profiler, frame);
+
+	vkCmdResetQueryPool(commandBuffer, frame->queryPool, 0, 2 * profiler->maxZonesPerFrame);
+
+	frame->recorded = VK_TRUE;
+	frame->zoneCount = 0;
+
+	profiler->currentFrame = frame;
+}
+
+// Writes the zone's begin timestamp, zones can be nested, and the name is copied. Zones
+// that don't fit in the frame are dropped. The profiler is externally synchronized.
+VKUAPI_ATTR void vkuCmdBeginProfilerZone(VkuProfiler profiler, VkCommandBuffer commandBuffer, const char *pName)
+{
+	assert(profiler);
+	assert(profiler->currentFrame);
+	assert(commandBuffer);
+	assert(pName);
+	assert(profiler->depth < VKU_PROFILER_MAX_DEPTH);
+
+
+	vku_profiler_frame *frame = profiler->currentFrame;
+
+	const uint32_t nameIndex = (frame->zoneCount < profiler->maxZonesPerFrame) ? vku_getProfilerZoneName(profiler, pName) : UINT32_MAX;
+
+	if (nameIndex == UINT32_MAX)
+	{
+		profiler->statistics.overflowZoneCount++;
+		profiler->openZones[profiler->depth++] = UINT32_MAX;
+
+		return;
+	}
+
+
+	const uint32_t zoneIndex = frame->zoneCount++;
+
+	frame->zones[zoneIndex].nameIndex = nameIndex;
+	frame->zones[zoneIndex].depth = profiler->depth;
+
+	profiler->openZones[profiler->depth++] = zoneIndex;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame->queryPool, 2 * zoneIndex);
+}
+
+// Writes the end timestamp of the innermost zone, in the same or a later command buffer
+VKUAPI_ATTR void vkuCmdEndProfilerZone(VkuProfiler profiler, VkCommandBuffer commandBuffer)
+{
+	assert(profiler);
+	assert(profiler->currentFrame);
+	assert(commandBuffer);
+	assert(profiler->depth > 0);
+
+
+	const uint32_t zoneIndex = profiler->openZones[--profiler->depth];
+
+	if (zoneIndex != UINT32_MAX)
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, profiler->currentFrame->queryPool, 2 * zoneIndex + 1);
+}
+
+
+static int vku_compareUint64(const void *a, const void *b)
+{
+	const uint64_t valueA = *((const uint64_t*) a);
+	const uint64_t valueB = *((const uint64_t*) b);
+
+	return (valueA < valueB) ? -1 : ((valueA > valueB) ? 1 : 0);
+}
+
+// Gets the statistics of each zone name, in the order the names were first recorded. If pZoneStatistics is NULL, then
+// the amount of zones is returned in pZoneCount, otherwise pZoneCount is the amount of elements in pZoneStatistics.
+// The names are valid until the profiler is destroyed.
+VKUAPI_ATTR void vkuGetProfilerZoneStatistics(VkuProfiler profiler, uint32_t *pZoneCount, VkuProfilerZoneStatistics *pZoneStatistics)
+{
+	assert(profiler);
+	assert(pZoneCount);
+
+
+	if (!pZoneStatistics)
+	{
+		(*pZoneCount) = profiler->nameCount;
+		return;
+	}
+
+	if ((*pZoneCount) > profiler->nameCount)
+		(*pZoneCount) = profiler->nameCount;
+
+
+	uint64_t samples[VKU_PROFILER_SAMPLE_COUNT];
+
+	for (uint32_t nameIndex = 0; nameIndex < (*pZoneCount); nameIndex++)
+	{
+		const vku_profiler_zone_name *name = &profiler->names[nameIndex];
+		VkuProfilerZoneStatistics *zoneStatistics = &pZoneStatistics[nameIndex];
+
+		memset(zoneStatistics, 0, sizeof(VkuProfilerZoneStatistics));
+
+		zoneStatistics->pName = name->pName;
+		zoneStatistics->count = name->count;
+
+		if (name->sampleCount == 0)
+			continue;
+
+
+		const uint32_t lastSample = (name->nextSample + VKU_PROFILER_SAMPLE_COUNT - 1) % VKU_PROFILER_SAMPLE_COUNT;
+		zoneStatistics->lastTime = name->samples[lastSample];
+
+		memcpy(samples, name->samples, name->sampleCount * sizeof(uint64_t));
+		qsort(samples, name->sampleCount, sizeof(uint64_t), vku_compareUint64);
+
+		uint64_t totalTime = 0;
+
+		for (uint32_t sampleIndex = 0; sampleIndex < name->sampleCount; sampleIndex++)
+			totalTime += samples[sampleIndex];
+
+		zoneStatistics->minTime = samples[0];
+		zoneStatistics->avgTime = totalTime / name->sampleCount;
+		zoneStatistics->p99Time = samples[(99 * (name->sampleCount - 1)) / 100];
+		zoneStatistics->maxTime = samples[name->sampleCount - 1];
+	}
+}
+
+VKUAPI_ATTR void vkuGetProfilerStatistics(VkuProfiler profiler, VkuProfilerStatistics *statistics)
+{
+	assert(profiler);
+	assert(statistics);
+
+	(*statistics) = profiler->statistics;
+}
+
+
+static void vku_writeJsonString(FILE *file, const char *string)
+{
+	fputc('"', file);
+
+	for (const char *c = string; *c; c++)
+	{
+		if ((*c == '"') || (*c == '\\'))
+			fprintf(file, "\\%c", *c);
+		else if ((unsigned char) *c < 0x20)
+			fprintf(file, "\\u%04x", (unsigned int) (unsigned char) *c);
+		else
+			fputc(*c, file);
+	}
+
+	fputc('"', file);
+}
+
+// Writes the recently read back zones as Chrome trace event JSON, which can be opened
+// in chrome://tracing or Perfetto. Each nesting depth is shown as its own thread.
+VKUAPI_ATTR VkResult vkuWriteProfilerTrace(VkuProfiler profiler, const char *path)
+{
+	assert(profiler);
+	assert(path);
+
+
+	FILE *file = fopen(path, "w");
+
+	if (!file)
+		return VK_ERROR_INITIALIZATION_FAILED;
+
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	const uint32_t firstEvent = (profiler->nextTraceEvent + VKU_PROFILER_TRACE_CAPACITY - profiler->traceCount) % VKU_PROFILER_TRACE_CAPACITY;
+
+	for (uint32_t i = 0; i < profiler->traceCount; i++)
+	{
+		const vku_profiler_trace_event *event = &profiler->traceEvents[(firstEvent + i) % VKU_PROFILER_TRACE_CAPACITY];
+
+		// The timestamps are in microseconds
+		fprintf(file, "{\"name\":");
+		vku_writeJsonString(file, profiler->names[event->nameIndex].pName);
+		fprintf(file, ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n", event->depth,
+			(double) event->startTime / 1000.0, (double) event->duration / 1000.0, ((i + 1) < profiler->traceCount) ? "," : "");
+	}
+
+	fprintf(file, "]}\n");
+
+	const VkBool32 failed = ferror(file) ? VK_TRUE : VK_FALSE;
+
+	if ((fclose(file) != 0) || failed)
+		return VK_ERROR_INITIALIZATION_FAILED;
+
+	return VK_SUCCESS;
+}
+
+
+// Allocations up to VKU_HOST_MAX_BLOCK_SIZE (including their header and alignment) come from per-thread
+// free lists of power of two size classes, starting at VKU_HOST_MIN_BLOCK_SIZE. The blocks are carved from
+// VKU_HOST_CHUNK_SIZE chunks. Larger allocations go straight to malloc().
+#define VKU_HOST_MIN_BLOCK_SIZE 32
+#define VKU_HOST_MAX_BLOCK_SIZE 4096
+#define VKU_HOST_SIZE_CLASS_COUNT 8
+#define VKU_HOST_CHUNK_SIZE 65536
+
+// When a thread's free list of a size class gets longer, half of it is moved to the shared free list
+#define VKU_HOST_THREAD_CACHE_LIMIT 256
+
+#define VKU_DEFAULT_HOST_ARENA_BLOCK_SIZE 65536
+
+#define VKU_HOST_ALLOCATION_SCOPE_COUNT 5
+
+
+typedef struct VkuHostAllocator_T* VkuHostAllocator;
+
+
+typedef struct VkuHostAllocatorCreateInfo
+{
+	// The scopes served from the per-thread arenas, as (1 << VkSystemAllocationScope) bits. The arenas are bump
+	// allocators whose blocks are reused once all their allocations are freed, which suits short lived allocations.
+	// 0 means only VK_SYSTEM_ALLOCATION_SCOPE_COMMAND.
+	uint32_t arenaScopeMask;
+
+	// 0 means VKU_DEFAULT_HOST_ARENA_BLOCK_SIZE, allocations larger than a quarter of it don't use the arenas
+	size_t arenaBlockSize;
+} VkuHostAllocatorCreateInfo;
+
+
+// Indexed by VkSystemAllocationScope, the sizes are the requested sizes
+typedef struct VkuHostAllocatorStatistics
+{
+	// The live allocations
+	uint64_t allocatedSize[VKU_HOST_ALLOCATION_SCOPE_COUNT];
+	uint64_t allocationCount[VKU_HOST_ALLOCATION_SCOPE_COUNT];
+
+	// The allocations ever made
+	uint64_t totalAllocationCount[VKU_HOST_ALLOCATION_SCOPE_COUNT];
+
+	// The driver's own allocations, reported with pfnInternalAllocation/pfnInternalFree
+	uint64_t internalAllocatedSize[VKU_HOST_ALLOCATION_SCOPE_COUNT];
+
+	// The memory allocated from the system for the chunks and arena blocks,
+	// which doesn't include the allocations that are larger than VKU_HOST_MAX_BLOCK_SIZE
+	uint64_t reservedSize;
+
+	// The running threads which have used the allocator
+	uint32_t threadCount;
+} VkuHostAllocatorStatistics;
+
+
+// Precedes each allocation
+typedef struct vku_host_header
+{
+	// The size class, or VKU_HOST_KIND_LARGE or VKU_HOST_KIND_ARENA
+	uint16_t kind;
+	uint16_t scope;
+
+	// From the start of the block (or arena block) to the allocation
+	uint32_t offset;
+
+	uint64_t size;
+} vku_host_header;
+
+#define VKU_HOST_KIND_LARGE VKU_HOST_SIZE_CLASS_COUNT
+#define VKU_HOST_KIND_ARENA (VKU_HOST_SIZE_CLASS_COUNT + 1)
+
+
+typedef struct vku_host_arena_block
+{
+	// The live allocations, plus 1 while it's a thread's current block
+	volatile uint32_t liveCount;
+
+	size_t usedSize;
+	size_t size;
+} vku_host_arena_block;
+
+// Where the allocations of an arena block start
+#define VKU_HOST_ARENA_DATA_OFFSET ((sizeof(vku_host_arena_block) + 15) & ~((size_t) 15))
+
+
+typedef struct vku_host_thread_cache
+{
+	VkuHostAllocator allocator;
+	struct vku_host_thread_cache *next;
+
+	// The free blocks are linked through their first bytes
+	void *freeLists[VKU_HOST_SIZE_CLASS_COUNT];
+	uint32_t freeCounts[VKU_HOST_SIZE_CLASS_COUNT];
+
+	// The unused part of the last chunk of each size class
+	char *chunkPointers[VKU_HOST_SIZE_CLASS_COUNT];
+	char *chunkEnds[VKU_HOST_SIZE_CLASS_COUNT];
+
+	vku_host_arena_block *arenaBlock;
+
+	// Only written by the thread, without atomics, which would cost more than the allocation itself, so
+	// vkuGetHostAllocatorStatistics() may see them slightly stale. Frees count on the freeing thread,
+	// so only the sums over all threads are meaningful.
+	volatile uint64_t allocatedSize[VKU_HOST_ALLOCATION_SCOPE_COUNT];
+	volatile uint64_t allocationCount[VKU_HOST_ALLOCATION_SCOPE_COUNT];
+	volatile uint64_t totalAllocationCount[VKU_HOST_ALLOCATION_SCOPE_COUNT];
+	volatile uint64_t internalAllocatedSize[VKU_HOST_ALLOCATION_SCOPE_COUNT];
+} vku_host_thread_cache;
+
+
+struct VkuHostAllocator_T
+{
+	uint32_t arenaScopeMask;
+	size_t arenaBlockSize;
+
+	vku_tls_key threadCacheKey;
+
+	// Guards the rest
+	vku_mutex mutex;
+
+	vku_host_thread_cache *threadCaches;
+	uint32_t threadCount;
+
+	// Only the statistics, which the threads that exited leave behind
+	vku_host_thread_cache exitedThreads;
+
+	uint32_t chunkCount, chunkCapacity;
+	void **chunks;
+
+	void *sharedFreeLists[VKU_HOST_SIZE_CLASS_COUNT];
+
+	volatile uint64_t reservedSize;
+};
+
+
+static vku_host_thread_cache* vku_getHostThreadCache(VkuHostAllocator allocator)
+{
+	vku_host_thread_cache *cache = (vku_host_thread_cache*) vku_getTlsValue(allocator->threadCacheKey);
+
+	if (cache)
+		return cache;
+
+
+	cache = (vku_host_thread_cache*) VKU_CALLOC(1, sizeof(vku_host_thread_cache));
+
+	if (!cache)
+		return NULL;
+
+	cache->allocator = allocator;
+
+	if (!vku_setTlsValue(allocator->threadCacheKey, cache))
+	{
+		VKU_FREE(cache);
+		return NULL;
+	}
+
+	vku_lockMutex(&allocator->mutex);
+
+	cache->next = allocator->threadCaches;
+	allocator->threadCaches = cache;
+	allocator->threadCount++;
+
+	vku_unlockMutex(&allocator->mutex);
+
+	return cache;
+}
+
+
+static char* vku_allocateHostBlock(VkuHostAllocator allocator, vku_host_thread_cache *cache, uint32_t sizeClass)
+{
+	const size_t blockSize = ((size_t) VKU_HOST_MIN_BLOCK_SIZE) << sizeClass;
+
+	if (!cache->freeLists[sizeClass])
+	{
+		if (cache->chunkPointers[sizeClass] && ((cache->chunkPointers[sizeClass] + blockSize) <= cache->chunkEnds[sizeClass]))
+		{
+			char *block = cache->chunkPointers[sizeClass];
+			cache->chunkPointers[sizeClass] += blockSize;
+
+			return block;
+		}
+
+
+		// Take the shared free list, or else start a new chunk
+		vku_lockMutex(&allocator->mutex);
+
+		cache->freeLists[sizeClass] = allocator->sharedFreeLists[sizeClass];
+		allocator->sharedFreeLists[sizeClass] = NULL;
+
+		for (void *block = cache->freeLists[sizeClass]; block; block = *((void**) block))
+			cache->freeCounts[sizeClass]++;
+
+		if (!cache->freeLists[sizeClass])
+		{
+			char *chunk = NULL;
+
+			if ((allocator->chunkCount < allocator->chunkCapacity) || vku_reserveArray((void**) &allocator->chunks, allocator->chunkCount, &allocator->chunkCapacity, sizeof(void*)))
+				chunk = (char*) VKU_MALLOC(VKU_HOST_CHUNK_SIZE + 15);
+
+			if (chunk)
+			{
+				allocator->chunks[allocator->chunkCount++] = chunk;
+
+				// The blocks are 16-byte aligned
+				cache->chunkPointers[sizeClass] = (char*) ((((uintptr_t) chunk) + 15) & ~((uintptr_t) 15));
+				cache->chunkEnds[sizeClass] = cache->chunkPointers[sizeClass] + VKU_HOST_CHUNK_SIZE;
+
+				vku_atomicAdd64(&allocator->reservedSize, VKU_HOST_CHUNK_SIZE + 15);
+			}
+		}
+
+		vku_unlockMutex(&allocator->mutex);
+
+		if (!cache->freeLists[sizeClass])
+		{
+			if (!cache->chunkPointers[sizeClass] || ((cache->chunkPointers[sizeClass] + blockSize) > cache->chunkEnds[sizeClass]))
+				return NULL;
+
+			char *block = cache->chunkPointers[sizeClass];
+			cache->chunkPointers[sizeClass] += blockSize;
+
+			return block;
+		}
+	}
+
+
+	char *block = (char*) cache->freeLists[sizeClass];
+
+	cache->freeLists[sizeClass] = *((void**) block);
+	cache->freeCounts[sizeClass]--;
+
+	return block;
+}
+
+static void vku_freeHostBlock(VkuHostAllocator allocator, vku_host_thread_cache *cache, uint32_t sizeClass, char *block)
+{
+	*((void**) block) = cache->freeLists[sizeClass];
+
+	cache->freeLists[sizeClass] = block;
+	cache->freeCounts[sizeClass]++;
+
+	if (cache->freeCounts[sizeClass] <= VKU_HOST_THREAD_CACHE_LIMIT)
+		return;
+
+
+	// Keep the first half, and move the rest to the shared free list
+	void *last = cache->freeLists[sizeClass];
+
+	for (uint32_t i = 1; i < (VKU_HOST_THREAD_CACHE_LIMIT / 2); i++)
+		last = *((void**) last);
+
+	void *first = *((void**) last);
+	*((void**) last) = NULL;
+
+	cache->freeCounts[sizeClass] = VKU_HOST_THREAD_CACHE_LIMIT / 2;
+
+	last = first;
+
+	while (*((void**) last))
+		last = *((void**) last);
+
+	vku_lockMutex(&allocator->mutex);
+
+	*((void**) last) = allocator->sharedFreeLists[sizeClass];
+	allocator->sharedFreeLists[sizeClass] = first;
+
+	vku_unlockMutex(&allocator->mutex);
+}
+
+
+static void vku_releaseHostArenaBlock(VkuHostAllocator allocator, vku_host_arena_block *block)
+{
+	if (vku_atomicAdd32(&block->liveCount, (uint32_t) -1) == 0)
+	{
+		vku_atomicAdd64(&allocator->reservedSize, (uint64_t) 0 - (uint64_t) block->size);
+		VKU_FREE(block);
+	}
+}
+
+// Returns the start of totalSize bytes in the thread's arena block
+static char* vku_allocateHostArena(VkuHostAllocator allocator, vku_host_thread_cache *cache, size_t totalSize, vku_host_arena_block **arenaBlock)
+{
+	vku_host_arena_block *block = cache->arenaBlock;
+
+	// Only the thread's reference is left, so nothing else can use the block
+	if (block && (vku_atomicAdd32(&block->liveCount, 0) == 1))
+		block->usedSize = VKU_HOST_ARENA_DATA_OFFSET;
+
+	// The allocations start 16-byte aligned
+	if (!block || ((block->usedSize + 15 + totalSize) > block->size))
+	{
+		vku_host_arena_block *newBlock = (vku_host_arena_block*) VKU_MALLOC(allocator->arenaBlockSize);
+
+		if (!newBlock)
+			return NULL;
+
+		newBlock->liveCount = 1;
+		newBlock->usedSize = VKU_HOST_ARENA_DATA_OFFSET;
+		newBlock->size = allocator->arenaBlockSize;
+
+		vku_atomicAdd64(&allocator->reservedSize, allocator->arenaBlockSize);
+
+		if (block)
+			vku_releaseHostArenaBlock(allocator, block);
+
+		block = newBlock;
+		cache->arenaBlock = block;
+	}
+
+	char *start = (char*) ((((uintptr_t) block) + block->usedSize + 15) & ~((uintptr_t) 15));
+
+	block->usedSize = (size_t) (start - ((char*) block)) + totalSize;
+	vku_atomicAdd32(&block->liveCount, 1);
+
+	(*arenaBlock) = block;
+
+	return start;
+}
+
+
+static void vku_countHostAllocation(vku_host_thread_cache *cache, uint32_t scope, uint64_t size, uint64_t count)
+{
+	cache->allocatedSize[scope] += size;
+	cache->allocationCount[scope] += count;
+}
+
+static void* VKAPI_CALL vku_hostAllocation(void *pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+	VkuHostAllocator allocator = (VkuHostAllocator) pUserData;
+
+	if (size == 0)
+		return NULL;
+
+	const uint32_t scope = (uint32_t) allocationScope;
+	assert(scope < VKU_HOST_ALLOCATION_SCOPE_COUNT);
+
+	vku_host_thread_cache *cache = vku_getHostThreadCache(allocator);
+
+	if (!cache)
+		return NULL;
+
+
+	// The blocks are 16-byte aligned, and the header takes the first 16 bytes
+	if (alignment < 16)
+		alignment = 16;
+
+	const size_t totalSize = sizeof(vku_host_header) + size + alignment - 16;
+
+	uint16_t kind;
+	char *block;
+	char *start;
+
+	if ((allocator->arenaScopeMask & (1u << scope)) && (totalSize <= (allocator->arenaBlockSize / 4)))
+	{
+		vku_host_arena_block *arenaBlock = NULL;
+
+		kind = VKU_HOST_KIND_ARENA;
+		start = vku_allocateHostArena(allocator, cache, totalSize, &arenaBlock);
+		block = (char*) arenaBlock;
+	}
+	else if (totalSize <= VKU_HOST_MAX_BLOCK_SIZE)
+	{
+		uint32_t sizeClass = 0;
+
+		while ((((size_t) VKU_HOST_MIN_BLOCK_SIZE) << sizeClass) < totalSize)
+			sizeClass++;
+
+		kind = (uint16_t) sizeClass;
+		block = vku_allocateHostBlock(allocator, cache, sizeClass);
+		start = block;
+	}
+	else
+	{
+		// malloc() may only align to 8 bytes
+		kind = VKU_HOST_KIND_LARGE;
+		block = (char*) VKU_MALLOC(totalSize + 15);
+		start = (char*) ((((uintptr_t) block) + 15) & ~((uintptr_t) 15));
+
+	}
+
+	if (!block || !start)
+		return NULL;
+
+
+	char *pMemory = (char*) ((((uintptr_t) start) + sizeof(vku_host_header) + alignment - 1) & ~((uintptr_t) alignment - 1));
+
+	vku_host_header *header = ((vku_host_header*) pMemory) - 1;
+
+	header->kind = kind;
+	header->scope = (uint16_t) scope;
+	header->offset = (uint32_t) (pMemory - block);
+	header->size = size;
+
+	vku_countHostAllocation(cache, scope, size, 1);
+	cache->totalAllocationCount[scope]++;
+
+	return pMemory;
+}
+
+static void VKAPI_CALL vku_hostFree(void *pUserData, void *pMemory)
+{
+	VkuHostAllocator allocator = (VkuHostAllocator) pUserData;
+
+	if (!pMemory)
+		return;
+
+	vku_host_thread_cache *cache = vku_getHostThreadCache(allocator);
+
+	// Without a cache, only the thread's statistics are lost
+	const vku_host_header *header = ((const vku_host_header*) pMemory) - 1;
+	char *block = ((char*) pMemory) - header->offset;
+
+	if (cache)
+		vku_countHostAllocation(cache, header->scope, (uint64_t) 0 - header->size, (uint64_t) -1);
+
+	if (header->kind == VKU_HOST_KIND_ARENA)
+		vku_releaseHostArenaBlock(allocator, (vku_host_arena_block*) block);
+	else if ((header->kind == VKU_HOST_KIND_LARGE) || !cache)
+	{
+		if (header->kind == VKU_HOST_KIND_LARGE)
+			VKU_FREE(block);
+		else
+		{
+			vku_lockMutex(&allocator->mutex);
+
+			*((void**) block) = allocator->sharedFreeLists[header->kind];
+			allocator->sharedFreeLists[header->kind] = block;
+
+			vku_unlockMutex(&allocator->mutex);
+		}
+	}
+	else
+		vku_freeHostBlock(allocator, cache, header->kind, block);
+}
+
+static void* VKAPI_CALL vku_hostReallocation(void *pUserData, void *pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+	if (!pOriginal)
+		return vku_hostAllocation(pUserData, size, alignment, allocationScope);
+
+	if (size == 0)
+	{
+		vku_hostFree(pUserData, pOriginal);
+		return NULL;
+	}
+
+
+	vku_host_header *header = ((vku_host_header*) pOriginal) - 1;
+
+	// A size class block can grow in place, since the alignment must be the original alignment
+	if (header->kind < VKU_HOST_SIZE_CLASS_COUNT)
+	{
+		const size_t capacity = (((size_t) VKU_HOST_MIN_BLOCK_SIZE) << header->kind) - header->offset;
+
+		if (size <= capacity)
+		{
+			vku_host_thread_cache *cache = vku_getHostThreadCache((VkuHostAllocator) pUserData);
+
+			if (cache)
+				vku_countHostAllocation(cache, header->scope, (uint64_t) size - header->size, 0);
+
+			header->size = size;
+
+			return pOriginal;
+		}
+	}
+
+
+	void *pMemory = vku_hostAllocation(pUserData, size, alignment, allocationScope);
+
+	if (!pMemory)
+		return NULL;
+
+	memcpy(pMemory, pOriginal, (header->size < size) ? header->size : size);
+
+	vku_hostFree(pUserData, pOriginal);
+
+	return pMemory;
+}
+
+static void VKAPI_CALL vku_hostInternalAllocation(void *pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope)
+{
+	(void) allocationType;
+
+	vku_host_thread_cache *cache = vku_getHostThreadCache((VkuHostAllocator) pUserData);
+
+	if (cache)
+		cache->internalAllocatedSize[allocationScope] += size;
+}
+
+static void VKAPI_CALL vku_hostInternalFree(void *pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope)
+{
+	(void) allocationType;
+
+	vku_host_thread_cache *cache = vku_getHostThreadCache((VkuHostAllocator) pUserData);
+
+	if (cache)
+		cache->internalAllocatedSize[allocationScope] -= size;
+}
+
+
+// Called when a thread which used the allocator exits, which hands its free blocks (and the
+// unused part of its chunks) to the shared free lists, and keeps its statistics
+static void VKU_TLS_DESTRUCTOR_CALL vku_exitHostThread(void *pCache)
+{
+	vku_host_thread_cache *cache = (vku_host_thread_cache*) pCache;
+	VkuHostAllocator allocator = cache->allocator;
+
+	if (cache->arenaBlock)
+		vku_releaseHostArenaBlock(allocator, cache->arenaBlock);
+
+
+	vku_lockMutex(&allocator->mutex);
+
+	for (uint32_t sizeClass = 0; sizeClass < VKU_HOST_SIZE_CLASS_COUNT; sizeClass++)
+	{
+		const size_t blockSize = ((size_t) VKU_HOST_MIN_BLOCK_SIZE) << sizeClass;
+
+		while (cache->chunkPointers[sizeClass] && ((cache->chunkPointers[sizeClass] + blockSize) <= cache->chunkEnds[sizeClass]))
+		{
+			char *block = cache->chunkPointers[sizeClass];
+			cache->chunkPointers[sizeClass] += blockSize;
+
+			*((void**) block) = cache->freeLists[sizeClass];
+			cache->freeLists[sizeClass] = block;
+		}
+
+		if (!cache->freeLists[sizeClass])
+			continue;
+
+		void *last = cache->freeLists[sizeClass];
+
+		while (*((void**) last))
+			last = *((void**) last);
+
+		*((void**) last) = allocator->sharedFreeLists[sizeClass];
+		allocator->sharedFreeLists[sizeClass] = cache->freeLists[sizeClass];
+	}
+
+	for (uint32_t scope = 0; scope < VKU_HOST_ALLOCATION_SCOPE_COUNT; scope++)
+	{
+		allocator->exitedThreads.allocatedSize[scope] += cache->allocatedSize[scope];
+		allocator->exitedThreads.allocationCount[scope] += cache->allocationCount[scope];
+		allocator->exitedThreads.totalAllocationCount[scope] += cache->totalAllocationCount[scope];
+		allocator->exitedThreads.internalAllocatedSize[scope] += cache->internalAllocatedSize[scope];
+	}
+
+
+	vku_host_thread_cache **link = &allocator->threadCaches;
+
+	while ((*link) != cache)
+		link = &(*link)->next;
+
+	(*link) = cache->next;
+	allocator->threadCount--;
+
+	vku_unlockMutex(&allocator->mutex);
+
+	VKU_FREE(cache);
+}
+
+
+VKUAPI_ATTR void vkuDestroyHostAllocator(VkuHostAllocator allocator);
+
+VKUAPI_ATTR VkResult vkuCreateHostAllocator(const VkuHostAllocatorCreateInfo *createInfo, VkuHostAllocator *allocator)
+{
+	assert(allocator);
+
+
+	(*allocator) = (VkuHostAllocator) VKU_CALLOC(1, sizeof(struct VkuHostAllocator_T));
+
+	if (!(*allocator))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*allocator)->arenaScopeMask = 1u << VK_SYSTEM_ALLOCATION_SCOPE_COMMAND;
+	(*allocator)->arenaBlockSize = VKU_DEFAULT_HOST_ARENA_BLOCK_SIZE;
+
+	if (createInfo && createInfo->arenaScopeMask)
+		(*allocator)->arenaScopeMask = createInfo->arenaScopeMask;
+
+	if (createInfo && createInfo->arenaBlockSize)
+		(*allocator)->arenaBlockSize = createInfo->arenaBlockSize;
+
+	assert((*allocator)->arenaBlockSize > (4 * VKU_HOST_ARENA_DATA_OFFSET));
+
+	vku_initMutex(&(*allocator)->mutex);
+
+	if (!vku_createTlsKey(&(*allocator)->threadCacheKey, vku_exitHostThread))
+	{
+		vku_destroyMutex(&(*allocator)->mutex);
+		VKU_FREE(*allocator);
+		(*allocator) = NULL;
+
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+	return VK_SUCCESS;
+}
+
+// Everything created with the allocation callbacks must have been destroyed
+VKUAPI_ATTR void vkuDestroyHostAllocator(VkuHostAllocator allocator)
+{
+	if (!allocator)
+		return;
+
+
+	// Deleting the key first, such that the threads which are still running don't call
+	// vku_exitHostThread() later on, and on Windows it's called for them right away
+	vku_destroyTlsKey(allocator->threadCacheKey);
+
+	for (vku_host_thread_cache *cache = allocator->threadCaches; cache;)
+	{
+		vku_host_thread_cache *next = cache->next;
+
+		VKU_FREE(cache->arenaBlock);
+		VKU_FREE(cache);
+
+		cache = next;
+	}
+
+	for (uint32_t chunkIndex = 0; chunkIndex < allocator->chunkCount; chunkIndex++)
+		VKU_FREE(allocator->chunks[chunkIndex]);
+
+	vku_destroyMutex(&allocator->mutex);
+
+	VKU_FREE(allocator->chunks);
+	VKU_FREE(allocator);
+}
+
+// The callbacks for vkuCreateInstance(), vkuCreateDevice() and so on, which can be used from any thread
+VKUAPI_ATTR void vkuGetHostAllocationCallbacks(VkuHostAllocator allocator, VkAllocationCallbacks *allocationCallbacks)
+{
+	assert(allocator);
+	assert(allocationCallbacks);
+
+	allocationCallbacks->pUserData = allocator;
+	allocationCallbacks->pfnAllocation = vku_hostAllocation;
+	allocationCallbacks->pfnReallocation = vku_hostReallocation;
+	allocationCallbacks->pfnFree = vku_hostFree;
+	allocationCallbacks->pfnInternalAllocation = vku_hostInternalAllocation;
+	allocationCallbacks->pfnInternalFree = vku_hostInternalFree;
+}
+
+VKUAPI_ATTR void vkuGetHostAllocatorStatistics(VkuHostAllocator allocator, VkuHostAllocatorStatistics *statistics)
+{
+	assert(allocator);
+	assert(statistics);
+
+
+	memset(statistics, 0, sizeof(VkuHostAllocatorStatistics));
+
+	vku_lockMutex(&allocator->mutex);
+
+	for (vku_host_thread_cache *cache = allocator->threadCaches; cache; cache = cache->next)
+	{
+		for (uint32_t scope = 0; scope < VKU_HOST_ALLOCATION_SCOPE_COUNT; scope++)
+		{
+			statistics->allocatedSize[scope] += cache->allocatedSize[scope];
+			statistics->allocationCount[scope] += cache->allocationCount[scope];
+			statistics->totalAllocationCount[scope] += cache->totalAllocationCount[scope];
+			statistics->internalAllocatedSize[scope] += cache->internalAllocatedSize[scope];
+		}
+	}
+
+	for (uint32_t scope = 0; scope < VKU_HOST_ALLOCATION_SCOPE_COUNT; scope++)
+	{
+		statistics->allocatedSize[scope] += allocator->exitedThreads.allocatedSize[scope];
+		statistics->allocationCount[scope] += allocator->exitedThreads.allocationCount[scope];
+		statistics->totalAllocationCount[scope] += allocator->exitedThreads.totalAllocationCount[scope];
+		statistics->internalAllocatedSize[scope] += allocator->exitedThreads.internalAllocatedSize[scope];
+	}
+
+	statistics->threadCount = allocator->threadCount;
+
+	vku_unlockMutex(&allocator->mutex);
+
+	statistics->reservedSize = vku_atomicAdd64(&allocator->reservedSize, 0);
+}
+
+// Asynchronous instance and device initialization, i.e. vkuCreateInstanceFromSpec(), vkuSelectPhysicalDevice(),
+// vkuGetQueueTopology() and vkuCreateDeviceFromSpecWithQueues() on a background thread
+
+typedef enum VkuAsyncInitStage
+{
+	VKU_ASYNC_INIT_STAGE_INSTANCE = 0,
+	VKU_ASYNC_INIT_STAGE_PHYSICAL_DEVICE = 1,
+	VKU_ASYNC_INIT_STAGE_QUEUE_TOPOLOGY = 2,
+	VKU_ASYNC_INIT_STAGE_DEVICE = 3,
+	VKU_ASYNC_INIT_STAGE_COMPLETE = 4
+} VkuAsyncInitStage;
+
+
+// Everything pointed to must stay valid until the initialization is complete, and the
+// pOptionalExtensionsEnabled/pOptionalLayersEnabled of the specs are written by the background thread
+typedef struct VkuAsyncInitCreateInfo
+{
+	uint32_t apiVersion;
+
+	// If NULL, then no extensions or layers are enabled
+	const VkuExtensionSpec *pInstanceSpec;
+	const VkuExtensionSpec *pDeviceSpec;
+
+	// If NULL, then the same as vkuGetPhysicalDevice()
+	const VkuDeviceSelectInfo *pSelectInfo;
+
+	// If not NULL, then VKU_QUEUE_ROLE_COUNT priorities, see vkuCreateDeviceWithQueues()
+	const float *pRolePriorities;
+
+	const VkAllocationCallbacks *pAllocator;
+} VkuAsyncInitCreateInfo;
+
+
+typedef struct VkuAsyncInitResult
+{
+	VkInstance instance;
+	VkPhysicalDevice physicalDevice;
+	VkuQueueTopology topology;
+
+	VkDevice device;
+	VkuQueues queues;
+
+	// The stage which failed, or VKU_ASYNC_INIT_STAGE_COMPLETE
+	VkuAsyncInitStage stage;
+
+	// In nanoseconds
+	uint64_t instanceTime;
+	uint64_t physicalDeviceTime;
+	uint64_t queueTopologyTime;
+	uint64_t deviceTime;
+} VkuAsyncInitResult;
+
+
+typedef struct VkuAsyncInit_T* VkuAsyncInit;
+
+
+struct VkuAsyncInit_T
+{
+	VkuAsyncInitCreateInfo createInfo;
+
+	vku_thread thread;
+
+	vku_mutex mutex;
+	vku_condition condition;
+
+	// Guarded by the mutex
+	VkBool32 complete;
+	VkuAsyncInitStage stage;
+	VkResult result;
+
+	VkuAsyncInitResult output;
+
+	// If the instance and device have been given to the caller by vkuWaitAsyncInit()
+	VkBool32 taken;
+};
+
+
+static void vku_setAsyncInitStage(VkuAsyncInit init, VkuAsyncInitStage stage)
+{
+	vku_lockMutex(&init->mutex);
+	init->stage = stage;
+	vku_unlockMutex(&init->mutex);
+}
+
+static void vku_asyncInitMain(void *pArgument)
+{
+	VkuAsyncInit init = (VkuAsyncInit) pArgument;
+	const VkuAsyncInitCreateInfo *createInfo = &init->createInfo;
+
+	VkuAsyncInitResult output;
+	memset(&output, 0, sizeof(output));
+
+	VkuExtensionSpec emptySpec;
+	memset(&emptySpec, 0, sizeof(emptySpec));
+
+
+	output.stage = VKU_ASYNC_INIT_STAGE_INSTANCE;
+
+	uint64_t time = vku_getTime();
+	VkResult err = vkuCreateInstanceFromSpec(createInfo->apiVersion,
+		createInfo->pInstanceSpec ? createInfo->pInstanceSpec : &emptySpec,
+		createInfo->pAllocator, &output.instance);
+
+	output.instanceTime = vku_getTime() - time;
+
+	if (!err)
+	{
+		output.stage = VKU_ASYNC_INIT_STAGE_PHYSICAL_DEVICE;
+		vku_setAsyncInitStage(init, output.stage);
+
+		time = vku_getTime();
+		err = vkuSelectPhysicalDevice(output.instance, createInfo->pSelectInfo, &output.physicalDevice);
+
+		output.physicalDeviceTime = vku_getTime() - time;
+	}
+
+	if (!err)
+	{
+		output.stage = VKU_ASYNC_INIT_STAGE_QUEUE_TOPOLOGY;
+		vku_setAsyncInitStage(init, output.stage);
+
+		time = vku_getTime();
+		err = vkuGetQueueTopology(output.physicalDevice, &output.topology);
+
+		output.queueTopologyTime = vku_getTime() - time;
+	}
+
+	if (!err)
+	{
+		output.stage = VKU_ASYNC_INIT_STAGE_DEVICE;
+		vku_setAsyncInitStage(init, output.stage);
+
+		time = vku_getTime();
+		err = vkuCreateDeviceFromSpecWithQueues(createInfo->pDeviceSpec ? createInfo->pDeviceSpec : &emptySpec,
+			createInfo->pAllocator, output.physicalDevice, &output.topology, createInfo->pRolePriorities,
+			&output.device, &output.queues);
+
+		output.deviceTime = vku_getTime() - time;
+	}
+
+	if (!err)
+		output.stage = VKU_ASYNC_INIT_STAGE_COMPLETE;
+
+
+	// Don't leave a partial initialization behind
+	if (err)
+	{
+		if (output.instance)
+			vkDestroyInstance(output.instance, createInfo->pAllocator);
+
+		output.instance = VK_NULL_HANDLE;
+		output.physicalDevice = VK_NULL_HANDLE;
+		output.device = VK_NULL_HANDLE;
+	}
+
+
+	vku_lockMutex(&init->mutex);
+
+	init->output = output;
+	init->stage = output.stage;
+	init->result = err;
+	init->complete = VK_TRUE;
+
+	vku_broadcastCondition(&init->condition);
+	vku_unlockMutex(&init->mutex);
+}
+
+
+// Begins the initialization on a background thread, such that the calling thread can
+// do something else in the meantime, e.g. load assets
+VKUAPI_ATTR VkResult vkuBeginAsyncInit(const VkuAsyncInitCreateInfo *createInfo, VkuAsyncInit *init)
+{
+	assert(createInfo);
+	assert(init);
+
+
+	(*init) = (VkuAsyncInit) VKU_CALLOC(1, sizeof(struct VkuAsyncInit_T));
+
+	if (!(*init))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*init)->createInfo = *createInfo;
+	(*init)->stage = VKU_ASYNC_INIT_STAGE_INSTANCE;
+	(*init)->result = VK_NOT_READY;
+
+	vku_initMutex(&(*init)->mutex);
+	vku_initCondition(&(*init)->condition);
+
+	if (!vku_createThread(&(*init)->thread, vku_asyncInitMain, *init))
+	{
+		vku_destroyCondition(&(*init)->condition);
+		vku_destroyMutex(&(*init)->mutex);
+
+		VKU_FREE(*init);
+		(*init) = NULL;
+
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+
+	return VK_SUCCESS;
+}
+
+// Joins the background thread. If the initialization succeeded, but vkuWaitAsyncInit() was never
+// called, then the VkDevice and VkInstance are destroyed, otherwise they're owned by the caller.
+VKUAPI_ATTR void vkuDestroyAsyncInit(VkuAsyncInit init)
+{
+	if (!init)
+		return;
+
+
+	vku_joinThread(&init->thread);
+
+	if (!init->taken)
+	{
+		if (init->output.device)
+			vkDestroyDevice(init->output.device, init->createInfo.pAllocator);
+
+		if (init->output.instance)
+			vkDestroyInstance(init->output.instance, init->createInfo.pAllocator);
+	}
+
+	vku_destroyCondition(&init->condition);
+	vku_destroyMutex(&init->mutex);
+
+	VKU_FREE(init);
+}
+
+// Returns VK_NOT_READY while the initialization is running, otherwise its result. Never blocks.
+// If stage isn't NULL, then it's set to the current stage, or the stage which failed.
+VKUAPI_ATTR VkResult vkuGetAsyncInitStatus(VkuAsyncInit init, VkuAsyncInitStage *stage)
+{
+	assert(init);
+
+
+	vku_lockMutex(&init->mutex);
+
+	const VkResult result = init->result;
+
+	if (stage)
+		(*stage) = init->stage;
+
+	vku_unlockMutex(&init->mutex);
+
+
+	return result;
+}
+
+// Waits for the initialization to complete and returns its result. On success the caller takes ownership
+// of the VkInstance and VkDevice in the result, the stage timings are set regardless.
+VKUAPI_ATTR VkResult vkuWaitAsyncInit(VkuAsyncInit init, VkuAsyncInitResult *result)
+{
+	assert(init);
+	assert(result);
+
+
+	vku_lockMutex(&init->mutex);
+
+	while (!init->complete)
+		vku_waitCondition(&init->condition, &init->mutex);
+
+	const VkResult err = init->result;
+
+	(*result) = init->output;
+	init->taken = VK_TRUE;
+
+	vku_unlockMutex(&init->mutex);
+
+
+	return err;
+}
+
+
+// Transient resources, i.e. buffers and images which are only used during part of a frame, like intermediate
+// render targets and scratch buffers. Each resource is declared with the interval of the frame it's used in,
+// e.g. the indices of the first and last pass using it, and resources with disjoint intervals share memory.
+
+typedef struct VkuTransientPool_T* VkuTransientPool;
+
+
+// The default amount of vkuAllocateTransientResources() in a row of a frame, which didn't use
+// a memory type, after which the frame's allocation of that memory type is freed
+#define VKU_DEFAULT_TRANSIENT_IDLE_LIMIT 8
+
+
+typedef struct VkuTransientPoolCreateInfo
+{
+	VkDevice device;
+
+	// The memory of each frame is allocated from the allocator
+	VkuAllocator allocator;
+
+	// The amount of frames in flight, each frame has its own memory
+	uint32_t frameCount;
+
+	// If 0, then VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	VkMemoryPropertyFlags requiredFlags;
+
+	// 0 means VKU_DEFAULT_TRANSIENT_IDLE_LIMIT
+	uint32_t idleLimit;
+
+	const VkAllocationCallbacks *pAllocator;
+} VkuTransientPoolCreateInfo;
+
+
+typedef struct VkuTransientPoolStatistics
+{
+	// Of the last vkuAllocateTransientResources()
+	uint32_t resourceCount;
+	uint32_t createdCount;
+	uint32_t reusedCount;
+
+	// The memory needed if each resource had its own memory, versus the memory needed with aliasing
+	VkDeviceSize naiveSize;
+	VkDeviceSize aliasedSize;
+
+	// The largest aliasedSize of any frame
+	VkDeviceSize peakAliasedSize;
+
+	// The memory allocated for all the frames
+	VkDeviceSize allocatedSize;
+} VkuTransientPoolStatistics;
+
+
+// The parts of the create info which decide if a handle can be reused, zeroed before being set such that they can be compared with memcmp()
+typedef struct vku_transient_description
+{
+	VkBool32 image;
+
+	VkFlags flags;
+	VkFlags usage;
+
+	VkDeviceSize size;
+
+	VkImageType imageType;
+	VkFormat format;
+	VkExtent3D extent;
+	uint32_t mipLevels;
+	uint32_t arrayLayers;
+	VkSampleCountFlagBits samples;
+	VkImageTiling tiling;
+	VkImageLayout initialLayout;
+} vku_transient_description;
+
+
+typedef struct vku_transient_resource
+{
+	vku_transient_description description;
+
+	uint32_t firstUse;
+	uint32_t lastUse;
+
+	VkBuffer buffer;
+	VkImage image;
+
+	VkMemoryRequirements memoryRequirements;
+
+	uint32_t groupIndex;
+	VkDeviceSize offset;
+
+	// The group allocation and offset the handle is bound to, where 0 means it isn't bound
+	uint64_t boundSerial;
+	VkDeviceSize boundOffset;
+} vku_transient_resource;
+
+
+// The resources with the same memory type, which are either linear or optimal, share an allocation
+typedef struct vku_transient_group
+{
+	uint32_t memoryTypeIndex;
+	VkBool32 linear;
+
+	VkDeviceSize requiredSize;
+	VkDeviceSize requiredAlignment;
+
+	VkuAllocation allocation;
+	VkDeviceSize allocationSize;
+	uint64_t allocationSerial;
+
+	// The allocations of the frame in a row which didn't use the group
+	uint32_t idleCount;
+} vku_transient_group;
+
+
+typedef struct vku_transient_frame
+{
+	// The resources declared since the frame began
+	uint32_t resourceCount;
+	uint32_t resourceCapacity;
+	vku_transient_resource *resources;
+
+	// The resources of the last time the frame was current, which can be reused
+	uint32_t cachedCount;
+	uint32_t cachedCapacity;
+	vku_transient_resource *cached;
+
+	uint32_t groupCount;
+	uint32_t groupCapacity;
+	vku_transient_group *groups;
+} vku_transient_frame;
+
+
+struct VkuTransientPool_T
+{
+	VkDevice device;
+	VkuAllocator allocator;
+	const VkAllocationCallbacks *pAllocator;
+
+	VkMemoryPropertyFlags requiredFlags;
+	uint32_t idleLimit;
+
+	uint32_t frameCount;
+	uint32_t frameIndex;
+	vku_transient_frame *frames;
+
+	// Identifies each group allocation, such that a rebound handle can be detected
+	uint64_t allocationSerial;
+
+	// Scratch for packing a group
+	uint32_t orderCapacity;
+	uint32_t *order;
+
+	VkuTransientPoolStatistics statistics;
+};
+
+
+static void vku_destroyTransientHandle(VkuTransientPool pool, vku_transient_resource *resource)
+{
+	if (resource->buffer)
+		vkDestroyBuffer(pool->device, resource->buffer, pool->pAllocator);
+
+	if (resource->image)
+		vkDestroyImage(pool->device, resource->image, pool->pAllocator);
+
+	resource->buffer = VK_NULL_HANDLE;
+	resource->image = VK_NULL_HANDLE;
+	resource->boundSerial = 0;
+}
+
+static VkResult vku_createTransientHandle(VkuTransientPool pool, vku_transient_resource *resource)
+{
+	const vku_transient_description *description = &resource->description;
+
+	VkResult err;
+
+	if (description->image)
+	{
+		VkImageCreateInfo imageCreateInfo;
+		memset(&imageCreateInfo, 0, sizeof(imageCreateInfo));
+
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.flags = description->flags;
+		imageCreateInfo.imageType = description->imageType;
+		imageCreateInfo.format = description->format;
+		imageCreateInfo.extent = description->extent;
+		imageCreateInfo.mipLevels = description->mipLevels;
+		imageCreateInfo.arrayLayers = description->arrayLayers;
+		imageCreateInfo.samples = description->samples;
+		imageCreateInfo.tiling = description->tiling;
+		imageCreateInfo.usage = description->usage;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = description->initialLayout;
+
+		err = vkCreateImage(pool->device, &imageCreateInfo, pool->pAllocator, &resource->image);
+
+		if (!err)
+			vkGetImageMemoryRequirements(pool->device, resource->image, &resource->memoryRequirements);
+	}
+	else
+	{
+		VkBufferCreateInfo bufferCreateInfo;
+		memset(&bufferCreateInfo, 0, sizeof(bufferCreateInfo));
+
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.flags = description->flags;
+		bufferCreateInfo.size = description->size;
+		bufferCreateInfo.usage = description->usage;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		err = vkCreateBuffer(pool->device, &bufferCreateInfo, pool->pAllocator, &resource->buffer);
+
+		if (!err)
+			vkGetBufferMemoryRequirements(pool->device, resource->buffer, &resource->memoryRequirements);
+	}
+
+	resource->boundSerial = 0;
+
+	return err;
+}
+
+
+// The handles bound to the allocation are recreated when they're used again
+static void vku_freeTransientGroup(VkuTransientPool pool, vku_transient_group *group)
+{
+	vkuFreeMemory(pool->allocator, group->allocation);
+
+	pool->statistics.allocatedSize -= group->allocationSize;
+
+	group->allocation = VK_NULL_HANDLE;
+	group->allocationSize = 0;
+}
+
+
+VKUAPI_ATTR void vkuDestroyTransientPool(VkuTransientPool pool);
+
+VKUAPI_ATTR VkResult vkuCreateTransientPool(const VkuTransientPoolCreateInfo *createInfo, VkuTransientPool *pool)
+{
+	assert(createInfo);
+	assert(createInfo->device);
+	assert(createInfo->allocator);
+	assert(createInfo->frameCount > 0);
+	assert(pool);
+
+
+	(*pool) = (VkuTransientPool) VKU_CALLOC(1, sizeof(struct VkuTransientPool_T));
+
+	if (!(*pool))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	(*pool)->device = createInfo->device;
+	(*pool)->allocator = createInfo->allocator;
+	(*pool)->pAllocator = createInfo->pAllocator;
+	(*pool)->requiredFlags = createInfo->requiredFlags ? createInfo->requiredFlags : (VkMemoryPropertyFlags) VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	(*pool)->idleLimit = createInfo->idleLimit ? createInfo->idleLimit : VKU_DEFAULT_TRANSIENT_IDLE_LIMIT;
+	(*pool)->frameCount = createInfo->frameCount;
+
+	(*pool)->frames = (vku_transient_frame*) VKU_CALLOC(createInfo->frameCount, sizeof(vku_transient_frame));
+
+	if (!(*pool)->frames)
+	{
+		vkuDestroyTransientPool(*pool);
+		(*pool) = NULL;
+
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+
+	return VK_SUCCESS;
+}
+
+// The device must be idle
+VKUAPI_ATTR void vkuDestroyTransientPool(VkuTransientPool pool)
+{
+	if (!pool)
+		return;
+
+
+	for (uint32_t frameIndex = 0; pool->frames && (frameIndex < pool->frameCount); frameIndex++)
+	{
+		vku_transient_frame *frame = &pool->frames[frameIndex];
+
+		for (uint32_t resourceIndex = 0; resourceIndex < frame->resourceCount; resourceIndex++)
+			vku_destroyTransientHandle(pool, &frame->resources[resourceIndex]);
+
+		for (uint32_t cachedIndex = 0; cachedIndex < frame->cachedCount; cachedIndex++)
+			vku_destroyTransientHandle(pool, &frame->cached[cachedIndex]);
+
+		for (uint32_t groupIndex = 0; groupIndex < frame->groupCount; groupIndex++)
+			vkuFreeMemory(pool->allocator, frame->groups[groupIndex].allocation);
+
+		VKU_FREE(frame->resources);
+		VKU_FREE(frame->cached);
+		VKU_FREE(frame->groups);
+	}
+
+	VKU_FREE(pool->frames);
+	VKU_FREE(pool->order);
+	VKU_FREE(pool);
+}
+
+
+// Makes frameIndex the current frame, after which its resources are declared. The frame's previous
+// submission must have completed, as its memory and handles are reused.
+VKUAPI_ATTR void vkuBeginTransientPoolFrame(VkuTransientPool pool, uint32_t frameIndex)
+{
+	assert(pool);
+	assert(frameIndex < pool->frameCount);
+
+
+	vku_transient_frame *frame = &pool->frames[frameIndex];
+
+	// The handles which weren't reused the last time
+	for (uint32_t cachedIndex = 0; cachedIndex < frame->cachedCount; cachedIndex++)
+		vku_destroyTransientHandle(pool, &frame->cached[cachedIndex]);
+
+
+	vku_transient_resource *cached = frame->cached;
+	const uint32_t cachedCapacity = frame->cachedCapacity;
+
+	frame->cached = frame->resources;
+	frame->cachedCount = frame->resourceCount;
+	frame->cachedCapacity = frame->resourceCapacity;
+
+	frame->resources = cached;
+	frame->resourceCount = 0;
+	frame->resourceCapacity = cachedCapacity;
+
+
+	pool->frameIndex = frameIndex;
+}
+
+
+static VkResult vku_declareTransientResource(VkuTransientPool pool, const vku_transient_description *description, uint32_t firstUse, uint32_t lastUse, uint32_t *resourceIndex)
+{
+	assert(firstUse <= lastUse);
+	assert(resourceIndex);
+
+
+	vku_transient_frame *frame = &pool->frames[pool->frameIndex];
+
+	if (!vku_reserveArray((void**) &frame->resources, frame->resourceCount, &frame->resourceCapacity, sizeof(vku_transient_resource)))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	vku_transient_resource *resource = &frame->resources[frame->resourceCount];
+	memset(resource, 0, sizeof(vku_transient_resource));
+
+	resource->description = (*description);
+	resource->firstUse = firstUse;
+	resource->lastUse = lastUse;
+
+	(*resourceIndex) = frame->resourceCount++;
+
+	return VK_SUCCESS;
+}
+
+// Declares a buffer used from firstUse to lastUse (inclusive) in the current frame. The buffer is
+// available after vkuAllocateTransientResources(). pNext isn't supported and sharingMode must be exclusive.
+VKUAPI_ATTR VkResult vkuDeclareTransientBuffer(VkuTransientPool pool, const VkBufferCreateInfo *createInfo, uint32_t firstUse, uint32_t lastUse, uint32_t *resourceIndex)
+{
+	assert(pool);
+	assert(createInfo);
+	assert(!createInfo->pNext);
+	assert(createInfo->sharingMode == VK_SHARING_MODE_EXCLUSIVE);
+
+
+	vku_transient_description description;
+	memset(&description, 0, sizeof(description));
+
+	description.image = VK_FALSE;
+	description.flags = createInfo->flags;
+	description.usage = createInfo->usage;
+	description.size = createInfo->size;
+
+	return vku_declareTransientResource(pool, &description, firstUse, lastUse, resourceIndex);
+}
+
+// Declares an image used from firstUse to lastUse (inclusive) in the current frame. As the memory is shared,
+// the image's contents are undefined at its first use, so transition it from VK_IMAGE_LAYOUT_UNDEFINED.
+VKUAPI_ATTR VkResult vkuDeclareTransientImage(VkuTransientPool pool, const VkImageCreateInfo *createInfo, uint32_t firstUse, uint32_t lastUse, uint32_t *resourceIndex)
+{
+	assert(pool);
+	assert(createInfo);
+	assert(!createInfo->pNext);
+	assert(createInfo->sharingMode == VK_SHARING_MODE_EXCLUSIVE);
+
+
+	vku_transient_description description;
+	memset(&description, 0, sizeof(description));
+
+	description.image = VK_TRUE;
+	description.flags = createInfo->flags;
+	description.usage = createInfo->usage;
+	description.imageType = createInfo->imageType;
+	description.format = createInfo->format;
+	description.extent = createInfo->extent;
+	description.mipLevels = createInfo->mipLevels;
+	description.arrayLayers = createInfo->arrayLayers;
+	description.samples = createInfo->samples;
+	description.tiling = createInfo->tiling;
+	description.initialLayout = createInfo->initialLayout;
+
+	return vku_declareTransientResource(pool, &description, firstUse, lastUse, resourceIndex);
+}
+
+
+// Returns the index of the frame's group for the memory type and linearity, adding it if needed
+static VkResult vku_getTransientGroup(vku_transient_frame *frame, uint32_t memoryTypeIndex, VkBool32 linear, uint32_t *groupIndex)
+{
+	for ((*groupIndex) = 0; (*groupIndex) < frame->groupCount; (*groupIndex)++)
+	{
+		const vku_transient_group *group = &frame->groups[*groupIndex];
+
+		if ((group->memoryTypeIndex == memoryTypeIndex) && (group->linear == linear))
+			return VK_SUCCESS;
+	}
+
+
+	if (!vku_reserveArray((void**) &frame->groups, frame->groupCount, &frame->groupCapacity, sizeof(vku_transient_group)))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	vku_transient_group *group = &frame->groups[frame->groupCount++];
+	memset(group, 0, sizeof(vku_transient_group));
+
+	group->memoryTypeIndex = memoryTypeIndex;
+	group->linear = linear;
+
+	return VK_SUCCESS;
+}
+
+// First fit, moves the resource past every placed resource it overlaps in both time and memory, until it overlaps none
+static VkDeviceSize vku_findTransientOffset(const vku_transient_resource *resources, uint32_t placedCount, const uint32_t *placed, const vku_transient_resource *resource)
+{
+	const VkDeviceSize size = resource->memoryRequirements.size;
+	const VkDeviceSize alignment = resource->memoryRequirements.alignment ? resource->memoryRequirements.alignment : 1;
+
+	VkDeviceSize offset = 0;
+	VkBool32 moved;
+
+	do
+	{
+		moved = VK_FALSE;
+
+		for (uint32_t placedIndex = 0; placedIndex < placedCount; placedIndex++)
+		{
+			const vku_transient_resource *other = &resources[placed[placedIndex]];
+
+			if ((other->lastUse < resource->firstUse) || (resource->lastUse < other->firstUse))
+				continue;
+
+			const VkDeviceSize otherEnd = other->offset + other->memoryRequirements.size;
+
+			if ((offset < otherEnd) && (other->offset < (offset + size)))
+			{
+				offset = ((otherEnd + alignment - 1) / alignment) * alignment;
+				moved = VK_TRUE;
+			}
+		}
+	}
+	while (moved);
+
+	return offset;
+}
+
+static VkResult vku_packTransientGroup(VkuTransientPool pool, vku_transient_frame *frame, uint32_t groupIndex)
+{
+	vku_transient_group *group = &frame->groups[groupIndex];
+
+	group->requiredSize = 0;
+	group->requiredAlignment = 1;
+
+
+	// The largest resources are placed first, which leaves fewer holes
+	uint32_t orderCount = 0;
+
+	for (uint32_t resourceIndex = 0; resourceIndex < frame->resourceCount; resourceIndex++)
+	{
+		const vku_transient_resource *resource = &frame->resources[resourceIndex];
+
+		if (resource->groupIndex != groupIndex)
+			continue;
+
+		if (!vku_reserveArray((void**) &pool->order, orderCount, &pool->orderCapacity, sizeof(uint32_t)))
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+		uint32_t insertIndex = orderCount++;
+
+		while ((insertIndex > 0) && (frame->resources[pool->order[insertIndex - 1]].memoryRequirements.size < resource->memoryRequirements.size))
+		{
+			pool->order[insertIndex] = pool->order[insertIndex - 1];
+			insertIndex--;
+		}
+
+		pool->order[insertIndex] = resourceIndex;
+	}
+
+
+	for (uint32_t orderIndex = 0; orderIndex < orderCount; orderIndex++)
+	{
+		vku_transient_resource *resource = &frame->resources[pool->order[orderIndex]];
+
+		resource->offset = vku_findTransientOffset(frame->resources, orderIndex, pool->order, resource);
+
+		const VkDeviceSize end = resource->offset + resource->memoryRequirements.size;
+
+		if (end > group->requiredSize)
+			group->requiredSize = end;
+
+		if (resource->memoryRequirements.alignment > group->requiredAlignment)
+			group->requiredAlignment = resource->memoryRequirements.alignment;
+	}
+
+	return VK_SUCCESS;
+}
+
+
+// Creates or reuses the handles of the current frame's resources, packs them and binds them to the frame's memory.
+// A handle is reused if the last time the frame was current a resource had the same description, and it's
+// placed at the same offset, which is the case as long as the frame's declarations stay the same.
+VKUAPI_ATTR VkResult vkuAllocateTransientResources(VkuTransientPool pool)
+{
+	assert(pool);
+
+
+	vku_transient_frame *frame = &pool->frames[pool->frameIndex];
+
+	pool->statistics.resourceCount = frame->resourceCount;
+	pool->statistics.createdCount = 0;
+	pool->statistics.reusedCount = 0;
+	pool->statistics.naiveSize = 0;
+	pool->statistics.aliasedSize = 0;
+
+
+	VkResult err = VK_SUCCESS;
+
+	for (uint32_t resourceIndex = 0; !err && (resourceIndex < frame->resourceCount); resourceIndex++)
+	{
+		vku_transient_resource *resource = &frame->resources[resourceIndex];
+
+		for (uint32_t cachedIndex = 0; !resource->buffer && !resource->image && (cachedIndex < frame->cachedCount); cachedIndex++)
+		{
+			vku_transient_resource *cached = &frame->cached[cachedIndex];
+
+			if ((!cached->buffer && !cached->image) || memcmp(&cached->description, &resource->description, sizeof(vku_transient_description)))
+				continue;
+
+			resource->buffer = cached->buffer;
+			resource->image = cached->image;
+			resource->memoryRequirements = cached->memoryRequirements;
+			resource->boundSerial = cached->boundSerial;
+			resource->boundOffset = cached->boundOffset;
+
+			cached->buffer = VK_NULL_HANDLE;
+			cached->image = VK_NULL_HANDLE;
+
+			pool->statistics.reusedCount++;
+		}
+
+		if (!resource->buffer && !resource->image)
+		{
+			err = vku_createTransientHandle(pool, resource);
+
+			if (err)
+				break;
+
+			pool->statistics.createdCount++;
+		}
+
+
+		uint32_t memoryTypeIndex;
+		err = vkuFindMemoryTypeIndex(&pool->allocator->memoryProperties, resource->memoryRequirements.memoryTypeBits, pool->requiredFlags, 0, &memoryTypeIndex);
+
+		if (!err)
+		{
+			const VkBool32 linear = (!resource->description.image || (resource->description.tiling == VK_IMAGE_TILING_LINEAR)) ? VK_TRUE : VK_FALSE;
+
+			err = vku_getTransientGroup(frame, memoryTypeIndex, linear, &resource->groupIndex);
+		}
+
+		pool->statistics.naiveSize += resource->memoryRequirements.size;
+	}
+
+
+	for (uint32_t groupIndex = 0; !err && (groupIndex < frame->groupCount); groupIndex++)
+	{
+		err = vku_packTransientGroup(pool, frame, groupIndex);
+
+		if (err)
+			break;
+
+
+		vku_transient_group *group = &frame->groups[groupIndex];
+
+		pool->statistics.aliasedSize += group->requiredSize;
+
+		if (group->requiredSize > 0)
+			group->idleCount = 0;
+		else
+			group->idleCount++;
+
+		// The handles bound to the old allocation are recreated below
+		if (group->allocation && ((group->allocationSize < group->requiredSize) || (group->idleCount >= pool->idleLimit)))
+			vku_freeTransientGroup(pool, group);
+
+		if (!group->allocation && (group->requiredSize > 0))
+		{
+			VkMemoryRequirements memoryRequirements;
+			memoryRequirements.size = group->requiredSize;
+			memoryRequirements.alignment = group->requiredAlignment;
+			memoryRequirements.memoryTypeBits = 1u << group->memoryTypeIndex;
+
+			VkuAllocationCreateInfo allocationCreateInfo;
+			memset(&allocationCreateInfo, 0, sizeof(allocationCreateInfo));
+
+			allocationCreateInfo.requiredFlags = pool->requiredFlags;
+			allocationCreateInfo.linear = group->linear;
+
+			err = vkuAllocateMemory(pool->allocator, &memoryRequirements, &allocationCreateInfo, &group->allocation);
+
+			if (err)
+				break;
+
+			group->allocationSize = group->requiredSize;
+			group->allocationSerial = ++pool->allocationSerial;
+
+			pool->statistics.allocatedSize += group->allocationSize;
+		}
+	}
+
+
+	for (uint32_t resourceIndex = 0; !err && (resourceIndex < frame->resourceCount); resourceIndex++)
+	{
+		vku_transient_resource *resource = &frame->resources[resourceIndex];
+		const vku_transient_group *group = &frame->groups[resource->groupIndex];
+
+		if ((resource->boundSerial == group->allocationSerial) && (resource->boundOffset == resource->offset))
+			continue;
+
+		// A bound handle can't be bound again
+		if (resource->boundSerial)
+		{
+			vku_destroyTransientHandle(pool, resource);
+
+			err = vku_createTransientHandle(pool, resource);
+
+			if (err)
+				break;
+
+			pool->statistics.reusedCount--;
+			pool->statistics.createdCount++;
+		}
+
+		const VkDeviceSize offset = group->allocation->offset + resource->offset;
+
+		if (resource->image)
+			err = vkBindImageMemory(pool->device, resource->image, group->allocation->memory, offset);
+		else
+			err = vkBindBufferMemory(pool->device, resource->buffer, group->allocation->memory, offset);
+
+		if (!err)
+		{
+			resource->boundSerial = group->allocationSerial;
+			resource->boundOffset = resource->offset;
+		}
+	}
+
+
+	// The handles which weren't reused
+	for (uint32_t cachedIndex = 0; cachedIndex < frame->cachedCount; cachedIndex++)
+		vku_destroyTransientHandle(pool, &frame->cached[cachedIndex]);
+
+	frame->cachedCount = 0;
+
+
+	if (pool->statistics.aliasedSize > pool->statistics.peakAliasedSize)
+		pool->statistics.peakAliasedSize = pool->statistics.aliasedSize;
+
+	return err;
+}
+
+
+VKUAPI_ATTR VkBuffer vkuGetTransientBuffer(VkuTransientPool pool, uint32_t resourceIndex)
+{
+	assert(pool);
+	assert(resourceIndex < pool->frames[pool->frameIndex].resourceCount);
+
+	return pool->frames[pool->frameIndex].resources[resourceIndex].buffer;
+}
+
+VKUAPI_ATTR VkImage vkuGetTransientImage(VkuTransientPool pool, uint32_t resourceIndex)
+{
+	assert(pool);
+	assert(resourceIndex < pool->frames[pool->frameIndex].resourceCount);
+
+	return pool->frames[pool->frameIndex].resources[resourceIndex].image;
+}
+
+
+// Frees the memory of the current frame's memory types which its last vkuAllocateTransientResources() didn't
+// use, without waiting for the idle limit. Like the allocation, it's called after vkuBeginTransientPoolFrame().
+VKUAPI_ATTR void vkuTrimTransientPool(VkuTransientPool pool)
+{
+	assert(pool);
+
+
+	vku_transient_frame *frame = &pool->frames[pool->frameIndex];
+
+	for (uint32_t groupIndex = 0; groupIndex < frame->groupCount; groupIndex++)
+	{
+		vku_transient_group *group = &frame->groups[groupIndex];
+
+		if (group->allocation && (group->requiredSize == 0))
+			vku_freeTransientGroup(pool, group);
+	}
+}
+
+
+VKUAPI_ATTR void vkuGetTransientPoolStatistics(VkuTransientPool pool, VkuTransientPoolStatistics *statistics)
+{
+	assert(pool);
+	assert(statistics);
+
+	(*statistics) = pool->statistics;
+}
+
+
+// Pass graphs, where each pass declares the buffers and images it reads and writes, after which vku tracks the state
+// of each resource and records the barriers. The barriers before a pass, or a batch of independent passes when
+// reordering, are merged into a single vkCmdPipelineBarrier(), using the stages of the accesses instead of ALL_COMMANDS.
+
+typedef struct VkuPassGraph_T* VkuPassGraph;
+
+
+// Records the pass's commands
+typedef void (VKAPI_PTR *PFN_vkuRecordPass)(void *pUserData, VkCommandBuffer commandBuffer);
+
+
+typedef struct VkuPassGraphStatistics
+{
+	// Of the last vkuCmdExecutePassGraph()
+	uint32_t passCount;
+
+	// The groups of passes sharing a barrier, which is the amount of passes without reordering
+	uint32_t batchCount;
+
+	// The vkCmdPipelineBarrier() calls, versus the hazards, i.e. the calls if each hazard got its own barrier
+	uint32_t barrierCount;
+	uint32_t hazardCount;
+
+	uint32_t imageBarrierCount;
+} VkuPassGraphStatistics;
+
+
+typedef struct vku_pass_resource
+{
+	VkBuffer buffer;
+	VkImage image;
+	VkImageAspectFlags aspectMask;
+
+	VkImageLayout layout;
+
+	// The last write, and the reads since then
+	VkPipelineStageFlags writeStages;
+	VkAccessFlags writeAccess;
+	VkPipelineStageFlags readStages;
+
+	// The stages and access the last write has been made visible to
+	VkPipelineStageFlags visibleStages;
+	VkAccessFlags visibleAccess;
+} vku_pass_resource;
+
+
+typedef struct vku_pass_access
+{
+	uint32_t resourceIndex;
+
+	VkPipelineStageFlags stageMask;
+	VkAccessFlags accessMask;
+	VkImageLayout layout;
+
+	VkBool32 write;
+} vku_pass_access;
+
+
+typedef struct vku_pass
+{
+	PFN_vkuRecordPass pfnRecord;
+	void *pUserData;
+
+	uint32_t firstAccess;
+	uint32_t accessCount;
+
+	uint32_t level;
+} vku_pass;
+
+
+// The levels of the last write and reads of a resource, used when reordering
+typedef struct vku_pass_resource_levels
+{
+	uint32_t writeLevel;
+	uint32_t readLevel;
+
+	VkImageLayout layout;
+} vku_pass_resource_levels;
+
+
+struct VkuPassGraph_T
+{
+	uint32_t resourceCount;
+	uint32_t resourceCapacity;
+	vku_pass_resource *resources;
+
+	uint32_t passCount;
+	uint32_t passCapacity;
+	vku_pass *passes;
+
+	uint32_t accessCount;
+	uint32_t accessCapacity;
+	vku_pass_access *accesses;
+
+	// Scratch for vkuCmdExecutePassGraph()
+	uint32_t orderCapacity;
+	uint32_t *order;
+
+	uint32_t levelCapacity;
+	vku_pass_resource_levels *levels;
+
+	uint32_t imageBarrierCapacity;
+	VkImageMemoryBarrier *imageBarriers;
+
+	VkuPassGraphStatistics statistics;
+};
+
+
+VKUAPI_ATTR VkResult vkuCreatePassGraph(VkuPassGraph *graph)
+{
+	assert(graph);
+
+
+	(*graph) = (VkuPassGraph) VKU_CALLOC(1, sizeof(struct VkuPassGraph_T));
+
+	if (!(*graph))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	return VK_SUCCESS;
+}
+
+VKUAPI_ATTR void vkuDestroyPassGraph(VkuPassGraph graph)
+{
+	if (!graph)
+		return;
+
+
+	VKU_FREE(graph->resources);
+	VKU_FREE(graph->passes);
+	VKU_FREE(graph->accesses);
+	VKU_FREE(graph->order);
+	VKU_FREE(graph->levels);
+	VKU_FREE(graph->imageBarriers);
+
+	VKU_FREE(graph);
+}
+
+
+static VkResult vku_importPassResource(VkuPassGraph graph, VkBuffer buffer, VkImage image, VkImageAspectFlags aspectMask, VkImageLayout layout, uint32_t *resourceIndex)
+{
+	assert(graph);
+	assert(resourceIndex);
+
+
+	for ((*resourceIndex) = 0; (*resourceIndex) < graph->resourceCount; (*resourceIndex)++)
+	{
+		const vku_pass_resource *resource = &graph->resources[*resourceIndex];
+
+		if ((resource->buffer == buffer) && (resource->image == image))
+			return VK_SUCCESS;
+	}
+
+
+	if (!vku_reserveArray((void**) &graph->resources, graph->resourceCount, &graph->resourceCapacity, sizeof(vku_pass_resource)))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	vku_pass_resource *resource = &graph->resources[graph->resourceCount];
+	memset(resource, 0, sizeof(vku_pass_resource));
+
+	resource->buffer = buffer;
+	resource->image = image;
+	resource->aspectMask = aspectMask;
+	resource->layout = layout;
+
+	(*resourceIndex) = graph->resourceCount++;
+
+	return VK_SUCCESS;
+}
+
+// Adds the buffer to the resources tracked by the graph, or returns the resource of the buffer if it's
+// already tracked. The resources stay tracked across executions, such that their state carries over.
+VKUAPI_ATTR VkResult vkuImportPassGraphBuffer(VkuPassGraph graph, VkBuffer buffer, uint32_t *resourceIndex)
+{
+	assert(buffer);
+
+	return vku_importPassResource(graph, buffer, VK_NULL_HANDLE, 0, VK_IMAGE_LAYOUT_UNDEFINED, resourceIndex);
+}
+
+// The same as vkuImportPassGraphBuffer(), where layout is the image's current layout. All the mip
+// levels and array layers of the aspects are tracked together.
+VKUAPI_ATTR VkResult vkuImportPassGraphImage(VkuPassGraph graph, VkImage image, VkImageAspectFlags aspectMask, VkImageLayout layout, uint32_t *resourceIndex)
+{
+	assert(image);
+	assert(aspectMask);
+
+	return vku_importPassResource(graph, VK_NULL_HANDLE, image, aspectMask, layout, resourceIndex);
+}
+
+// The layout the image is in, after the executed passes
+VKUAPI_ATTR VkImageLayout vkuGetPassGraphImageLayout(VkuPassGraph graph, uint32_t resourceIndex)
+{
+	assert(graph);
+	assert(resourceIndex < graph->resourceCount);
+
+	return graph->resources[resourceIndex].layout;
+}
+
+// Stops tracking all the resources, e.g. when they're destroyed
+VKUAPI_ATTR void vkuResetPassGraphResources(VkuPassGraph graph)
+{
+	assert(graph);
+
+	graph->resourceCount = 0;
+}
+
+
+// Removes the passes of the last execution
+VKUAPI_ATTR void vkuBeginPassGraph(VkuPassGraph graph)
+{
+	assert(graph);
+
+	graph->passCount = 0;
+	graph->accessCount = 0;
+}
+
+// Adds a pass, after which its reads and writes are added using vkuAddPassRead() and vkuAddPassWrite()
+VKUAPI_ATTR VkResult vkuAddPass(VkuPassGraph graph, PFN_vkuRecordPass pfnRecord, void *pUserData)
+{
+	assert(graph);
+	assert(pfnRecord);
+
+
+	if (!vku_reserveArray((void**) &graph->passes, graph->passCount, &graph->passCapacity, sizeof(vku_pass)))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	vku_pass *pass = &graph->passes[graph->passCount++];
+	memset(pass, 0, sizeof(vku_pass));
+
+	pass->pfnRecord = pfnRecord;
+	pass->pUserData = pUserData;
+	pass->firstAccess = graph->accessCount;
+
+	return VK_SUCCESS;
+}
+
+static VkResult vku_addPassAccess(VkuPassGraph graph, uint32_t resourceIndex, VkPipelineStageFlags stageMask, VkAccessFlags accessMask, VkImageLayout layout, VkBool32 write)
+{
+	assert(graph);
+	assert(graph->passCount > 0);
+	assert(resourceIndex < graph->resourceCount);
+	assert(stageMask);
+
+
+	if (!vku_reserveArray((void**) &graph->accesses, graph->accessCount, &graph->accessCapacity, sizeof(vku_pass_access)))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	vku_pass_access *access = &graph->accesses[graph->accessCount++];
+
+	access->resourceIndex = resourceIndex;
+	access->stageMask = stageMask;
+	access->accessMask = accessMask;
+	access->layout = graph->resources[resourceIndex].image ? layout : VK_IMAGE_LAYOUT_UNDEFINED;
+	access->write = write;
+
+	graph->passes[graph->passCount - 1].accessCount++;
+
+	return VK_SUCCESS;
+}
+
+// The last added pass reads the resource in the stages, where the layout is ignored for buffers.
+// A resource read and written by the same pass is only added as a write, with both access flags.
+VKUAPI_ATTR VkResult vkuAddPassRead(VkuPassGraph graph, uint32_t resourceIndex, VkPipelineStageFlags stageMask, VkAccessFlags accessMask, VkImageLayout layout)
+{
+	return vku_addPassAccess(graph, resourceIndex, stageMask, accessMask, layout, VK_FALSE);
+}
+
+VKUAPI_ATTR VkResult vkuAddPassWrite(VkuPassGraph graph, uint32_t resourceIndex, VkPipelineStageFlags stageMask, VkAccessFlags accessMask, VkImageLayout layout)
+{
+	return vku_addPassAccess(graph, resourceIndex, stageMask, accessMask, layout, VK_TRUE);
+}
+
+
+// Sets the level of each pass to one more than the levels of the passes it depends on, such that the passes
+// of a level are independent. A pass depends on the earlier passes writing what it reads, reading or writing
+// what it writes, or using an image in another layout.
+static void vku_levelPasses(VkuPassGraph graph, uint32_t *levelCount)
+{
+	for (uint32_t resourceIndex = 0; resourceIndex < graph->resourceCount; resourceIndex++)
+	{
+		graph->levels[resourceIndex].writeLevel = 0;
+		graph->levels[resourceIndex].readLevel = 0;
+		graph->levels[resourceIndex].layout = graph->resources[resourceIndex].layout;
+	}
+
+	// The levels are stored plus one, such that 0 means no pass
+	(*levelCount) = 0;
+
+	for (uint32_t passIndex = 0; passIndex < graph->passCount; passIndex++)
+	{
+		vku_pass *pass = &graph->passes[passIndex];
+
+		uint32_t level = 1;
+
+		for (uint32_t accessIndex = pass->firstAccess; accessIndex < (pass->firstAccess + pass->accessCount); accessIndex++)
+		{
+			const vku_pass_access *access = &graph->accesses[accessIndex];
+			const vku_pass_resource_levels *levels = &graph->levels[access->resourceIndex];
+
+			uint32_t after = levels->writeLevel;
+
+			if (access->write || (access->layout != levels->layout))
+				after = (levels->readLevel > after) ? levels->readLevel : after;
+
+			if ((after + 1) > level)
+				level = after + 1;
+		}
+
+		for (uint32_t accessIndex = pass->firstAccess; accessIndex < (pass->firstAccess + pass->accessCount); accessIndex++)
+		{
+			const vku_pass_access *access = &graph->accesses[accessIndex];
+			vku_pass_resource_levels *levels = &graph->levels[access->resourceIndex];
+
+			// A layout transition is a write
+			if (access->write || (access->layout != levels->layout))
+			{
+				levels->writeLevel = level;
+				levels->readLevel = 0;
+				levels->layout = access->layout;
+			}
+			else if (level > levels->readLevel)
+				levels->readLevel = level;
+		}
+
+		pass->level = level - 1;
+
+		if (level > (*levelCount))
+			(*levelCount) = level;
+	}
+}
+
+
+// The barrier merged from the hazards of a batch of passes
+typedef struct vku_pass_barrier
+{
+	VkPipelineStageFlags srcStageMask;
+	VkPipelineStageFlags dstStageMask;
+
+	VkAccessFlags srcAccessMask;
+	VkAccessFlags dstAccessMask;
+
+	uint32_t imageBarrierCount;
+} vku_pass_barrier;
+
+
+static VkResult vku_transitionPassResource(VkuPassGraph graph, const vku_pass_access *access, vku_pass_barrier *barrier)
+{
+	vku_pass_resource *resource = &graph->resources[access->resourceIndex];
+
+	const VkBool32 layoutTransition = (resource->image && (access->layout != resource->layout)) ? VK_TRUE : VK_FALSE;
+
+	if (layoutTransition)
+	{
+		if (!vku_reserveArray((void**) &graph->imageBarriers, barrier->imageBarrierCount, &graph->imageBarrierCapacity, sizeof(VkImageMemoryBarrier)))
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+		VkImageMemoryBarrier *imageBarrier = &graph->imageBarriers[barrier->imageBarrierCount++];
+		memset(imageBarrier, 0, sizeof(VkImageMemoryBarrier));
+
+		imageBarrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier->srcAccessMask = resource->writeAccess;
+		imageBarrier->dstAccessMask = access->accessMask;
+		imageBarrier->oldLayout = resource->layout;
+		imageBarrier->newLayout = access->layout;
+		imageBarrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier->image = resource->image;
+		imageBarrier->subresourceRange.aspectMask = resource->aspectMask;
+		imageBarrier->subresourceRange.baseMipLevel = 0;
+		imageBarrier->subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		imageBarrier->subresourceRange.baseArrayLayer = 0;
+		imageBarrier->subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+		barrier->srcStageMask |= resource->writeStages | resource->readStages;
+		barrier->dstStageMask |= access->stageMask;
+
+		graph->statistics.hazardCount++;
+		graph->statistics.imageBarrierCount++;
+
+		// The transition's writes are visible to the access
+		resource->layout = access->layout;
+		resource->writeStages = access->stageMask;
+		resource->writeAccess = access->write ? access->accessMask : 0;
+		resource->readStages = access->write ? 0 : access->stageMask;
+		resource->visibleStages = access->stageMask;
+		resource->visibleAccess = access->accessMask;
+
+		return VK_SUCCESS;
+	}
+
+
+	if (access->write)
+	{
+		// Write after write and write after read
+		if (resource->writeStages || resource->readStages)
+		{
+			barrier->srcStageMask |= resource->writeStages | resource->readStages;
+			barrier->dstStageMask |= access->stageMask;
+			barrier->srcAccessMask |= resource->writeAccess;
+			barrier->dstAccessMask |= resource->writeAccess ? access->accessMask : 0;
+
+			graph->statistics.hazardCount++;
+		}
+
+		resource->writeStages = access->stageMask;
+		resource->writeAccess = access->accessMask;
+		resource->readStages = 0;
+		resource->visibleStages = 0;
+		resource->visibleAccess = 0;
+	}
+	else
+	{
+		// Read after write, unless the write is already visible to the stages and access
+		if (resource->writeStages && (((resource->visibleStages & access->stageMask) != access->stageMask) || ((resource->visibleAccess & access->accessMask) != access->accessMask)))
+		{
+			barrier->srcStageMask |= resource->writeStages;
+			barrier->dstStageMask |= access->stageMask;
+			barrier->srcAccessMask |= resource->writeAccess;
+			barrier->dstAccessMask |= access->accessMask;
+
+			resource->visibleStages |= access->stageMask;
+			resource->visibleAccess |= access->accessMask;
+
+			graph->statistics.hazardCount++;
+		}
+
+		resource->readStages |= access->stageMask;
+	}
+
+	return VK_SUCCESS;
+}
+
+
+// Records the passes into the command buffer, with the barriers in between. If reorder is VK_TRUE, then the
+// passes are grouped by their dependencies, such that the independent passes share a single barrier and run
+// without stalling in between. Otherwise the passes are recorded in the order they were added.
+VKUAPI_ATTR VkResult vkuCmdExecutePassGraph(VkuPassGraph graph, VkCommandBuffer commandBuffer, VkBool32 reorder)
+{
+	assert(graph);
+	assert(commandBuffer);
+
+
+	memset(&graph->statistics, 0, sizeof(VkuPassGraphStatistics));
+
+	graph->statistics.passCount = graph->passCount;
+
+	if (graph->passCount < 1)
+		return VK_SUCCESS;
+
+
+	if (!vku_reserveArray((void**) &graph->order, graph->passCount, &graph->orderCapacity, sizeof(uint32_t)))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	if (!vku_reserveArray((void**) &graph->levels, graph->resourceCount, &graph->levelCapacity, sizeof(vku_pass_resource_levels)))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	uint32_t batchCount = graph->passCount;
+
+	if (reorder)
+		vku_levelPasses(graph, &batchCount);
+	else
+	{
+		for (uint32_t passIndex = 0; passIndex < graph->passCount; passIndex++)
+			graph->passes[passIndex].level = passIndex;
+	}
+
+	// Stable, such that the passes of a batch keep the order they were added in
+	uint32_t orderCount = 0;
+
+	for (uint32_t level = 0; level < batchCount; level++)
+		for (uint32_t passIndex = 0; passIndex < graph->passCount; passIndex++)
+			if (graph->passes[passIndex].level == level)
+				graph->order[orderCount++] = passIndex;
+
+	graph->statistics.batchCount = batchCount;
+
+
+	for (uint32_t orderIndex = 0; orderIndex < orderCount; )
+	{
+		const uint32_t level = graph->passes[graph->order[orderIndex]].level;
+
+		uint32_t orderEnd = orderIndex;
+
+		while ((orderEnd < orderCount) && (graph->passes[graph->order[orderEnd]].level == level))
+			orderEnd++;
+
+
+		vku_pass_barrier barrier;
+		memset(&barrier, 0, sizeof(barrier));
+
+		for (uint32_t batchIndex = orderIndex; batchIndex < orderEnd; batchIndex++)
+		{
+			const vku_pass *pass = &graph->passes[graph->order[batchIndex]];
+
+			for (uint32_t accessIndex = pass->firstAccess; accessIndex < (pass->firstAccess + pass->accessCount); accessIndex++)
+			{
+				VkResult err = vku_transitionPassResource(graph, &graph->accesses[accessIndex], &barrier);
+
+				if (err)
+					return err;
+			}
+		}
+
+		if (barrier.dstStageMask)
+		{
+			VkMemoryBarrier memoryBarrier;
+			memset(&memoryBarrier, 0, sizeof(memoryBarrier));
+
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = barrier.srcAccessMask;
+			memoryBarrier.dstAccessMask = barrier.dstAccessMask;
+
+			// Nothing to wait for, e.g. the first use of an image in VK_IMAGE_LAYOUT_UNDEFINED
+			const VkPipelineStageFlags srcStageMask = barrier.srcStageMask ? barrier.srcStageMask : (VkPipelineStageFlags) VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, srcStageMask, barrier.dstStageMask, 0,
+				memoryBarrier.dstAccessMask ? 1 : 0, &memoryBarrier, 0, NULL,
+				barrier.imageBarrierCount, graph->imageBarriers);
+
+			graph->statistics.barrierCount++;
+		}
+
+
+		for (uint32_t batchIndex = orderIndex; batchIndex < orderEnd; batchIndex++)
+		{
+			const vku_pass *pass = &graph->passes[graph->order[batchIndex]];
+
+			pass->pfnRecord(pass->pUserData, commandBuffer);
+		}
+
+		orderIndex = orderEnd;
+	}
+
+
+	return VK_SUCCESS;
+}
+
+
+VKUAPI_ATTR void vkuGetPassGraphStatistics(VkuPassGraph graph, VkuPassGraphStatistics *statistics)
+{
+	assert(graph);
+	assert(statistics);
+
+	(*statistics) = graph->statistics;
+}
+
+
+// XXH64, used for hashing the SPIR-V, as it's several times faster than FNV-1a for large inputs
+
+#define VKU_XXH64_PRIME_1 0x9E3779B185EBCA87ull
+#define VKU_XXH64_PRIME_2 0xC2B2AE3D27D4EB4Full
+#define VKU_XXH64_PRIME_3 0x165667B19E3779F9ull
+#define VKU_XXH64_PRIME_4 0x85EBCA77C2B2AE63ull
+#define VKU_XXH64_PRIME_5 0x27D4EB2F165667C5ull
+
+
+static uint64_t vku_rotateLeft64(uint64_t value, uint32_t bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t vku_xxh64Round(uint64_t accumulator, uint64_t input)
+{
+	accumulator += input * VKU_XXH64_PRIME_2;
+	accumulator = vku_rotateLeft64(accumulator, 31);
+
+	return accumulator * VKU_XXH64_PRIME_1;
+}
+
+static uint64_t vku_xxh64MergeRound(uint64_t accumulator, uint64_t value)
+{
+	accumulator ^= vku_xxh64Round(0, value);
+
+	return accumulator * VKU_XXH64_PRIME_1 + VKU_XXH64_PRIME_4;
+}
+
+// The words are read in the native byte order, so the hashes only match XXH64's on little-endian machines
+static uint64_t vku_xxh64(const void *data, size_t size, uint64_t seed)
+{
+	const uint8_t *bytes = (const uint8_t*) data;
+	const uint8_t *end = bytes + size;
+
+	uint64_t hash;
+
+	if (size >= 32)
+	{
+		uint64_t accumulators[4] = {
+			seed + VKU_XXH64_PRIME_1 + VKU_XXH64_PRIME_2,
+			seed + VKU_XXH64_PRIME_2,
+			seed,
+			seed - VKU_XXH64_PRIME_1
+		};
+
+		for (; (end - bytes) >= 32; bytes += 32)
+		{
+			for (uint32_t lane = 0; lane < 4; lane++)
+			{
+				uint64_t input;
+				memcpy(&input, bytes + lane * 8, 8);
+
+				accumulators[lane] = vku_xxh64Round(accumulators[lane], input);
+			}
+		}
+
+		hash = vku_rotateLeft64(accumulators[0], 1) + vku_rotateLeft64(accumulators[1], 7) +
+			vku_rotateLeft64(accumulators[2], 12) + vku_rotateLeft64(accumulators[3], 18);
+
+		for (uint32_t lane = 0; lane < 4; lane++)
+			hash = vku_xxh64MergeRound(hash, accumulators[lane]);
+	}
+	else
+		hash = seed + VKU_XXH64_PRIME_5;
+
+	hash += (uint64_t) size;
+
+
+	for (; (end - bytes) >= 8; bytes += 8)
+	{
+		uint64_t input;
+		memcpy(&input, bytes, 8);
+
+		hash ^= vku_xxh64Round(0, input);
+		hash = vku_rotateLeft64(hash, 27) * VKU_XXH64_PRIME_1 + VKU_XXH64_PRIME_4;
+	}
+
+	if ((end - bytes) >= 4)
+	{
+		uint32_t input;
+		memcpy(&input, bytes, 4);
+
+		hash ^= ((uint64_t) input) * VKU_XXH64_PRIME_1;
+		hash = vku_rotateLeft64(hash, 23) * VKU_XXH64_PRIME_2 + VKU_XXH64_PRIME_3;
+
+		bytes += 4;
+	}
+
+	for (; bytes < end; bytes++)
+	{
+		hash ^= ((uint64_t) (*bytes)) * VKU_XXH64_PRIME_5;
+		hash = vku_rotateLeft64(hash, 11) * VKU_XXH64_PRIME_1;
+	}
+
+
+	hash ^= hash >> 33;
+	hash *= VKU_XXH64_PRIME_2;
+	hash ^= hash >> 29;
+	hash *= VKU_XXH64_PRIME_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+
+
+// A cache of VkShaderModules keyed by the XXH64 hash and size of their SPIR-V, such that identical SPIR-V,
+// whether from a file or from memory, gives the same VkShaderModule. The modules are reference counted.
+
+typedef struct VkuShaderCache_T* VkuShaderCache;
+
+
+typedef struct VkuShaderCacheStatistics
+{
+	uint32_t moduleCount;
+	uint32_t referencedModuleCount;
+
+	// Acquiring a module which is in the cache is a hit
+	uint64_t acquireCount;
+	uint64_t hitCount;
+
+	// Nanoseconds spent mapping and hashing files, and in vkCreateShaderModule()
+	uint64_t loadTime;
+	uint64_t hashTime;
+	uint64_t createTime;
+
+	// The nanoseconds vkCreateShaderModule() took for each module, summed for each hit
+	uint64_t savedTime;
+} VkuShaderCacheStatistics;
+
+
+typedef struct vku_shader_entry
+{
+	uint64_t hash;
+	size_t codeSize;
+
+	VkShaderModule module;
+	uint32_t referenceCount;
+
+	uint64_t createTime;
+} vku_shader_entry;
+
+
+struct VkuShaderCache_T
+{
+	VkDevice device;
+	const VkAllocationCallbacks *pAllocator;
+
+	vku_mutex mutex;
+
+	// The same entries, sorted by (hash, size) and by handle
+	uint32_t entryCount;
+	uint32_t entryCapacity;
+	vku_shader_entry **entriesByHash;
+	vku_shader_entry **entriesByHandle;
+
+	VkuShaderCacheStatistics statistics;
+};
+
+
+VKUAPI_ATTR VkResult vkuCreateShaderCache(VkDevice device, const VkAllocationCallbacks *pAllocator, VkuShaderCache *cache)
+{
+	assert(device);
+	assert(cache);
+
+
+	(*cache) = (VkuShaderCache) VKU_CALLOC(1, sizeof(struct VkuShaderCache_T));
+
+	if (!(*cache))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	(*cache)->device = device;
+	(*cache)->pAllocator = pAllocator;
+
+	vku_initMutex(&(*cache)->mutex);
+
+	return VK_SUCCESS;
+}
+
+// Destroys all the VkShaderModules, including the ones which are still referenced
+VKUAPI_ATTR void vkuDestroyShaderCache(VkuShaderCache cache)
+{
+	if (!cache)
+		return;
+
+	for (uint32_t entryIndex = 0; entryIndex < cache->entryCount; entryIndex++)
+	{
+		vkDestroyShaderModule(cache->device, cache->entriesByHash[entryIndex]->module, cache->pAllocator);
+		VKU_FREE(cache->entriesByHash[entryIndex]);
+	}
+
+	vku_destroyMutex(&cache->mutex);
+
+	VKU_FREE(cache->entriesByHash);
+	VKU_FREE(cache->entriesByHandle);
+	VKU_FREE(cache);
+}
+
+
+// Returns the index of the first entry in the cache with a (hash, size) greater than or equal to (hash, codeSize)
+static uint32_t vku_lowerBoundShaderHash(VkuShaderCache cache, uint64_t hash, size_t codeSize)
+{
+	uint32_t first = 0, last = cache->entryCount;
+
+	while (first < last)
+	{
+		const uint32_t middle = first + (last - first) / 2;
+		const vku_shader_entry *entry = cache->entriesByHash[middle];
+
+		if ((entry->hash < hash) || ((entry->hash == hash) && (entry->codeSize < codeSize)))
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	return first;
+}
+
+// Returns the index of the first entry in the cache with a handle greater than or equal to module
+static uint32_t vku_lowerBoundShaderHandle(VkuShaderCache cache, VkShaderModule module)
+{
+	uint32_t first = 0, last = cache->entryCount;
+
+	while (first < last)
+	{
+		const uint32_t middle = first + (last - first) / 2;
+
+		if (cache->entriesByHandle[middle]->module < module)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	return first;
+}
+
+
+// Gets the VkShaderModule for the SPIR-V from the cache, or creates it if it isn't in it, and adds a reference,
+// which is released with vkuReleaseShaderModule(). Modules are identified by the hash and size of the SPIR-V,
+// so the code itself isn't compared. The cache is internally synchronized.
+VKUAPI_ATTR VkResult vkuAcquireShaderModule(VkuShaderCache cache, size_t codeSize, const uint32_t *pCode, VkShaderModule *module)
+{
+	assert(cache);
+	assert(codeSize > 0);
+	assert(pCode);
+	assert(module);
+
+
+	const uint64_t hashStart = vku_getTime();
+	const uint64_t hash = vku_xxh64(pCode, codeSize, 0);
+	const uint64_t hashTime = vku_getTime() - hashStart;
+
+
+	vku_lockMutex(&cache->mutex);
+
+	cache->statistics.acquireCount++;
+	cache->statistics.hashTime += hashTime;
+
+	const uint32_t hashIndex = vku_lowerBoundShaderHash(cache, hash, codeSize);
+
+	if (hashIndex < cache->entryCount)
+	{
+		vku_shader_entry *entry = cache->entriesByHash[hashIndex];
+
+		if ((entry->hash == hash) && (entry->codeSize == codeSize))
+		{
+			if (entry->referenceCount++ == 0)
+				cache->statistics.referencedModuleCount++;
+
+			cache->statistics.hitCount++;
+			cache->statistics.savedTime += entry->createTime;
+
+			(*module) = entry->module;
+
+			vku_unlockMutex(&cache->mutex);
+
+			return VK_SUCCESS;
+		}
+	}
+
+
+	VkResult err = VK_SUCCESS;
+
+	if (cache->entryCount == cache->entryCapacity)
+	{
+		const uint32_t entryCapacity = cache->entryCapacity ? (cache->entryCapacity * 2) : 16;
+
+		vku_shader_entry **entriesByHash = (vku_shader_entry**) VKU_REALLOC(cache->entriesByHash, entryCapacity * sizeof(vku_shader_entry*));
+
+		if (entriesByHash)
+			cache->entriesByHash = entriesByHash;
+
+		vku_shader_entry **entriesByHandle = (vku_shader_entry**) VKU_REALLOC(cache->entriesByHandle, entryCapacity * sizeof(vku_shader_entry*));
+
+		if (entriesByHandle)
+			cache->entriesByHandle = entriesByHandle;
+
+		if (!entriesByHash || !entriesByHandle)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+		else
+			cache->entryCapacity = entryCapacity;
+	}
+
+	vku_shader_entry *entry = NULL;
+
+	if (!err)
+	{
+		entry = (vku_shader_entry*) VKU_CALLOC(1, sizeof(vku_shader_entry));
+
+		if (!entry)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	if (!err)
+	{
+		VkShaderModuleCreateInfo createInfo;
+		memset(&createInfo, 0, sizeof(createInfo));
+
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = codeSize;
+		createInfo.pCode = pCode;
+
+		const uint64_t createStart = vku_getTime();
+
+		err = vkCreateShaderModule(cache->device, &createInfo, cache->pAllocator, &entry->module);
+
+		entry->createTime = vku_getTime() - createStart;
+	}
+
+	if (err)
+	{
+		vku_unlockMutex(&cache->mutex);
+
+		VKU_FREE(entry);
+
+		return err;
+	}
+
+
+	entry->hash = hash;
+	entry->codeSize = codeSize;
+	entry->referenceCount = 1;
+
+	const uint32_t handleIndex = vku_lowerBoundShaderHandle(cache, entry->module);
+
+	memmove(cache->entriesByHash + hashIndex + 1, cache->entriesByHash + hashIndex, (cache->entryCount - hashIndex) * sizeof(vku_shader_entry*));
+	memmove(cache->entriesByHandle + handleIndex + 1, cache->entriesByHandle + handleIndex, (cache->entryCount - handleIndex) * sizeof(vku_shader_entry*));
+
+	cache->entriesByHash[hashIndex] = entry;
+	cache->entriesByHandle[handleIndex] = entry;
+	cache->entryCount++;
+
+	cache->statistics.moduleCount++;
+	cache->statistics.referencedModuleCount++;
+	cache->statistics.createTime += entry->createTime;
+
+	(*module) = entry->module;
+
+	vku_unlockMutex(&cache->mutex);
+
+	return VK_SUCCESS;
+}
+
+// The same as vkuAcquireShaderModule(), using the memory mapped SPIR-V file at path. Returns
+// VK_ERROR_INITIALIZATION_FAILED if the file doesn't exist or doesn't start with the SPIR-V magic number.
+VKUAPI_ATTR VkResult vkuLoadShaderModule(VkuShaderCache cache, const char *path, VkShaderModule *module)
+{
+	assert(cache);
+	assert(path);
+	assert(module);
+
+
+	const uint64_t loadStart = vku_getTime();
+
+	vku_mapped_file mappedFile;
+
+	if (!vku_mapFile(path, &mappedFile))
+		return VK_ERROR_INITIALIZATION_FAILED;
+
+	// The header is 5 words, where the first is the magic number
+	const uint32_t *pCode = (const uint32_t*) mappedFile.data;
+
+	if ((mappedFile.size < (5 * sizeof(uint32_t))) || (mappedFile.size % sizeof(uint32_t)) || (pCode[0] != 0x07230203u))
+	{
+		vku_unmapFile(&mappedFile);
+
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+
+	VkResult err = vkuAcquireShaderModule(cache, mappedFile.size, pCode, module);
+
+	vku_unmapFile(&mappedFile);
+
+
+	const uint64_t loadTime = vku_getTime() - loadStart;
+
+	vku_lockMutex(&cache->mutex);
+	cache->statistics.loadTime += loadTime;
+	vku_unlockMutex(&cache->mutex);
+
+	return err;
+}
+
+// Releases a reference. Unreferenced modules stay in the cache until vkuTrimShaderCache(),
+// such that releasing and acquiring the same module again doesn't recreate it.
+VKUAPI_ATTR void vkuReleaseShaderModule(VkuShaderCache cache, VkShaderModule module)
+{
+	assert(cache);
+
+	if (!module)
+		return;
+
+
+	vku_lockMutex(&cache->mutex);
+
+	const uint32_t handleIndex = vku_lowerBoundShaderHandle(cache, module);
+
+	assert(handleIndex < cache->entryCount);
+	assert(cache->entriesByHandle[handleIndex]->module == module);
+
+	vku_shader_entry *entry = cache->entriesByHandle[handleIndex];
+
+	assert(entry->referenceCount > 0);
+
+	if (--entry->referenceCount == 0)
+		cache->statistics.referencedModuleCount--;
+
+	vku_unlockMutex(&cache->mutex);
+}
+
+// Destroys the modules which aren't referenced
+VKUAPI_ATTR void vkuTrimShaderCache(VkuShaderCache cache)
+{
+	assert(cache);
+
+
+	vku_lockMutex(&cache->mutex);
+
+	uint32_t keptCount = 0;
+
+	for (uint32_t entryIndex = 0; entryIndex < cache->entryCount; entryIndex++)
+		if (cache->entriesByHandle[entryIndex]->referenceCount > 0)
+			cache->entriesByHandle[keptCount++] = cache->entriesByHandle[entryIndex];
+
+	keptCount = 0;
+
+	for (uint32_t entryIndex = 0; entryIndex < cache->entryCount; entryIndex++)
+	{
+		vku_shader_entry *entry = cache->entriesByHash[entryIndex];
+
+		if (entry->referenceCount > 0)
+		{
+			cache->entriesByHash[keptCount++] = entry;
+			continue;
+		}
+
+		vkDestroyShaderModule(cache->device, entry->module, cache->pAllocator);
+		VKU_FREE(entry);
+	}
+
+	cache->entryCount = keptCount;
+	cache->statistics.moduleCount = keptCount;
+
+	vku_unlockMutex(&cache->mutex);
+}
+
+
+VKUAPI_ATTR void vkuGetShaderCacheStatistics(VkuShaderCache cache, VkuShaderCacheStatistics *statistics)
+{
+	assert(cache);
+	assert(statistics);
+
+	vku_lockMutex(&cache->mutex);
+	(*statistics) = cache->statistics;
+	vku_unlockMutex(&cache->mutex);
+}
+
+
+
+// Builds a VkSpecializationInfo without allocating, e.g. for compute kernel variants:
+//     VkuSpecialization specialization;
+//     vkuInitSpecialization(&specialization);
+//     vkuSetSpecializationUint32(&specialization, 0, workgroupSize);
+//     vkuSetSpecializationBool32(&specialization, 1, VK_TRUE);
+//     stage.pSpecializationInfo = vkuGetSpecializationInfo(&specialization);
+
+#define VKU_MAX_SPECIALIZATION_CONSTANTS 16
+
+
+typedef struct VkuSpecialization
+{
+	VkSpecializationInfo info;
+
+	VkSpecializationMapEntry mapEntries[VKU_MAX_SPECIALIZATION_CONSTANTS];
+
+	// Each constant is at most 8 bytes
+	uint64_t data[VKU_MAX_SPECIALIZATION_CONSTANTS];
+} VkuSpecialization;
+
+
+VKUAPI_ATTR void vkuInitSpecialization(VkuSpecialization *specialization)
+{
+	assert(specialization);
+
+	memset(specialization, 0, sizeof(VkuSpecialization));
+}
+
+// Sets the constant, replacing its value if it's already set. Returns VK_ERROR_TOO_MANY_OBJECTS if all
+// VKU_MAX_SPECIALIZATION_CONSTANTS are set. The size must be 4 (32-bit scalars and VkBool32) or 8 (64-bit scalars).
+VKUAPI_ATTR VkResult vkuSetSpecializationConstant(VkuSpecialization *specialization, uint32_t constantID, const void *pData, size_t size)
+{
+	assert(specialization);
+	assert(pData);
+	assert((size == 4) || (size == 8));
+
+
+	uint32_t entryIndex = 0;
+
+	while ((entryIndex < specialization->info.mapEntryCount) && (specialization->mapEntries[entryIndex].constantID != constantID))
+		entryIndex++;
+
+	if (entryIndex >= VKU_MAX_SPECIALIZATION_CONSTANTS)
+		return VK_ERROR_TOO_MANY_OBJECTS;
+
+
+	// Each constant gets its own 8 byte slot, such that replacing a value never moves the others
+	VkSpecializationMapEntry *mapEntry = &specialization->mapEntries[entryIndex];
+
+	mapEntry->constantID = constantID;
+	mapEntry->offset = (uint32_t) (entryIndex * sizeof(uint64_t));
+	mapEntry->size = size;
+
+	specialization->data[entryIndex] = 0;
+	memcpy(&specialization->data[entryIndex], pData, size);
+
+	if (entryIndex == specialization->info.mapEntryCount)
+		specialization->info.mapEntryCount++;
+
+	return VK_SUCCESS;
+}
+
+VKUAPI_ATTR VkResult vkuSetSpecializationUint32(VkuSpecialization *specialization, uint32_t constantID, uint32_t value)
+{
+	return vkuSetSpecializationConstant(specialization, constantID, &value, sizeof(value));
+}
+
+VKUAPI_ATTR VkResult vkuSetSpecializationInt32(VkuSpecialization *specialization, uint32_t constantID, int32_t value)
+{
+	return vkuSetSpecializationConstant(specialization, constantID, &value, sizeof(value));
+}
+
+VKUAPI_ATTR VkResult vkuSetSpecializationFloat(VkuSpecialization *specialization, uint32_t constantID, float value)
+{
+	return vkuSetSpecializationConstant(specialization, constantID, &value, sizeof(value));
+}
+
+VKUAPI_ATTR VkResult vkuSetSpecializationBool32(VkuSpecialization *specialization, uint32_t constantID, VkBool32 value)
+{
+	return vkuSetSpecializationConstant(specialization, constantID, &value, sizeof(value));
+}
+
+// The pointers are set when called, so call it again if the VkuSpecialization is copied or moved
+VKUAPI_ATTR const VkSpecializationInfo* vkuGetSpecializationInfo(VkuSpecialization *specialization)
+{
+	assert(specialization);
+
+	specialization->info.pMapEntries = specialization->mapEntries;
+	specialization->info.dataSize = specialization->info.mapEntryCount * sizeof(uint64_t);
+	specialization->info.pData = specialization->data;
+
+	return &specialization->info;
+}
+
+// A hash of the constants and their values, e.g. for keying pipeline variants
+VKUAPI_ATTR uint64_t vkuHashSpecialization(const VkuSpecialization *specialization)
+{
+	assert(specialization);
+
+	uint64_t hash = 0;
+
+	for (uint32_t entryIndex = 0; entryIndex < specialization->info.mapEntryCount; entryIndex++)
+	{
+		const VkSpecializationMapEntry *mapEntry = &specialization->mapEntries[entryIndex];
+
+		// Order independent, such that setting the same constants in another order gives the same hash
+		uint64_t entryData[2] = { mapEntry->constantID, specialization->data[entryIndex] };
+
+		hash += vku_xxh64(entryData, sizeof(entryData), 0);
+	}
+
+	return hash;
+}
+
+
+// Streams large files to buffers on I/O threads: the files are memory mapped, copied a chunk at a time
+// straight into staging memory, and the chunks are submitted to a transfer queue, e.g. the transfer
+// queue of vkuGetQueueTopology(). Reading, copying and the GPU's copies of different chunks overlap.
+
+// The default size of each chunk, the default amount of chunks in flight, and the default amount of I/O threads
+#define VKU_DEFAULT_STREAM_CHUNK_SIZE (4ull * 1024ull * 1024ull)
+#define VKU_DEFAULT_STREAM_CHUNK_COUNT 8
+#define VKU_DEFAULT_STREAM_THREAD_COUNT 2
+
+
+typedef struct VkuStreamer_T* VkuStreamer;
+
+
+typedef struct VkuStreamerCreateInfo
+{
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	// The queue the copies are submitted to from the I/O threads, which must not be used elsewhere while streaming,
+	// e.g. the VKU_QUEUE_ROLE_TRANSFER queue when it's dedicated. If the queue family isn't the one the buffers are
+	// used on, then the buffers need VK_SHARING_MODE_CONCURRENT or a queue family ownership transfer.
+	uint32_t queueFamilyIndex;
+	VkQueue queue;
+
+	// If not NULL the staging memory is allocated from it,
+	// otherwise the streamer allocates its own VkDeviceMemory
+	VkuAllocator allocator;
+
+	// 0 means VKU_DEFAULT_STREAM_CHUNK_SIZE
+	VkDeviceSize chunkSize;
+
+	// The amount of chunks being copied or in flight, each has chunkSize bytes
+	// of staging memory. 0 means VKU_DEFAULT_STREAM_CHUNK_COUNT
+	uint32_t chunkCount;
+
+	// 0 means VKU_DEFAULT_STREAM_THREAD_COUNT
+	uint32_t threadCount;
+
+	// Used for vkCreateBuffer(), vkAllocateMemory() etc.
+	const VkAllocationCallbacks *pAllocator;
+} VkuStreamerCreateInfo;
+
+
+typedef struct VkuStreamerStatistics
+{
+	uint32_t threadCount;
+
+	uint64_t requestCount;
+	uint64_t chunkCount;
+
+	// The bytes submitted to the queue
+	VkDeviceSize streamedSize;
+
+	// The nanoseconds spent copying from the mapped files into the staging memory (which includes reading
+	// the files, as the pages are faulted in), summed across the I/O threads
+	uint64_t copyTime;
+
+	// The times an I/O thread had to wait for the GPU to finish copying a chunk before reusing its
+	// staging memory, and the total time waited in nanoseconds
+	uint64_t stallCount;
+	uint64_t stallTime;
+} VkuStreamerStatistics;
+
+
+typedef struct vku_stream_request
+{
+	vku_mapped_file mappedFile;
+
+	VkDeviceSize fileOffset;
+	VkDeviceSize size;
+
+	VkBuffer dstBuffer;
+	VkDeviceSize dstOffset;
+
+	// Signaled by the submission of the last chunk
+	VkSemaphore signalSemaphore;
+	VkFence fence;
+
+	// The next chunk to be copied, and the amount of submitted chunks
+	uint32_t chunkCount;
+	uint32_t nextChunkIndex;
+	uint32_t submittedChunkCount;
+
+	// The first error of its chunks, the semaphore and fence are signaled regardless
+	VkResult result;
+
+	struct vku_stream_request *pNext;
+} vku_stream_request;
+
+
+typedef enum vku_stream_slot_state
+{
+	VKU_STREAM_SLOT_STATE_IDLE,
+	VKU_STREAM_SLOT_STATE_COPYING,
+	VKU_STREAM_SLOT_STATE_SUBMITTED
+} vku_stream_slot_state;
+
+
+// The staging memory of a chunk, each has its own command pool, such that the I/O threads can record in parallel
+typedef struct vku_stream_slot
+{
+	VkCommandPool commandPool;
+	VkCommandBuffer commandBuffer;
+	VkFence fence;
+
+	vku_stream_slot_state state;
+
+	// The order of the submissions, the oldest submitted slot is reused first
+	uint64_t submitIndex;
+} vku_stream_slot;
+
+
+struct VkuStreamer_T
+{
+	VkDevice device;
+	VkQueue queue;
+	VkuAllocator allocator;
+	const VkAllocationCallbacks *pAllocator;
+
+	VkDeviceSize chunkSize;
+
+	// chunkSize bytes for each slot
+	VkBuffer buffer;
+	VkuAllocation allocation;
+	VkDeviceMemory memory;
+	char *pMappedData;
+
+	uint32_t slotCount;
+	vku_stream_slot *slots;
+
+	uint32_t threadCount;
+	vku_thread *threads;
+
+	// Guards everything below it, and the queue
+	vku_mutex mutex;
+
+	// Signaled when a request is queued and when a slot is submitted, and when the streamer may have become idle
+	vku_condition workCondition;
+	vku_condition idleCondition;
+
+	vku_stream_request *firstRequest;
+	vku_stream_request *lastRequest;
+
+	uint32_t copyingSlotCount;
+	uint64_t submitCount;
+
+	VkBool32 exiting;
+
+	// The first error since the last vkuWaitStreamerIdle()
+	VkResult result;
+
+	VkuStreamerStatistics statistics;
+};
+
+
+// Returns the idle slot, or the slot submitted the longest ago, or UINT32_MAX if all the slots are being copied to
+static uint32_t vku_findStreamSlot(VkuStreamer streamer)
+{
+	uint32_t foundSlotIndex = UINT32_MAX;
+
+	for (uint32_t slotIndex = 0; slotIndex < streamer->slotCount; slotIndex++)
+	{
+		const vku_stream_slot *slot = &streamer->slots[slotIndex];
+
+		if (slot->state == VKU_STREAM_SLOT_STATE_IDLE)
+			return slotIndex;
+
+		if ((slot->state == VKU_STREAM_SLOT_STATE_SUBMITTED) &&
+			((foundSlotIndex == UINT32_MAX) || (slot->submitIndex < streamer->slots[foundSlotIndex].submitIndex)))
+			foundSlotIndex = slotIndex;
+	}
+
+	return foundSlotIndex;
+}
+
+
+// Copies a chunk into the slot's staging memory and records the copy to the destination buffer
+static VkResult vku_copyStreamChunk(VkuStreamer streamer, uint32_t slotIndex, VkBool32 submitted, const vku_stream_request *request, uint32_t chunkIndex)
+{
+	vku_stream_slot *slot = &streamer->slots[slotIndex];
+
+	VkResult err = VK_SUCCESS;
+
+	// Wait for the GPU to finish copying the slot's previous chunk
+	if (submitted)
+	{
+		err = vkGetFenceStatus(streamer->device, slot->fence);
+
+		if (err == VK_NOT_READY)
+		{
+			const uint64_t stallStart = vku_getTime();
+
+			err = vkWaitForFences(streamer->device, 1, &slot->fence, VK_TRUE, UINT64_MAX);
+
+			const uint64_t stallTime = vku_getTime() - stallStart;
+
+			vku_lockMutex(&streamer->mutex);
+			streamer->statistics.stallCount++;
+			streamer->statistics.stallTime += stallTime;
+			vku_unlockMutex(&streamer->mutex);
+		}
+	}
+
+	if (!err)
+		err = vkResetFences(streamer->device, 1, &slot->fence);
+
+	if (err)
+		return err;
+
+
+	const VkDeviceSize chunkOffset = chunkIndex * streamer->chunkSize;
+	const VkDeviceSize chunkSize = ((request->size - chunkOffset) < streamer->chunkSize) ? (request->size - chunkOffset) : streamer->chunkSize;
+
+	const uint64_t copyStart = vku_getTime();
+
+	memcpy(streamer->pMappedData + slotIndex * streamer->chunkSize, (const char*) request->mappedFile.data + request->fileOffset + chunkOffset, (size_t) chunkSize);
+
+	const uint64_t copyTime = vku_getTime() - copyStart;
+
+
+	err = vkResetCommandPool(streamer->device, slot->commandPool, 0);
+
+	if (err)
+		return err;
+
+	VkCommandBufferBeginInfo beginInfo;
+	memset(&beginInfo, 0, sizeof(beginInfo));
+
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	err = vkBeginCommandBuffer(slot->commandBuffer, &beginInfo);
+
+	if (err)
+		return err;
+
+	VkBufferCopy region;
+	region.srcOffset = slotIndex * streamer->chunkSize;
+	region.dstOffset = request->dstOffset + chunkOffset;
+	region.size = chunkSize;
+
+	vkCmdCopyBuffer(slot->commandBuffer, streamer->buffer, request->dstBuffer, 1, &region);
+
+	err = vkEndCommandBuffer(slot->commandBuffer);
+
+
+	vku_lockMutex(&streamer->mutex);
+	streamer->statistics.copyTime += copyTime;
+	vku_unlockMutex(&streamer->mutex);
+
+	return err;
+}
+
+
+static void vku_streamerWorkerMain(void *pStreamer)
+{
+	VkuStreamer streamer = (VkuStreamer) pStreamer;
+
+	vku_lockMutex(&streamer->mutex);
+
+	for (;;)
+	{
+		uint32_t slotIndex = UINT32_MAX;
+
+		while (!streamer->exiting || streamer->firstRequest)
+		{
+			if (streamer->firstRequest)
+			{
+				slotIndex = vku_findStreamSlot(streamer);
+
+				if (slotIndex != UINT32_MAX)
+					break;
+			}
+
+			vku_waitCondition(&streamer->workCondition, &streamer->mutex);
+		}
+
+		// The queued requests are completed before exiting
+		if (slotIndex == UINT32_MAX)
+			break;
+
+
+		vku_stream_request *request = streamer->firstRequest;
+		const uint32_t chunkIndex = request->nextChunkIndex++;
+
+		if (request->nextChunkIndex == request->chunkCount)
+		{
+			streamer->firstRequest = request->pNext;
+
+			if (!streamer->firstRequest)
+				streamer->lastRequest = NULL;
+		}
+
+		vku_stream_slot *slot = &streamer->slots[slotIndex];
+
+		const VkBool32 submitted = (slot->state == VKU_STREAM_SLOT_STATE_SUBMITTED) ? VK_TRUE : VK_FALSE;
+
+		slot->state = VKU_STREAM_SLOT_STATE_COPYING;
+		streamer->copyingSlotCount++;
+
+		vku_unlockMutex(&streamer->mutex);
+
+
+		VkResult err = vku_copyStreamChunk(streamer, slotIndex, submitted, request, chunkIndex);
+
+
+		vku_lockMutex(&streamer->mutex);
+
+		// The chunks of a request are submitted in any order, but the semaphore and fence are signaled
+		// by the last submission, which covers the chunks submitted before it on the same queue
+		const VkBool32 lastChunk = ((request->submittedChunkCount + 1) == request->chunkCount) ? VK_TRUE : VK_FALSE;
+
+		slot->state = VKU_STREAM_SLOT_STATE_IDLE;
+
+		if (!err)
+		{
+			VkSubmitInfo submitInfo;
+			memset(&submitInfo, 0, sizeof(submitInfo));
+
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &slot->commandBuffer;
+
+			if (lastChunk && (request->signalSemaphore != VK_NULL_HANDLE))
+			{
+				submitInfo.signalSemaphoreCount = 1;
+				submitInfo.pSignalSemaphores = &request->signalSemaphore;
+			}
+
+			err = vkQueueSubmit(streamer->queue, 1, &submitInfo, slot->fence);
+
+			if (!err)
+			{
+				slot->state = VKU_STREAM_SLOT_STATE_SUBMITTED;
+				slot->submitIndex = streamer->submitCount++;
+
+				streamer->statistics.chunkCount++;
+				streamer->statistics.streamedSize += ((request->size - chunkIndex * streamer->chunkSize) < streamer->chunkSize) ?
+					(request->size - chunkIndex * streamer->chunkSize) : streamer->chunkSize;
+			}
+		}
+
+		// Otherwise the semaphore wasn't signaled by the chunk
+		const VkBool32 chunkSubmitted = err ? VK_FALSE : VK_TRUE;
+
+		if (err && (request->result == VK_SUCCESS))
+			request->result = err;
+
+		// An empty submission signals the fence (and the semaphore if the last chunk failed) once everything
+		// submitted before it has completed. It's done even if a chunk failed, such that nothing waits forever
+		// on the request, and the error is returned by vkuWaitStreamerIdle() instead
+		if (lastChunk)
+		{
+			VkSubmitInfo submitInfo;
+			memset(&submitInfo, 0, sizeof(submitInfo));
+
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+			if (!chunkSubmitted && (request->signalSemaphore != VK_NULL_HANDLE))
+			{
+				submitInfo.signalSemaphoreCount = 1;
+				submitInfo.pSignalSemaphores = &request->signalSemaphore;
+			}
+
+			if ((submitInfo.signalSemaphoreCount > 0) || (request->fence != VK_NULL_HANDLE))
+			{
+				err = vkQueueSubmit(streamer->queue, submitInfo.signalSemaphoreCount, &submitInfo, request->fence);
+
+				if (err && (request->result == VK_SUCCESS))
+					request->result = err;
+			}
+		}
+
+		if (request->result && (streamer->result == VK_SUCCESS))
+			streamer->result = request->result;
+
+		request->submittedChunkCount++;
+		streamer->copyingSlotCount--;
+
+		vku_broadcastCondition(&streamer->workCondition);
+		vku_broadcastCondition(&streamer->idleCondition);
+
+
+		// All the chunks have been copied out of the file
+		if (lastChunk)
+		{
+			vku_unlockMutex(&streamer->mutex);
+
+			vku_unmapFile(&request->mappedFile);
+			VKU_FREE(request);
+
+			vku_lockMutex(&streamer->mutex);
+		}
+	}
+
+	vku_unlockMutex(&streamer->mutex);
+}
+
+
+VKUAPI_ATTR void vkuDestroyStreamer(VkuStreamer streamer);
+
+VKUAPI_ATTR VkResult vkuCreateStreamer(const VkuStreamerCreateInfo *createInfo, VkuStreamer *streamer)
+{
+	assert(createInfo);
+	assert(createInfo->physicalDevice);
+	assert(createInfo->device);
+	assert(createInfo->queue);
+	assert(streamer);
+
+
+	(*streamer) = (VkuStreamer) VKU_CALLOC(1, sizeof(struct VkuStreamer_T));
+
+	if (!(*streamer))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+
+	VkDeviceSize chunkSize = createInfo->chunkSize ? createInfo->chunkSize : VKU_DEFAULT_STREAM_CHUNK_SIZE;
+	chunkSize = (chunkSize + VKU_UPLOAD_RING_ALIGNMENT - 1) & ~(VKU_UPLOAD_RING_ALIGNMENT - 1);
+
+	(*streamer)->device = createInfo->device;
+	(*streamer)->queue = createInfo->queue;
+	(*streamer)->allocator = createInfo->allocator;
+	(*streamer)->pAllocator = createInfo->pAllocator;
+
+	(*streamer)->chunkSize = chunkSize;
+	(*streamer)->slotCount = createInfo->chunkCount ? createInfo->chunkCount : VKU_DEFAULT_STREAM_CHUNK_COUNT;
+
+	vku_initMutex(&(*streamer)->mutex);
+	vku_initCondition(&(*streamer)->workCondition);
+	vku_initCondition(&(*streamer)->idleCondition);
+
+
+	VkBufferCreateInfo bufferCreateInfo;
+	memset(&bufferCreateInfo, 0, sizeof(bufferCreateInfo));
+
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = chunkSize * (*streamer)->slotCount;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	uint32_t actualLayerCount = enabledLayerCount;
+	VkResult err = vkCreateBuffer(createInfo->device, &bufferCreateInfo, createInfo->pAllocator, &(*streamer)->buffer);
 
 
-	if (enableValidation)
+	// Host coherent memory, such that the writes never have to be flushed
+	const VkMemoryPropertyFlags requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	if (!err && createInfo->allocator)
 	{
-		// Validation is enabled, so just add all the layers
+		VkuAllocationCreateInfo allocationCreateInfo;
+		memset(&allocationCreateInfo, 0, sizeof(allocationCreateInfo));
 
-		enabledLayerNames = vkuGetDeviceLayerNames(physicalDevice, &enabledLayerCount);
-		actualLayerCount = enabledLayerCount;
+		allocationCreateInfo.requiredFlags = requiredFlags;
+		allocationCreateInfo.linear = VK_TRUE;
+		allocationCreateInfo.dedicated = VK_TRUE;
+
+		err = vkuAllocateBufferMemory(createInfo->allocator, (*streamer)->buffer, &allocationCreateInfo, &(*streamer)->allocation);
+
+		if (!err)
+			(*streamer)->pMappedData = (char*) (*streamer)->allocation->pMappedData;
 	}
-	else
+	else if (!err)
 	{
-		// Validation is not enabled, so remove the VK_EXT_debug_report extension
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(createInfo->physicalDevice, &memoryProperties);
 
-		for (uint32_t enabledExtensionIndex = 0; enabledExtensionIndex < actualExtensionCount; enabledExtensionIndex++)
+		VkMemoryRequirements memoryRequirements;
+		vkGetBufferMemoryRequirements(createInfo->device, (*streamer)->buffer, &memoryRequirements);
+
+		VkMemoryAllocateInfo allocateInfo;
+		memset(&allocateInfo, 0, sizeof(allocateInfo));
+
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = memoryRequirements.size;
+
+		err = vkuFindMemoryTypeIndex(&memoryProperties, memoryRequirements.memoryTypeBits, requiredFlags, 0, &allocateInfo.memoryTypeIndex);
+
+		if (!err)
+			err = vkAllocateMemory(createInfo->device, &allocateInfo, createInfo->pAllocator, &(*streamer)->memory);
+
+		if (!err)
+			err = vkBindBufferMemory(createInfo->device, (*streamer)->buffer, (*streamer)->memory, 0);
+
+		if (!err)
+			err = vkMapMemory(createInfo->device, (*streamer)->memory, 0, VK_WHOLE_SIZE, 0, (void**) &(*streamer)->pMappedData);
+	}
+
+
+	if (!err)
+	{
+		(*streamer)->slots = (vku_stream_slot*) VKU_CALLOC((*streamer)->slotCount, sizeof(vku_stream_slot));
+
+		if (!(*streamer)->slots)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo;
+	memset(&commandPoolCreateInfo, 0, sizeof(commandPoolCreateInfo));
+
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = createInfo->queueFamilyIndex;
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+	memset(&commandBufferAllocateInfo, 0, sizeof(commandBufferAllocateInfo));
+
+	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferAllocateInfo.commandBufferCount = 1;
+
+	VkFenceCreateInfo fenceCreateInfo;
+	memset(&fenceCreateInfo, 0, sizeof(fenceCreateInfo));
+
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	for (uint32_t slotIndex = 0; !err && (slotIndex < (*streamer)->slotCount); slotIndex++)
+	{
+		vku_stream_slot *slot = &(*streamer)->slots[slotIndex];
+
+		err = vkCreateCommandPool(createInfo->device, &commandPoolCreateInfo, createInfo->pAllocator, &slot->commandPool);
+
+		if (!err)
 		{
-			char *enabledExtensionName = enabledExtensionNames[enabledExtensionIndex];
+			commandBufferAllocateInfo.commandPool = slot->commandPool;
 
-			if (!vku_strcmp(enabledExtensionName, VK_EXT_DEBUG_REPORT_EXTENSION_NAME))
-			{
-				// If it's the last extension name, just decrement enabledExtensionCount
-				if (enabledExtensionIndex == (actualExtensionCount - 1))
-				{
-					enabledExtensionCount--;
-				}
-				else // If not, swap with the last extension name
-				{
-					enabledExtensionNames[enabledExtensionIndex] = enabledExtensionNames[actualExtensionCount - 1];
-					enabledExtensionNames[actualExtensionCount - 1] = enabledExtensionName;
+			err = vkAllocateCommandBuffers(createInfo->device, &commandBufferAllocateInfo, &slot->commandBuffer);
+		}
 
-					// The first if will be called in the end, decrementing the enabledExtensionCount
-				}
-			}
+		if (!err)
+			err = vkCreateFence(createInfo->device, &fenceCreateInfo, createInfo->pAllocator, &slot->fence);
+	}
+
+
+	const uint32_t threadCount = createInfo->threadCount ? createInfo->threadCount : VKU_DEFAULT_STREAM_THREAD_COUNT;
+
+	if (!err)
+	{
+		(*streamer)->threads = (vku_thread*) VKU_CALLOC(threadCount, sizeof(vku_thread));
+
+		if (!(*streamer)->threads)
+			err = VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	for (uint32_t threadIndex = 0; !err && (threadIndex < threadCount); threadIndex++)
+	{
+		if (!vku_createThread(&(*streamer)->threads[threadIndex], vku_streamerWorkerMain, *streamer))
+			err = VK_ERROR_INITIALIZATION_FAILED;
+		else
+			(*streamer)->threadCount++;
+	}
+
+	(*streamer)->statistics.threadCount = (*streamer)->threadCount;
+
+
+	if (err)
+	{
+		vkuDestroyStreamer(*streamer);
+		(*streamer) = NULL;
+
+		return err;
+	}
+
+	return VK_SUCCESS;
+}
+
+// Completes the queued requests, and waits for the submitted chunks
+VKUAPI_ATTR void vkuDestroyStreamer(VkuStreamer streamer)
+{
+	if (!streamer)
+		return;
+
+
+	vku_lockMutex(&streamer->mutex);
+	streamer->exiting = VK_TRUE;
+	vku_broadcastCondition(&streamer->workCondition);
+	vku_unlockMutex(&streamer->mutex);
+
+	for (uint32_t threadIndex = 0; threadIndex < streamer->threadCount; threadIndex++)
+		vku_joinThread(&streamer->threads[threadIndex]);
+
+
+	// Without threads no requests could have been queued
+	if (streamer->slots)
+	{
+		for (uint32_t slotIndex = 0; slotIndex < streamer->slotCount; slotIndex++)
+		{
+			vku_stream_slot *slot = &streamer->slots[slotIndex];
+
+			if (slot->state == VKU_STREAM_SLOT_STATE_SUBMITTED)
+				vkWaitForFences(streamer->device, 1, &slot->fence, VK_TRUE, UINT64_MAX);
+
+			if (slot->fence != VK_NULL_HANDLE)
+				vkDestroyFence(streamer->device, slot->fence, streamer->pAllocator);
+
+			// Destroying the pool frees the command buffer
+			if (slot->commandPool != VK_NULL_HANDLE)
+				vkDestroyCommandPool(streamer->device, slot->commandPool, streamer->pAllocator);
 		}
 	}
 
 
-	VkResult err = vkuCreateDevice(enabledExtensionCount, enabledExtensionNames, enabledLayerCount, enabledLayerNames, pAllocator, physicalDevice, queueFamilyIndex, device);
+	if (streamer->buffer != VK_NULL_HANDLE)
+		vkDestroyBuffer(streamer->device, streamer->buffer, streamer->pAllocator);
 
+	// Freeing implicitly unmaps the memory
+	if (streamer->allocation)
+		vkuFreeMemory(streamer->allocator, streamer->allocation);
+	else if (streamer->memory != VK_NULL_HANDLE)
+		vkFreeMemory(streamer->device, streamer->memory, streamer->pAllocator);
 
-	// Remember to delete it by the actualExtensionCount and not the enabledExtensionCount
-	vkuDeleteInstanceExtensionNames(actualExtensionCount, enabledExtensionNames);
-	// enabledExtensionNames = NULL;
 
-	// Remember to delete it by the actualLayerCount and not the enabledLayerCount
-	vkuDeleteInstanceLayerNames(actualLayerCount, enabledLayerNames);
-	// enabledLayerNames = NULL;
+	vku_destroyCondition(&streamer->idleCondition);
+	vku_destroyCondition(&streamer->workCondition);
+	vku_destroyMutex(&streamer->mutex);
+
+	VKU_FREE(streamer->threads);
+	VKU_FREE(streamer->slots);
+	VKU_FREE(streamer);
+}
+
+
+// Queues streaming size bytes (0 means up to the end of the file) at fileOffset of the file at path,
+// to dstBuffer at dstOffset, and returns without waiting. When all of it has been copied by the
+// queue, then signalSemaphore and fence are signaled, both are optional. They are signaled even
+// if copying a chunk failed, in which case vkuWaitStreamerIdle() returns the error. Returns
+// VK_ERROR_INITIALIZATION_FAILED if the file can't be mapped or is smaller than the range.
+// The streamer is internally synchronized.
+VKUAPI_ATTR VkResult vkuStreamFile(VkuStreamer streamer, const char *path, VkDeviceSize fileOffset, VkDeviceSize size,
+	VkBuffer dstBuffer, VkDeviceSize dstOffset, VkSemaphore signalSemaphore, VkFence fence)
+{
+	assert(streamer);
+	assert(path);
+	assert(dstBuffer);
+
+
+	vku_stream_request *request = (vku_stream_request*) VKU_CALLOC(1, sizeof(vku_stream_request));
+
+	if (!request)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	if (!vku_mapFile(path, &request->mappedFile))
+	{
+		VKU_FREE(request);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+	if (size == 0)
+		size = (fileOffset < request->mappedFile.size) ? (request->mappedFile.size - fileOffset) : 0;
+
+	if ((size == 0) || (fileOffset > request->mappedFile.size) || (size > (request->mappedFile.size - fileOffset)))
+	{
+		vku_unmapFile(&request->mappedFile);
+		VKU_FREE(request);
+
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+#if !defined(_WIN32) && defined(POSIX_MADV_SEQUENTIAL)
+	// Read ahead more aggressively, as the chunks are copied mostly in order
+	posix_madvise((void*) request->mappedFile.data, request->mappedFile.size, POSIX_MADV_SEQUENTIAL);
+#endif
+
+
+	request->fileOffset = fileOffset;
+	request->size = size;
+	request->dstBuffer = dstBuffer;
+	request->dstOffset = dstOffset;
+	request->signalSemaphore = signalSemaphore;
+	request->fence = fence;
+	request->chunkCount = (uint32_t) ((size + streamer->chunkSize - 1) / streamer->chunkSize);
+
+
+	vku_lockMutex(&streamer->mutex);
+
+	if (streamer->lastRequest)
+		streamer->lastRequest->pNext = request;
+	else
+		streamer->firstRequest = request;
+
+	streamer->lastRequest = request;
+
+	streamer->statistics.requestCount++;
+
+	vku_broadcastCondition(&streamer->workCondition);
+	vku_unlockMutex(&streamer->mutex);
+
+	return VK_SUCCESS;
+}
+
+// Waits until all the queued requests have been copied by the queue, and returns the first error
+// (e.g. VK_ERROR_DEVICE_LOST) that occurred since the last call, if any
+VKUAPI_ATTR VkResult vkuWaitStreamerIdle(VkuStreamer streamer)
+{
+	assert(streamer);
+
+
+	vku_lockMutex(&streamer->mutex);
+
+	while (streamer->firstRequest || (streamer->copyingSlotCount > 0))
+		vku_waitCondition(&streamer->idleCondition, &streamer->mutex);
+
+	VkResult err = VK_SUCCESS;
+
+	for (uint32_t slotIndex = 0; slotIndex < streamer->slotCount; slotIndex++)
+	{
+		vku_stream_slot *slot = &streamer->slots[slotIndex];
+
+		if (slot->state != VKU_STREAM_SLOT_STATE_SUBMITTED)
+			continue;
+
+		if (!err)
+			err = vkWaitForFences(streamer->device, 1, &slot->fence, VK_TRUE, UINT64_MAX);
+
+		// The fence is reset before the slot is reused
+		if (!err)
+			slot->state = VKU_STREAM_SLOT_STATE_IDLE;
+	}
+
+	if (streamer->result != VK_SUCCESS)
+		err = streamer->result;
 
+	streamer->result = VK_SUCCESS;
+
+	vku_unlockMutex(&streamer->mutex);
 
 	return err;
 }
 
 
+VKUAPI_ATTR void vkuGetStreamerStatistics(VkuStreamer streamer, VkuStreamerStatistics *statistics)
+{
+	assert(streamer);
+	assert(statistics);
+
+	vku_lockMutex(&streamer->mutex);
+	(*statistics) = streamer->statistics;
+	vku_unlockMutex(&streamer->mutex);
+}
+
+
+// Snapshots of the budget and usage of each memory heap, using VK_EXT_memory_budget if the device has it,
+// and otherwise estimating them from the allocations of a VkuAllocator. Crossing the thresholds calls a
+// callback, such that caches can be evicted before allocations start failing with VK_ERROR_OUT_OF_DEVICE_MEMORY.
+
+#define VKU_MAX_MEMORY_THRESHOLDS 8
+
+// Without VK_EXT_memory_budget the budget is this percentage of the heap's size,
+// as the rest of the heap is usually taken by other processes and the driver
+#define VKU_ESTIMATED_BUDGET_PERCENTAGE 80
+
+
+typedef struct VkuMemoryTelemetry_T* VkuMemoryTelemetry;
+
+
+typedef struct VkuHeapBudget
+{
+	VkDeviceSize size;
+	VkMemoryHeapFlags flags;
+
+	// The amount of the heap the process can use, and the amount it uses
+	VkDeviceSize budget;
+	VkDeviceSize usage;
+
+	// The highest usage of all the snapshots
+	VkDeviceSize peakUsage;
+
+	// The size of the VkDeviceMemory allocated by the VkuAllocator, 0 without one
+	VkDeviceSize allocatedSize;
+} VkuHeapBudget;
+
+
+typedef struct VkuMemorySnapshot
+{
+	// VK_TRUE if the budget and usage come from VK_EXT_memory_budget, VK_FALSE if they're estimated
+	VkBool32 memoryBudget;
+
+	// The vku_getTime() of the snapshot in nanoseconds, and the amount of snapshots taken
+	uint64_t time;
+	uint64_t snapshotCount;
+
+	uint32_t memoryHeapCount;
+	VkuHeapBudget heaps[VK_MAX_MEMORY_HEAPS];
+} VkuMemorySnapshot;
+
+
+// Called by vkuUpdateMemoryTelemetry() when a heap's usage crosses a threshold, with exceeded VK_TRUE if it rose
+// above (threshold * budget) and VK_FALSE if it fell below it. Crossing several thresholds at once calls it for each.
+typedef void (VKAPI_PTR *PFN_vkuMemoryThreshold)(void *pUserData, uint32_t heapIndex, float threshold, VkBool32 exceeded, const VkuHeapBudget *heap);
+
+
+typedef struct VkuMemoryTelemetryCreateInfo
+{
+	VkInstance instance;
+	VkPhysicalDevice physicalDevice;
+
+	// VK_TRUE if the device was created with VK_EXT_memory_budget, which is checked with vkuIsDeviceExtensionSupported(),
+	// and the instance is Vulkan 1.1 or has VK_KHR_get_physical_device_properties2. Otherwise the usage is estimated
+	// from the allocator, which can be given either way.
+	VkBool32 memoryBudget;
+	VkuAllocator allocator;
+
+	// The minimum nanoseconds between snapshots, vkuUpdateMemoryTelemetry() does nothing until they have passed
+	uint64_t updateInterval;
+
+	// Ascending fractions of the budget, e.g. 0.75 and 0.9
+	uint32_t thresholdCount;
+	const float *pThresholds;
+
+	PFN_vkuMemoryThreshold pfnThreshold;
+	void *pUserData;
+} VkuMemoryTelemetryCreateInfo;
+
+
+struct VkuMemoryTelemetry_T
+{
+	VkPhysicalDevice physicalDevice;
+	VkuAllocator allocator;
+
+#ifdef VK_EXT_memory_budget
+	PFN_vkGetPhysicalDeviceMemoryProperties2 pfnGetPhysicalDeviceMemoryProperties2;
+#endif
+
+	uint64_t updateInterval;
+
+	uint32_t thresholdCount;
+	float thresholds[VKU_MAX_MEMORY_THRESHOLDS];
+
+	PFN_vkuMemoryThreshold pfnThreshold;
+	void *pUserData;
+
+	// For each heap the amount of thresholds its usage is above
+	uint32_t thresholdLevels[VK_MAX_MEMORY_HEAPS];
+
+	VkuMemorySnapshot snapshot;
+};
+
+
+VKUAPI_ATTR VkBool32 vkuUpdateMemoryTelemetry(VkuMemoryTelemetry telemetry);
+
+VKUAPI_ATTR VkResult vkuCreateMemoryTelemetry(const VkuMemoryTelemetryCreateInfo *createInfo, VkuMemoryTelemetry *telemetry)
+{
+	assert(createInfo);
+	assert(createInfo->physicalDevice);
+	assert(createInfo->thresholdCount <= VKU_MAX_MEMORY_THRESHOLDS);
+	assert(!createInfo->thresholdCount || createInfo->pThresholds);
+	assert(telemetry);
+
+
+	(*telemetry) = (VkuMemoryTelemetry) VKU_CALLOC(1, sizeof(struct VkuMemoryTelemetry_T));
+
+	if (!(*telemetry))
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	(*telemetry)->physicalDevice = createInfo->physicalDevice;
+	(*telemetry)->allocator = createInfo->allocator;
+	(*telemetry)->updateInterval = createInfo->updateInterval;
+
+	(*telemetry)->thresholdCount = createInfo->thresholdCount;
+	(*telemetry)->pfnThreshold = createInfo->pfnThreshold;
+	(*telemetry)->pUserData = createInfo->pUserData;
+
+	for (uint32_t thresholdIndex = 0; thresholdIndex < createInfo->thresholdCount; thresholdIndex++)
+	{
+		assert(!thresholdIndex || (createInfo->pThresholds[thresholdIndex - 1] < createInfo->pThresholds[thresholdIndex]));
+
+		(*telemetry)->thresholds[thresholdIndex] = createInfo->pThresholds[thresholdIndex];
+	}
+
+
+#ifdef VK_EXT_memory_budget
+	if (createInfo->memoryBudget && vkuIsDeviceExtensionSupported(createInfo->physicalDevice, NULL, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+	{
+		assert(createInfo->instance);
+
+		(*telemetry)->pfnGetPhysicalDeviceMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2)
+			vkGetInstanceProcAddr(createInfo->instance, "vkGetPhysicalDeviceMemoryProperties2");
+
+		if (!(*telemetry)->pfnGetPhysicalDeviceMemoryProperties2)
+			(*telemetry)->pfnGetPhysicalDeviceMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2)
+				vkGetInstanceProcAddr(createInfo->instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+	}
+#endif
+
+
+	// The first snapshot is taken right away, without calling the callback for the thresholds already exceeded
+	const PFN_vkuMemoryThreshold pfnThreshold = (*telemetry)->pfnThreshold;
+
+	(*telemetry)->pfnThreshold = NULL;
+	vkuUpdateMemoryTelemetry(*telemetry);
+	(*telemetry)->pfnThreshold = pfnThreshold;
+
+	return VK_SUCCESS;
+}
+
+VKUAPI_ATTR void vkuDestroyMemoryTelemetry(VkuMemoryTelemetry telemetry)
+{
+	VKU_FREE(telemetry);
+}
+
+
+// Takes a snapshot if updateInterval has passed since the last one, e.g. call it once per frame, and returns VK_TRUE
+// if it did. The thresholds are checked against the snapshot, and the callback is called before returning.
+// The telemetry is externally synchronized, as is the allocator.
+VKUAPI_ATTR VkBool32 vkuUpdateMemoryTelemetry(VkuMemoryTelemetry telemetry)
+{
+	assert(telemetry);
+
+
+	const uint64_t time = vku_getTime();
+
+	if ((telemetry->snapshot.snapshotCount > 0) && ((time - telemetry->snapshot.time) < telemetry->updateInterval))
+		return VK_FALSE;
+
+
+	VkuMemorySnapshot *snapshot = &telemetry->snapshot;
+
+	snapshot->time = time;
+	snapshot->snapshotCount++;
+	snapshot->memoryBudget = VK_FALSE;
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+
+#ifdef VK_EXT_memory_budget
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties;
+
+	if (telemetry->pfnGetPhysicalDeviceMemoryProperties2)
+	{
+		memset(&budgetProperties, 0, sizeof(budgetProperties));
+
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+		VkPhysicalDeviceMemoryProperties2 memoryProperties2;
+		memset(&memoryProperties2, 0, sizeof(memoryProperties2));
+
+		memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		memoryProperties2.pNext = &budgetProperties;
+
+		telemetry->pfnGetPhysicalDeviceMemoryProperties2(telemetry->physicalDevice, &memoryProperties2);
+
+		memoryProperties = memoryProperties2.memoryProperties;
+		snapshot->memoryBudget = VK_TRUE;
+	}
+	else
+#endif
+		vku_getPhysicalDeviceMemoryProperties(telemetry->physicalDevice, &memoryProperties);
+
+	VkuAllocatorStatistics allocatorStatistics;
+
+	if (telemetry->allocator)
+		vkuGetAllocatorStatistics(telemetry->allocator, &allocatorStatistics);
+	else
+		memset(&allocatorStatistics, 0, sizeof(allocatorStatistics));
+
+
+	snapshot->memoryHeapCount = memoryProperties.memoryHeapCount;
+
+	for (uint32_t heapIndex = 0; heapIndex < memoryProperties.memoryHeapCount; heapIndex++)
+	{
+		VkuHeapBudget *heap = &snapshot->heaps[heapIndex];
+
+		heap->size = memoryProperties.memoryHeaps[heapIndex].size;
+		heap->flags = memoryProperties.memoryHeaps[heapIndex].flags;
+		heap->allocatedSize = allocatorStatistics.heaps[heapIndex].allocatedSize;
+
+#ifdef VK_EXT_memory_budget
+		if (snapshot->memoryBudget)
+		{
+			heap->budget = budgetProperties.heapBudget[heapIndex];
+			heap->usage = budgetProperties.heapUsage[heapIndex];
+		}
+		else
+#endif
+		{
+			heap->budget = heap->size / 100 * VKU_ESTIMATED_BUDGET_PERCENTAGE;
+			heap->usage = heap->allocatedSize;
+		}
+
+		if (heap->usage > heap->peakUsage)
+			heap->peakUsage = heap->usage;
+
+
+		uint32_t thresholdLevel = 0;
+
+		while ((thresholdLevel < telemetry->thresholdCount) && ((double) heap->usage >= (double) heap->budget * telemetry->thresholds[thresholdLevel]))
+			thresholdLevel++;
+
+		const uint32_t previousThresholdLevel = telemetry->thresholdLevels[heapIndex];
+
+		telemetry->thresholdLevels[heapIndex] = thresholdLevel;
+
+		if (!telemetry->pfnThreshold)
+			continue;
+
+		for (uint32_t thresholdIndex = previousThresholdLevel; thresholdIndex < thresholdLevel; thresholdIndex++)
+			telemetry->pfnThreshold(telemetry->pUserData, heapIndex, telemetry->thresholds[thresholdIndex], VK_TRUE, heap);
+
+		for (uint32_t thresholdIndex = previousThresholdLevel; thresholdIndex > thresholdLevel; thresholdIndex--)
+			telemetry->pfnThreshold(telemetry->pUserData, heapIndex, telemetry->thresholds[thresholdIndex - 1], VK_FALSE, heap);
+	}
+
+	return VK_TRUE;
+}
+
+// Gets the latest snapshot, without taking a new one
+VKUAPI_ATTR void vkuGetMemorySnapshot(VkuMemoryTelemetry telemetry, VkuMemorySnapshot *snapshot)
+{
+	assert(telemetry);
+	assert(snapshot);
+
+	(*snapshot) = telemetry->snapshot;
+}
+
+// Restarts the high-water marks at the usage of the latest snapshot
+VKUAPI_ATTR void vkuResetMemoryPeaks(VkuMemoryTelemetry telemetry)
+{
+	assert(telemetry);
+
+	for (uint32_t heapIndex = 0; heapIndex < telemetry->snapshot.memoryHeapCount; heapIndex++)
+		telemetry->snapshot.heaps[heapIndex].peakUsage = telemetry->snapshot.heaps[heapIndex].usage;
+}
+
+
 
 // #if defined(VK_USE_PLATFORM_WIN32_KHR)
 // #elif defined(VK_USE_PLATFORM_XCB_KHR)